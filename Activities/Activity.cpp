@@ -11,10 +11,14 @@
 #include "Activity.h"
 #include "ActivityAttribute.h"
 #include "AxisName.h"
+#include "Defines.h"
+#include "TrainingStressCalculator.h"
 #include "UnitMgr.h"
 
 Activity::Activity()
 {
+	AttributeHandlers(); // interns our attribute names before the first query
+
 	SegmentType nullSegment = { 0, 0, 0 };
 
 	m_additionalWeightKg = (double)0.0;
@@ -124,6 +128,17 @@ uint8_t Activity::HeartRateZone() const
 	return 5;
 }
 
+double Activity::TrainingStress() const
+{
+	if (m_numHeartRateReadings == 0)
+	{
+		return (double)0.0;
+	}
+
+	TrainingStressCalculator calc;
+	return calc.EstimateFromHeartRate(ElapsedTimeInSeconds(), AverageHeartRate(), m_athlete.EstimateRestingHeartRate(), m_athlete.EstimateMaxHeartRate(), m_athlete.GetGender());
+}
+
 bool Activity::ProcessSensorReading(const SensorReading& reading)
 {
 	if (reading.reading.size() == 0)
@@ -237,167 +252,239 @@ bool Activity::ProcessFootPodReading(const SensorReading& reading)
 	return true;
 }
 
+const ActivityAttributeHandlerTable<Activity>& Activity::AttributeHandlers()
+{
+	static const ActivityAttributeHandlerTable<Activity> handlers = BuildAttributeHandlers();
+	return handlers;
+}
+
+ActivityAttributeHandlerTable<Activity> Activity::BuildAttributeHandlers()
+{
+	ActivityAttributeHandlerTable<Activity> handlers;
+
+	handlers.Register(ACTIVITY_ATTRIBUTE_START_TIME, &Activity::QueryStartTimeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_END_TIME, &Activity::QueryEndTimeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_HEART_RATE, &Activity::QueryHeartRateAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_AVG_HEART_RATE, &Activity::QueryAvgHeartRateAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_MAX_HEART_RATE, &Activity::QueryMaxHeartRateAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_HEART_RATE_PERCENTAGE, &Activity::QueryHeartRatePercentageAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_HEART_RATE_ZONE, &Activity::QueryHeartRateZoneAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_ELAPSED_TIME, &Activity::QueryElapsedTimeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_CALORIES_BURNED, &Activity::QueryCaloriesBurnedAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_TRAINING_STRESS, &Activity::QueryTrainingStressAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_X, &Activity::QueryXAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_Y, &Activity::QueryYAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_Z, &Activity::QueryZAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_ADDITIONAL_WEIGHT, &Activity::QueryAdditionalWeightAttribute);
+	return handlers;
+}
+
 ActivityAttributeType Activity::QueryActivityAttribute(const std::string& attributeName) const
 {
 	ActivityAttributeType result;
+	ActivityAttributeId attributeId = ActivityAttributeRegistry::Lookup(attributeName);
 
-	result.startTime = 0;
-	result.endTime = 0;
-	result.unitSystem = UnitMgr::GetUnitSystem();
-
-	if (attributeName.compare(ACTIVITY_ATTRIBUTE_START_TIME) == 0)
+	// Names that were never interned (split times, lap times, etc.) are parsed by the subclasses.
+	if (attributeId != ACTIVITY_ATTRIBUTE_ID_NOT_FOUND)
 	{
-		result.value.intVal = m_startTimeSecs;
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_TIME;
-		result.startTime = m_startTimeSecs;
-		result.endTime = 0;
-		result.valid = m_startTimeSecs > 0;
+		result = QueryActivityAttributeById(attributeId);
 	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_END_TIME) == 0)
+	else
 	{
-		result.value.intVal = m_endTimeSecs;
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_TIME;
-		result.startTime = m_startTimeSecs;
-		result.endTime = m_endTimeSecs;
-		result.valid = m_endTimeSecs > 0;
+		result = QueryNamedActivityAttribute(attributeName);
 	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_HEART_RATE) == 0)
-	{
-		uint64_t timeSinceLastUpdate = 0;
-		if (!HasStopped())
-			timeSinceLastUpdate = CurrentTimeInMs() - m_lastHeartRateUpdateTime;
+	return result;
+}
 
-		SegmentType hr = CurrentHeartRate();
-		result.value.doubleVal = hr.value.doubleVal;
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_BPM;
-		result.startTime = hr.startTime;
-		result.endTime = hr.endTime;
-		result.valid = (m_numHeartRateReadings > 0) && (timeSinceLastUpdate < 3000);
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_AVG_HEART_RATE) == 0)
-	{
-		result.value.doubleVal = AverageHeartRate();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_BPM;
-		result.valid = m_numHeartRateReadings > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_MAX_HEART_RATE) == 0)
-	{
-		SegmentType hr = MaxHeartRate();
-		result.value.doubleVal = hr.value.doubleVal;
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_BPM;
-		result.startTime = hr.startTime;
-		result.endTime = hr.endTime;
-		result.valid = m_numHeartRateReadings > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_HEART_RATE_PERCENTAGE) == 0)
-	{
-		result.value.doubleVal = HeartRatePercentage();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_PERCENTAGE;
-		result.valid = m_numHeartRateReadings > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_HEART_RATE_ZONE) == 0)
-	{
-		result.value.intVal = HeartRateZone();
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_NOT_SET;
-		result.valid = m_numHeartRateReadings > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_ELAPSED_TIME) == 0)
-	{
-		result.value.timeVal = ElapsedTimeInSeconds();
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_CALORIES_BURNED) == 0)
+ActivityAttributeType Activity::QueryActivityAttributeById(ActivityAttributeId attributeId) const
+{
+	ActivityAttributeType result;
+
+	if (!AttributeHandlers().Query(this, attributeId, result))
 	{
-		result.value.doubleVal = CaloriesBurned();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_CALORIES;
-		result.valid = true;
+		result = QueryNamedActivityAttribute(ActivityAttributeRegistry::Name(attributeId));
 	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_X) == 0)
+	return result;
+}
+
+ActivityAttributeType Activity::QueryNamedActivityAttribute(const std::string& attributeName) const
+{
+	ActivityAttributeType result;
+
+	result.startTime = 0;
+	result.endTime = 0;
+	result.unitSystem = UnitMgr::GetUnitSystem();
+	result.valueType = TYPE_NOT_SET;
+	result.valid = false;
+	return result;
+}
+
+void Activity::QueryStartTimeAttribute(ActivityAttributeType& result) const
+{
+	result.value.intVal = m_startTimeSecs;
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_TIME;
+	result.startTime = m_startTimeSecs;
+	result.endTime = 0;
+	result.valid = m_startTimeSecs > 0;
+}
+
+void Activity::QueryEndTimeAttribute(ActivityAttributeType& result) const
+{
+	result.value.intVal = m_endTimeSecs;
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_TIME;
+	result.startTime = m_startTimeSecs;
+	result.endTime = m_endTimeSecs;
+	result.valid = m_endTimeSecs > 0;
+}
+
+void Activity::QueryHeartRateAttribute(ActivityAttributeType& result) const
+{
+	uint64_t timeSinceLastUpdate = 0;
+	if (!HasStopped())
+		timeSinceLastUpdate = CurrentTimeInMs() - m_lastHeartRateUpdateTime;
+
+	SegmentType hr = CurrentHeartRate();
+	result.value.doubleVal = hr.value.doubleVal;
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_BPM;
+	result.startTime = hr.startTime;
+	result.endTime = hr.endTime;
+	result.valid = (m_numHeartRateReadings > 0) && (timeSinceLastUpdate < 3000);
+}
+
+void Activity::QueryAvgHeartRateAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = AverageHeartRate();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_BPM;
+	result.valid = m_numHeartRateReadings > 0;
+}
+
+void Activity::QueryMaxHeartRateAttribute(ActivityAttributeType& result) const
+{
+	SegmentType hr = MaxHeartRate();
+	result.value.doubleVal = hr.value.doubleVal;
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_BPM;
+	result.startTime = hr.startTime;
+	result.endTime = hr.endTime;
+	result.valid = m_numHeartRateReadings > 0;
+}
+
+void Activity::QueryHeartRatePercentageAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = HeartRatePercentage();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_PERCENTAGE;
+	result.valid = m_numHeartRateReadings > 0;
+}
+
+void Activity::QueryHeartRateZoneAttribute(ActivityAttributeType& result) const
+{
+	result.value.intVal = HeartRateZone();
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_NOT_SET;
+	result.valid = m_numHeartRateReadings > 0;
+}
+
+void Activity::QueryElapsedTimeAttribute(ActivityAttributeType& result) const
+{
+	result.value.timeVal = ElapsedTimeInSeconds();
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.valid = true;
+}
+
+void Activity::QueryCaloriesBurnedAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = CaloriesBurned();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_CALORIES;
+	result.valid = true;
+}
+
+void Activity::QueryTrainingStressAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = TrainingStress();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_NOT_SET;
+	result.valid = result.value.doubleVal > (double)0.0;
+}
+
+void Activity::QueryXAttribute(ActivityAttributeType& result) const
+{
+	try
 	{
-		try
+		if (m_lastAccelReading.reading.count(AXIS_NAME_X) > 0)
 		{
-			if (m_lastAccelReading.reading.count(AXIS_NAME_X) > 0)
-			{
-				result.value.doubleVal = m_lastAccelReading.reading.at(AXIS_NAME_X);
-				result.valueType = TYPE_DOUBLE;
-				result.measureType = MEASURE_G;
-				result.valid = true;
-			}
-			else
-			{
-				result.valid = false;
-			}
+			result.value.doubleVal = m_lastAccelReading.reading.at(AXIS_NAME_X);
+			result.valueType = TYPE_DOUBLE;
+			result.measureType = MEASURE_G;
+			result.valid = true;
 		}
-		catch (...)
+		else
 		{
 			result.valid = false;
 		}
 	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_Y) == 0)
+	catch (...)
+	{
+		result.valid = false;
+	}
+}
+
+void Activity::QueryYAttribute(ActivityAttributeType& result) const
+{
+	try
 	{
-		try
+		if (m_lastAccelReading.reading.count(AXIS_NAME_Y) > 0)
 		{
-			if (m_lastAccelReading.reading.count(AXIS_NAME_Y) > 0)
-			{
-				result.value.doubleVal = m_lastAccelReading.reading.at(AXIS_NAME_Y);
-				result.valueType = TYPE_DOUBLE;
-				result.measureType = MEASURE_G;
-				result.valid = true;
-			}
-			else
-			{
-				result.valid = false;
-			}
+			result.value.doubleVal = m_lastAccelReading.reading.at(AXIS_NAME_Y);
+			result.valueType = TYPE_DOUBLE;
+			result.measureType = MEASURE_G;
+			result.valid = true;
 		}
-		catch (...)
+		else
 		{
 			result.valid = false;
 		}
 	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_Z) == 0)
+	catch (...)
 	{
-		try
+		result.valid = false;
+	}
+}
+
+void Activity::QueryZAttribute(ActivityAttributeType& result) const
+{
+	try
+	{
+		if (m_lastAccelReading.reading.count(AXIS_NAME_Z) > 0)
 		{
-			if (m_lastAccelReading.reading.count(AXIS_NAME_Z) > 0)
-			{
-				result.value.doubleVal = m_lastAccelReading.reading.at(AXIS_NAME_Z);
-				result.valueType = TYPE_DOUBLE;
-				result.measureType = MEASURE_G;
-				result.valid = true;
-			}
-			else
-			{
-				result.valid = false;
-			}
+			result.value.doubleVal = m_lastAccelReading.reading.at(AXIS_NAME_Z);
+			result.valueType = TYPE_DOUBLE;
+			result.measureType = MEASURE_G;
+			result.valid = true;
 		}
-		catch (...)
+		else
 		{
 			result.valid = false;
 		}
 	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_ADDITIONAL_WEIGHT) == 0)
-	{
-		result.value.doubleVal = AdditionalWeightUsedKg();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_WEIGHT;
-		result.valid = true;
-	}
-	else
+	catch (...)
 	{
-		result.valueType = TYPE_NOT_SET;
 		result.valid = false;
 	}
-	return result;
+}
+
+void Activity::QueryAdditionalWeightAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = AdditionalWeightUsedKg();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_WEIGHT;
+	result.valid = true;
 }
 
 void Activity::SetActivityAttribute(const std::string& attributeName, ActivityAttributeType attributeValue)
@@ -563,11 +650,11 @@ void Activity::BuildSummaryAttributeList(std::vector<std::string>& attributes) c
 	attributes.push_back(ACTIVITY_ATTRIBUTE_MAX_HEART_RATE);
 	attributes.push_back(ACTIVITY_ATTRIBUTE_ELAPSED_TIME);
 	attributes.push_back(ACTIVITY_ATTRIBUTE_CALORIES_BURNED);
+	attributes.push_back(ACTIVITY_ATTRIBUTE_TRAINING_STRESS);
 }
 
 std::string Activity::FormatTimeStr(time_t timeVal) const
 {
-	const uint32_t SECS_PER_DAY  = 86400;
 	const uint32_t SECS_PER_HOUR = 3600;
 	const uint32_t SECS_PER_MIN  = 60;
 	const uint32_t MINS_PER_HOUR = 60;
@@ -12,6 +12,7 @@
 #include <vector>
 #include <time.h>
 
+#include "ActivityAttributeRegistry.h"
 #include "ActivityAttributeType.h"
 #include "ActivityType.h"
 #include "IntervalWorkout.h"
@@ -75,7 +76,8 @@ public:
 	virtual bool ProcessSensorReading(const SensorReading& reading);
 	virtual void OnFinishedLoadingSensorData() {}; // Called when done loading sensor data from the database
 
-	virtual ActivityAttributeType QueryActivityAttribute(const std::string& attributeName) const;
+	ActivityAttributeType QueryActivityAttribute(const std::string& attributeName) const;
+	virtual ActivityAttributeType QueryActivityAttributeById(ActivityAttributeId attributeId) const;
 	virtual void SetActivityAttribute(const std::string& attributeName, ActivityAttributeType attributeValue);
 
 	virtual double CaloriesBurned() const = 0;
@@ -89,6 +91,9 @@ public:
 	virtual double HeartRatePercentage() const { return m_currentHeartRateBpm.value.doubleVal / m_athlete.EstimateMaxHeartRate(); };
 	virtual uint8_t HeartRateZone() const;
 
+	/// Estimated training stress, from heart rate unless a subclass has a better measure (power, pace).
+	virtual double TrainingStress() const;
+
 	virtual time_t NumSecondsPaused() const;
 	virtual time_t ElapsedTimeInMinutes() const { return ElapsedTimeInSeconds() / (double)60.0; };
 	virtual time_t ElapsedTimeInSeconds() const { return (time_t)(ElapsedTimeInMs() / 1000); };
@@ -105,6 +110,8 @@ public:
 	virtual void UserWantsToAdvanceIntervalState() { m_intervalWorkoutState.shouldAdvance = true; };
 
 protected:
+	virtual ActivityAttributeType QueryNamedActivityAttribute(const std::string& attributeName) const;
+
 	virtual bool ProcessAccelerometerReading(const SensorReading& reading);
 	virtual bool ProcessLocationReading(const SensorReading& reading);
 	virtual bool ProcessHrmReading(const SensorReading& reading);
@@ -147,6 +154,24 @@ private:
 	time_t               m_secsPreviouslySpentPaused; // number of seconds spent paused
 	SensorReading        m_lastAccelReading;          // the oldest accelerometer reading received
 	SensorReading        m_mostRecentSensorReading;   // the youngest sensor reading received
+
+	static const ActivityAttributeHandlerTable<Activity>& AttributeHandlers();
+	static ActivityAttributeHandlerTable<Activity> BuildAttributeHandlers();
+
+	void QueryStartTimeAttribute(ActivityAttributeType& result) const;
+	void QueryEndTimeAttribute(ActivityAttributeType& result) const;
+	void QueryHeartRateAttribute(ActivityAttributeType& result) const;
+	void QueryAvgHeartRateAttribute(ActivityAttributeType& result) const;
+	void QueryMaxHeartRateAttribute(ActivityAttributeType& result) const;
+	void QueryHeartRatePercentageAttribute(ActivityAttributeType& result) const;
+	void QueryHeartRateZoneAttribute(ActivityAttributeType& result) const;
+	void QueryElapsedTimeAttribute(ActivityAttributeType& result) const;
+	void QueryCaloriesBurnedAttribute(ActivityAttributeType& result) const;
+	void QueryTrainingStressAttribute(ActivityAttributeType& result) const;
+	void QueryXAttribute(ActivityAttributeType& result) const;
+	void QueryYAttribute(ActivityAttributeType& result) const;
+	void QueryZAttribute(ActivityAttributeType& result) const;
+	void QueryAdditionalWeightAttribute(ActivityAttributeType& result) const;
 };
 
 #endif
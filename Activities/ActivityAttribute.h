@@ -92,5 +92,6 @@
 #define ACTIVITY_ATTRIBUTE_RUN_DISTANCE               "Run Distance"            // distance from a foot pod
 #define ACTIVITY_ATTRIBUTE_TOTAL_ASCENT               "Total Ascent"            // 
 #define ACTIVITY_ATTRIBUTE_SWIM_STROKES               "Swim Strokes"            // the number of swim strokes taken
+#define ACTIVITY_ATTRIBUTE_TRAINING_STRESS            "Training Stress"         // estimated training stress score (TSS)
 
 #endif
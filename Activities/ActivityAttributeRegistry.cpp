@@ -0,0 +1,50 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "ActivityAttributeRegistry.h"
+
+#include <mutex>
+#include <unordered_map>
+
+static std::mutex g_registryMutex;
+static std::unordered_map<std::string, ActivityAttributeId> g_attributeIds; // name -> id
+static std::vector<std::string> g_attributeNames;                           // id -> name
+
+ActivityAttributeId ActivityAttributeRegistry::Intern(const std::string& attributeName)
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+
+	std::unordered_map<std::string, ActivityAttributeId>::const_iterator iter = g_attributeIds.find(attributeName);
+	if (iter != g_attributeIds.end())
+		return iter->second;
+	if (g_attributeNames.size() >= ACTIVITY_ATTRIBUTE_ID_NOT_FOUND)
+		return ACTIVITY_ATTRIBUTE_ID_NOT_FOUND;
+
+	ActivityAttributeId attributeId = (ActivityAttributeId)g_attributeNames.size();
+	g_attributeIds.insert(std::make_pair(attributeName, attributeId));
+	g_attributeNames.push_back(attributeName);
+	return attributeId;
+}
+
+ActivityAttributeId ActivityAttributeRegistry::Lookup(const std::string& attributeName)
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+
+	std::unordered_map<std::string, ActivityAttributeId>::const_iterator iter = g_attributeIds.find(attributeName);
+	if (iter != g_attributeIds.end())
+		return iter->second;
+	return ACTIVITY_ATTRIBUTE_ID_NOT_FOUND;
+}
+
+std::string ActivityAttributeRegistry::Name(ActivityAttributeId attributeId)
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+
+	if (attributeId < g_attributeNames.size())
+		return g_attributeNames.at(attributeId);
+	return "";
+}
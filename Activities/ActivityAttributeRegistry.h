@@ -0,0 +1,65 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __ACTIVITY_ATTRIBUTE_REGISTRY__
+#define __ACTIVITY_ATTRIBUTE_REGISTRY__
+
+#include <string>
+#include <vector>
+
+#include "ActivityAttributeType.h"
+#include "UnitMgr.h"
+
+/**
+* Maps attribute names (see ActivityAttribute.h) to small integer identifiers.
+*
+* Names are interned once, when the activity classes build their handler tables, so that
+* attribute queries can dispatch on an integer instead of walking a chain of string compares.
+*/
+class ActivityAttributeRegistry
+{
+public:
+	static ActivityAttributeId Intern(const std::string& attributeName);
+	static ActivityAttributeId Lookup(const std::string& attributeName);
+	static std::string Name(ActivityAttributeId attributeId);
+};
+
+/**
+* Per-class table of attribute handlers, indexed by attribute identifier.
+*/
+template <class T>
+class ActivityAttributeHandlerTable
+{
+public:
+	typedef void (T::*Handler)(ActivityAttributeType& result) const;
+
+	void Register(const char* const attributeName, Handler handler)
+	{
+		ActivityAttributeId attributeId = ActivityAttributeRegistry::Intern(attributeName);
+		if (attributeId >= m_handlers.size())
+			m_handlers.resize(attributeId + 1, NULL);
+		m_handlers[attributeId] = handler;
+	};
+
+	/// Runs the handler for the given attribute, returns false if this class doesn't handle it.
+	bool Query(const T* activity, ActivityAttributeId attributeId, ActivityAttributeType& result) const
+	{
+		if (attributeId >= m_handlers.size() || m_handlers[attributeId] == NULL)
+			return false;
+
+		result.startTime = 0;
+		result.endTime = 0;
+		result.unitSystem = UnitMgr::GetUnitSystem();
+		(activity->*m_handlers[attributeId])(result);
+		return true;
+	};
+
+private:
+	std::vector<Handler> m_handlers;
+};
+
+#endif
@@ -60,4 +60,8 @@ typedef struct ActivityAttributeType
 	bool                         valid;       // tells us whether or not the data is valid
 } ActivityAttributeType;
 
+typedef uint16_t ActivityAttributeId; // interned attribute name, see ActivityAttributeRegistry
+
+#define ACTIVITY_ATTRIBUTE_ID_NOT_FOUND ((ActivityAttributeId)0xffff)
+
 #endif
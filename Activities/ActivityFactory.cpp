@@ -57,7 +57,7 @@ Activity* ActivityFactory::CreateActivity(const std::string& type, Database& dat
 
 	if (type.compare(ChinUp::Type()) == 0)
 	{
-		GForceAnalyzer* analyzer = GForceAnalyzerFactory::GetAnalyzerForActivity(type, database);
+		GForceAnalyzer* analyzer = GForceAnalyzerFactory::AcquireAnalyzerForActivity(type, database);
 		pActivity = new ChinUp(analyzer);
 	}
 	else if (type.compare(Cycling::Type()) == 0)
@@ -82,12 +82,12 @@ Activity* ActivityFactory::CreateActivity(const std::string& type, Database& dat
 	}
 	else if (type.compare(PullUp::Type()) == 0)
 	{
-		GForceAnalyzer* analyzer = GForceAnalyzerFactory::GetAnalyzerForActivity(type, database);
+		GForceAnalyzer* analyzer = GForceAnalyzerFactory::AcquireAnalyzerForActivity(type, database);
 		pActivity = new PullUp(analyzer);
 	}
 	else if (type.compare(PushUp::Type()) == 0)
 	{
-		GForceAnalyzer* analyzer = GForceAnalyzerFactory::GetAnalyzerForActivity(type, database);
+		GForceAnalyzer* analyzer = GForceAnalyzerFactory::AcquireAnalyzerForActivity(type, database);
 		pActivity = new PushUp(analyzer);
 	}
 	else if (type.compare(Run::Type()) == 0)
@@ -96,7 +96,7 @@ Activity* ActivityFactory::CreateActivity(const std::string& type, Database& dat
 	}
 	else if (type.compare(Squat::Type()) == 0)
 	{
-		GForceAnalyzer* analyzer = GForceAnalyzerFactory::GetAnalyzerForActivity(type, database);
+		GForceAnalyzer* analyzer = GForceAnalyzerFactory::AcquireAnalyzerForActivity(type, database);
 		pActivity = new Squat(analyzer);
 	}
 	else if (type.compare(StationaryCycling::Type()) == 0)
@@ -134,10 +134,11 @@ void ActivityFactory::CreateActivity(ActivitySummary& summary, Database& databas
 		summary.pActivity->SetEndTimeSecs(summary.endTime);
 
 		User user = m_user;
-		struct tm* pStartTime = localtime(&summary.startTime);
+		struct tm startTime;
+		localtime_r(&summary.startTime, &startTime); // may be called from more than one thread at a time
 		double userWeightKg = user.GetWeightKg();
 		database.RetrieveNearestWeightMeasurement(summary.startTime, userWeightKg);
-		user.SetBaseDateForComputingAge(*pStartTime);
+		user.SetBaseDateForComputingAge(startTime);
 		user.SetWeightKg(userWeightKg);
 		user.SetFtp(user.GetFtp());
 		summary.pActivity->SetAthleteProfile(user);
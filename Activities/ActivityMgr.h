@@ -17,6 +17,7 @@
 #include "Gender.h"
 #include "IntervalWorkoutSegment.h"
 #include "SensorType.h"
+#include "SensorWriterStats.h"
 #include "UnitSystem.h"
 #include "WorkoutType.h"
 
@@ -32,6 +33,10 @@ extern "C" {
 	bool ResetDatabase(void);
 	bool CloseDatabase(void);
 
+	// Functions for managing the worker threads used by bulk operations.
+	void SetWorkerThreadCount(size_t numThreads); // zero means one per core, bulk operations that are already running keep their threads
+	size_t GetWorkerThreadCount(void);
+
 	// Functions for managing the activity name.
 	bool SetActivityName(const char* const activityId, const char* const name);
 	char* GetActivityName(const char* const activityId);
@@ -122,9 +127,22 @@ extern "C" {
 	bool LoadHistoricalActivityLapData(size_t activityIndex);
 	bool LoadHistoricalActivitySensorData(size_t activityIndex, SensorType sensor, SensorDataCallback callback, void* context);
 	bool LoadAllHistoricalActivitySensorData(size_t activityIndex);
+	HistoryLoadHandle LoadHistoricalActivitySensorDataAsync(size_t activityIndex, SensorType sensor, HistoryLoadCallback callback, void* context);
+	HistoryLoadHandle LoadAllHistoricalActivitySensorDataAsync(size_t activityIndex, HistoryLoadCallback callback, void* context);
+	bool FinishHistoricalActivityLoad(HistoryLoadHandle handle);
+	void CancelHistoricalActivityLoad(HistoryLoadHandle handle);
 	bool LoadAllHistoricalActivitySummaryData(void);
 	bool LoadHistoricalActivitySummaryData(size_t activityIndex);
 	bool SaveHistoricalActivitySummaryData(size_t activityIndex);
+	bool SaveAllHistoricalActivitySummaryData(void);
+
+	// Functions for paging through history.
+	void ResetHistoricalActivityPages(bool newestFirst);
+	size_t ReadNextHistoricalActivityPage(size_t maxActivities, HistoricalActivityCallback callback, void* context);
+
+	// Functions for limiting the memory used by loaded history.
+	void SetHistoricalActivityMemoryBudget(size_t numBytes);
+	size_t GetHistoricalActivityMemoryUsage(void);
 
 	// Functions for unloading history.
 	void FreeHistoricalActivityList(void);
@@ -153,6 +171,10 @@ extern "C" {
 
 	// Functions for modifying historical activity.
 	bool TrimActivityData(const char* const activityId, uint64_t newTime, bool fromStart);
+	bool IsActivityReprocessingNeeded(void);
+	bool IsReprocessingActivities(void);
+	bool ReprocessAllActivities(bool restart, ExportProgressCallback progressCallback, void* context);
+	void CancelReprocessAllActivities(void);
 
 	// Functions for listing activity types.
 	void GetActivityTypes(ActivityTypeCallback callback, void* context);
@@ -165,6 +187,7 @@ extern "C" {
 
 	// Functions for estimating the athlete's fitness.
 	double EstimateFtp(void);
+	size_t QueryTrainingLoads(time_t startTime, time_t endTime, TrainingLoadCallback callback, void* context);
 
 	// Functions for managing workout generation.
 	bool InitializeWorkoutList(void);
@@ -217,22 +240,34 @@ extern "C" {
 	// Functions for importing/exporting activities.
 	bool ImportActivityFromFile(const char* const fileName, const char* const activityType, const char* const activityId);
 	char* ExportActivityFromDatabase(const char* const activityId, FileFormat format, const char* const dirName);
+	bool ExportActivityFromDatabaseToBuffer(const char* const activityId, FileFormat format, bool compress, uint8_t** buffer, size_t* bufferLen);
+	bool ExportActivityFromDatabaseUsingWriteCallback(const char* const activityId, FileFormat format, bool compress, ExportDataCallback callback, void* context);
 	char* ExportActivityUsingCallbackData(const char* const activityId, FileFormat format, const char* const dirName, time_t startTime, const char* const sportType, GetNextCoordinateCallback nextCoordinateCallback, void* context);
 	char* ExportActivitySummary(const char* activityType, const char* const dirName);
+	char* ExportAllSensorDataToParquet(const char* const dirName);
+	char* ExportAllActivitiesToArchive(FileFormat format, const char* const dirName, ExportProgressCallback progressCallback, void* context);
+	void CancelExportAllActivitiesToArchive(void);
 
 	// Functions for processing sensor reads.
+	// Other than weight, readings are queued for the sensor processing thread and these return as soon as the reading is queued.
+	// Live readings are dropped if the queue stays full, imported ones wait for room instead.
 	bool ProcessWeightReading(double weightKg, time_t timestamp);
 	bool ProcessAccelerometerReading(double x, double y, double z, uint64_t timestampMs);
 	bool ProcessLocationReading(double lat, double lon, double alt, double horizontalAccuracy, double verticalAccuracy, uint64_t gpsTimestampMs);
+	bool ProcessImportedLocationReading(double lat, double lon, double alt, double horizontalAccuracy, double verticalAccuracy, uint64_t gpsTimestampMs);
 	bool ProcessHrmReading(double bpm, uint64_t timestampMs);
 	bool ProcessCadenceReading(double rpm, uint64_t timestampMs);
 	bool ProcessWheelSpeedReading(double revCount, uint64_t timestampMs);
 	bool ProcessPowerMeterReading(double watts, uint64_t timestampMs);
 	bool ProcessRunStrideLengthReading(double decimeters, uint64_t timestampMs);
 	bool ProcessRunDistanceReading(double decimeters, uint64_t timestampMs);
+	uint64_t GetSensorReadingQueueOverflowCount(void);
+	void GetSensorWriterStats(SensorWriterStats* stats);
 
 	// Accessor functions for the most recent value of a particular attribute.
 	ActivityAttributeType QueryLiveActivityAttribute(const char* const attributeName);
+	ActivityAttributeId GetActivityAttributeId(const char* const attributeName);
+	ActivityAttributeType QueryLiveActivityAttributeById(ActivityAttributeId attributeId);
 	void SetLiveActivityAttribute(const char* const attributeName, ActivityAttributeType attributeValue);
 
 	// Functions for getting the value of a particular attribute across all activities.
@@ -240,6 +275,7 @@ extern "C" {
 	ActivityAttributeType QueryActivityAttributeTotal(const char* const attributeName);
 	ActivityAttributeType QueryActivityAttributeTotalByActivityType(const char* const attributeName, const char* const activityType);
 	ActivityAttributeType QueryBestActivityAttributeByActivityType(const char* const attributeName, const char* const activityType, bool smallestIsBest, char** const pActivityId);
+	size_t QueryPersonalRecords(const char* const attributeName, const char* const activityType, time_t startTime, time_t endTime, size_t maxRecords, PersonalRecordCallback callback, void* context);
 
 	// Functions for importing ZWO files.
 	bool ImportZwoFile(const char* const fileName, const char* const workoutId, const char* const workoutName);
@@ -7,14 +7,19 @@
 
 #include "ActivityMgr.h"
 #include "ActivityAttribute.h"
+#include "ActivityAttributeRegistry.h"
 #include "ActivityFactory.h"
+#include "ActivityReprocessor.h"
 #include "ActivitySummary.h"
+#include "ArchiveExporter.h"
 #include "AxisName.h"
 #include "Database.h"
 #include "DataExporter.h"
 #include "DataImporter.h"
+#include "DatabaseReaderPool.h"
 #include "Distance.h"
 #include "HeatMapGenerator.h"
+#include "HistoricalActivityLoader.h"
 #include "IntervalWorkout.h"
 #include "WorkoutImporter.h"
 #include "WorkoutPlanGenerator.h"
@@ -25,29 +30,143 @@
 #include "LiftingActivity.h"
 #include "MountainBiking.h"
 #include "Run.h"
+#include "SensorReadingQueue.h"
+#include "SensorReadingWriter.h"
+#include "TaskExecutor.h"
 #include "Shoes.h"
 #include "UnitMgr.h"
 #include "User.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <time.h>
 #include <sys/time.h>
 
+#define SENSOR_PROCESSING_BATCH_SIZE 32 // readings applied per hold of g_currentActivityMutex, keeps UI queries responsive
+#define LIVE_SNAPSHOT_INTERVAL_MS    250 // how often the live snapshot is refreshed when no readings arrive, so timers keep moving
+#define SENSOR_QUEUE_FULL_WAIT_MS    50 // how long a sensor callback waits for room in a full queue before dropping the reading
+#define HISTORY_LOAD_THREADS         2 // worker threads for asynchronous history loads, kept apart from the bulk operations
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+	typedef struct LoadedHistoricalActivity
+	{
+		std::list<std::string>::iterator lruIter; // position in g_loadedActivityLru
+		size_t                           numBytes; // estimated memory held by the activity's sensor data
+	} LoadedHistoricalActivity;
+
 	Activity*        g_pCurrentActivity = NULL;
 	ActivityFactory* g_pActivityFactory = NULL;
 	Database*        g_pDatabase = NULL;
+	DatabaseReaderPool* g_pDatabaseReaders = NULL; // read only connections for history queries and exports
 	bool             g_autoStartEnabled = false;
 
 	ActivitySummaryList           g_historicalActivityList; // cache of completed activities
 	std::map<std::string, size_t> g_activityIdMap; // maps activity IDs to activity indexes
+	bool                          g_historicalActivityListLoaded = false; // true when g_historicalActivityList holds the complete history
+	std::atomic<bool>             g_historicalActivityListStale(false); // set from other threads when the stored summaries change, forces a reload
+	ActivityPageCursor            g_historicalActivityPageCursor = { false, 0, 0 }; // position of the next page of history
+	bool                          g_historicalActivityPagesNewestFirst = true; // order in which history pages are read
+	std::list<std::string>        g_loadedActivityLru; // IDs of historical activities with sensor data loaded, most recently used first
+	std::map<std::string, LoadedHistoricalActivity> g_loadedActivities; // maps activity IDs to their entry in the LRU list
+	std::set<std::string>         g_evictedActivities; // IDs of activities whose sensor data was dropped and must be reloaded on access
+	std::map<std::string, size_t> g_pinnedActivities; // IDs of historical activities that are borrowed, and must not be freed, with their pin counts
+	size_t                        g_loadedActivityBytes = 0; // estimated memory held by all loaded historical activities
+	size_t                        g_loadedActivityBudget = 64 * 1024 * 1024; // memory budget for loaded historical activities
 	std::vector<Bike>             g_bikes; // cache of bike profiles
 	std::vector<Shoes>            g_shoes; // cache of shoe profiles
 	std::vector<IntervalWorkout>  g_intervalWorkouts; // cache of interval workouts
 	std::vector<PacePlan>         g_pacePlans; // cache of pace plans
 	std::vector<Workout>          g_workouts; // cache of planned workouts
+	ArchiveExporter*              g_pArchiveExporter = NULL; // the archive export that is in progress, if any
+	std::mutex                    g_archiveExporterMutex; // protects g_pArchiveExporter
+	ActivityReprocessor*          g_pActivityReprocessor = NULL; // the reprocessing that is in progress, if any
+	std::mutex                    g_activityReprocessorMutex; // protects g_pActivityReprocessor
+	SensorReadingQueue            g_sensorReadingQueue; // readings waiting to be applied to the current activity
+	std::thread                   g_sensorProcessingThread; // applies queued readings to the current activity
+	std::atomic<bool>             g_sensorProcessingEnabled(false); // tells the processing thread to keep running
+	std::atomic<bool>             g_acceptingSensorReadings(false); // true while the current activity is recording
+	std::mutex                    g_currentActivityMutex; // held by whichever thread is modifying the current activity
+	std::mutex                    g_sensorWakeMutex; // used with g_sensorWakeCondition
+	std::condition_variable       g_sensorWakeCondition; // signalled when readings are queued
+	std::mutex                    g_sensorRoomMutex; // used with g_sensorRoomCondition
+	std::condition_variable       g_sensorRoomCondition; // signalled when the processing thread frees up room in the queue
+	std::atomic<uint64_t>         g_numDroppedSensorReadings(0); // readings that were discarded because the queue stayed full
+	std::vector<ActivityAttributeId>           g_liveAttributeIds; // attributes of the current activity that are kept in the live snapshot
+	std::shared_ptr<const SummaryAttributeMap> g_liveAttributeSnapshot; // latest values of g_liveAttributeIds, NULL when not recording
+	SensorReadingWriter*          g_pSensorReadingWriter = NULL; // persists readings for the current activity while it is recording
+	SensorWriterStats             g_lastSensorWriterStats = { 0 }; // stats of the most recently stopped writer
+	std::shared_ptr<TaskExecutor> g_pTaskExecutor; // shared by bulk operations, created on first use, each operation holds a reference while it runs
+	size_t                        g_numWorkerThreads = 0; // size of g_pTaskExecutor, zero means one thread per core
+	std::shared_ptr<TaskExecutor> g_pHistoryLoadExecutor; // runs asynchronous history loads, created on first use
+	std::mutex                    g_taskExecutorMutex; // protects g_pTaskExecutor and g_pHistoryLoadExecutor
+	std::map<HistoryLoadHandle, std::shared_ptr<HistoricalActivityLoader>> g_historyLoads; // asynchronous loads that haven't been finished or cancelled
+	HistoryLoadHandle             g_nextHistoryLoadHandle = 1; // handle given to the next asynchronous load
+	size_t                        g_numHistoryLoadsRunning = 0; // asynchronous loads still on a worker thread, including cancelled ones
+	std::mutex                    g_historyLoadsMutex; // protects g_historyLoads, g_nextHistoryLoadHandle, and g_numHistoryLoadsRunning
+	std::condition_variable       g_historyLoadsIdle; // signalled when an asynchronous load leaves its worker thread
+
+	void InsertHistoricalActivity(const ActivitySummary& summary);
+	void RemoveHistoricalActivity(const char* const activityId);
+	void ForgetLoadedHistoricalActivity(const std::string& activityId);
+	void StartSensorProcessing();
+	void StopSensorProcessing();
+	size_t DrainSensorReadingQueue(size_t maxReadings);
+	void PublishLiveAttributeSnapshot();
+	void StopSensorReadingWriter();
+	void CancelAllHistoricalActivityLoads();
+
+	// The caller must hold g_currentActivityMutex.
+	bool IsCurrentActivityInProgress()
+	{
+		return (g_pCurrentActivity && g_pCurrentActivity->HasStarted() && !g_pCurrentActivity->HasStopped());
+	}
+
+	// Bulk operations (exports, reprocessing, etc.) share one pool of worker threads rather than each starting their own.
+	// The pool is only destroyed once nothing holds it, so tasks must not hold it themselves (or it could be destroyed
+	// on one of its own threads).
+	std::shared_ptr<TaskExecutor> GetTaskExecutor()
+	{
+		std::lock_guard<std::mutex> lock(g_taskExecutorMutex);
+
+		if (!g_pTaskExecutor)
+		{
+			g_pTaskExecutor = std::make_shared<TaskExecutor>(g_numWorkerThreads);
+		}
+		return g_pTaskExecutor;
+	}
+
+	// Bulk operations can keep every thread of their pool busy for minutes, so loads the UI is waiting on get
+	// threads of their own. That way they always start right away, and cancelling them is never held up.
+	std::shared_ptr<TaskExecutor> GetHistoryLoadExecutor()
+	{
+		std::lock_guard<std::mutex> lock(g_taskExecutorMutex);
+
+		if (!g_pHistoryLoadExecutor)
+		{
+			g_pHistoryLoadExecutor = std::make_shared<TaskExecutor>(HISTORY_LOAD_THREADS);
+		}
+		return g_pHistoryLoadExecutor;
+	}
+
+	// History is read through a pooled read only connection, when one is available, so that it doesn't
+	// wait on (or hold up) writes to the main connection.
+	Database* HistoryDatabase(const PooledDatabaseReader& reader)
+	{
+		if (reader.Get())
+		{
+			return reader.Get();
+		}
+		return g_pDatabase;
+	}
 
 	//
 	// Functions for managing the database.
@@ -69,6 +188,7 @@ extern "C" {
 				if (g_pDatabase->Open(dbFileName))
 				{
 					g_pDatabase->CreateTables();
+					g_pDatabaseReaders = new DatabaseReaderPool(dbFileName, DATABASE_READER_POOL_SIZE);
 				}
 				else
 				{
@@ -87,7 +207,16 @@ extern "C" {
 		{
 			deleted = g_pDatabase->DeleteActivity(activityId);
 		}
-		if (g_pCurrentActivity && (g_pCurrentActivity->GetId().compare(activityId) == 0))
+		if (deleted)
+		{
+			RemoveHistoricalActivity(activityId);
+		}
+		bool isCurrentActivity = false;
+		{
+			std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+			isCurrentActivity = g_pCurrentActivity && (g_pCurrentActivity->GetId().compare(activityId) == 0);
+		}
+		if (isCurrentActivity)
 		{
 			DestroyCurrentActivity();
 		}
@@ -102,6 +231,7 @@ extern "C" {
 		{
 			deleted = g_pDatabase->Reset();
 		}
+		FreeHistoricalActivityList();
 		return deleted;
 	}
 
@@ -109,6 +239,14 @@ extern "C" {
 	{
 		bool deleted = false;
 
+		// Asynchronous loads read through the pooled connections, so they have to be stopped first.
+		CancelAllHistoricalActivityLoads();
+
+		if (g_pDatabaseReaders)
+		{
+			delete g_pDatabaseReaders;
+			g_pDatabaseReaders = NULL;
+		}
 		if (g_pDatabase)
 		{
 			deleted = g_pDatabase->Close();
@@ -116,15 +254,45 @@ extern "C" {
 		return deleted;
 	}
 
+	//
+	// Functions for managing the worker threads used by bulk operations.
+	//
+
+	void SetWorkerThreadCount(size_t numThreads)
+	{
+		std::shared_ptr<TaskExecutor> pOldExecutor;
+
+		{
+			std::lock_guard<std::mutex> lock(g_taskExecutorMutex);
+
+			g_numWorkerThreads = numThreads;
+
+			// The next bulk operation will create a pool of the new size. Operations that are running keep the
+			// old one, which goes away when the last of them finishes.
+			pOldExecutor.swap(g_pTaskExecutor);
+		}
+	}
+
+	size_t GetWorkerThreadCount(void)
+	{
+		return GetTaskExecutor()->GetNumThreads();
+	}
+
 	//
 	// Functions for managing the activity name.
 	//
 
 	bool SetActivityName(const char* const activityId, const char* const name)
 	{
-		if (g_pDatabase)
+		if (g_pDatabase && g_pDatabase->UpdateActivityName(activityId, name))
 		{
-			return g_pDatabase->UpdateActivityName(activityId, name);
+			size_t activityIndex = ConvertActivityIdToActivityIndex(activityId);
+
+			if (activityIndex < g_historicalActivityList.size())
+			{
+				g_historicalActivityList.at(activityIndex).name = name;
+			}
+			return true;
 		}
 		return false;
 	}
@@ -403,13 +571,13 @@ extern "C" {
 			{
 				if (bikeId == summaryBikeId)
 				{
-					ActivityAttributeType revs = summary.summaryAttributes.find(ACTIVITY_ATTRIBUTE_NUM_WHEEL_REVOLUTIONS)->second;
-					ActivityAttributeType distance = summary.summaryAttributes.find(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED)->second;
+					const ActivityAttributeType* revs = summary.summaryAttributes.Find(ACTIVITY_ATTRIBUTE_NUM_WHEEL_REVOLUTIONS);
+					const ActivityAttributeType* distance = summary.summaryAttributes.Find(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED);
 
-					if (revs.valid && distance.valid)
+					if (revs && distance && revs->valid && distance->valid)
 					{
-						double distanceMm = UnitConverter::MilesToKilometers(distance.value.doubleVal) * 1000000;	// Convert to millimeters
-						double wheelCircumference = distanceMm / (double)revs.value.intVal;
+						double distanceMm = UnitConverter::MilesToKilometers(distance->value.doubleVal) * 1000000;	// Convert to millimeters
+						double wheelCircumference = distanceMm / (double)revs->value.intVal;
 						circumferenceTotalMm += wheelCircumference;
 						++numSamples;
 					}
@@ -505,6 +673,8 @@ extern "C" {
 
 	void SetCurrentBicycle(const char* const name)
 	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
 		if (g_pCurrentActivity)
 		{
 			for (auto iter = g_bikes.begin(); iter != g_bikes.end(); ++iter)
@@ -518,6 +688,7 @@ extern "C" {
 					if (pCycling)
 					{
 						pCycling->SetBikeProfile(bike);
+						PublishLiveAttributeSnapshot();
 					}
 					break;
 				}
@@ -684,12 +855,15 @@ extern "C" {
 
 	bool SetCurrentIntervalWorkout(const char* const workoutId)
 	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
 		if (g_pCurrentActivity && workoutId)
 		{
 			const IntervalWorkout* workout = GetIntervalWorkout(workoutId);
 			if (workout)
 			{
 				g_pCurrentActivity->SetIntervalWorkout((*workout));
+				PublishLiveAttributeSnapshot();
 				return true;
 			}
 		}
@@ -698,7 +872,9 @@ extern "C" {
 
 	bool CheckCurrentIntervalWorkout()
 	{
-		if (IsActivityInProgress())
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (IsCurrentActivityInProgress())
 		{
 			return g_pCurrentActivity->CheckIntervalWorkout();
 		}
@@ -707,7 +883,9 @@ extern "C" {
 
 	bool GetCurrentIntervalWorkoutSegment(IntervalWorkoutSegment* segment)
 	{
-		if (IsActivityInProgress())
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (IsCurrentActivityInProgress())
 		{
 			return g_pCurrentActivity->GetCurrentIntervalWorkoutSegment(*segment);
 		}
@@ -716,7 +894,9 @@ extern "C" {
 
 	bool IsIntervalWorkoutComplete()
 	{
-		if (IsActivityInProgress())
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (IsCurrentActivityInProgress())
 		{
 			return g_pCurrentActivity->IsIntervalWorkoutComplete();
 		}
@@ -725,10 +905,13 @@ extern "C" {
 
 	void AdvanceCurrentIntervalWorkout()
 	{
-		if (IsActivityInProgress())
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (IsCurrentActivityInProgress())
 		{
-			return g_pCurrentActivity->UserWantsToAdvanceIntervalState();
-		}		
+			g_pCurrentActivity->UserWantsToAdvanceIntervalState();
+			PublishLiveAttributeSnapshot();
+		}
 	}
 
 	//
@@ -977,12 +1160,15 @@ extern "C" {
 
 	bool SetCurrentPacePlan(const char* const planId)
 	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
 		if (g_pCurrentActivity && planId)
 		{
 			const PacePlan* pacePlan = GetPacePlan(planId);
 			if (pacePlan)
 			{
 				g_pCurrentActivity->SetPacePlan((*pacePlan));
+				PublishLiveAttributeSnapshot();
 				return true;
 			}
 		}
@@ -995,11 +1181,16 @@ extern "C" {
 
 	bool MergeActivities(const char* const activityId1, const char* const activityId2)
 	{
+		bool result = false;
+
 		if (g_pDatabase)
 		{
-			return g_pDatabase->MergeActivities(activityId1, activityId2);
+			result = g_pDatabase->MergeActivities(activityId1, activityId2);
 		}
-		return false;
+
+		// Both activities change, so the cached history has to be reloaded.
+		FreeHistoricalActivityList();
+		return result;
 	}
 
 	//
@@ -1033,616 +1224,1115 @@ extern "C" {
 	// Functions for loading history.
 	//
 
-	void InitializeHistoricalActivityList()
+	//
+	// Functions for limiting the memory used by loaded history.
+	//
+
+	size_t EstimateHistoricalActivityBytes(const ActivitySummary& summary)
 	{
-		FreeHistoricalActivityList();
-		
-		if (g_pDatabase)
-		{
-			g_pDatabase->RetrieveActivities(g_historicalActivityList);
+		size_t numBytes = 0;
 
-			// Build the activity id to index hash map.
-			for (size_t activityIndex = 0; activityIndex < g_historicalActivityList.size(); ++activityIndex)
-			{
-				ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-				g_activityIdMap.insert(std::pair<std::string, size_t>(summary.activityId, activityIndex));
-			}
+		numBytes += summary.accelerometerReadings.NumBytes();
+
+		MovingActivity* pMovingActivity = dynamic_cast<MovingActivity*>(summary.pActivity);
+		if (pMovingActivity)
+		{
+			numBytes += pMovingActivity->GetTrack().NumBytes();
 		}
+		return numBytes;
 	}
 
-	void CreateHistoricalActivityObject(size_t activityIndex)
+	void ForgetLoadedHistoricalActivity(const std::string& activityId)
 	{
-		if (g_pActivityFactory && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		auto iter = g_loadedActivities.find(activityId);
+
+		if (iter != g_loadedActivities.end())
 		{
-			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-			if (!summary.pActivity)
-			{
-				g_pActivityFactory->CreateActivity(summary, *g_pDatabase);
-			}
+			g_loadedActivityBytes -= (*iter).second.numBytes;
+			g_loadedActivityLru.erase((*iter).second.lruIter);
+			g_loadedActivities.erase(iter);
 		}
+		g_evictedActivities.erase(activityId);
 	}
 
-	void CreateHistoricalActivityObjectById(const char* activityId)
+	void ClearHistoricalActivitySensorData(ActivitySummary& summary)
 	{
-		size_t activityIndex = ConvertActivityIdToActivityIndex(activityId);
-		CreateHistoricalActivityObject(activityIndex);
+		summary.accelerometerReadings.Clear();
+		summary.loadedSensors.clear();
 	}
 
-	void CreateAllHistoricalActivityObjects()
+	// Drops the sensor data of a loaded activity, leaving an empty activity object with its summary attributes
+	// in its place so that code that only looks at summaries keeps working.
+	void EvictHistoricalActivity(ActivitySummary& summary)
 	{
-		for (size_t i = 0; i < g_historicalActivityList.size(); ++i)
+		ForgetLoadedHistoricalActivity(summary.activityId);
+
+		if (summary.pActivity)
 		{
-			CreateHistoricalActivityObject(i);
+			delete summary.pActivity;
+			summary.pActivity = NULL;
 		}
-	}
 
-	bool LoadHistoricalActivityLapData(size_t activityIndex)
-	{
-		bool result = false;
+		ClearHistoricalActivitySensorData(summary);
 
-		if (g_pDatabase && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		if (g_pActivityFactory && g_pDatabase)
 		{
-			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			g_pActivityFactory->CreateActivity(summary, *g_pDatabase);
 
 			if (summary.pActivity)
 			{
-				MovingActivity* pMovingActivity = dynamic_cast<MovingActivity*>(summary.pActivity);
-
-				if (pMovingActivity)
+				for (auto attributeIter = summary.summaryAttributes.begin(); attributeIter != summary.summaryAttributes.end(); ++attributeIter)
 				{
-					LapSummaryList laps;
-					result = g_pDatabase->RetrieveLaps(summary.activityId, laps);
-					pMovingActivity->SetLaps(laps);
+					summary.pActivity->SetActivityAttribute(ActivityAttributeRegistry::Name((*attributeIter).first), (*attributeIter).second);
 				}
 			}
 		}
-		return result;
+
+		g_evictedActivities.insert(summary.activityId);
 	}
 
-	bool LoadHistoricalActivitySensorData(size_t activityIndex, SensorType sensor, SensorDataCallback callback, void* context)
+	bool IsHistoricalActivityPinned(const std::string& activityId)
 	{
-		bool result = false;
+		return g_pinnedActivities.count(activityId) > 0;
+	}
 
-		if (g_pDatabase && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+	// Evicts the least recently used activities until the loaded history fits in the budget. The most recently
+	// used activity is never evicted, even if it is larger than the budget on its own, and neither are pinned ones.
+	void EnforceLoadedHistoricalActivityBudget()
+	{
+		auto iter = g_loadedActivityLru.end();
+
+		while ((g_loadedActivityBytes > g_loadedActivityBudget) && (iter != g_loadedActivityLru.begin()))
 		{
-			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			--iter;
 
-			if (summary.pActivity)
+			if ((iter == g_loadedActivityLru.begin()) || IsHistoricalActivityPinned(*iter))
 			{
-				switch (sensor)
-				{
-					case SENSOR_TYPE_UNKNOWN:
-						break;
-					case SENSOR_TYPE_ACCELEROMETER:
-						if (summary.accelerometerReadings.size() == 0)
-						{
-							if (g_pDatabase->RetrieveActivityAccelerometerReadings(summary.activityId, summary.accelerometerReadings))
-							{
-								for (auto iter = summary.accelerometerReadings.begin(); iter != summary.accelerometerReadings.end(); ++iter)
-								{
-									summary.pActivity->ProcessSensorReading((*iter));
-									if (callback)
-										callback(summary.activityId.c_str(), context);
-								}
-								result = true;
-							}
-						}
-						else
-						{
-							result = true;
-						}
-						break;
-					case SENSOR_TYPE_LOCATION:
-						if (summary.locationPoints.size() == 0)
-						{
-							if (g_pDatabase->RetrieveActivityPositionReadings(summary.activityId, summary.locationPoints))
-							{
-								for (auto iter = summary.locationPoints.begin(); iter != summary.locationPoints.end(); ++iter)
-								{
-									summary.pActivity->ProcessSensorReading((*iter));
-									if (callback)
-										callback(summary.activityId.c_str(), context);
-								}
-								result = true;
-							}
-						}
-						else
-						{
-							result = true;
-						}
-						break;
-					case SENSOR_TYPE_HEART_RATE:
-						if (summary.heartRateMonitorReadings.size() == 0)
-						{
-							if (g_pDatabase->RetrieveActivityHeartRateMonitorReadings(summary.activityId, summary.heartRateMonitorReadings))
-							{
-								for (auto iter = summary.heartRateMonitorReadings.begin(); iter != summary.heartRateMonitorReadings.end(); ++iter)
-								{
-									const SensorReading& reading = (*iter);
-									summary.pActivity->ProcessSensorReading(reading);
-									if (callback)
-										callback(summary.activityId.c_str(), context);
-								}
-								result = true;
-							}
-						}
-						else
-						{
-							result = true;
-						}
-						break;
-					case SENSOR_TYPE_CADENCE:
-						if (summary.cadenceReadings.size() == 0)
-						{
-							if (g_pDatabase->RetrieveActivityCadenceReadings(summary.activityId, summary.cadenceReadings))
-							{
-								for (auto iter = summary.cadenceReadings.begin(); iter != summary.cadenceReadings.end(); ++iter)
-								{
-									const SensorReading& reading = (*iter);
-									summary.pActivity->ProcessSensorReading(reading);
-									if (callback)
-										callback(summary.activityId.c_str(), context);
-								}
-								result = true;
-							}
-						}
-						else
-						{
-							result = true;
-						}
-						break;
-					case SENSOR_TYPE_WHEEL_SPEED:
-						result = true;
-						break;
-					case SENSOR_TYPE_POWER:
-						if (summary.powerReadings.size() == 0)
-						{
-							if (g_pDatabase->RetrieveActivityPowerMeterReadings(summary.activityId, summary.powerReadings))
-							{
-								for (auto iter = summary.powerReadings.begin(); iter != summary.powerReadings.end(); ++iter)
-								{
-									const SensorReading& reading = (*iter);
-									summary.pActivity->ProcessSensorReading(reading);
-									if (callback)
-										callback(summary.activityId.c_str(), context);
-								}
-								result = true;
-							}
-						}
-						else
-						{
-							result = true;
-						}
-						break;
-					case SENSOR_TYPE_FOOT_POD:
-						result = true;
-						break;
-					case SENSOR_TYPE_SCALE:
-					case SENSOR_TYPE_LIGHT:
-					case SENSOR_TYPE_RADAR:
-					case SENSOR_TYPE_GOPRO:
-					case NUM_SENSOR_TYPES:
-						result = false;
-						break;
-				}
+				continue;
 			}
-		}
-		return result;
-	}
 
-	bool LoadAllHistoricalActivitySensorData(size_t activityIndex)
-	{
-		bool result = true;
+			std::string activityId = (*iter);
+			size_t activityIndex = ConvertActivityIdToActivityIndex(activityId.c_str());
 
-		if (g_pDatabase && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
-		{
-			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			// Eviction erases the entry, so step past it first.
+			++iter;
 
-			if (summary.pActivity)
+			if (activityIndex < g_historicalActivityList.size())
 			{
-				std::vector<SensorType> sensorTypes;
-				summary.pActivity->ListUsableSensors(sensorTypes);
-
-				for (auto iter = sensorTypes.begin(); iter != sensorTypes.end() && result; ++iter)
-				{
-					if (!LoadHistoricalActivitySensorData(activityIndex, (*iter), NULL, NULL))
-					{
-						result = false;
-					}
-				}
-				
-				summary.pActivity->OnFinishedLoadingSensorData();
+				EvictHistoricalActivity(g_historicalActivityList.at(activityIndex));
 			}
 			else
 			{
-				result = false;
+				ForgetLoadedHistoricalActivity(activityId);
 			}
 		}
-		else
-		{
-			result = false;
-		}
-		return result;
 	}
 
-	bool LoadHistoricalActivitySummaryData(size_t activityIndex)
+	// Marks the activity as the most recently used one and updates its share of the budget.
+	void TouchLoadedHistoricalActivity(size_t activityIndex)
 	{
-		bool result = false;
+		ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+		auto iter = g_loadedActivities.find(summary.activityId);
 
-		if (g_pDatabase && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		if (iter == g_loadedActivities.end())
 		{
-			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			LoadedHistoricalActivity loaded;
 
-			if (g_pDatabase->RetrieveSummaryData(summary.activityId, summary.summaryAttributes))
-			{
-				if (summary.pActivity)
-				{
-					for (auto attributeIter = summary.summaryAttributes.begin(); attributeIter != summary.summaryAttributes.end(); ++attributeIter)
-					{
-						const std::string& attributeName = (*attributeIter).first;
-						const ActivityAttributeType& value = (*attributeIter).second;
-						
-						summary.pActivity->SetActivityAttribute(attributeName, value);
-					}
-					
-					result = true;
-				}
-			}
+			g_loadedActivityLru.push_front(summary.activityId);
+			loaded.lruIter = g_loadedActivityLru.begin();
+			loaded.numBytes = 0;
+			iter = g_loadedActivities.insert(std::make_pair(summary.activityId, loaded)).first;
 		}
-		return result;
+		else
+		{
+			g_loadedActivityLru.splice(g_loadedActivityLru.begin(), g_loadedActivityLru, (*iter).second.lruIter);
+		}
+
+		g_evictedActivities.erase(summary.activityId);
+
+		size_t numBytes = EstimateHistoricalActivityBytes(summary);
+		g_loadedActivityBytes = g_loadedActivityBytes - (*iter).second.numBytes + numBytes;
+		(*iter).second.numBytes = numBytes;
+
+		EnforceLoadedHistoricalActivityBudget();
 	}
 
-	bool LoadAllHistoricalActivitySummaryData()
+	// Reloads the sensor data of an activity that was evicted from the cache. Does nothing for activities that
+	// are loaded or were never loaded.
+	void EnsureHistoricalActivityIsLoaded(size_t activityIndex)
 	{
-		bool result = true;
+		if (activityIndex >= g_historicalActivityList.size())
+		{
+			return;
+		}
 
-		for (size_t i = 0; i < g_historicalActivityList.size(); ++i)
+		const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+
+		if (g_loadedActivities.count(summary.activityId) > 0)
 		{
-			result &= LoadHistoricalActivitySummaryData(i);
+			TouchLoadedHistoricalActivity(activityIndex);
+		}
+		else if (g_evictedActivities.count(summary.activityId) > 0)
+		{
+			g_evictedActivities.erase(summary.activityId);
+			LoadHistoricalActivityLapData(activityIndex);
+			LoadAllHistoricalActivitySensorData(activityIndex);
 		}
-		return result;
 	}
 
-	bool SaveHistoricalActivitySummaryData(size_t activityIndex)
+	void SetHistoricalActivityMemoryBudget(size_t numBytes)
 	{
-		bool result = false;
+		g_loadedActivityBudget = numBytes;
+		EnforceLoadedHistoricalActivityBudget();
+	}
 
-		if (g_pDatabase && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+	size_t GetHistoricalActivityMemoryUsage()
+	{
+		return g_loadedActivityBytes;
+	}
+
+	void RebuildHistoricalActivityIdMap(size_t firstActivityIndex)
+	{
+		for (size_t activityIndex = firstActivityIndex; activityIndex < g_historicalActivityList.size(); ++activityIndex)
 		{
 			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			g_activityIdMap[summary.activityId] = activityIndex;
+		}
+	}
 
-			if (summary.pActivity)
+	// The list is loaded once and then kept up to date as activities are started, imported, and deleted,
+	// so calling this again is cheap. FreeHistoricalActivityList forces a reload on the next call.
+	void InitializeHistoricalActivityList()
+	{
+		// The list itself is kept up to date as activities are saved and deleted, so only the activity objects and
+		// their sensor data are reset, as callers expect to start over with each activity.
+		if (g_historicalActivityListLoaded && !g_historicalActivityListStale.exchange(false))
+		{
+			for (size_t activityIndex = 0; activityIndex < g_historicalActivityList.size(); ++activityIndex)
 			{
-				std::vector<std::string> attributes;
-				summary.pActivity->BuildSummaryAttributeList(attributes);
+				FreeHistoricalActivityObject(activityIndex);
+			}
+			return;
+		}
 
-				result = true;
+		FreeHistoricalActivityList();
 
-				for (auto iter = attributes.begin(); iter != attributes.end() && result; ++iter)
-				{
-					const std::string& attribute = (*iter);
-					ActivityAttributeType value = summary.pActivity->QueryActivityAttribute(attribute);
+		PooledDatabaseReader reader(g_pDatabaseReaders);
+		Database* pDatabase = HistoryDatabase(reader);
 
-					if (value.valid)
-					{
-						UnitMgr::ConvertActivityAttributeToCustomaryUnits(value);
-						result = g_pDatabase->CreateSummaryData(summary.activityId, attribute, value);
-					}
-				}
-			}
+		if (pDatabase && pDatabase->RetrieveActivities(g_historicalActivityList))
+		{
+			// Build the activity id to index hash map.
+			RebuildHistoricalActivityIdMap(0);
+			g_historicalActivityListLoaded = true;
 		}
-		return result;
 	}
 
-	//
-	// Functions for unloading history.
-	//
-
-	void FreeHistoricalActivityList()
+	void InsertHistoricalActivity(const ActivitySummary& summary)
 	{
-		for (auto iter = g_historicalActivityList.begin(); iter != g_historicalActivityList.end(); ++iter)
+		if (!g_historicalActivityListLoaded || (g_activityIdMap.count(summary.activityId) > 0))
 		{
-			ActivitySummary& summary = (*iter);
-
-			if (summary.pActivity)
-			{
-				delete summary.pActivity;
-				summary.pActivity = NULL;
-			}
+			return;
+		}
 
-			summary.locationPoints.clear();
-			summary.accelerometerReadings.clear();
-			summary.heartRateMonitorReadings.clear();
-			summary.cadenceReadings.clear();
-			summary.powerReadings.clear();
-			summary.summaryAttributes.clear();
+		// Keep the list sorted by start time. Ties go last, matching the database order.
+		auto iter = g_historicalActivityList.begin();
+		while ((iter != g_historicalActivityList.end()) && ((*iter).startTime <= summary.startTime))
+		{
+			++iter;
 		}
 
-		g_historicalActivityList.clear();
-		g_activityIdMap.clear();
+		size_t activityIndex = iter - g_historicalActivityList.begin();
+		g_historicalActivityList.insert(iter, summary);
+		RebuildHistoricalActivityIdMap(activityIndex);
 	}
 
-	void FreeHistoricalActivityObject(size_t activityIndex)
+	void RemoveHistoricalActivity(const char* const activityId)
 	{
+		size_t activityIndex = ConvertActivityIdToActivityIndex(activityId);
+
 		if (activityIndex < g_historicalActivityList.size())
 		{
 			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+
+			ForgetLoadedHistoricalActivity(summary.activityId);
+
 			if (summary.pActivity)
 			{
 				delete summary.pActivity;
 				summary.pActivity = NULL;
 			}
+
+			g_historicalActivityList.erase(g_historicalActivityList.begin() + activityIndex);
+			g_activityIdMap.erase(activityId);
+			RebuildHistoricalActivityIdMap(activityIndex);
 		}
 	}
 
-	void FreeHistoricalActivitySensorData(size_t activityIndex)
+	//
+	// Functions for paging through history.
+	//
+
+	void ResetHistoricalActivityPages(bool newestFirst)
 	{
-		if (activityIndex < g_historicalActivityList.size())
+		g_historicalActivityPageCursor.valid = false;
+		g_historicalActivityPageCursor.startTime = 0;
+		g_historicalActivityPageCursor.rowId = 0;
+		g_historicalActivityPagesNewestFirst = newestFirst;
+	}
+
+	size_t ReadNextHistoricalActivityPage(size_t maxActivities, HistoricalActivityCallback callback, void* context)
+	{
+		ActivitySummaryList page;
+		PooledDatabaseReader reader(g_pDatabaseReaders);
+		Database* pDatabase = HistoryDatabase(reader);
+
+		if (pDatabase && pDatabase->RetrieveActivityPage(g_historicalActivityPageCursor, maxActivities, g_historicalActivityPagesNewestFirst, page))
 		{
-			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-			summary.locationPoints.clear();
-			summary.accelerometerReadings.clear();
-			summary.heartRateMonitorReadings.clear();
-			summary.cadenceReadings.clear();
-			summary.powerReadings.clear();
+			for (auto iter = page.begin(); iter != page.end(); ++iter)
+			{
+				const ActivitySummary& summary = (*iter);
+				callback(summary.activityId.c_str(), summary.type.c_str(), summary.name.c_str(), summary.startTime, summary.endTime, context);
+			}
 		}
+		return page.size();
 	}
 
-	void FreeHistoricalActivitySummaryData(size_t activityIndex)
+	void CreateHistoricalActivityObject(size_t activityIndex)
 	{
-		if (activityIndex < g_historicalActivityList.size())
+		if (g_pActivityFactory && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
 		{
 			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-			summary.summaryAttributes.clear();
+			if (!summary.pActivity)
+			{
+				g_pActivityFactory->CreateActivity(summary, *g_pDatabase);
+			}
 		}
 	}
 
-	//
-	// Functions for accessing historical data.
-	//
+	void CreateHistoricalActivityObjectById(const char* activityId)
+	{
+		size_t activityIndex = ConvertActivityIdToActivityIndex(activityId);
+		CreateHistoricalActivityObject(activityIndex);
+	}
 
-	void GetHistoricalActivityStartAndEndTime(size_t activityIndex, time_t* const startTime, time_t* const endTime)
+	void CreateAllHistoricalActivityObjects()
 	{
-		if (activityIndex < g_historicalActivityList.size())
+		for (size_t i = 0; i < g_historicalActivityList.size(); ++i)
 		{
-			if (startTime)
-				(*startTime) = g_historicalActivityList.at(activityIndex).startTime;
-			if (endTime)
-				(*endTime) = g_historicalActivityList.at(activityIndex).endTime;
+			CreateHistoricalActivityObject(i);
 		}
 	}
 
-	void FixHistoricalActivityEndTime(size_t activityIndex)
+	bool LoadHistoricalActivityLapData(size_t activityIndex)
 	{
-		if (activityIndex < g_historicalActivityList.size())
+		bool result = false;
+		PooledDatabaseReader reader(g_pDatabaseReaders);
+		Database* pDatabase = HistoryDatabase(reader);
+
+		if (pDatabase && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
 		{
 			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
 
 			if (summary.pActivity)
 			{
-				summary.pActivity->SetEndTimeFromSensorReadings();
-				summary.endTime = summary.pActivity->GetEndTimeSecs();
-				g_pDatabase->UpdateActivityEndTime(summary.activityId, summary.endTime);
-			}
-		}
-	}
+				MovingActivity* pMovingActivity = dynamic_cast<MovingActivity*>(summary.pActivity);
 
-	char* GetHistoricalActivityType(size_t activityIndex)
-	{
-		if (activityIndex < g_historicalActivityList.size())
-		{
-			return strdup(g_historicalActivityList.at(activityIndex).type.c_str());
+				if (pMovingActivity)
+				{
+					LapSummaryList laps;
+					result = pDatabase->RetrieveLaps(summary.activityId, laps);
+					pMovingActivity->SetLaps(laps);
+				}
+			}
 		}
-		return NULL;
+		return result;
 	}
 
-	char* GetHistoricalActivityName(size_t activityIndex)
+	bool LoadHistoricalActivitySensorData(size_t activityIndex, SensorType sensor, SensorDataCallback callback, void* context)
 	{
-		if (activityIndex < g_historicalActivityList.size())
-		{
-			return strdup(g_historicalActivityList.at(activityIndex).name.c_str());
-		}
-		return NULL;
-	}
+		bool result = false;
+		PooledDatabaseReader reader(g_pDatabaseReaders);
+		Database* pDatabase = HistoryDatabase(reader);
 
-	char* GetHistoricalActivityAttributeName(size_t activityIndex, size_t attributeNameIndex)
-	{
-		if (activityIndex < g_historicalActivityList.size())
+		if (pDatabase && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
 		{
-			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
 
 			if (summary.pActivity)
 			{
-				std::vector<std::string> attributeNames;
-				summary.pActivity->BuildSummaryAttributeList(attributeNames);
-				std::sort(attributeNames.begin(), attributeNames.end());
+				if (summary.loadedSensors.count(sensor) > 0)
+				{
+					result = true;
+				}
+				else
+				{
+					SensorReadingList readings;
+					SensorReadingColumns* pColumns = NULL;
 
-				if (attributeNameIndex < attributeNames.size())
+					switch (sensor)
+					{
+						case SENSOR_TYPE_UNKNOWN:
+							break;
+						case SENSOR_TYPE_ACCELEROMETER:
+							result = pDatabase->RetrieveActivityAccelerometerReadings(summary.activityId, readings);
+							pColumns = &summary.accelerometerReadings;
+							break;
+						case SENSOR_TYPE_LOCATION:
+							// The activity object keeps the locations as its track, so the summary doesn't keep a second copy.
+							result = pDatabase->RetrieveActivityPositionReadings(summary.activityId, readings);
+							break;
+						case SENSOR_TYPE_HEART_RATE:
+							result = pDatabase->RetrieveActivityHeartRateMonitorReadings(summary.activityId, readings);
+							break;
+						case SENSOR_TYPE_CADENCE:
+							result = pDatabase->RetrieveActivityCadenceReadings(summary.activityId, readings);
+							break;
+						case SENSOR_TYPE_WHEEL_SPEED:
+							result = true;
+							break;
+						case SENSOR_TYPE_POWER:
+							result = pDatabase->RetrieveActivityPowerMeterReadings(summary.activityId, readings);
+							break;
+						case SENSOR_TYPE_FOOT_POD:
+							result = true;
+							break;
+						case SENSOR_TYPE_SCALE:
+						case SENSOR_TYPE_LIGHT:
+						case SENSOR_TYPE_RADAR:
+						case SENSOR_TYPE_GOPRO:
+						case NUM_SENSOR_TYPES:
+							result = false;
+							break;
+					}
+
+					if (result)
+					{
+						for (auto iter = readings.begin(); iter != readings.end(); ++iter)
+						{
+							const SensorReading& reading = (*iter);
+
+							summary.pActivity->ProcessSensorReading(reading);
+							if (pColumns)
+								pColumns->Append(reading);
+							if (callback)
+								callback(summary.activityId.c_str(), context);
+						}
+						summary.loadedSensors.insert(sensor);
+					}
+				}
+
+				if (result)
 				{
-					return strdup(attributeNames.at(attributeNameIndex).c_str());
+					TouchLoadedHistoricalActivity(activityIndex);
 				}
 			}
 		}
-		return NULL;
+		return result;
 	}
 
-	ActivityAttributeType QueryHistoricalActivityAttribute(size_t activityIndex, const char* const pAttributeName)
+	bool LoadAllHistoricalActivitySensorData(size_t activityIndex)
 	{
-		ActivityAttributeType result;
+		bool result = true;
 
-		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		if (g_pDatabase && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
 		{
-			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-
-			std::string attributeName = pAttributeName;
-			ActivityAttributeMap::const_iterator mapIter = summary.summaryAttributes.find(attributeName);
+			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
 
-			if (mapIter != summary.summaryAttributes.end())
+			if (summary.pActivity)
 			{
-				return summary.summaryAttributes.at(attributeName);
-			}
+				std::vector<SensorType> sensorTypes;
+				summary.pActivity->ListUsableSensors(sensorTypes);
 
-			if (summary.pActivity)
+				for (auto iter = sensorTypes.begin(); iter != sensorTypes.end() && result; ++iter)
+				{
+					if (!LoadHistoricalActivitySensorData(activityIndex, (*iter), NULL, NULL))
+					{
+						result = false;
+					}
+				}
+				
+				summary.pActivity->OnFinishedLoadingSensorData();
+			}
+			else
 			{
-				return summary.pActivity->QueryActivityAttribute(attributeName);
+				result = false;
 			}
 		}
-
-		result.valid = false;
+		else
+		{
+			result = false;
+		}
 		return result;
 	}
 
-	ActivityAttributeType QueryHistoricalActivityAttributeById(const char* activityId, const char* const pAttributeName)
-	{
-		size_t activityIndex = ConvertActivityIdToActivityIndex(activityId);
-		return QueryHistoricalActivityAttribute(activityIndex, pAttributeName);
-	}
-
-	size_t GetNumHistoricalActivityLocationPoints(size_t activityIndex)
+	HistoryLoadHandle StartHistoricalActivityLoad(size_t activityIndex, const std::set<SensorType>& sensors, HistoryLoadCallback callback, void* context)
 	{
-		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		if (!(g_pDatabaseReaders && g_pActivityFactory) || (activityIndex >= g_historicalActivityList.size()) || (activityIndex == ACTIVITY_INDEX_UNKNOWN))
 		{
-			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-			return summary.locationPoints.size();
+			return 0;
 		}
-		return 0;		
-	}
 
-	size_t GetNumHistoricalActivityAccelerometerReadings(size_t activityIndex)
-	{
-		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		HistoryLoadHandle handle = 0;
+		std::shared_ptr<HistoricalActivityLoader> pLoader;
+
 		{
-			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-			return summary.accelerometerReadings.size();
+			std::lock_guard<std::mutex> lock(g_historyLoadsMutex);
+
+			handle = g_nextHistoryLoadHandle++;
+			pLoader = std::make_shared<HistoricalActivityLoader>(handle, g_historicalActivityList.at(activityIndex), sensors, *g_pActivityFactory);
+			g_historyLoads.insert(std::make_pair(handle, pLoader));
+			++g_numHistoryLoadsRunning;
 		}
-		return 0;		
+
+		DatabaseReaderPool* pReaders = g_pDatabaseReaders;
+
+		GetHistoryLoadExecutor()->Submit([pLoader, pReaders, callback, context]
+		{
+			pLoader->Load(pReaders, callback, context);
+
+			// Notified under the lock so that CloseDatabase can't return while we're still touching the condition.
+			std::lock_guard<std::mutex> lock(g_historyLoadsMutex);
+			--g_numHistoryLoadsRunning;
+			g_historyLoadsIdle.notify_all();
+		});
+
+		return handle;
 	}
 
-	size_t GetNumHistoricalActivityAttributes(size_t activityIndex)
+	// Returns immediately, the callback is called on a worker thread (possibly before this returns) with batches
+	// of locations as they are processed and then once more with the outcome. The sensors that are already loaded
+	// are read again, since the load builds a new activity object to replace the current one.
+	HistoryLoadHandle LoadHistoricalActivitySensorDataAsync(size_t activityIndex, SensorType sensor, HistoryLoadCallback callback, void* context)
 	{
+		std::set<SensorType> sensors;
+
 		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
 		{
-			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-			if (summary.pActivity)
-			{
-				std::vector<std::string> attributeNames;
-				summary.pActivity->BuildSummaryAttributeList(attributeNames);
-				return attributeNames.size();
-			}
+			sensors = g_historicalActivityList.at(activityIndex).loadedSensors;
 		}
-		return 0;
+		sensors.insert(sensor);
+
+		return StartHistoricalActivityLoad(activityIndex, sensors, callback, context);
 	}
 
-	size_t GetNumHistoricalActivities()
+	HistoryLoadHandle LoadAllHistoricalActivitySensorDataAsync(size_t activityIndex, HistoryLoadCallback callback, void* context)
 	{
-		return g_historicalActivityList.size();
+		return StartHistoricalActivityLoad(activityIndex, std::set<SensorType>(), callback, context);
 	}
 
-	size_t GetNumHistoricalActivitiesByType(const char* const pActivityType)
+	// Called on the thread that owns the history, once the callback has reported that the load is complete, to swap
+	// the loaded data into the history. Returns false (and frees the handle) if the load didn't complete, the
+	// activity is no longer in the history, or the activity is pinned and so can't be replaced.
+	bool FinishHistoricalActivityLoad(HistoryLoadHandle handle)
 	{
-		size_t numActivities = 0;
+		std::shared_ptr<HistoricalActivityLoader> pLoader;
 
-		for (auto iter = g_historicalActivityList.begin(); iter != g_historicalActivityList.end(); ++iter)
 		{
-			ActivitySummary& summary = (*iter);
-			if (summary.type.compare(pActivityType) == 0)
+			std::lock_guard<std::mutex> lock(g_historyLoadsMutex);
+
+			auto iter = g_historyLoads.find(handle);
+			if ((iter == g_historyLoads.end()) || ((*iter).second->GetState() == HISTORY_LOAD_IN_PROGRESS))
 			{
-				++numActivities;
+				return false;
 			}
+			pLoader = (*iter).second;
+			g_historyLoads.erase(iter);
 		}
-		return numActivities;
-	}
 
-	void SetHistoricalActivityAttribute(size_t activityIndex, const char* const attributeName, ActivityAttributeType attributeValue)
-	{
-		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		if (pLoader->GetState() != HISTORY_LOAD_COMPLETE)
 		{
-			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-			if (summary.pActivity)
-			{
-				summary.pActivity->SetActivityAttribute(attributeName, attributeValue);
-			}
+			return false;
 		}
-	}
 
-	//
-	// Functions for accessing historical routes.
-	//
+		size_t activityIndex = ConvertActivityIdToActivityIndex(pLoader->GetActivityId().c_str());
+		if ((activityIndex >= g_historicalActivityList.size()) || (activityIndex == ACTIVITY_INDEX_UNKNOWN))
+		{
+			return false;
+		}
 
-	bool GetHistoricalActivityPoint(size_t activityIndex, size_t pointIndex, Coordinate* const coordinate)
-	{
-		bool result = false;
+		ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
 
-		if (coordinate == NULL)
+		if (IsHistoricalActivityPinned(summary.activityId))
 		{
 			return false;
 		}
-
-		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		if (summary.pActivity)
 		{
-			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-			if (pointIndex < summary.locationPoints.size())
-			{
-				SensorReading& reading = summary.locationPoints.at(pointIndex);
-				coordinate->latitude   = reading.reading.at(ACTIVITY_ATTRIBUTE_LATITUDE);
-				coordinate->longitude  = reading.reading.at(ACTIVITY_ATTRIBUTE_LONGITUDE);
-				coordinate->altitude   = reading.reading.at(ACTIVITY_ATTRIBUTE_ALTITUDE);
-				coordinate->time       = reading.time;
-				result = true;
-			}
+			delete summary.pActivity;
+			summary.pActivity = NULL;
 		}
-		return result;
-	}
+		ClearHistoricalActivitySensorData(summary);
 
-	bool GetActivityPoint(size_t pointIndex, Coordinate* const coordinate)
-	{
-		bool result = false;
-		
-		if (coordinate == NULL)
+		if (!pLoader->TakeResult(summary))
 		{
 			return false;
 		}
 
-		if (g_pCurrentActivity)
+		// The old activity object may have been given the stored summary values, so the new one needs them too.
+		for (auto attributeIter = summary.summaryAttributes.begin(); attributeIter != summary.summaryAttributes.end(); ++attributeIter)
 		{
-			MovingActivity* pMovingActivity = dynamic_cast<MovingActivity*>(g_pCurrentActivity);
-			if (pMovingActivity)
-			{
-				result = pMovingActivity->GetCoordinate(pointIndex, coordinate);
-			}
+			summary.pActivity->SetActivityAttribute(ActivityAttributeRegistry::Name((*attributeIter).first), (*attributeIter).second);
 		}
-		return result;
-	}
 
-	//
-	// Functions for modifying historical activity.
-	//
+		TouchLoadedHistoricalActivity(activityIndex);
+		return true;
+	}
 
-	bool TrimActivityData(const char* const activityId, uint64_t newTime, bool fromStart)
+	// The callback is still called, with HISTORY_LOAD_CANCELLED, if the load was running. The handle is freed.
+	void CancelHistoricalActivityLoad(HistoryLoadHandle handle)
 	{
-		bool result = false;
+		std::lock_guard<std::mutex> lock(g_historyLoadsMutex);
 
-		if (g_pDatabase)
+		auto iter = g_historyLoads.find(handle);
+		if (iter != g_historyLoads.end())
 		{
-			result  = g_pDatabase->TrimActivityAccelerometerReadings(activityId, newTime, fromStart);
-			result &= g_pDatabase->TrimActivityCadenceReadings(activityId, newTime, fromStart);
-			result &= g_pDatabase->TrimActivityPositionReadings(activityId, newTime, fromStart);
-			result &= g_pDatabase->TrimActivityHeartRateMonitorReadings(activityId, newTime, fromStart);
+			(*iter).second->Cancel();
+			g_historyLoads.erase(iter);
+		}
+	}
 
-			if (result)
-			{
-				newTime /= 1000;
+	// Cancels every asynchronous load and waits for them to leave their worker threads.
+	void CancelAllHistoricalActivityLoads()
+	{
+		std::unique_lock<std::mutex> lock(g_historyLoadsMutex);
 
-				if (fromStart)
-					result = g_pDatabase->UpdateActivityStartTime(activityId, (time_t)newTime);
-				else
-					result = g_pDatabase->UpdateActivityEndTime(activityId, (time_t)newTime);
-			}
+		for (auto iter = g_historyLoads.begin(); iter != g_historyLoads.end(); ++iter)
+		{
+			(*iter).second->Cancel();
 		}
-		return result;
+		g_historyLoads.clear();
+
+		g_historyLoadsIdle.wait(lock, [] { return g_numHistoryLoadsRunning == 0; });
 	}
 
-	//
+	bool LoadHistoricalActivitySummaryData(size_t activityIndex)
+	{
+		bool result = false;
+		PooledDatabaseReader reader(g_pDatabaseReaders);
+		Database* pDatabase = HistoryDatabase(reader);
+
+		if (pDatabase && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		{
+			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+
+			if (pDatabase->RetrieveSummaryData(summary.activityId, summary.summaryAttributes))
+			{
+				if (summary.pActivity)
+				{
+					for (auto attributeIter = summary.summaryAttributes.begin(); attributeIter != summary.summaryAttributes.end(); ++attributeIter)
+					{
+						std::string attributeName = ActivityAttributeRegistry::Name((*attributeIter).first);
+						const ActivityAttributeType& value = (*attributeIter).second;
+						
+						summary.pActivity->SetActivityAttribute(attributeName, value);
+					}
+					
+					result = true;
+				}
+			}
+		}
+		return result;
+	}
+
+	bool LoadAllHistoricalActivitySummaryData()
+	{
+		bool result = false;
+
+		PooledDatabaseReader reader(g_pDatabaseReaders);
+		Database* pDatabase = HistoryDatabase(reader);
+
+		// Read everything in one query rather than one query per activity.
+		if (pDatabase && pDatabase->RetrieveAllSummaryData(g_historicalActivityList))
+		{
+			result = true;
+
+			for (auto iter = g_historicalActivityList.begin(); iter != g_historicalActivityList.end(); ++iter)
+			{
+				ActivitySummary& summary = (*iter);
+
+				if (summary.pActivity)
+				{
+					for (auto attributeIter = summary.summaryAttributes.begin(); attributeIter != summary.summaryAttributes.end(); ++attributeIter)
+					{
+						summary.pActivity->SetActivityAttribute(ActivityAttributeRegistry::Name((*attributeIter).first), (*attributeIter).second);
+					}
+				}
+				else
+				{
+					result = false;
+				}
+			}
+		}
+		return result;
+	}
+
+	// Queries the summary attributes of the given activity, converted to the units in which they are stored.
+	void BuildActivitySummaryValues(const Activity* const pActivity, SummaryAttributeMap& values)
+	{
+		ActivityReprocessor::BuildSummaryValues(pActivity, values);
+	}
+
+	bool SaveHistoricalActivitySummaryData(size_t activityIndex)
+	{
+		bool result = false;
+
+		if (g_pDatabase && (activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		{
+			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+
+			if (summary.pActivity)
+			{
+				SummaryAttributeMap values;
+
+				BuildActivitySummaryValues(summary.pActivity, values);
+				result = g_pDatabase->CreateSummaryData(summary.activityId, values);
+			}
+		}
+		return result;
+	}
+
+	// Saves the summary data for every historical activity that has been loaded, in a single transaction.
+	bool SaveAllHistoricalActivitySummaryData()
+	{
+		bool result = false;
+
+		if (g_pDatabase)
+		{
+			ActivitySummaryList activitiesToSave;
+
+			for (auto iter = g_historicalActivityList.begin(); iter != g_historicalActivityList.end(); ++iter)
+			{
+				const ActivitySummary& summary = (*iter);
+
+				if (summary.pActivity)
+				{
+					ActivitySummary toSave;
+
+					toSave.activityId = summary.activityId;
+					toSave.type = summary.type;
+					toSave.pActivity = NULL;
+					BuildActivitySummaryValues(summary.pActivity, toSave.summaryAttributes);
+					activitiesToSave.push_back(toSave);
+				}
+			}
+
+			result = g_pDatabase->CreateSummaryData(activitiesToSave);
+		}
+		return result;
+	}
+
+	//
+	// Functions for unloading history.
+	//
+
+	void FreeHistoricalActivityList()
+	{
+		for (auto iter = g_historicalActivityList.begin(); iter != g_historicalActivityList.end(); ++iter)
+		{
+			ActivitySummary& summary = (*iter);
+
+			if (summary.pActivity)
+			{
+				delete summary.pActivity;
+				summary.pActivity = NULL;
+			}
+
+			ClearHistoricalActivitySensorData(summary);
+			summary.summaryAttributes.Clear();
+		}
+
+		g_historicalActivityList.clear();
+		g_activityIdMap.clear();
+		g_historicalActivityListLoaded = false;
+
+		g_loadedActivityLru.clear();
+		g_loadedActivities.clear();
+		g_evictedActivities.clear();
+		g_loadedActivityBytes = 0;
+	}
+
+	// Pinned activities are left alone.
+	void FreeHistoricalActivityObject(size_t activityIndex)
+	{
+		if (activityIndex < g_historicalActivityList.size())
+		{
+			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			if (IsHistoricalActivityPinned(summary.activityId))
+			{
+				return;
+			}
+			ForgetLoadedHistoricalActivity(summary.activityId);
+			if (summary.pActivity)
+			{
+				delete summary.pActivity;
+				summary.pActivity = NULL;
+			}
+
+			// The sensor data was fed to the object, so it has to be fed again to the next one.
+			ClearHistoricalActivitySensorData(summary);
+		}
+	}
+
+	void FreeHistoricalActivitySensorData(size_t activityIndex)
+	{
+		if (activityIndex < g_historicalActivityList.size())
+		{
+			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			ForgetLoadedHistoricalActivity(summary.activityId);
+
+			// Locations are part of the activity object's track and are only freed along with the object.
+			bool locationsLoaded = summary.loadedSensors.count(SENSOR_TYPE_LOCATION) > 0;
+			ClearHistoricalActivitySensorData(summary);
+			if (locationsLoaded)
+			{
+				summary.loadedSensors.insert(SENSOR_TYPE_LOCATION);
+			}
+		}
+	}
+
+	void FreeHistoricalActivitySummaryData(size_t activityIndex)
+	{
+		if (activityIndex < g_historicalActivityList.size())
+		{
+			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			summary.summaryAttributes.Clear();
+		}
+	}
+
+	//
+	// Functions for accessing historical data.
+	//
+
+	void GetHistoricalActivityStartAndEndTime(size_t activityIndex, time_t* const startTime, time_t* const endTime)
+	{
+		if (activityIndex < g_historicalActivityList.size())
+		{
+			if (startTime)
+				(*startTime) = g_historicalActivityList.at(activityIndex).startTime;
+			if (endTime)
+				(*endTime) = g_historicalActivityList.at(activityIndex).endTime;
+		}
+	}
+
+	void FixHistoricalActivityEndTime(size_t activityIndex)
+	{
+		EnsureHistoricalActivityIsLoaded(activityIndex);
+
+		if (activityIndex < g_historicalActivityList.size())
+		{
+			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+
+			if (summary.pActivity)
+			{
+				summary.pActivity->SetEndTimeFromSensorReadings();
+				summary.endTime = summary.pActivity->GetEndTimeSecs();
+				g_pDatabase->UpdateActivityEndTime(summary.activityId, summary.endTime);
+			}
+		}
+	}
+
+	char* GetHistoricalActivityType(size_t activityIndex)
+	{
+		if (activityIndex < g_historicalActivityList.size())
+		{
+			return strdup(g_historicalActivityList.at(activityIndex).type.c_str());
+		}
+		return NULL;
+	}
+
+	char* GetHistoricalActivityName(size_t activityIndex)
+	{
+		if (activityIndex < g_historicalActivityList.size())
+		{
+			return strdup(g_historicalActivityList.at(activityIndex).name.c_str());
+		}
+		return NULL;
+	}
+
+	char* GetHistoricalActivityAttributeName(size_t activityIndex, size_t attributeNameIndex)
+	{
+		if (activityIndex < g_historicalActivityList.size())
+		{
+			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+
+			if (summary.pActivity)
+			{
+				std::vector<std::string> attributeNames;
+				summary.pActivity->BuildSummaryAttributeList(attributeNames);
+				std::sort(attributeNames.begin(), attributeNames.end());
+
+				if (attributeNameIndex < attributeNames.size())
+				{
+					return strdup(attributeNames.at(attributeNameIndex).c_str());
+				}
+			}
+		}
+		return NULL;
+	}
+
+	ActivityAttributeType QueryHistoricalActivityAttribute(size_t activityIndex, const char* const pAttributeName)
+	{
+		ActivityAttributeType result;
+
+		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		{
+			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+
+			std::string attributeName = pAttributeName;
+			const ActivityAttributeType* summaryValue = summary.summaryAttributes.Find(attributeName);
+
+			if (summaryValue)
+			{
+				return *summaryValue;
+			}
+
+			EnsureHistoricalActivityIsLoaded(activityIndex);
+
+			if (summary.pActivity)
+			{
+				return summary.pActivity->QueryActivityAttribute(attributeName);
+			}
+		}
+
+		result.valid = false;
+		return result;
+	}
+
+	ActivityAttributeType QueryHistoricalActivityAttributeById(const char* activityId, const char* const pAttributeName)
+	{
+		size_t activityIndex = ConvertActivityIdToActivityIndex(activityId);
+		return QueryHistoricalActivityAttribute(activityIndex, pAttributeName);
+	}
+
+	size_t GetNumHistoricalActivityLocationPoints(size_t activityIndex)
+	{
+		EnsureHistoricalActivityIsLoaded(activityIndex);
+
+		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		{
+			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			const MovingActivity* pMovingActivity = dynamic_cast<const MovingActivity*>(summary.pActivity);
+
+			if (pMovingActivity)
+			{
+				return pMovingActivity->GetTrack().NumPositions();
+			}
+		}
+		return 0;		
+	}
+
+	size_t GetNumHistoricalActivityAccelerometerReadings(size_t activityIndex)
+	{
+		EnsureHistoricalActivityIsLoaded(activityIndex);
+
+		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		{
+			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			return summary.accelerometerReadings.NumReadings();
+		}
+		return 0;		
+	}
+
+	size_t GetNumHistoricalActivityAttributes(size_t activityIndex)
+	{
+		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		{
+			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			if (summary.pActivity)
+			{
+				std::vector<std::string> attributeNames;
+				summary.pActivity->BuildSummaryAttributeList(attributeNames);
+				return attributeNames.size();
+			}
+		}
+		return 0;
+	}
+
+	size_t GetNumHistoricalActivities()
+	{
+		return g_historicalActivityList.size();
+	}
+
+	size_t GetNumHistoricalActivitiesByType(const char* const pActivityType)
+	{
+		size_t numActivities = 0;
+
+		for (auto iter = g_historicalActivityList.begin(); iter != g_historicalActivityList.end(); ++iter)
+		{
+			ActivitySummary& summary = (*iter);
+			if (summary.type.compare(pActivityType) == 0)
+			{
+				++numActivities;
+			}
+		}
+		return numActivities;
+	}
+
+	void SetHistoricalActivityAttribute(size_t activityIndex, const char* const attributeName, ActivityAttributeType attributeValue)
+	{
+		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		{
+			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			if (summary.pActivity)
+			{
+				summary.pActivity->SetActivityAttribute(attributeName, attributeValue);
+			}
+		}
+	}
+
+	//
+	// Functions for accessing historical routes.
+	//
+
+	bool GetHistoricalActivityPoint(size_t activityIndex, size_t pointIndex, Coordinate* const coordinate)
+	{
+		bool result = false;
+
+		if (coordinate == NULL)
+		{
+			return false;
+		}
+
+		EnsureHistoricalActivityIsLoaded(activityIndex);
+
+		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		{
+			const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+			const MovingActivity* pMovingActivity = dynamic_cast<const MovingActivity*>(summary.pActivity);
+
+			if (pMovingActivity)
+			{
+				result = pMovingActivity->GetCoordinate(pointIndex, coordinate);
+			}
+		}
+		return result;
+	}
+
+	bool GetActivityPoint(size_t pointIndex, Coordinate* const coordinate)
+	{
+		bool result = false;
+		
+		if (coordinate == NULL)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (g_pCurrentActivity)
+		{
+			MovingActivity* pMovingActivity = dynamic_cast<MovingActivity*>(g_pCurrentActivity);
+			if (pMovingActivity)
+			{
+				result = pMovingActivity->GetCoordinate(pointIndex, coordinate);
+			}
+		}
+		return result;
+	}
+
+	//
+	// Functions for modifying historical activity.
+	//
+
+	bool TrimActivityData(const char* const activityId, uint64_t newTime, bool fromStart)
+	{
+		bool result = false;
+
+		if (g_pDatabase)
+		{
+			result  = g_pDatabase->TrimActivityAccelerometerReadings(activityId, newTime, fromStart);
+			result &= g_pDatabase->TrimActivityCadenceReadings(activityId, newTime, fromStart);
+			result &= g_pDatabase->TrimActivityPositionReadings(activityId, newTime, fromStart);
+			result &= g_pDatabase->TrimActivityHeartRateMonitorReadings(activityId, newTime, fromStart);
+
+			if (result)
+			{
+				newTime /= 1000;
+
+				if (fromStart)
+					result = g_pDatabase->UpdateActivityStartTime(activityId, (time_t)newTime);
+				else
+					result = g_pDatabase->UpdateActivityEndTime(activityId, (time_t)newTime);
+			}
+
+			// The activity's times and sensor data changed, so the cached history has to be reloaded.
+			FreeHistoricalActivityList();
+		}
+		return result;
+	}
+
+	// True if any activity has a summary from an older version of the summary calculations, or none recorded at all,
+	// which is also the case for every activity after the summary version table is first created.
+	bool IsActivityReprocessingNeeded(void)
+	{
+		PooledDatabaseReader reader(g_pDatabaseReaders);
+		Database* pDatabase = HistoryDatabase(reader);
+
+		if (pDatabase)
+		{
+			return pDatabase->HasActivitiesWithOldSummaries(SUMMARY_ALGORITHM_VERSION);
+		}
+		return false;
+	}
+
+	bool IsReprocessingActivities(void)
+	{
+		std::lock_guard<std::mutex> lock(g_activityReprocessorMutex);
+		return g_pActivityReprocessor != NULL;
+	}
+
+	// Blocks until every activity is done, so should be called from a background thread. The cached history
+	// is reloaded by the next call to InitializeHistoricalActivityList.
+	bool ReprocessAllActivities(bool restart, ExportProgressCallback progressCallback, void* context)
+	{
+		if (!(g_pDatabase && g_pActivityFactory))
+		{
+			return false;
+		}
+
+		ActivityReprocessor* pReprocessor = NULL;
+
+		{
+			std::lock_guard<std::mutex> lock(g_activityReprocessorMutex);
+
+			// Only one reprocessing at a time.
+			if (g_pActivityReprocessor)
+			{
+				return false;
+			}
+			pReprocessor = g_pActivityReprocessor = new ActivityReprocessor();
+		}
+
+		// The workers get their own copy of the factory so they don't contend with the UI.
+		ActivityFactory factory = *g_pActivityFactory;
+		std::shared_ptr<TaskExecutor> pExecutor = GetTaskExecutor();
+		bool result = pReprocessor->ReprocessAllFromDatabase(g_pDatabase->GetFileName(), restart, factory, *pExecutor, progressCallback, context);
+
+		// Even a cancelled or failed run may have rewritten some of the summaries.
+		g_historicalActivityListStale = true;
+
+		{
+			std::lock_guard<std::mutex> lock(g_activityReprocessorMutex);
+			g_pActivityReprocessor = NULL;
+		}
+		delete pReprocessor;
+
+		return result;
+	}
+
+	// Activities that were finished before cancelling keep their new summaries, the rest are done by the next call.
+	void CancelReprocessAllActivities(void)
+	{
+		std::lock_guard<std::mutex> lock(g_activityReprocessorMutex);
+
+		if (g_pActivityReprocessor)
+		{
+			g_pActivityReprocessor->Cancel();
+		}
+	}
+
+	//
 	// Functions for listing activity types.
 	//
 
@@ -1665,18 +2355,22 @@ extern "C" {
 
 	void GetActivityAttributeNames(AttributeNameCallback callback, void* context)
 	{
-		if (g_pCurrentActivity)
-		{
-			std::vector<std::string> attributeNames;
+		std::vector<std::string> attributeNames;
 
-			g_pCurrentActivity->BuildAttributeList(attributeNames);
-			std::sort(attributeNames.begin(), attributeNames.end());
+		{
+			std::lock_guard<std::mutex> lock(g_currentActivityMutex);
 
-			for (auto iter = attributeNames.begin(); iter != attributeNames.end(); ++iter)
+			if (g_pCurrentActivity)
 			{
-				callback((*iter).c_str(), context);
+				g_pCurrentActivity->BuildAttributeList(attributeNames);
 			}
 		}
+		std::sort(attributeNames.begin(), attributeNames.end());
+
+		for (auto iter = attributeNames.begin(); iter != attributeNames.end(); ++iter)
+		{
+			callback((*iter).c_str(), context);
+		}
 	}
 
 	//
@@ -1685,27 +2379,51 @@ extern "C" {
 
 	void GetUsableSensorTypes(SensorTypeCallback callback, void* context)
 	{
-		if (g_pCurrentActivity)
+		std::vector<SensorType> sensorTypes;
+
 		{
-			std::vector<SensorType> sensorTypes;
+			std::lock_guard<std::mutex> lock(g_currentActivityMutex);
 
-			g_pCurrentActivity->ListUsableSensors(sensorTypes);
-			for (auto iter = sensorTypes.begin(); iter != sensorTypes.end(); ++iter)
+			if (g_pCurrentActivity)
 			{
-				callback((*iter), context);
+				g_pCurrentActivity->ListUsableSensors(sensorTypes);
 			}
 		}
+		for (auto iter = sensorTypes.begin(); iter != sensorTypes.end(); ++iter)
+		{
+			callback((*iter), context);
+		}
 	}
 
 	//
 	// Functions for estimating the athlete's fitness.
 	//
 
-	// InitializeHistoricalActivityList and LoadAllHistoricalActivitySummaryData should be called before calling this.
 	double EstimateFtp(void)
 	{
-		FtpCalculator calc;
-		return calc.Estimate(g_historicalActivityList);
+		if (g_pDatabase)
+		{
+			FtpCalculator calc;
+			return calc.Estimate(*g_pDatabase);
+		}
+		return (double)0.0;
+	}
+
+	// Calls the callback once for every day in the time range. The loads are maintained as summary data is saved,
+	// so history doesn't need to be loaded.
+	size_t QueryTrainingLoads(time_t startTime, time_t endTime, TrainingLoadCallback callback, void* context)
+	{
+		TrainingLoadList loads;
+
+		if (g_pDatabase && callback && g_pDatabase->RetrieveTrainingLoads(startTime, endTime, loads))
+		{
+			for (auto iter = loads.begin(); iter != loads.end(); ++iter)
+			{
+				const TrainingLoad& load = (*iter);
+				callback(load.day, load.stress, load.chronicLoad, load.acuteLoad, load.chronicLoad - load.acuteLoad, context);
+			}
+		}
+		return loads.size();
 	}
 
 	//
@@ -1763,7 +2481,6 @@ extern "C" {
 		return 0;
 	}
 
-	// InitializeHistoricalActivityList and LoadAllHistoricalActivitySummaryData should be called before calling this.
 	bool GenerateWorkouts(void)
 	{
 		if (g_pDatabase)
@@ -1771,7 +2488,7 @@ extern "C" {
 			WorkoutPlanGenerator gen;
 
 			// Generate new workouts.
-			std::map<std::string, double> inputs = gen.CalculateInputs(g_historicalActivityList);
+			std::map<std::string, double> inputs = gen.CalculateInputs(*g_pDatabase);
 			std::vector<Workout*> plannedWorkouts = gen.GenerateWorkouts(inputs);
 
 			// Delete old workouts.
@@ -1870,362 +2587,868 @@ extern "C" {
 	// Functions for creating and destroying the current activity.
 	//
 
-	// Creates the activity object, does not create an entry in the database.
-	// It should be followed by a call to StartActivity to make the initial entry in the database.
-	// This is done this way so that an activity can be cancelled before it is started.
-	void CreateActivityObject(const char* const activityType)
+	// Creates the activity object, does not create an entry in the database.
+	// It should be followed by a call to StartActivity to make the initial entry in the database.
+	// This is done this way so that an activity can be cancelled before it is started.
+	void CreateActivityObject(const char* const activityType)
+	{
+		if (!activityType)
+		{
+			return;
+		}
+
+		if (IsActivityCreated())
+		{
+			StopCurrentActivity();
+			DestroyCurrentActivity();
+		}
+		if (g_pActivityFactory)
+		{
+			Activity* pActivity = g_pActivityFactory->CreateActivity(activityType, *g_pDatabase);
+
+			std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+			g_pCurrentActivity = pActivity;
+		}
+	}
+
+	void ReCreateOrphanedActivity(size_t activityIndex)
+	{
+		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
+		{
+			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+
+			if (!summary.pActivity)
+			{
+				g_pActivityFactory->CreateActivity(summary, *g_pDatabase);
+
+				LoadHistoricalActivityLapData(activityIndex);
+				LoadAllHistoricalActivitySensorData(activityIndex);
+
+				// The object now belongs to the current activity, so it must not be evicted with the history.
+				{
+					std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+					g_pCurrentActivity = summary.pActivity;
+				}
+				ForgetLoadedHistoricalActivity(summary.activityId);
+				ClearHistoricalActivitySensorData(summary);
+				summary.pActivity = NULL;
+
+				// Recording picks up where it left off.
+				if (IsActivityInProgress())
+				{
+					StartSensorProcessing();
+				}
+			}
+		}
+	}
+
+	void DestroyCurrentActivity()
+	{
+		StopSensorProcessing();
+
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (g_pCurrentActivity)
+		{
+			g_pCurrentActivity->Stop();
+
+			// Anything still queued belongs to the activity being thrown away.
+			DrainSensorReadingQueue(SIZE_MAX);
+			StopSensorReadingWriter();
+
+			delete g_pCurrentActivity;
+			g_pCurrentActivity = NULL;
+		}
+	}
+
+	char* GetCurrentActivityType()
+	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (g_pCurrentActivity)
+		{
+			return strdup(g_pCurrentActivity->GetType().c_str());
+		}
+		return NULL;
+	}
+
+	// The string belongs to the current activity, so it's only valid until the activity is destroyed.
+	const char* const GetCurrentActivityId()
+	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (g_pCurrentActivity)
+		{
+			return g_pCurrentActivity->GetIdCStr();
+		}
+		return NULL;
+	}
+
+	//
+	// Functions for starting/stopping the current activity.
+	//
+
+	// The caller must hold g_currentActivityMutex.
+	void InsertCurrentActivityIntoHistory()
+	{
+		ActivitySummary summary;
+
+		summary.activityId = g_pCurrentActivity->GetId();
+		summary.type = g_pCurrentActivity->GetType();
+		summary.startTime = g_pCurrentActivity->GetStartTimeSecs();
+		summary.endTime = 0;
+		summary.pActivity = NULL;
+		InsertHistoricalActivity(summary);
+	}
+
+	// Starts the activity and creates its database entry. A start time of zero means now.
+	// The caller must hold g_currentActivityMutex.
+	bool StartCurrentActivity(const char* const activityId, time_t startTime)
+	{
+		if (g_pCurrentActivity && !g_pCurrentActivity->HasStarted() && g_pDatabase)
+		{
+			if (g_pCurrentActivity->Start())
+			{
+				if (startTime != 0)
+				{
+					g_pCurrentActivity->SetStartTimeSecs(startTime);
+				}
+
+				if (g_pDatabase->StartActivity(activityId, "", g_pCurrentActivity->GetType(), g_pCurrentActivity->GetStartTimeSecs()))
+				{
+					g_pCurrentActivity->SetId(activityId);
+					InsertCurrentActivityIntoHistory();
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	bool StartActivity(const char* const activityId)
+	{
+		{
+			std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+			if (!StartCurrentActivity(activityId, 0))
+			{
+				return false;
+			}
+		}
+		StartSensorProcessing();
+		return true;
+	}
+
+	bool StartActivityWithTimestamp(const char* const activityId, time_t startTime)
+	{
+		{
+			std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+			if (!StartCurrentActivity(activityId, startTime))
+			{
+				return false;
+			}
+		}
+		StartSensorProcessing();
+		return true;
+	}
+
+	bool StopCurrentActivity()
+	{
+		// Stop accepting readings and apply everything that was accepted before the activity is stopped.
+		StopSensorProcessing();
+
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		DrainSensorReadingQueue(SIZE_MAX);
+		StopSensorReadingWriter();
+
+		if (g_pCurrentActivity && g_pCurrentActivity->HasStarted())
+		{
+			g_pCurrentActivity->Stop();
+
+			if (g_pDatabase && g_pDatabase->StopActivity(g_pCurrentActivity->GetEndTimeSecs(), g_pCurrentActivity->GetId()))
+			{
+				size_t activityIndex = ConvertActivityIdToActivityIndex(g_pCurrentActivity->GetIdCStr());
+
+				if (activityIndex < g_historicalActivityList.size())
+				{
+					g_historicalActivityList.at(activityIndex).endTime = g_pCurrentActivity->GetEndTimeSecs();
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool PauseCurrentActivity()
+	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (g_pCurrentActivity && g_pCurrentActivity->HasStarted())
+		{
+			// Readings taken before the pause (or resume) belong on that side of it, and are on disk before it returns.
+			DrainSensorReadingQueue(SIZE_MAX);
+			if (g_pSensorReadingWriter)
+			{
+				g_pSensorReadingWriter->Flush();
+			}
+
+			g_pCurrentActivity->Pause();
+			PublishLiveAttributeSnapshot();
+			return g_pCurrentActivity->IsPaused();
+		}
+		return false;
+	}
+
+	bool StartNewLap()
+	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (g_pCurrentActivity && g_pCurrentActivity->HasStarted() && g_pDatabase)
+		{
+			MovingActivity* pMovingActivity = dynamic_cast<MovingActivity*>(g_pCurrentActivity);
+
+			if (pMovingActivity)
+			{
+				pMovingActivity->StartNewLap();
+				PublishLiveAttributeSnapshot();
+				return g_pDatabase->CreateNewLap(g_pCurrentActivity->GetId(), pMovingActivity->GetCurrentLapStartTime());
+			}
+		}
+		return false;
+	}
+
+	bool SaveActivitySummaryData()
+	{
+		bool result = false;
+		std::string activityId;
+		SummaryAttributeMap values;
+
+		// The values are computed under the lock, but written without it.
+		{
+			std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+			if (!g_pCurrentActivity || !g_pCurrentActivity->HasStopped())
+			{
+				return false;
+			}
+			activityId = g_pCurrentActivity->GetId();
+			BuildActivitySummaryValues(g_pCurrentActivity, values);
+		}
+
+		if (g_pDatabase)
+		{
+			result = g_pDatabase->CreateSummaryData(activityId, values);
+
+			// Computed from every reading as it arrived, so there's nothing for reprocessing to do.
+			if (result)
+			{
+				result = g_pDatabase->UpdateSummaryVersion(activityId, SUMMARY_ALGORITHM_VERSION);
+			}
+		}
+		return result;
+	}
+
+	//
+	// Functions for managing the autostart state.
+	//
+
+	bool IsAutoStartEnabled()
+	{
+		return g_autoStartEnabled;
+	}
+	
+	void SetAutoStart(bool value)
+	{
+		g_autoStartEnabled = value;
+	}
+
+	//
+	// Functions for querying the status of the current activity.
+	//
+	
+	bool IsActivityCreated()
+	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+		return (g_pCurrentActivity != NULL);
+	}
+
+	bool IsActivityInProgress()
+	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+		return IsCurrentActivityInProgress();
+	}
+	
+	bool IsActivityInProgressAndNotPaused()
+	{
+		return IsActivityInProgress() && !IsActivityPaused();
+	}
+
+	bool IsActivityOrphaned(size_t* activityIndex)
 	{
-		if (!activityType)
-		{
-			return;
-		}
+		bool result = false;
 
-		if (g_pCurrentActivity)
-		{
-			StopCurrentActivity();
-			DestroyCurrentActivity();
-		}
-		if (g_pActivityFactory)
+		InitializeHistoricalActivityList();
+
+		size_t numActivities = GetNumHistoricalActivities();
+		if (numActivities > 0)
 		{
-			g_pCurrentActivity = g_pActivityFactory->CreateActivity(activityType, *g_pDatabase);
+			time_t startTime = 0;
+			time_t endTime = 0;
+
+			(*activityIndex) = numActivities - 1;
+			GetHistoricalActivityStartAndEndTime((*activityIndex), &startTime, &endTime);
+			result = (endTime == 0);
 		}
+		return result;
 	}
 
-	void ReCreateOrphanedActivity(size_t activityIndex)
+	bool IsActivityPaused()
 	{
-		if ((activityIndex < g_historicalActivityList.size()) && (activityIndex != ACTIVITY_INDEX_UNKNOWN))
-		{
-			ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
-
-			if (!summary.pActivity)
-			{
-				g_pActivityFactory->CreateActivity(summary, *g_pDatabase);
-				g_pCurrentActivity = summary.pActivity;
-
-				LoadHistoricalActivityLapData(activityIndex);
-				LoadAllHistoricalActivitySensorData(activityIndex);
-				
-				summary.pActivity = NULL;
-			}
-		}
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+		return (g_pCurrentActivity && g_pCurrentActivity->IsPaused());
 	}
 
-	void DestroyCurrentActivity()
+	bool IsMovingActivity()
 	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
 		if (g_pCurrentActivity)
 		{
-			g_pCurrentActivity->Stop();
-			delete g_pCurrentActivity;
-			g_pCurrentActivity = NULL;
+			MovingActivity* pMovingActivity = dynamic_cast<MovingActivity*>(g_pCurrentActivity);
+			return pMovingActivity != NULL;
 		}
+		return false;
 	}
 
-	char* GetCurrentActivityType()
+	bool IsLiftingActivity()
 	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
 		if (g_pCurrentActivity)
 		{
-			return strdup(g_pCurrentActivity->GetType().c_str());
+			LiftingActivity* pLiftingActivity = dynamic_cast<LiftingActivity*>(g_pCurrentActivity);
+			return pLiftingActivity != NULL;
 		}
-		return NULL;
+		return false;
 	}
 
-	const char* const GetCurrentActivityId()
+	bool IsCyclingActivity()
 	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
 		if (g_pCurrentActivity)
 		{
-			return g_pCurrentActivity->GetIdCStr();
+			Cycling* pCycling = dynamic_cast<Cycling*>(g_pCurrentActivity);
+			return pCycling != NULL;
 		}
-		return NULL;
+		return false;
 	}
 
 	//
-	// Functions for starting/stopping the current activity.
+	// Functions for importing/exporting activities.
 	//
 
-	bool StartActivity(const char* const activityId)
+	bool ImportActivityFromFile(const char* const pFileName, const char* const pActivityType, const char* const activityId)
 	{
-		if (g_pCurrentActivity && !g_pCurrentActivity->HasStarted() && g_pDatabase)
+		bool result = false;
+
+		if (pFileName)
 		{
-			if (g_pCurrentActivity->Start())
+			std::string fileName = pFileName;
+			std::string fileExtension = fileName.substr(fileName.find_last_of(".") + 1);;
+			DataImporter importer;
+
+			if (fileExtension.compare("gpx") == 0)
 			{
-				if (g_pDatabase->StartActivity(activityId, "", g_pCurrentActivity->GetType(), g_pCurrentActivity->GetStartTimeSecs()))
-				{
-					g_pCurrentActivity->SetId(activityId);
-					return true;
-				}
+				result = importer.ImportFromGpx(pFileName, pActivityType, activityId, g_pDatabase);
+			}
+			else if (fileExtension.compare("tcx") == 0)
+			{
+				result = importer.ImportFromTcx(pFileName, pActivityType, activityId, g_pDatabase);
+			}
+			else if (fileExtension.compare("csv") == 0)
+			{
+				result = importer.ImportFromCsv(pFileName, pActivityType, activityId, g_pDatabase);
 			}
-		}
-		return false;
-	}
 
-	bool StartActivityWithTimestamp(const char* const activityId, time_t startTime)
-	{
-		if (g_pCurrentActivity && !g_pCurrentActivity->HasStarted() && g_pDatabase)
-		{
-			if (g_pCurrentActivity->Start())
+			if (result)
 			{
-				g_pCurrentActivity->SetStartTimeSecs(startTime);
+				ActivitySummary summary;
 
-				if (g_pDatabase->StartActivity(activityId, "", g_pCurrentActivity->GetType(), g_pCurrentActivity->GetStartTimeSecs()))
+				if (g_pDatabase->RetrieveActivity(activityId, summary) && (summary.activityId.size() > 0))
 				{
-					g_pCurrentActivity->SetId(activityId);
-					return true;
+					InsertHistoricalActivity(summary);
 				}
 			}
 		}
-		return false;
+		return result;
 	}
 
-	bool StopCurrentActivity()
+	// Loads the activity if it was evicted and pins it, so that the returned object stays valid (even if other
+	// history is loaded in the meantime) until UnpinHistoricalActivity is called. Pins are counted.
+	const Activity* PinHistoricalActivity(const char* const activityId)
 	{
-		if (g_pCurrentActivity && g_pCurrentActivity->HasStarted())
+		size_t activityIndex = ConvertActivityIdToActivityIndex(activityId);
+
+		if ((activityIndex >= g_historicalActivityList.size()) || (activityIndex == ACTIVITY_INDEX_UNKNOWN))
 		{
-			g_pCurrentActivity->Stop();
+			return NULL;
+		}
 
-			if (g_pDatabase)
-			{
-				return g_pDatabase->StopActivity(g_pCurrentActivity->GetEndTimeSecs(), g_pCurrentActivity->GetId());
-			}
+		EnsureHistoricalActivityIsLoaded(activityIndex);
+
+		const ActivitySummary& summary = g_historicalActivityList.at(activityIndex);
+		if (summary.pActivity)
+		{
+			++g_pinnedActivities[summary.activityId];
 		}
-		return false;
+		return summary.pActivity;
 	}
 
-	bool PauseCurrentActivity()
+	void UnpinHistoricalActivity(const char* const activityId)
 	{
-		if (g_pCurrentActivity && g_pCurrentActivity->HasStarted())
+		auto iter = g_pinnedActivities.find(activityId);
+
+		if (iter != g_pinnedActivities.end())
 		{
-			g_pCurrentActivity->Pause();
-			return g_pCurrentActivity->IsPaused();
+			if (--(*iter).second == 0)
+			{
+				g_pinnedActivities.erase(iter);
+			}
+
+			// Anything that was kept over the budget because it was pinned can go now.
+			EnforceLoadedHistoricalActivityBudget();
 		}
-		return false;
 	}
 
-	bool StartNewLap()
+	char* ExportActivityFromDatabase(const char* const activityId, FileFormat format, const char* const pDirName)
 	{
-		if (g_pCurrentActivity && g_pCurrentActivity->HasStarted() && g_pDatabase)
+		char* result = NULL;
+		const Activity* pActivity = PinHistoricalActivity(activityId);
+
+		if (pActivity)
 		{
-			MovingActivity* pMovingActivity = dynamic_cast<MovingActivity*>(g_pCurrentActivity);
+			std::string tempFileName = pDirName;
+			DataExporter exporter;
+			PooledDatabaseReader reader(g_pDatabaseReaders);
 
-			if (pMovingActivity)
+			if (exporter.ExportFromDatabase(format, tempFileName, HistoryDatabase(reader), pActivity))
 			{
-				pMovingActivity->StartNewLap();
-				return g_pDatabase->CreateNewLap(g_pCurrentActivity->GetId(), pMovingActivity->GetCurrentLapStartTime());
+				result = strdup(tempFileName.c_str());
 			}
+			UnpinHistoricalActivity(activityId);
 		}
-		return false;
+		return result;
 	}
 
-	bool SaveActivitySummaryData()
+	bool ExportActivityFromDatabaseToBuffer(const char* const activityId, FileFormat format, bool compress, uint8_t** buffer, size_t* bufferLen)
 	{
 		bool result = false;
-		
-		if (g_pCurrentActivity && g_pCurrentActivity->HasStopped())
+
+		if (!(buffer && bufferLen))
+		{
+			return false;
+		}
+
+		const Activity* pActivity = PinHistoricalActivity(activityId);
+
+		if (pActivity)
 		{
-			std::vector<std::string> attributes;
-			g_pCurrentActivity->BuildSummaryAttributeList(attributes);
+			std::string exportBuffer;
+			DataExporter exporter;
+			PooledDatabaseReader reader(g_pDatabaseReaders);
 
-			for (auto iter = attributes.begin(); iter != attributes.end(); ++iter)
+			// An empty export has nothing to hand back, and malloc(0) may return NULL or a pointer that can't be used.
+			if (exporter.ExportFromDatabaseToBuffer(format, exportBuffer, compress, HistoryDatabase(reader), pActivity) && exportBuffer.size() > 0)
 			{
-				const std::string& attribute = (*iter);
-				ActivityAttributeType value = g_pCurrentActivity->QueryActivityAttribute(attribute);
-
-				if (value.valid)
+				// Caller is responsible for freeing the buffer.
+				(*buffer) = (uint8_t*)malloc(exportBuffer.size());
+				if (*buffer)
 				{
-					UnitMgr::ConvertActivityAttributeToCustomaryUnits(value);
-					result = g_pDatabase->CreateSummaryData(g_pCurrentActivity->GetId(), attribute, value);
+					memcpy(*buffer, exportBuffer.data(), exportBuffer.size());
+					(*bufferLen) = exportBuffer.size();
+					result = true;
 				}
 			}
+			UnpinHistoricalActivity(activityId);
 		}
 		return result;
 	}
 
-	//
-	// Functions for managing the autostart state.
-	//
+	bool ExportActivityFromDatabaseUsingWriteCallback(const char* const activityId, FileFormat format, bool compress, ExportDataCallback callback, void* context)
+	{
+		bool result = false;
 
-	bool IsAutoStartEnabled()
+		// The callback may well call back into the history, so the activity has to survive anything it loads.
+		const Activity* pActivity = PinHistoricalActivity(activityId);
+
+		if (pActivity)
+		{
+			DataExporter exporter;
+			PooledDatabaseReader reader(g_pDatabaseReaders);
+			result = exporter.ExportFromDatabaseUsingWriteCallback(format, callback, context, compress, HistoryDatabase(reader), pActivity);
+			UnpinHistoricalActivity(activityId);
+		}
+		return result;
+	}
+
+	char* ExportActivityUsingCallbackData(const char* const activityId, FileFormat format, const char* const pDirName, time_t startTime, const char* const sportType, GetNextCoordinateCallback nextCoordinateCallback, void* context)
 	{
-		return g_autoStartEnabled;
+		std::string tempFileName = pDirName;
+		std::string tempSportType = sportType;
+		DataExporter exporter;
+
+		if (exporter.ExportUsingCallbackData(format, tempFileName, startTime, tempSportType, activityId, nextCoordinateCallback, context))
+		{
+			return strdup(tempFileName.c_str());
+		}
+		return NULL;
 	}
-	
-	void SetAutoStart(bool value)
+
+	char* ExportActivitySummary(const char* activityType, const char* const dirName)
 	{
-		g_autoStartEnabled = value;
+		std::string activityTypeStr = activityType;
+		std::string tempFileName = dirName;
+		DataExporter exporter;
+
+		if (exporter.ExportActivitySummary(g_historicalActivityList, activityTypeStr, tempFileName))
+		{
+			return strdup(tempFileName.c_str());
+		}
+		return NULL;
 	}
 
-	//
-	// Functions for querying the status of the current activity.
-	//
-	
-	bool IsActivityCreated()
+	char* ExportAllSensorDataToParquet(const char* const dirName)
 	{
-		return (g_pCurrentActivity != NULL);
+		if (!g_pDatabase)
+		{
+			return NULL;
+		}
+
+		std::string tempFileName = dirName;
+		DataExporter exporter;
+		PooledDatabaseReader reader(g_pDatabaseReaders);
+
+		if (exporter.ExportSensorHistoryToParquet(tempFileName, HistoryDatabase(reader)))
+		{
+			return strdup(tempFileName.c_str());
+		}
+		return NULL;
 	}
 
-	bool IsActivityInProgress()
+	// Blocks until the archive is complete, so should be called from a background thread.
+	char* ExportAllActivitiesToArchive(FileFormat format, const char* const dirName, ExportProgressCallback progressCallback, void* context)
 	{
-		return (g_pCurrentActivity && g_pCurrentActivity->HasStarted() && !g_pCurrentActivity->HasStopped());
+		if (!(g_pDatabase && g_pActivityFactory))
+		{
+			return NULL;
+		}
+
+		ArchiveExporter* pExporter = NULL;
+
+		{
+			std::lock_guard<std::mutex> lock(g_archiveExporterMutex);
+
+			// Only one archive export at a time.
+			if (g_pArchiveExporter)
+			{
+				return NULL;
+			}
+			pExporter = g_pArchiveExporter = new ArchiveExporter();
+		}
+
+		// The workers get their own copy of the factory so they don't contend with the UI.
+		ActivityFactory factory = *g_pActivityFactory;
+		std::string tempFileName = dirName;
+		char* result = NULL;
+		std::shared_ptr<TaskExecutor> pExecutor = GetTaskExecutor();
+
+		if (pExporter->ExportAllFromDatabase(format, tempFileName, g_pDatabase->GetFileName(), factory, *pExecutor, progressCallback, context))
+		{
+			result = strdup(tempFileName.c_str());
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(g_archiveExporterMutex);
+			g_pArchiveExporter = NULL;
+		}
+		delete pExporter;
+
+		return result;
 	}
-	
-	bool IsActivityInProgressAndNotPaused()
+
+	void CancelExportAllActivitiesToArchive(void)
 	{
-		return IsActivityInProgress() && !IsActivityPaused();
+		std::lock_guard<std::mutex> lock(g_archiveExporterMutex);
+
+		if (g_pArchiveExporter)
+		{
+			g_pArchiveExporter->Cancel();
+		}
 	}
 
-	bool IsActivityOrphaned(size_t* activityIndex)
+	//
+	// Functions for processing sensor reads.
+	//
+
+	// Applies a reading to the current activity and stores it. Only called by whichever thread holds g_currentActivityMutex.
+	bool ProcessSensorReading(const SensorReading& reading)
 	{
 		bool result = false;
 
-		InitializeHistoricalActivityList();
+		if (IsCurrentActivityInProgress())
+		{
+			bool processed = g_pCurrentActivity->ProcessSensorReading(reading);
+
+			if (processed && g_pSensorReadingWriter)
+			{
+				result = g_pSensorReadingWriter->Write(g_pCurrentActivity->GetId(), reading);
+			}
+			else if (processed && g_pDatabase)
+			{
+				result = g_pDatabase->CreateSensorReading(g_pCurrentActivity->GetId(), reading);
+			}
+		}
 
-		size_t numActivities = GetNumHistoricalActivities();
-		if (numActivities > 0)
+		// Wheel revolutions also count towards the bike's mileage.
+		// It goes through the writer, since the shared connection may be in the middle of a transaction on another thread.
+		if (reading.type == SENSOR_TYPE_WHEEL_SPEED)
 		{
-			time_t startTime = 0;
-			time_t endTime = 0;
-
-			(*activityIndex) = numActivities - 1;
-			GetHistoricalActivityStartAndEndTime((*activityIndex), &startTime, &endTime);
-			result = (endTime == 0);
+			Cycling* pCycling = dynamic_cast<Cycling*>(g_pCurrentActivity);
+			if (pCycling)
+			{
+				Bike bike = pCycling->GetBikeProfile();
+				if (bike.id > BIKE_ID_NOT_SET)
+				{
+					if (g_pSensorReadingWriter)
+					{
+						g_pSensorReadingWriter->UpdateBike(bike);
+					}
+					else if (g_pDatabase)
+					{
+						g_pDatabase->UpdateBike(bike);
+					}
+				}
+			}
 		}
 		return result;
 	}
 
-	bool IsActivityPaused()
+	// Pops and processes up to maxReadings queued readings. The caller must hold g_currentActivityMutex,
+	// which is what makes it the queue's single consumer.
+	size_t DrainSensorReadingQueue(size_t maxReadings)
 	{
-		return (g_pCurrentActivity && g_pCurrentActivity->IsPaused());
-	}
+		size_t numProcessed = 0;
+		QueuedSensorReading queued;
+		SensorReading reading;
 
-	bool IsMovingActivity()
-	{
-		if (g_pCurrentActivity)
+		while ((numProcessed < maxReadings) && g_sensorReadingQueue.Pop(queued))
 		{
-			MovingActivity* pMovingActivity = dynamic_cast<MovingActivity*>(g_pCurrentActivity);
-			return pMovingActivity != NULL;
+			SensorReadingQueue::ToSensorReading(queued, reading);
+			ProcessSensorReading(reading);
+			++numProcessed;
 		}
-		return false;
+		return numProcessed;
 	}
 
-	bool IsLiftingActivity()
+	// Recomputes every live attribute and swaps the result in for the UI to read. Replaced snapshots are freed
+	// when the last reader lets go of them, so readers never see a half written one and never wait for this.
+	// The caller must hold g_currentActivityMutex.
+	void PublishLiveAttributeSnapshot()
 	{
-		if (g_pCurrentActivity)
+		if (!g_sensorProcessingEnabled || !g_pCurrentActivity)
 		{
-			LiftingActivity* pLiftingActivity = dynamic_cast<LiftingActivity*>(g_pCurrentActivity);
-			return pLiftingActivity != NULL;
+			return;
 		}
-		return false;
-	}
 
-	bool IsCyclingActivity()
-	{
-		if (g_pCurrentActivity)
+		std::shared_ptr<SummaryAttributeMap> snapshot = std::make_shared<SummaryAttributeMap>();
+
+		for (auto iter = g_liveAttributeIds.begin(); iter != g_liveAttributeIds.end(); ++iter)
 		{
-			Cycling* pCycling = dynamic_cast<Cycling*>(g_pCurrentActivity);
-			return pCycling != NULL;
+			snapshot->Set((*iter), g_pCurrentActivity->QueryActivityAttributeById(*iter));
 		}
-		return false;
+		std::atomic_store(&g_liveAttributeSnapshot, std::shared_ptr<const SummaryAttributeMap>(snapshot));
 	}
 
-	//
-	// Functions for importing/exporting activities.
-	//
-
-	bool ImportActivityFromFile(const char* const pFileName, const char* const pActivityType, const char* const activityId)
+	void SensorProcessingThread()
 	{
-		bool result = false;
+		std::chrono::steady_clock::time_point lastPublished = std::chrono::steady_clock::now();
 
-		if (pFileName)
+		while (g_sensorProcessingEnabled)
 		{
-			std::string fileName = pFileName;
-			std::string fileExtension = fileName.substr(fileName.find_last_of(".") + 1);;
-			DataImporter importer;
+			size_t numProcessed = 0;
 
-			if (fileExtension.compare("gpx") == 0)
+			// If the writer has fallen behind then wait for it here, before taking the lock, so the UI isn't held up too.
+			// The writer lives as long as this thread does.
+			if (g_pSensorReadingWriter)
 			{
-				result = importer.ImportFromGpx(pFileName, pActivityType, activityId, g_pDatabase);
+				g_pSensorReadingWriter->WaitForRoom();
 			}
-			else if (fileExtension.compare("tcx") == 0)
+
 			{
-				result = importer.ImportFromTcx(pFileName, pActivityType, activityId, g_pDatabase);
+				std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+				numProcessed = DrainSensorReadingQueue(SENSOR_PROCESSING_BATCH_SIZE);
+
+				std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+				if ((numProcessed > 0) || (now - lastPublished >= std::chrono::milliseconds(LIVE_SNAPSHOT_INTERVAL_MS)))
+				{
+					PublishLiveAttributeSnapshot();
+					lastPublished = now;
+				}
 			}
-			else if (fileExtension.compare("csv") == 0)
+
+			// Let any callback that's waiting on a full queue know there's room.
+			if (numProcessed > 0)
 			{
-				result = importer.ImportFromCsv(pFileName, pActivityType, activityId, g_pDatabase);
+				{
+					std::lock_guard<std::mutex> lock(g_sensorRoomMutex);
+				}
+				g_sensorRoomCondition.notify_all();
+			}
+
+			// Producers signal without taking the wake mutex so they never block, which means a wakeup
+			// can occasionally be missed. The timeout bounds how long such a reading waits.
+			if (numProcessed == 0)
+			{
+				std::unique_lock<std::mutex> lock(g_sensorWakeMutex);
+				g_sensorWakeCondition.wait_for(lock, std::chrono::milliseconds(LIVE_SNAPSHOT_INTERVAL_MS), [] { return !g_sensorProcessingEnabled || !g_sensorReadingQueue.IsEmpty(); });
 			}
 		}
-		return result;
 	}
 
-	char* ExportActivityFromDatabase(const char* const activityId, FileFormat format, const char* const pDirName)
+	void StartSensorProcessing()
 	{
-		const Activity* pActivity = NULL;
-
-		for (auto iter = g_historicalActivityList.begin(); iter != g_historicalActivityList.end(); ++iter)
+		if (!g_sensorProcessingThread.joinable())
 		{
-			const ActivitySummary& current = (*iter);
+			std::lock_guard<std::mutex> lock(g_currentActivityMutex);
 
-			if (current.activityId.compare(activityId) == 0)
+			// The attributes the activity can display are fixed for its lifetime, so they're only looked up once.
+			std::vector<std::string> attributeNames;
+			g_pCurrentActivity->BuildAttributeList(attributeNames);
+
+			g_liveAttributeIds.clear();
+			for (auto iter = attributeNames.begin(); iter != attributeNames.end(); ++iter)
 			{
-				pActivity = current.pActivity;
-				break;
+				g_liveAttributeIds.push_back(ActivityAttributeRegistry::Intern(*iter));
 			}
-		}
-
-		if (pActivity)
-		{
-			std::string tempFileName = pDirName;
-			DataExporter exporter;
+			std::sort(g_liveAttributeIds.begin(), g_liveAttributeIds.end());
 
-			if (exporter.ExportFromDatabase(format, tempFileName, g_pDatabase, pActivity))
+			// Without a writer (i.e. if its connection can't be opened) readings are written inline.
+			if (!g_pSensorReadingWriter && g_pDatabase)
 			{
-				return strdup(tempFileName.c_str());
+				g_pSensorReadingWriter = new SensorReadingWriter();
+				if (!g_pSensorReadingWriter->Start(g_pDatabase->GetFileName()))
+				{
+					delete g_pSensorReadingWriter;
+					g_pSensorReadingWriter = NULL;
+				}
 			}
+
+			g_sensorProcessingEnabled = true;
+			PublishLiveAttributeSnapshot();
+			g_sensorProcessingThread = std::thread(SensorProcessingThread);
 		}
-		return NULL;
+		g_acceptingSensorReadings = true;
 	}
 
-	char* ExportActivityUsingCallbackData(const char* const activityId, FileFormat format, const char* const pDirName, time_t startTime, const char* const sportType, GetNextCoordinateCallback nextCoordinateCallback, void* context)
+	// Readings that were already queued are left for the caller to drain.
+	void StopSensorProcessing()
 	{
-		std::string tempFileName = pDirName;
-		std::string tempSportType = sportType;
-		DataExporter exporter;
+		g_acceptingSensorReadings = false;
+		g_sensorProcessingEnabled = false;
+		g_sensorWakeCondition.notify_all();
+		{
+			std::lock_guard<std::mutex> lock(g_sensorRoomMutex);
+		}
+		g_sensorRoomCondition.notify_all();
 
-		if (exporter.ExportUsingCallbackData(format, tempFileName, startTime, tempSportType, activityId, nextCoordinateCallback, context))
+		if (g_sensorProcessingThread.joinable())
 		{
-			return strdup(tempFileName.c_str());
+			g_sensorProcessingThread.join();
 		}
-		return NULL;
+
+		// From here on the activity isn't changing behind the UI's back, so it can be queried directly.
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+		std::atomic_store(&g_liveAttributeSnapshot, std::shared_ptr<const SummaryAttributeMap>());
 	}
 
-	char* ExportActivitySummary(const char* activityType, const char* const dirName)
+	// Writes whatever the writer still has queued and shuts it down. The caller must hold g_currentActivityMutex
+	// and have drained the sensor reading queue, since draining may hand more readings to the writer.
+	void StopSensorReadingWriter()
 	{
-		std::string activityTypeStr = activityType;
-		std::string tempFileName = dirName;
-		DataExporter exporter;
+		if (g_pSensorReadingWriter)
+		{
+			g_pSensorReadingWriter->Stop();
+			g_lastSensorWriterStats = g_pSensorReadingWriter->GetStats();
 
-		if (exporter.ExportActivitySummary(g_historicalActivityList, activityTypeStr, tempFileName))
+			delete g_pSensorReadingWriter;
+			g_pSensorReadingWriter = NULL;
+		}
+	}
+
+	// Called from the sensor callbacks, on whichever thread they arrive, and for imported readings. Readings are never processed here.
+	// If the queue is full then the processing thread has fallen behind. A live reading waits a little while for it to make room
+	// and is then dropped, since the sensor can't be held up. Readings that can't be dropped (e.g. an activity sent over from the
+	// watch, which is fed in faster than real time) wait for as long as it takes, which slows the import down to the rate at
+	// which they can be processed.
+	bool EnqueueSensorReading(const QueuedSensorReading& reading, bool canDrop)
+	{
+		if (!g_acceptingSensorReadings)
 		{
-			return strdup(tempFileName.c_str());
+			return false;
 		}
-		return NULL;
+
+		if (!g_sensorReadingQueue.Push(reading))
+		{
+			bool queued = false;
+			std::unique_lock<std::mutex> lock(g_sensorRoomMutex);
+
+			// The processing thread can miss a wakeup, so keep nudging it while waiting.
+			do
+			{
+				g_sensorWakeCondition.notify_one();
+				g_sensorRoomCondition.wait_for(lock, std::chrono::milliseconds(SENSOR_QUEUE_FULL_WAIT_MS), [&reading, &queued] { queued = g_sensorReadingQueue.Push(reading); return queued || !g_sensorProcessingEnabled; });
+			} while (!queued && !canDrop && g_sensorProcessingEnabled);
+
+			// A reading that isn't queued because recording stopped is refused, the same as one that arrives afterwards.
+			if (!queued)
+			{
+				if (canDrop && g_sensorProcessingEnabled)
+				{
+					++g_numDroppedSensorReadings;
+				}
+				return false;
+			}
+		}
+
+		g_sensorWakeCondition.notify_one();
+		return true;
 	}
 
-	//
-	// Functions for processing sensor reads.
-	//
+	// The number of readings that were dropped because the processing thread couldn't keep up.
+	uint64_t GetSensorReadingQueueOverflowCount()
+	{
+		return g_numDroppedSensorReadings;
+	}
 
-	bool ProcessSensorReading(const SensorReading& reading)
+	// Reports on the writer for the activity being recorded, or the last one if nothing is being recorded.
+	void GetSensorWriterStats(SensorWriterStats* stats)
 	{
-		if (IsActivityInProgress())
+		if (stats)
 		{
-			bool processed = g_pCurrentActivity->ProcessSensorReading(reading);
+			std::lock_guard<std::mutex> lock(g_currentActivityMutex);
 
-			if (processed && g_pDatabase)
+			if (g_pSensorReadingWriter)
+			{
+				(*stats) = g_pSensorReadingWriter->GetStats();
+			}
+			else
 			{
-				return g_pDatabase->CreateSensorReading(g_pCurrentActivity->GetId(), reading);
+				(*stats) = g_lastSensorWriterStats;
 			}
 		}
-		return false;
 	}
 
 	bool ProcessWeightReading(double weightKg, time_t timestamp)
@@ -2257,106 +3480,133 @@ extern "C" {
 
 	bool ProcessAccelerometerReading(double x, double y, double z, uint64_t timestampMs)
 	{
-		SensorReading reading;
+		QueuedSensorReading reading;
 		reading.type = SENSOR_TYPE_ACCELEROMETER;
-		reading.reading.insert(SensorNameValuePair(AXIS_NAME_X, x));
-		reading.reading.insert(SensorNameValuePair(AXIS_NAME_Y, y));
-		reading.reading.insert(SensorNameValuePair(AXIS_NAME_Z, z));
 		reading.time = timestampMs;
-		return ProcessSensorReading(reading);
+		reading.numValues = 0;
+		SensorReadingQueue::AddValue(reading, AXIS_NAME_X, x);
+		SensorReadingQueue::AddValue(reading, AXIS_NAME_Y, y);
+		SensorReadingQueue::AddValue(reading, AXIS_NAME_Z, z);
+		return EnqueueSensorReading(reading, true);
 	}
 
-	bool ProcessLocationReading(double lat, double lon, double alt, double horizontalAccuracy, double verticalAccuracy, uint64_t gpsTimestampMs)
+	QueuedSensorReading MakeLocationReading(double lat, double lon, double alt, double horizontalAccuracy, double verticalAccuracy, uint64_t gpsTimestampMs)
 	{
-		SensorReading reading;
+		QueuedSensorReading reading;
 		reading.type = SENSOR_TYPE_LOCATION;
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_LATITUDE, lat));
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_LONGITUDE, lon));
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_ALTITUDE, alt));
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_HORIZONTAL_ACCURACY, horizontalAccuracy));
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_VERTICAL_ACCURACY, verticalAccuracy));
 		reading.time = gpsTimestampMs;
-		return ProcessSensorReading(reading);
+		reading.numValues = 0;
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_LATITUDE, lat);
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_LONGITUDE, lon);
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_ALTITUDE, alt);
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_HORIZONTAL_ACCURACY, horizontalAccuracy);
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_VERTICAL_ACCURACY, verticalAccuracy);
+		return reading;
+	}
+
+	bool ProcessLocationReading(double lat, double lon, double alt, double horizontalAccuracy, double verticalAccuracy, uint64_t gpsTimestampMs)
+	{
+		return EnqueueSensorReading(MakeLocationReading(lat, lon, alt, horizontalAccuracy, verticalAccuracy, gpsTimestampMs), true);
+	}
+
+	bool ProcessImportedLocationReading(double lat, double lon, double alt, double horizontalAccuracy, double verticalAccuracy, uint64_t gpsTimestampMs)
+	{
+		return EnqueueSensorReading(MakeLocationReading(lat, lon, alt, horizontalAccuracy, verticalAccuracy, gpsTimestampMs), false);
 	}
 
 	bool ProcessHrmReading(double bpm, uint64_t timestampMs)
 	{
-		SensorReading reading;
+		QueuedSensorReading reading;
 		reading.type = SENSOR_TYPE_HEART_RATE;
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_HEART_RATE, bpm));
 		reading.time = timestampMs;
-		return ProcessSensorReading(reading);
+		reading.numValues = 0;
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_HEART_RATE, bpm);
+		return EnqueueSensorReading(reading, true);
 	}
 
 	bool ProcessCadenceReading(double rpm, uint64_t timestampMs)
 	{
-		SensorReading reading;
+		QueuedSensorReading reading;
 		reading.type = SENSOR_TYPE_CADENCE;
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_CADENCE, rpm));
 		reading.time = timestampMs;
-		return ProcessSensorReading(reading);
+		reading.numValues = 0;
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_CADENCE, rpm);
+		return EnqueueSensorReading(reading, true);
 	}
 
 	bool ProcessWheelSpeedReading(double revCount, uint64_t timestampMs)
 	{
-		SensorReading reading;
+		QueuedSensorReading reading;
 		reading.type = SENSOR_TYPE_WHEEL_SPEED;
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_NUM_WHEEL_REVOLUTIONS, revCount));
 		reading.time = timestampMs;
-
-		bool processed = ProcessSensorReading(reading);
-
-		if (g_pDatabase)
-		{
-			Cycling* pCycling = dynamic_cast<Cycling*>(g_pCurrentActivity);
-			if (pCycling)
-			{
-				Bike bike = pCycling->GetBikeProfile();
-				if (bike.id > BIKE_ID_NOT_SET)
-				{
-					g_pDatabase->UpdateBike(bike);
-				}
-			}
-		}
-
-		return processed;
+		reading.numValues = 0;
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_NUM_WHEEL_REVOLUTIONS, revCount);
+		return EnqueueSensorReading(reading, true);
 	}
 
 	bool ProcessPowerMeterReading(double watts, uint64_t timestampMs)
 	{
-		SensorReading reading;
+		QueuedSensorReading reading;
 		reading.type = SENSOR_TYPE_POWER;
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_POWER, watts));
 		reading.time = timestampMs;
-		return ProcessSensorReading(reading);
+		reading.numValues = 0;
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_POWER, watts);
+		return EnqueueSensorReading(reading, true);
 	}
 
 	bool ProcessRunStrideLengthReading(double decimeters, uint64_t timestampMs)
 	{
-		SensorReading reading;
+		QueuedSensorReading reading;
 		reading.type = SENSOR_TYPE_FOOT_POD;
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_RUN_STRIDE_LENGTH, decimeters));
 		reading.time = timestampMs;
-		return ProcessSensorReading(reading);
+		reading.numValues = 0;
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_RUN_STRIDE_LENGTH, decimeters);
+		return EnqueueSensorReading(reading, true);
 	}
 
 	bool ProcessRunDistanceReading(double decimeters, uint64_t timestampMs)
 	{
-		SensorReading reading;
+		QueuedSensorReading reading;
 		reading.type = SENSOR_TYPE_FOOT_POD;
-		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_RUN_DISTANCE, decimeters));
 		reading.time = timestampMs;
-		return ProcessSensorReading(reading);
+		reading.numValues = 0;
+		SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_RUN_DISTANCE, decimeters);
+		return EnqueueSensorReading(reading, true);
 	}
 
 	//
 	// Accessor functions for the most recent value of a particular attribute.
 	//
 
+	// While recording, the UI is answered from the snapshot published by the sensor processing thread,
+	// which costs a lookup and never waits on the activity. Returns false if the attribute isn't in it.
+	bool QueryLiveAttributeSnapshot(ActivityAttributeId attributeId, ActivityAttributeType& result)
+	{
+		std::shared_ptr<const SummaryAttributeMap> snapshot = std::atomic_load(&g_liveAttributeSnapshot);
+
+		if (snapshot)
+		{
+			const ActivityAttributeType* value = snapshot->Find(attributeId);
+			if (value)
+			{
+				result = (*value);
+				return true;
+			}
+		}
+		return false;
+	}
+
 	ActivityAttributeType QueryLiveActivityAttribute(const char* const attributeName)
 	{
 		ActivityAttributeType result;
 
+		if (attributeName && QueryLiveAttributeSnapshot(ActivityAttributeRegistry::Lookup(attributeName), result))
+		{
+			return result;
+		}
+
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
 		if (g_pCurrentActivity && attributeName)
 		{
 			result = g_pCurrentActivity->QueryActivityAttribute(attributeName);
@@ -2371,11 +3621,48 @@ extern "C" {
 		return result;
 	}
 
+	ActivityAttributeId GetActivityAttributeId(const char* const attributeName)
+	{
+		if (attributeName)
+		{
+			return ActivityAttributeRegistry::Intern(attributeName);
+		}
+		return ACTIVITY_ATTRIBUTE_ID_NOT_FOUND;
+	}
+
+	ActivityAttributeType QueryLiveActivityAttributeById(ActivityAttributeId attributeId)
+	{
+		ActivityAttributeType result;
+
+		if (QueryLiveAttributeSnapshot(attributeId, result))
+		{
+			return result;
+		}
+
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
+		if (g_pCurrentActivity && (attributeId != ACTIVITY_ATTRIBUTE_ID_NOT_FOUND))
+		{
+			result = g_pCurrentActivity->QueryActivityAttributeById(attributeId);
+		}
+		else
+		{
+			result.valueType   = TYPE_NOT_SET;
+			result.measureType = MEASURE_NOT_SET;
+			result.unitSystem  = UNIT_SYSTEM_US_CUSTOMARY;
+			result.valid       = false;
+		}
+		return result;
+	}
+
 	void SetLiveActivityAttribute(const char* const attributeName, ActivityAttributeType attributeValue)
 	{
+		std::lock_guard<std::mutex> lock(g_currentActivityMutex);
+
 		if (g_pCurrentActivity && attributeName)
 		{
 			g_pCurrentActivity->SetActivityAttribute(attributeName, attributeValue);
+			PublishLiveAttributeSnapshot();
 		}
 	}
 
@@ -2394,6 +3681,9 @@ extern "C" {
 		return result;
 	}
 
+	// Lifetime totals and records come from the aggregates the database maintains as summaries are saved,
+	// so they don't need the historical activities (or their summaries) to be loaded.
+
 	ActivityAttributeType QueryActivityAttributeTotal(const char* const pAttributeName)
 	{
 		ActivityAttributeType result;
@@ -2401,40 +3691,13 @@ extern "C" {
 		result.valueType   = TYPE_NOT_SET;
 		result.measureType = MEASURE_NOT_SET;
 		result.unitSystem  = UNIT_SYSTEM_US_CUSTOMARY;
+		result.valid       = false;
 
-		std::string attributeName = pAttributeName;
-
-		for (auto iter = g_historicalActivityList.begin(); iter != g_historicalActivityList.end(); ++iter)
+		if (g_pDatabase && pAttributeName)
 		{
-			const ActivitySummary& summary = (*iter);
-
-			ActivityAttributeMap::const_iterator mapIter = summary.summaryAttributes.find(attributeName);
-			if (mapIter != summary.summaryAttributes.end())
+			if (!g_pDatabase->RetrieveAttributeTotal("", pAttributeName, result))
 			{
-				const ActivityAttributeType& currentResult = summary.summaryAttributes.at(attributeName);
-
-				if (result.valueType == TYPE_NOT_SET)
-				{
-					result = currentResult;
-					result.valid = true;
-				}
-				else if (result.valueType == currentResult.valueType)
-				{
-					switch (result.valueType)
-					{
-						case TYPE_DOUBLE:
-							result.value.doubleVal += currentResult.value.doubleVal;
-							break;
-						case TYPE_INTEGER:
-							result.value.intVal    += currentResult.value.intVal;
-							break;
-						case TYPE_TIME:
-							result.value.timeVal   += currentResult.value.timeVal;
-							break;
-						case TYPE_NOT_SET:
-							break;
-					}
-				}
+				result.valid = false;
 			}
 		}
 		return result;
@@ -2449,44 +3712,11 @@ extern "C" {
 		result.unitSystem  = UNIT_SYSTEM_US_CUSTOMARY;
 		result.valid       = false;
 
-		std::string attributeName = pAttributeName;
-
-		// Look through all activity summaries.
-		for (auto iter = g_historicalActivityList.begin(); iter != g_historicalActivityList.end(); ++iter)
+		if (g_pDatabase && pAttributeName && pActivityType && (strlen(pActivityType) > 0))
 		{
-			const ActivitySummary& summary = (*iter);
-
-			// If this activity is of the right type.
-			if (summary.pActivity && (summary.pActivity->GetType().compare(pActivityType) == 0))
+			if (!g_pDatabase->RetrieveAttributeTotal(pActivityType, pAttributeName, result))
 			{
-				ActivityAttributeMap::const_iterator mapIter = summary.summaryAttributes.find(attributeName);
-				if (mapIter != summary.summaryAttributes.end())
-				{
-					const ActivityAttributeType& currentResult = summary.summaryAttributes.at(attributeName);
-
-					if (result.valueType == TYPE_NOT_SET)
-					{
-						result = currentResult;
-						result.valid = true;
-					}
-					else if (result.valueType == currentResult.valueType)
-					{
-						switch (result.valueType)
-						{
-							case TYPE_DOUBLE:
-								result.value.doubleVal += currentResult.value.doubleVal;
-								break;
-							case TYPE_INTEGER:
-								result.value.intVal    += currentResult.value.intVal;
-								break;
-							case TYPE_TIME:
-								result.value.timeVal   += currentResult.value.timeVal;
-								break;
-							case TYPE_NOT_SET:
-								break;
-						}
-					}
-				}
+				result.valid = false;
 			}
 		}
 		return result;
@@ -2501,90 +3731,17 @@ extern "C" {
 		result.unitSystem  = UNIT_SYSTEM_US_CUSTOMARY;
 		result.valid       = false;
 
-		if (!(pAttributeName && pActivityType && pActivityId))
+		if (!(g_pDatabase && pAttributeName && pActivityType && pActivityId) || (strlen(pActivityType) == 0))
 		{
 			return result;
 		}
 
-		std::string attributeName = pAttributeName;
 		std::string activityId;
 
-		// Look through all activity summaries.
-		for (auto iter = g_historicalActivityList.begin(); iter != g_historicalActivityList.end(); ++iter)
+		if (!g_pDatabase->RetrieveBestAttributeValue(pActivityType, pAttributeName, smallestIsBest, result, activityId))
 		{
-			const ActivitySummary& summary = (*iter);
-
-			// If this activity is of the right type.
-			if (summary.pActivity && (summary.pActivity->GetType().compare(pActivityType) == 0))
-			{
-				// Find the requested piece of summary data for this activity.
-				ActivityAttributeMap::const_iterator mapIter = summary.summaryAttributes.find(attributeName);
-				if (mapIter != summary.summaryAttributes.end())
-				{
-					const ActivityAttributeType& currentResult = summary.summaryAttributes.at(attributeName);
-
-					if (result.valueType == TYPE_NOT_SET)
-					{
-						result = currentResult;
-						activityId = summary.activityId;
-					}
-					else if (result.valueType == currentResult.valueType)
-					{
-						switch (result.valueType)
-						{
-							case TYPE_DOUBLE:
-								if (smallestIsBest)
-								{
-									if (result.value.doubleVal > currentResult.value.doubleVal)
-									{
-										result = currentResult;
-										activityId = summary.activityId;
-									}
-								}
-								else if (result.value.doubleVal < currentResult.value.doubleVal)
-								{
-									result = currentResult;
-									activityId = summary.activityId;
-								}
-								break;
-							case TYPE_INTEGER:
-								if (smallestIsBest)
-								{
-									if (result.value.intVal > currentResult.value.intVal)
-									{
-										result = currentResult;
-										activityId = summary.activityId;
-									}
-								}
-								else if (result.value.intVal < currentResult.value.intVal)
-								{
-									result = currentResult;
-									activityId = summary.activityId;
-								}
-								break;
-							case TYPE_TIME:
-								if (smallestIsBest)
-								{
-									if (result.value.timeVal > currentResult.value.timeVal)
-									{
-										result = currentResult;
-										activityId = summary.activityId;
-									}
-								}
-								else if (result.value.timeVal < currentResult.value.timeVal)
-								{
-									result = currentResult;
-									activityId = summary.activityId;
-								}
-								break;
-							case TYPE_NOT_SET:
-								break;
-						}
-					}
-				}
-			}
+			result.valid = false;
 		}
-		
 		if (result.valid && (activityId.size() > 0))
 		{
 			(*pActivityId) = strdup(activityId.c_str());
@@ -2592,6 +3749,22 @@ extern "C" {
 		return result;
 	}
 
+	// Lists the best efforts (fastest 5K, etc.) of activities that started within the given time range, best first.
+	size_t QueryPersonalRecords(const char* const pAttributeName, const char* const pActivityType, time_t startTime, time_t endTime, size_t maxRecords, PersonalRecordCallback callback, void* context)
+	{
+		PersonalRecordList records;
+
+		if (g_pDatabase && pAttributeName && pActivityType && callback && g_pDatabase->RetrievePersonalRecords(pActivityType, pAttributeName, startTime, endTime, maxRecords, records))
+		{
+			for (auto iter = records.begin(); iter != records.end(); ++iter)
+			{
+				const PersonalRecord& record = (*iter);
+				callback(record.activityId.c_str(), record.activityStartTime, record.value, context);
+			}
+		}
+		return records.size();
+	}
+
 	//
 	// Functions for importing ZWO files.
 	//
@@ -10,15 +10,16 @@
 
 #include <stdint.h>
 #include <time.h>
-#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "Activity.h"
 #include "SensorReading.h"
+#include "SensorReadingColumns.h"
+#include "SummaryAttributeMap.h"
 
 typedef std::vector<SensorReading> SensorReadingList;
-typedef std::map<std::string, ActivityAttributeType> ActivityAttributeMap;
 
 typedef struct ActivitySummary
 {
@@ -28,12 +29,9 @@ typedef struct ActivitySummary
 	time_t               endTime;                  // End time for the activity (UNIX time) or zero if not set
 	std::string          type;                     // Type of the activity (cycling, running, etc.)
 	std::string          name;                     // Name of the activity
-	SensorReadingList    locationPoints;           // List of all locations
-	SensorReadingList    accelerometerReadings;    // List of all accelerometer readings recorded as part of this activity
-	SensorReadingList    heartRateMonitorReadings; // List of all heart rate monitor readings recorded as part of this activity
-	SensorReadingList    cadenceReadings;          // List of all cadence sensor readings recorded as part of this activity
-	SensorReadingList    powerReadings;            // List of power meter readings recorded as part of this activity
-	ActivityAttributeMap summaryAttributes;
+	SensorReadingColumns accelerometerReadings;    // All accelerometer readings recorded as part of this activity
+	std::set<SensorType> loadedSensors;            // Sensors whose readings have been fed to pActivity, only the accelerometer's are also kept here
+	SummaryAttributeMap  summaryAttributes;        // Summary attributes, keyed by interned attribute ID
 	Activity*            pActivity;
 } ActivitySummary;
 
@@ -8,9 +8,13 @@
 #ifndef __CALLBACKS__
 #define __CALLBACKS__
 
+#include "ActivityAttributeType.h"
 #include "Coordinate.h"
+#include "HistoryLoadState.h"
 #include "SensorType.h"
 
+#include <time.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -25,6 +29,12 @@ extern "C" {
 	typedef void (*AttributeNameCallback)(const char* name, void* context);
 	typedef void (*SensorTypeCallback)(SensorType type, void* context);
 	typedef bool (*GetNextCoordinateCallback)(const char* activityId, Coordinate* coordinate, void* context);
+	typedef bool (*ExportDataCallback)(const uint8_t* data, size_t dataLen, void* context);
+	typedef void (*ExportProgressCallback)(size_t numCompleted, size_t numTotal, void* context);
+	typedef void (*HistoricalActivityCallback)(const char* activityId, const char* activityType, const char* activityName, time_t startTime, time_t endTime, void* context);
+	typedef void (*PersonalRecordCallback)(const char* activityId, time_t activityStartTime, ActivityAttributeType value, void* context);
+	typedef void (*TrainingLoadCallback)(time_t day, double trainingStress, double chronicLoad, double acuteLoad, double stressBalance, void* context);
+	typedef void (*HistoryLoadCallback)(HistoryLoadHandle handle, HistoryLoadState state, const Coordinate* points, size_t numPoints, void* context);
 
 #ifdef __cplusplus
 }
@@ -15,6 +15,7 @@ ChinUp::ChinUp(GForceAnalyzer* const analyzer) : LiftingActivity(analyzer)
 
 ChinUp::~ChinUp()
 {
+	ReleaseGForceAnalyzer();
 }
 
 double ChinUp::CaloriesBurned() const
@@ -10,11 +10,14 @@
 #include "Cycling.h"
 #include "ActivityAttribute.h"
 #include "Statistics.h"
+#include "TrainingStressCalculator.h"
 #include "UnitMgr.h"
 #include "UnitConversionFactors.h"
 
 Cycling::Cycling() : MovingActivity()
 {
+	AttributeHandlers(); // interns our attribute names before the first query
+
 	m_speedDataSource                   = SPEED_FROM_GPS;
 
 	m_distanceAtFirstWheelSpeedReadingM = (double)0.0;
@@ -213,178 +216,220 @@ bool Cycling::ProcessPowerMeterReading(const SensorReading& reading)
 	return MovingActivity::ProcessPowerMeterReading(reading);
 }
 
-ActivityAttributeType Cycling::QueryActivityAttribute(const std::string& attributeName) const
+const ActivityAttributeHandlerTable<Cycling>& Cycling::AttributeHandlers()
 {
-	ActivityAttributeType result;
+	static const ActivityAttributeHandlerTable<Cycling> handlers = BuildAttributeHandlers();
+	return handlers;
+}
 
-	result.startTime = 0;
-	result.endTime = 0;
+ActivityAttributeHandlerTable<Cycling> Cycling::BuildAttributeHandlers()
+{
+	ActivityAttributeHandlerTable<Cycling> handlers;
+
+	handlers.Register(ACTIVITY_ATTRIBUTE_CADENCE, &Cycling::QueryCadenceAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_AVG_CADENCE, &Cycling::QueryAvgCadenceAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_MAX_CADENCE, &Cycling::QueryMaxCadenceAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_POWER, &Cycling::QueryPowerAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_AVG_POWER, &Cycling::QueryAvgPowerAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_NORMALIZED_POWER, &Cycling::QueryNormalizedPowerAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_MAX_POWER, &Cycling::QueryMaxPowerAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_3_SEC_POWER, &Cycling::Query3SecPowerAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_20_MIN_POWER, &Cycling::Query20MinPowerAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_1_HOUR_POWER, &Cycling::Query1HourPowerAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_HIGHEST_3_SEC_POWER, &Cycling::QueryHighest3SecPowerAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_HIGHEST_20_MIN_POWER, &Cycling::QueryHighest20MinPowerAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_HIGHEST_1_HOUR_POWER, &Cycling::QueryHighest1HourPowerAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_POWER_ZONE, &Cycling::QueryPowerZoneAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_NUM_WHEEL_REVOLUTIONS, &Cycling::QueryNumWheelRevolutionsAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_WHEEL_SPEED, &Cycling::QueryWheelSpeedAttribute);
+	return handlers;
+}
 
-	if (attributeName.compare(ACTIVITY_ATTRIBUTE_CADENCE) == 0)
-	{
-		uint64_t timeSinceLastUpdate = 0;
-		if (!HasStopped())
-			timeSinceLastUpdate = CurrentTimeInMs() - m_lastCadenceUpdateTime;
-
-		result.value.doubleVal = CurrentCadence();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_RPM;
-		result.startTime = m_lastCadenceUpdateTime;
-		result.endTime = m_lastCadenceUpdateTime;
-		result.valid = (m_numCadenceReadings > 0) && (timeSinceLastUpdate < 3000);
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_AVG_CADENCE) == 0)
-	{
-		result.value.doubleVal = AverageCadence();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_RPM;
-		result.valid = m_numCadenceReadings > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_MAX_CADENCE) == 0)
-	{
-		result.value.doubleVal = MaximumCadence();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_RPM;
-		result.valid = m_numCadenceReadings > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_POWER) == 0)
-	{
-		uint64_t timeSinceLastUpdate = 0;
-		if (!HasStopped())
-			timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
-		
-		result.value.doubleVal = CurrentPower();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_POWER;
-		result.startTime = m_lastPowerUpdateTime;
-		result.endTime = m_lastPowerUpdateTime;
-		result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < 3000);
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_AVG_POWER) == 0)
-	{
-		result.value.doubleVal = AveragePower();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_POWER;
-		result.valid = m_numPowerReadings > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_NORMALIZED_POWER) == 0)
-	{
-		result.value.doubleVal = NormalizedPower();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_POWER;
-		result.valid = m_numPowerReadings > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_MAX_POWER) == 0)
-	{
-		result.value.doubleVal = MaximumPower();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_POWER;
-		result.valid = m_numPowerReadings > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_3_SEC_POWER) == 0)
-	{
-		uint64_t timeSinceLastUpdate = 0;
-		if (!HasStopped())
-			timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
-		
-		result.value.doubleVal = ThreeSecPower();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_POWER;
-		result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < 3000);
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_20_MIN_POWER) == 0)
-	{
-		uint64_t timeSinceLastUpdate = 0;
-		if (!HasStopped())
-			timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
-		
-		result.value.doubleVal = TwentyMinPower();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_POWER;
-		result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < (20 * 60000));
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_1_HOUR_POWER) == 0)
-	{
-		uint64_t timeSinceLastUpdate = 0;
-		if (!HasStopped())
-			timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
-		
-		result.value.doubleVal = OneHourPower();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_POWER;
-		result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < (60 * 60000));
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_HIGHEST_3_SEC_POWER) == 0)
-	{
-		uint64_t timeSinceLastUpdate = 0;
-		if (!HasStopped())
-			timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
-		
-		result.value.doubleVal = HighestThreeSecPower();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_POWER;
-		result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < 3000);
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_HIGHEST_20_MIN_POWER) == 0)
-	{
-		uint64_t timeSinceLastUpdate = 0;
-		if (!HasStopped())
-			timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
-		
-		result.value.doubleVal = HighestTwentyMinPower();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_POWER;
-		result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < (20 * 60000));
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_HIGHEST_1_HOUR_POWER) == 0)
-	{
-		uint64_t timeSinceLastUpdate = 0;
-		if (!HasStopped())
-			timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
-		
-		result.value.doubleVal = HighestOneHourPower();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_POWER;
-		result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < (60 * 60000));
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_POWER_ZONE) == 0)
-	{
-		uint64_t timeSinceLastUpdate = 0;
-		if (!HasStopped())
-			timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
-		
-		uint8_t zone = CurrentPowerZone();
-		result.value.intVal = zone;
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_NOT_SET;
-		result.valid = (zone > 0) && (m_numPowerReadings > 0) && (timeSinceLastUpdate < 3000);
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_NUM_WHEEL_REVOLUTIONS) == 0)
-	{
-		result.value.intVal = NumWheelRevolutions();
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_COUNT;
-		result.startTime = m_firstWheelSpeedTime;
-		result.endTime = m_currentWheelSpeedTime;
-		result.valid = m_firstWheelSpeedReading > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_WHEEL_SPEED) == 0)
-	{
-		SegmentType segment = CurrentSpeedFromWheelSpeed();
-		result.value.doubleVal = segment.value.doubleVal;
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_SPEED;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = m_firstWheelSpeedReading > 0;
-	}
-	else
+ActivityAttributeType Cycling::QueryActivityAttributeById(ActivityAttributeId attributeId) const
+{
+	ActivityAttributeType result;
+
+	if (!AttributeHandlers().Query(this, attributeId, result))
 	{
-		result = MovingActivity::QueryActivityAttribute(attributeName);
+		result = MovingActivity::QueryActivityAttributeById(attributeId);
 	}
 	return result;
 }
 
+void Cycling::QueryCadenceAttribute(ActivityAttributeType& result) const
+{
+	uint64_t timeSinceLastUpdate = 0;
+	if (!HasStopped())
+		timeSinceLastUpdate = CurrentTimeInMs() - m_lastCadenceUpdateTime;
+
+	result.value.doubleVal = CurrentCadence();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_RPM;
+	result.startTime = m_lastCadenceUpdateTime;
+	result.endTime = m_lastCadenceUpdateTime;
+	result.valid = (m_numCadenceReadings > 0) && (timeSinceLastUpdate < 3000);
+}
+
+void Cycling::QueryAvgCadenceAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = AverageCadence();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_RPM;
+	result.valid = m_numCadenceReadings > 0;
+}
+
+void Cycling::QueryMaxCadenceAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = MaximumCadence();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_RPM;
+	result.valid = m_numCadenceReadings > 0;
+}
+
+void Cycling::QueryPowerAttribute(ActivityAttributeType& result) const
+{
+	uint64_t timeSinceLastUpdate = 0;
+	if (!HasStopped())
+		timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
+	
+	result.value.doubleVal = CurrentPower();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_POWER;
+	result.startTime = m_lastPowerUpdateTime;
+	result.endTime = m_lastPowerUpdateTime;
+	result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < 3000);
+}
+
+void Cycling::QueryAvgPowerAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = AveragePower();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_POWER;
+	result.valid = m_numPowerReadings > 0;
+}
+
+void Cycling::QueryNormalizedPowerAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = NormalizedPower();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_POWER;
+	result.valid = m_numPowerReadings > 0;
+}
+
+void Cycling::QueryMaxPowerAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = MaximumPower();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_POWER;
+	result.valid = m_numPowerReadings > 0;
+}
+
+void Cycling::Query3SecPowerAttribute(ActivityAttributeType& result) const
+{
+	uint64_t timeSinceLastUpdate = 0;
+	if (!HasStopped())
+		timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
+	
+	result.value.doubleVal = ThreeSecPower();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_POWER;
+	result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < 3000);
+}
+
+void Cycling::Query20MinPowerAttribute(ActivityAttributeType& result) const
+{
+	uint64_t timeSinceLastUpdate = 0;
+	if (!HasStopped())
+		timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
+	
+	result.value.doubleVal = TwentyMinPower();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_POWER;
+	result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < (20 * 60000));
+}
+
+void Cycling::Query1HourPowerAttribute(ActivityAttributeType& result) const
+{
+	uint64_t timeSinceLastUpdate = 0;
+	if (!HasStopped())
+		timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
+	
+	result.value.doubleVal = OneHourPower();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_POWER;
+	result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < (60 * 60000));
+}
+
+void Cycling::QueryHighest3SecPowerAttribute(ActivityAttributeType& result) const
+{
+	uint64_t timeSinceLastUpdate = 0;
+	if (!HasStopped())
+		timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
+	
+	result.value.doubleVal = HighestThreeSecPower();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_POWER;
+	result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < 3000);
+}
+
+void Cycling::QueryHighest20MinPowerAttribute(ActivityAttributeType& result) const
+{
+	uint64_t timeSinceLastUpdate = 0;
+	if (!HasStopped())
+		timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
+	
+	result.value.doubleVal = HighestTwentyMinPower();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_POWER;
+	result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < (20 * 60000));
+}
+
+void Cycling::QueryHighest1HourPowerAttribute(ActivityAttributeType& result) const
+{
+	uint64_t timeSinceLastUpdate = 0;
+	if (!HasStopped())
+		timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
+	
+	result.value.doubleVal = HighestOneHourPower();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_POWER;
+	result.valid = (m_numPowerReadings > 0) && (timeSinceLastUpdate < (60 * 60000));
+}
+
+void Cycling::QueryPowerZoneAttribute(ActivityAttributeType& result) const
+{
+	uint64_t timeSinceLastUpdate = 0;
+	if (!HasStopped())
+		timeSinceLastUpdate = CurrentTimeInMs() - m_lastPowerUpdateTime;
+	
+	uint8_t zone = CurrentPowerZone();
+	result.value.intVal = zone;
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_NOT_SET;
+	result.valid = (zone > 0) && (m_numPowerReadings > 0) && (timeSinceLastUpdate < 3000);
+}
+
+void Cycling::QueryNumWheelRevolutionsAttribute(ActivityAttributeType& result) const
+{
+	result.value.intVal = NumWheelRevolutions();
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_COUNT;
+	result.startTime = m_firstWheelSpeedTime;
+	result.endTime = m_currentWheelSpeedTime;
+	result.valid = m_firstWheelSpeedReading > 0;
+}
+
+void Cycling::QueryWheelSpeedAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = CurrentSpeedFromWheelSpeed();
+	result.value.doubleVal = segment.value.doubleVal;
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_SPEED;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = m_firstWheelSpeedReading > 0;
+}
+
 SegmentType Cycling::CurrentSpeedFromWheelSpeed() const
 {
 	SegmentType result = { 0, 0, 0 };
@@ -485,6 +530,19 @@ uint8_t Cycling::CurrentPowerZone() const
 	return 6;
 }
 
+// Scored from power when there is a power meter and the athlete has set their FTP.
+double Cycling::TrainingStress() const
+{
+	double ftp = m_athlete.GetFtp();
+	if ((m_numPowerReadings == 0) || (ftp < (double)1.0))
+	{
+		return MovingActivity::TrainingStress();
+	}
+
+	TrainingStressCalculator calc;
+	return calc.EstimateFromPower(ElapsedTimeInSeconds(), NormalizedPower(), ftp);
+}
+
 void Cycling::BuildAttributeList(std::vector<std::string>& attributes) const
 {
 	attributes.push_back(ACTIVITY_ATTRIBUTE_CADENCE);
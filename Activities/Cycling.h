@@ -29,7 +29,7 @@ public:
 
 	virtual void ListUsableSensors(std::vector<SensorType>& sensorTypes) const;
 
-	virtual ActivityAttributeType QueryActivityAttribute(const std::string& attributeName) const;
+	virtual ActivityAttributeType QueryActivityAttributeById(ActivityAttributeId attributeId) const;
 
 	virtual void SetBikeProfile(const Bike& bike) { m_bike = bike; };
 	virtual Bike GetBikeProfile() const { return m_bike; };
@@ -55,6 +55,8 @@ public:
 	virtual double HighestOneHourPower() const { return m_highest1HourPower; };
 	virtual uint8_t CurrentPowerZone() const;
 
+	virtual double TrainingStress() const;
+
 	virtual uint16_t NumWheelRevolutions() const { return m_currentWheelSpeedReading - m_firstWheelSpeedReading; };
 
 	virtual void BuildAttributeList(std::vector<std::string>& attributes) const;
@@ -104,6 +106,26 @@ private:
 
 	uint64_t        m_lastCadenceUpdateTime; // time the cadence data was last updated
 	uint64_t        m_lastPowerUpdateTime;   // time the power data was last updated
+
+	static const ActivityAttributeHandlerTable<Cycling>& AttributeHandlers();
+	static ActivityAttributeHandlerTable<Cycling> BuildAttributeHandlers();
+
+	void QueryCadenceAttribute(ActivityAttributeType& result) const;
+	void QueryAvgCadenceAttribute(ActivityAttributeType& result) const;
+	void QueryMaxCadenceAttribute(ActivityAttributeType& result) const;
+	void QueryPowerAttribute(ActivityAttributeType& result) const;
+	void QueryAvgPowerAttribute(ActivityAttributeType& result) const;
+	void QueryNormalizedPowerAttribute(ActivityAttributeType& result) const;
+	void QueryMaxPowerAttribute(ActivityAttributeType& result) const;
+	void Query3SecPowerAttribute(ActivityAttributeType& result) const;
+	void Query20MinPowerAttribute(ActivityAttributeType& result) const;
+	void Query1HourPowerAttribute(ActivityAttributeType& result) const;
+	void QueryHighest3SecPowerAttribute(ActivityAttributeType& result) const;
+	void QueryHighest20MinPowerAttribute(ActivityAttributeType& result) const;
+	void QueryHighest1HourPowerAttribute(ActivityAttributeType& result) const;
+	void QueryPowerZoneAttribute(ActivityAttributeType& result) const;
+	void QueryNumWheelRevolutionsAttribute(ActivityAttributeType& result) const;
+	void QueryWheelSpeedAttribute(ActivityAttributeType& result) const;
 };
 
 #endif
@@ -7,6 +7,7 @@
 
 #include "FtpCalculator.h"
 #include "ActivityAttribute.h"
+#include "ActivityType.h"
 
 FtpCalculator::FtpCalculator()
 {
@@ -32,45 +33,28 @@ double FtpCalculator::Estimate(double best20MinPower, double best1HourPower)
 	return max20MinAdjusted;
 }
 
-double FtpCalculator::Estimate(const ActivitySummaryList& historicalActivities)
+double FtpCalculator::Estimate(Database& database)
 {
-	double bestEstimate = (double)0.0;
-	time_t cutoffTime = time(NULL) - ((365.25 / 2.0) * 24.0 * 60.0 * 60.0); // last six months
+	const char* const cyclingTypes[] = { ACTIVITY_TYPE_CYCLING, ACTIVITY_TYPE_STATIONARY_BIKE };
 
-	// Look through all activity summaries.
-	for (auto iter = historicalActivities.begin(); iter != historicalActivities.end(); ++iter)
+	double best20MinPower = (double)0.0;
+	double best1HourPower = (double)0.0;
+	time_t now = time(NULL);
+	time_t cutoffTime = now - ((365.25 / 2.0) * 24.0 * 60.0 * 60.0); // last six months
+
+	// The estimate grows with both powers, so the best of the per-activity estimates comes from the best of each power.
+	for (size_t i = 0; i < sizeof(cyclingTypes) / sizeof(cyclingTypes[0]); ++i)
 	{
-		const ActivitySummary& summary = (*iter);
+		double power = (double)0.0;
 
-		if (summary.startTime > cutoffTime)
+		if (database.RetrieveLargestSummaryValue(cyclingTypes[i], ACTIVITY_ATTRIBUTE_HIGHEST_20_MIN_POWER, cutoffTime + 1, now + 1, power) && (power > best20MinPower))
 		{
-			if ((summary.type.compare(ACTIVITY_TYPE_CYCLING) == 0) ||
-				(summary.type.compare(ACTIVITY_TYPE_STATIONARY_BIKE) == 0))
-			{
-				double best20MinPower = (double)0.0;
-				double best1HourPower = (double)0.0;
-
-				if (summary.summaryAttributes.find(ACTIVITY_ATTRIBUTE_HIGHEST_20_MIN_POWER) != summary.summaryAttributes.end())
-				{
-					ActivityAttributeType attr = summary.summaryAttributes.at(ACTIVITY_ATTRIBUTE_HIGHEST_20_MIN_POWER);
-					if (attr.valid)
-						best20MinPower = attr.value.doubleVal;
-				}
-				if (summary.summaryAttributes.find(ACTIVITY_ATTRIBUTE_HIGHEST_1_HOUR_POWER) != summary.summaryAttributes.end())
-				{
-					ActivityAttributeType attr = summary.summaryAttributes.at(ACTIVITY_ATTRIBUTE_HIGHEST_1_HOUR_POWER);
-					if (attr.valid)
-						best1HourPower = attr.value.doubleVal;
-				}
-
-				double estimate = this->Estimate(best20MinPower, best1HourPower);
-
-				if (estimate > bestEstimate)
-				{
-					bestEstimate = estimate;
-				}
-			}
+			best20MinPower = power;
+		}
+		if (database.RetrieveLargestSummaryValue(cyclingTypes[i], ACTIVITY_ATTRIBUTE_HIGHEST_1_HOUR_POWER, cutoffTime + 1, now + 1, power) && (power > best1HourPower))
+		{
+			best1HourPower = power;
 		}
 	}
-	return bestEstimate;
+	return this->Estimate(best20MinPower, best1HourPower);
 }
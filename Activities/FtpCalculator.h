@@ -8,7 +8,7 @@
 #ifndef __FTPCALCULATOR__
 #define __FTPCALCULATOR__
 
-#include "ActivitySummary.h"
+#include "Database.h"
 
 class FtpCalculator
 {
@@ -17,7 +17,8 @@ public:
 	virtual ~FtpCalculator();
 
 	double Estimate(double best20MinPower, double best1HourPower);
-	double Estimate(const ActivitySummaryList& historicalActivities);
+	/// Estimates from the best efforts of the last six months. Reads them from the database instead of loaded history.
+	double Estimate(Database& database);
 };
 
 #endif
@@ -27,17 +27,16 @@ GForceAnalyzer::~GForceAnalyzer()
 
 void GForceAnalyzer::Clear()
 {
-	LibMath::GraphLine x, y, z;
-	m_graphLines[AXIS_NAME_X] = x;
-	m_graphLines[AXIS_NAME_Y] = y;
-	m_graphLines[AXIS_NAME_Z] = z;
+	// Swapped with empty containers, rather than assigned from them, so the memory is actually given back.
+	LibMath::GraphLine().swap(m_graphLines[AXIS_NAME_X]);
+	LibMath::GraphLine().swap(m_graphLines[AXIS_NAME_Y]);
+	LibMath::GraphLine().swap(m_graphLines[AXIS_NAME_Z]);
 
-	LibMath::GraphPeakList xPeaks, yPeaks, zPeaks;
-	m_peaks[AXIS_NAME_X] = xPeaks;
-	m_peaks[AXIS_NAME_Y] = yPeaks;
-	m_peaks[AXIS_NAME_Z] = zPeaks;
+	LibMath::GraphPeakList().swap(m_peaks[AXIS_NAME_X]);
+	LibMath::GraphPeakList().swap(m_peaks[AXIS_NAME_Y]);
+	LibMath::GraphPeakList().swap(m_peaks[AXIS_NAME_Z]);
 
-	m_dataPeaks.clear();
+	LibMath::GraphPeakList().swap(m_dataPeaks);
 	m_lastPeakCalculationTime = 0;
 }
 
@@ -15,7 +15,8 @@
 #include "Squat.h"
 #include "SquatAnalyzer.h"
 
-GForceAnalyzerMap GForceAnalyzerFactory::m_analyzers;
+std::mutex GForceAnalyzerFactory::m_poolMutex;
+GForceAnalyzerPool GForceAnalyzerFactory::m_pool;
 
 GForceAnalyzerFactory::GForceAnalyzerFactory()
 {
@@ -48,18 +49,43 @@ GForceAnalyzer* GForceAnalyzerFactory::CreateAnalyzerForActivity(const std::stri
 	return pAnalyzer;
 }
 
-GForceAnalyzer* GForceAnalyzerFactory::GetAnalyzerForActivity(const std::string& type, Database& database)
+GForceAnalyzer* GForceAnalyzerFactory::AcquireAnalyzerForActivity(const std::string& type, Database& database)
 {
-	GForceAnalyzer* pAnalyzer = NULL;
+	{
+		std::lock_guard<std::mutex> lock(m_poolMutex);
+
+		std::vector<GForceAnalyzer*>& idle = m_pool[type];
+		if (idle.size() > 0)
+		{
+			GForceAnalyzer* pAnalyzer = idle.back();
+			idle.pop_back();
+			return pAnalyzer;
+		}
+	}
+
+	return CreateAnalyzerForActivity(type, database);
+}
 
-	try
+void GForceAnalyzerFactory::ReleaseAnalyzer(const std::string& type, GForceAnalyzer* analyzer)
+{
+	if (!analyzer)
 	{
-		pAnalyzer = GForceAnalyzerFactory::m_analyzers.at(type);
+		return;
 	}
-	catch (...)
+
+	// Cleared now, rather than when reused, so an idle analyzer doesn't hold on to a whole activity's readings.
+	analyzer->Clear();
+
 	{
-		pAnalyzer = CreateAnalyzerForActivity(type, database);
-		GForceAnalyzerFactory::m_analyzers.insert(std::pair<std::string, GForceAnalyzer*>(type, pAnalyzer));
+		std::lock_guard<std::mutex> lock(m_poolMutex);
+
+		std::vector<GForceAnalyzer*>& idle = m_pool[type];
+		if (idle.size() < GFORCE_ANALYZER_POOL_SIZE)
+		{
+			idle.push_back(analyzer);
+			return;
+		}
 	}
-	return pAnalyzer;
+
+	delete analyzer;
 }
@@ -8,14 +8,26 @@
 #ifndef __GFORCEANALYZERFACTORY__
 #define __GFORCEANALYZERFACTORY__
 
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "Database.h"
 #include "GForceAnalyzer.h"
 #include "LiftingActivity.h"
 
-typedef std::map<std::string, GForceAnalyzer*> GForceAnalyzerMap;
+#define GFORCE_ANALYZER_POOL_SIZE 4 // Idle analyzers kept for reuse, per activity type
 
+typedef std::map<std::string, std::vector<GForceAnalyzer*>> GForceAnalyzerPool;
+
+/**
+* Hands out accelerometer analyzers for lifting activities.
+*
+* Each activity gets an analyzer of its own, so that any number of lifting activities can be analyzed at once.
+* Analyzers are released back to a small pool when their activity is destroyed, so loading a long list of
+* historical activities doesn't mean building (and throwing away) an analyzer for each one.
+*/
 class GForceAnalyzerFactory
 {
 public:
@@ -23,10 +35,14 @@ public:
 	virtual ~GForceAnalyzerFactory();
 
 	static GForceAnalyzer* CreateAnalyzerForActivity(const std::string& type, Database& database);
-	static GForceAnalyzer* GetAnalyzerForActivity(const std::string& type, Database& database);
+
+	/// The caller owns the analyzer until it is given back with ReleaseAnalyzer.
+	static GForceAnalyzer* AcquireAnalyzerForActivity(const std::string& type, Database& database);
+	static void ReleaseAnalyzer(const std::string& type, GForceAnalyzer* analyzer);
 
 private:
-	static GForceAnalyzerMap m_analyzers;
+	static std::mutex         m_poolMutex; // Protects the pool
+	static GForceAnalyzerPool m_pool;      // Idle analyzers, by activity type
 };
 
 #endif
@@ -8,27 +8,40 @@
 #include "LiftingActivity.h"
 #include "ActivityAttribute.h"
 #include "Defines.h"
+#include "GForceAnalyzerFactory.h"
 #include "UnitMgr.h"
 
 LiftingActivity::LiftingActivity(GForceAnalyzer* const analyzer)
 	:  m_analyzer(analyzer), Activity()
 {
+	AttributeHandlers(); // interns our attribute names before the first query
+
 	Clear();
 }
 
 LiftingActivity::~LiftingActivity()
 {
 	Clear();
+
+	// Subclasses give the analyzer back in their destructors, where GetType() still works. This only catches one that didn't.
+	delete m_analyzer;
 }
 
 void LiftingActivity::SetGForceAnalyzer(GForceAnalyzer* const analyzer)
 {
-	if (analyzer)
+	if (analyzer && (analyzer != m_analyzer))
 	{
+		ReleaseGForceAnalyzer();
 		m_analyzer = analyzer;
 	}
 }
 
+void LiftingActivity::ReleaseGForceAnalyzer()
+{
+	GForceAnalyzerFactory::ReleaseAnalyzer(GetType(), m_analyzer);
+	m_analyzer = NULL;
+}
+
 bool LiftingActivity::Start()
 {
 	Clear();
@@ -93,44 +106,45 @@ bool LiftingActivity::ProcessAccelerometerReading(const SensorReading& reading)
 	return Activity::ProcessAccelerometerReading(reading);
 }
 
-ActivityAttributeType LiftingActivity::QueryActivityAttribute(const std::string& attributeName) const
+const ActivityAttributeHandlerTable<LiftingActivity>& LiftingActivity::AttributeHandlers()
+{
+	static const ActivityAttributeHandlerTable<LiftingActivity> handlers = BuildAttributeHandlers();
+	return handlers;
+}
+
+ActivityAttributeHandlerTable<LiftingActivity> LiftingActivity::BuildAttributeHandlers()
+{
+	ActivityAttributeHandlerTable<LiftingActivity> handlers;
+
+	handlers.Register(ACTIVITY_ATTRIBUTE_REPS, &LiftingActivity::QueryRepsAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_REPS_COMPUTED, &LiftingActivity::QueryRepsComputedAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_REPS_CORRECTED, &LiftingActivity::QueryRepsCorrectedAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_SETS, &LiftingActivity::QuerySetsAttribute);
+	return handlers;
+}
+
+ActivityAttributeType LiftingActivity::QueryActivityAttributeById(ActivityAttributeId attributeId) const
+{
+	ActivityAttributeType result;
+
+	if (!AttributeHandlers().Query(this, attributeId, result))
+	{
+		result = Activity::QueryActivityAttributeById(attributeId);
+	}
+	return result;
+}
+
+ActivityAttributeType LiftingActivity::QueryNamedActivityAttribute(const std::string& attributeName) const
 {
 	ActivityAttributeType result;
 
 	result.startTime = 0;
 	result.endTime = 0;
 	result.unitSystem = UnitMgr::GetUnitSystem();
+	result.valueType = TYPE_NOT_SET;
+	result.valid = false;
 
-	if (attributeName.compare(ACTIVITY_ATTRIBUTE_REPS) == 0)
-	{
-		result.value.intVal = Total();
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_COUNT;
-		result.valid = result.value.intVal > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_REPS_COMPUTED) == 0)
-	{
-		result.value.intVal = ComputedTotal();
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_COUNT;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_REPS_CORRECTED) == 0)
-	{
-		result.value.intVal = CorrectedTotal();
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_COUNT;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_SETS) == 0)
-	{
-		uint16_t total = Total();
-		result.value.intVal = Sets();
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_COUNT;
-		result.valid = total > 0;
-	}
-	else if (attributeName.find(ACTIVITY_ATTRIBUTE_GRAPH_PEAK) == 0)
+	if (attributeName.find(ACTIVITY_ATTRIBUTE_GRAPH_PEAK) == 0)
 	{
 		if (m_analyzer)
 		{
@@ -157,11 +171,44 @@ ActivityAttributeType LiftingActivity::QueryActivityAttribute(const std::string&
 	}
 	else
 	{
-		result = Activity::QueryActivityAttribute(attributeName);
+		result = Activity::QueryNamedActivityAttribute(attributeName);
 	}
 	return result;
 }
 
+void LiftingActivity::QueryRepsAttribute(ActivityAttributeType& result) const
+{
+	result.value.intVal = Total();
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_COUNT;
+	result.valid = result.value.intVal > 0;
+}
+
+void LiftingActivity::QueryRepsComputedAttribute(ActivityAttributeType& result) const
+{
+	result.value.intVal = ComputedTotal();
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_COUNT;
+	result.valid = true;
+}
+
+void LiftingActivity::QueryRepsCorrectedAttribute(ActivityAttributeType& result) const
+{
+	result.value.intVal = CorrectedTotal();
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_COUNT;
+	result.valid = true;
+}
+
+void LiftingActivity::QuerySetsAttribute(ActivityAttributeType& result) const
+{
+	uint16_t total = Total();
+	result.value.intVal = Sets();
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_COUNT;
+	result.valid = total > 0;
+}
+
 void LiftingActivity::SetActivityAttribute(const std::string& attributeName, ActivityAttributeType attributeValue)
 {
 	if (attributeName.compare(ACTIVITY_ATTRIBUTE_REPS_CORRECTED) == 0)
@@ -16,6 +16,7 @@
 *
 * All activity types that do not require location data (typically strength activities such as push-ups, pull-ups, etc.) inherit from this class with common functionality being encapsulated here.
 * An instantiation of any class that inherits from this class represents a specific activity performed by the user.
+* The activity owns its analyzer and gives it back to the GForceAnalyzerFactory, by activity type, when it is destroyed.
 */
 class LiftingActivity : public Activity
 {
@@ -30,7 +31,7 @@ public:
 
 	virtual void ListUsableSensors(std::vector<SensorType>& sensorTypes) const;
 
-	virtual ActivityAttributeType QueryActivityAttribute(const std::string& attributeName) const;
+	virtual ActivityAttributeType QueryActivityAttributeById(ActivityAttributeId attributeId) const;
 	virtual void SetActivityAttribute(const std::string& attributeName, ActivityAttributeType attributeValue);
 
 	virtual time_t ActiveTimeInSeconds() const { return (time_t)(ElapsedTimeInSeconds() - (m_restingTimeMs / 1000)); };
@@ -47,7 +48,12 @@ public:
 	virtual void BuildSummaryAttributeList(std::vector<std::string>& attributes) const;
 
 protected:
-	GForceAnalyzer* m_analyzer;
+	virtual ActivityAttributeType QueryNamedActivityAttribute(const std::string& attributeName) const;
+
+	/// Gives the analyzer back to the factory's pool, must be called by each subclass's destructor.
+	void ReleaseGForceAnalyzer();
+
+	GForceAnalyzer* m_analyzer; // owned, not shared with any other activity
 	LibMath::GraphPeakList m_computedRepList;
 	uint16_t m_repsCorrected;
 	uint16_t m_sets;
@@ -60,6 +66,15 @@ protected:
 	virtual bool CheckSetsInterval();
 	virtual bool CheckRepsInterval();
 	virtual void AdvanceIntervalState();
+
+private:
+	static const ActivityAttributeHandlerTable<LiftingActivity>& AttributeHandlers();
+	static ActivityAttributeHandlerTable<LiftingActivity> BuildAttributeHandlers();
+
+	void QueryRepsAttribute(ActivityAttributeType& result) const;
+	void QueryRepsComputedAttribute(ActivityAttributeType& result) const;
+	void QueryRepsCorrectedAttribute(ActivityAttributeType& result) const;
+	void QuerySetsAttribute(ActivityAttributeType& result) const;
 };
 
 #endif
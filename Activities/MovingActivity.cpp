@@ -23,8 +23,10 @@
 #define METERS_PER_MARATHON       42164.8128
 #define METERS_PER_CENTURY        160934.4
 
-MovingActivity::MovingActivity() : Activity()
+MovingActivity::MovingActivity() : Activity(), m_track(true)
 {
+	AttributeHandlers(); // interns our attribute names before the first query
+
 	m_currentLoc.latitude = (double)0.0;
 	m_currentLoc.longitude = (double)0.0;
 	m_currentLoc.altitude = (double)0.0;
@@ -38,6 +40,8 @@ MovingActivity::MovingActivity() : Activity()
 	m_distanceTraveledM = (double)0.0;
 	m_totalAscentM = (double)0.0;
 	m_stoppedTimeMS = 0;
+	m_lastMovingTimeSecs = 0;
+	m_paceStationaryMS = 0;
 	
 	SegmentType nullSegment = { 0, 0, 0 };
 	
@@ -69,8 +73,7 @@ MovingActivity::MovingActivity() : Activity()
 MovingActivity::~MovingActivity()
 {
 	m_altitudeBuffer.clear();
-	m_coordinates.clear();
-	m_distances.clear();
+	m_track.Clear();
 	m_laps.clear();
 	m_splitTimes.clear();
 }
@@ -103,18 +106,17 @@ void MovingActivity::RecomputeRecordTimes()
 	uint64_t startTime = 0;
 	uint64_t endTime   = 0;
 	
-	TimeDistancePairList::const_reverse_iterator iter = m_distances.rbegin();
+	size_t distanceIndex = m_track.NumDistances();
 
 	if (DistanceTraveledInMeters() > (double)400.0)  // recompute last 400 meter time
 	{
-		while ((iter != m_distances.rend()) && (distance < (double)400.0))
+		while ((distanceIndex > 0) && (distance < (double)400.0))
 		{
-			const TimeDistancePair& item = (*iter);
+			TimeDistancePair item = m_track.GetDistance(--distanceIndex);
 			if (endTime == 0)
 				endTime = item.time;
 			startTime = item.time;
 			distance += item.distanceM;
-			iter++;
 		}
 		
 		m_last400MSec.value.intVal = (uint32_t)((endTime - startTime) / 1000);
@@ -129,14 +131,13 @@ void MovingActivity::RecomputeRecordTimes()
 	
 	if (DistanceTraveledInMeters() > (double)1000.0)  // recompute last km time
 	{
-		while ((iter != m_distances.rend()) && (distance < (double)1000.0))
+		while ((distanceIndex > 0) && (distance < (double)1000.0))
 		{
-			const TimeDistancePair& item = (*iter);
+			TimeDistancePair item = m_track.GetDistance(--distanceIndex);
 			if (endTime == 0)
 				endTime = item.time;
 			startTime = item.time;
 			distance += item.distanceM;
-			iter++;
 		}
 		
 		m_lastKmSec.value.intVal = (uint32_t)((endTime - startTime) / 1000);
@@ -151,12 +152,11 @@ void MovingActivity::RecomputeRecordTimes()
 
 	if (DistanceTraveledInMeters() > (double)METERS_PER_MILE) // recompute last mile time
 	{
-		while ((iter != m_distances.rend()) && (distance < (double)METERS_PER_MILE))
+		while ((distanceIndex > 0) && (distance < (double)METERS_PER_MILE))
 		{
-			const TimeDistancePair& item = (*iter);
+			TimeDistancePair item = m_track.GetDistance(--distanceIndex);
 			startTime = item.time;
 			distance += item.distanceM;
-			iter++;
 		}
 		
 		m_lastMileSec.value.intVal = (uint32_t)((endTime - startTime) / 1000);
@@ -171,12 +171,11 @@ void MovingActivity::RecomputeRecordTimes()
 
 	if (DistanceTraveledInMeters() > (double)5000.0) // recompute last 5K time
 	{
-		while ((iter != m_distances.rend()) && (distance < (double)5000.0))
+		while ((distanceIndex > 0) && (distance < (double)5000.0))
 		{
-			const TimeDistancePair& item = (*iter);
+			TimeDistancePair item = m_track.GetDistance(--distanceIndex);
 			startTime = item.time;
 			distance += item.distanceM;
-			iter++;
 		}
 		
 		m_last5KSec.value.intVal = (uint32_t)((endTime - startTime) / 1000);
@@ -191,12 +190,11 @@ void MovingActivity::RecomputeRecordTimes()
 
 	if (DistanceTraveledInMeters() > (double)10000.0) // recompute last 10K time
 	{
-		while ((iter != m_distances.rend()) && (distance < (double)10000.0))
+		while ((distanceIndex > 0) && (distance < (double)10000.0))
 		{
-			const TimeDistancePair& item = (*iter);
+			TimeDistancePair item = m_track.GetDistance(--distanceIndex);
 			startTime = item.time;
 			distance += item.distanceM;
-			iter++;
 		}
 		
 		m_last10KSec.value.intVal = (uint32_t)((endTime - startTime) / 1000);
@@ -211,12 +209,11 @@ void MovingActivity::RecomputeRecordTimes()
 
 	if (DistanceTraveledInMeters() > (double)METERS_PER_HALF_MARATHON) // recompute last 13.1 mile time
 	{
-		while ((iter != m_distances.rend()) && (distance < (double)METERS_PER_HALF_MARATHON))
+		while ((distanceIndex > 0) && (distance < (double)METERS_PER_HALF_MARATHON))
 		{
-			const TimeDistancePair& item = (*iter);
+			TimeDistancePair item = m_track.GetDistance(--distanceIndex);
 			startTime = item.time;
 			distance += item.distanceM;
-			iter++;
 		}
 		
 		m_lastHalfMarathonSec.value.intVal = (uint32_t)((endTime - startTime) / 1000);
@@ -231,12 +228,11 @@ void MovingActivity::RecomputeRecordTimes()
 
 	if (DistanceTraveledInMeters() > (double)METERS_PER_MARATHON) // recompute last 26.2 mile time
 	{
-		while ((iter != m_distances.rend()) && (distance < (double)METERS_PER_MARATHON))
+		while ((distanceIndex > 0) && (distance < (double)METERS_PER_MARATHON))
 		{
-			const TimeDistancePair& item = (*iter);
+			TimeDistancePair item = m_track.GetDistance(--distanceIndex);
 			startTime = item.time;
 			distance += item.distanceM;
-			iter++;
 		}
 		
 		m_lastMarathonSec.value.intVal = (uint32_t)((endTime - startTime) / 1000);
@@ -251,12 +247,11 @@ void MovingActivity::RecomputeRecordTimes()
 
 	if (DistanceTraveledInMeters() > (double)100000.0) // recompute last 100K time
 	{
-		while ((iter != m_distances.rend()) && (distance < (double)100000.0))
+		while ((distanceIndex > 0) && (distance < (double)100000.0))
 		{
-			const TimeDistancePair& item = (*iter);
+			TimeDistancePair item = m_track.GetDistance(--distanceIndex);
 			startTime = item.time;
 			distance += item.distanceM;
-			iter++;
 		}
 
 		m_lastMetricCenturySec.value.intVal = (uint32_t)((endTime - startTime) / 1000);
@@ -271,12 +266,11 @@ void MovingActivity::RecomputeRecordTimes()
 
 	if (DistanceTraveledInMeters() > (double)METERS_PER_CENTURY) // recompute last 100 mile time
 	{
-		while ((iter != m_distances.rend()) && (distance < (double)METERS_PER_CENTURY))
+		while ((distanceIndex > 0) && (distance < (double)METERS_PER_CENTURY))
 		{
-			const TimeDistancePair& item = (*iter);
+			TimeDistancePair item = m_track.GetDistance(--distanceIndex);
 			startTime = item.time;
 			distance += item.distanceM;
-			iter++;
 		}
 		
 		m_lastCenturySec.value.intVal = (uint32_t)((endTime - startTime) / 1000);
@@ -385,7 +379,7 @@ bool MovingActivity::ProcessLocationReading(const SensorReading& reading)
 		m_totalAscentM += currAlt - prevAlt;
 	}
 
-	m_coordinates.push_back(m_currentLoc);
+	m_track.AppendPosition(m_currentLoc);
 
 	if (m_previousLocSet)
 	{
@@ -393,7 +387,7 @@ bool MovingActivity::ProcessLocationReading(const SensorReading& reading)
 		distanceInfo.verticalDistanceM = m_currentLoc.altitude - m_previousLoc.altitude;
 		distanceInfo.distanceM = LibMath::Distance::haversineDistance(m_previousLoc.latitude, m_previousLoc.longitude, m_previousLoc.altitude, m_currentLoc.latitude, m_currentLoc.longitude, m_currentLoc.altitude);
 		distanceInfo.time = reading.time;
-		m_distances.push_back(distanceInfo);
+		m_track.AppendDistance(distanceInfo.time, distanceInfo.distanceM, distanceInfo.verticalDistanceM);
 
 		SetDistanceTraveledInMeters(DistanceTraveledInMeters() + distanceInfo.distanceM);
 
@@ -469,380 +463,91 @@ bool MovingActivity::GetCoordinate(size_t pointIndex, Coordinate* const pCoordin
 		return false;
 	}
 	
-	if (pointIndex < m_coordinates.size())
+	if (pointIndex < m_track.NumPositions())
 	{
-		pCoordinate->latitude  = m_coordinates.at(pointIndex).latitude;
-		pCoordinate->longitude = m_coordinates.at(pointIndex).longitude;
-		pCoordinate->altitude  = m_coordinates.at(pointIndex).altitude;
+		pCoordinate->latitude  = m_track.Latitude(pointIndex);
+		pCoordinate->longitude = m_track.Longitude(pointIndex);
+		pCoordinate->altitude  = m_track.Altitude(pointIndex);
+		pCoordinate->time      = m_track.PositionTime(pointIndex);
 		result = true;
 	}
 	return result;	
 }
 
-ActivityAttributeType MovingActivity::QueryActivityAttribute(const std::string& attributeName) const
+const ActivityAttributeHandlerTable<MovingActivity>& MovingActivity::AttributeHandlers()
+{
+	static const ActivityAttributeHandlerTable<MovingActivity> handlers = BuildAttributeHandlers();
+	return handlers;
+}
+
+ActivityAttributeHandlerTable<MovingActivity> MovingActivity::BuildAttributeHandlers()
+{
+	ActivityAttributeHandlerTable<MovingActivity> handlers;
+
+	handlers.Register(ACTIVITY_ATTRIBUTE_MOVING_TIME, &MovingActivity::QueryMovingTimeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_MIN_ALTITUDE, &MovingActivity::QueryMinAltitudeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_MAX_ALTITUDE, &MovingActivity::QueryMaxAltitudeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_AVG_PACE, &MovingActivity::QueryAvgPaceAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_MOVING_PACE, &MovingActivity::QueryMovingPaceAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_CURRENT_PACE, &MovingActivity::QueryCurrentPaceAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_PACE, &MovingActivity::QueryFastestPaceAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_GAP_TO_TARGET_PACE, &MovingActivity::QueryGapToTargetPaceAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_AVG_SPEED, &MovingActivity::QueryAvgSpeedAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_MOVING_SPEED, &MovingActivity::QueryMovingSpeedAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_CURRENT_SPEED, &MovingActivity::QueryCurrentSpeedAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_SPEED, &MovingActivity::QueryFastestSpeedAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, &MovingActivity::QueryDistanceTraveledAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_PREVIOUS_DISTANCE_TRAVELED, &MovingActivity::QueryPreviousDistanceTraveledAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_LATITUDE, &MovingActivity::QueryLatitudeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_LONGITUDE, &MovingActivity::QueryLongitudeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_HORIZONTAL_ACCURACY, &MovingActivity::QueryHorizontalAccuracyAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_VERTICAL_ACCURACY, &MovingActivity::QueryVerticalAccuracyAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_ALTITUDE, &MovingActivity::QueryAltitudeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_STARTING_LATITUDE, &MovingActivity::QueryStartingLatitudeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_STARTING_LONGITUDE, &MovingActivity::QueryStartingLongitudeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_CENTURY, &MovingActivity::QueryFastestCenturyAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_METRIC_CENTURY, &MovingActivity::QueryFastestMetricCenturyAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_MARATHON, &MovingActivity::QueryFastestMarathonAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_HALF_MARATHON, &MovingActivity::QueryFastestHalfMarathonAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_10K, &MovingActivity::QueryFastest10KAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_5K, &MovingActivity::QueryFastest5KAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_MILE, &MovingActivity::QueryFastestMileAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_KM, &MovingActivity::QueryFastestKmAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_FASTEST_400M, &MovingActivity::QueryFastest400MAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_LAST_10K, &MovingActivity::QueryLast10KAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_LAST_5K, &MovingActivity::QueryLast5KAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_LAST_MILE, &MovingActivity::QueryLastMileAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_LAST_KM, &MovingActivity::QueryLastKmAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_CURRENT_CLIMB, &MovingActivity::QueryCurrentClimbAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_BIGGEST_CLIMB, &MovingActivity::QueryBiggestClimbAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_VERTICAL_SPEED, &MovingActivity::QueryVerticalSpeedAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_CURRENT_LAP_TIME, &MovingActivity::QueryCurrentLapTimeAttribute);
+	handlers.Register(ACTIVITY_ATTRIBUTE_TOTAL_ASCENT, &MovingActivity::QueryTotalAscentAttribute);
+	return handlers;
+}
+
+ActivityAttributeType MovingActivity::QueryActivityAttributeById(ActivityAttributeId attributeId) const
+{
+	ActivityAttributeType result;
+
+	if (!AttributeHandlers().Query(this, attributeId, result))
+	{
+		result = Activity::QueryActivityAttributeById(attributeId);
+	}
+	return result;
+}
+
+ActivityAttributeType MovingActivity::QueryNamedActivityAttribute(const std::string& attributeName) const
 {
 	ActivityAttributeType result;
 
 	result.startTime = 0;
 	result.endTime = 0;
 	result.unitSystem = UnitMgr::GetUnitSystem();
+	result.valueType = TYPE_NOT_SET;
+	result.valid = false;
 
-	if (attributeName.compare(ACTIVITY_ATTRIBUTE_MOVING_TIME) == 0)
-	{
-		result.value.timeVal = MovingTimeInSeconds();
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_MIN_ALTITUDE) == 0)
-	{
-		SegmentType segment = MinimumAltitude();
-		result.value.doubleVal = segment.value.doubleVal;
-		result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
-		result.measureType = MEASURE_ALTITUDE;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = m_coordinates.size() > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_MAX_ALTITUDE) == 0)
-	{
-		SegmentType segment = MaximumAltitude();
-		result.value.doubleVal = segment.value.doubleVal;
-		result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
-		result.measureType = MEASURE_ALTITUDE;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = m_coordinates.size() > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_AVG_PACE) == 0)
-	{
-		result.value.timeVal = (time_t)AveragePace();
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_PACE;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_MOVING_PACE) == 0)
-	{
-		result.value.timeVal = (time_t)MovingPace();
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_PACE;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_CURRENT_PACE) == 0)
-	{
-		SegmentType segment = CurrentPace();
-		result.value.timeVal = (time_t)segment.value.doubleVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_PACE;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_PACE) == 0)
-	{
-		SegmentType segment = FastestPace();
-		result.value.timeVal = (time_t)segment.value.doubleVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_PACE;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_GAP_TO_TARGET_PACE) == 0)
-	{
-		result.value.timeVal = GapToTargetPace();
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_PACE;
-		result.valid = m_pacePlan.planId.size() > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_AVG_SPEED) == 0)
-	{
-		result.value.doubleVal = AverageSpeed();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_SPEED;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_MOVING_SPEED) == 0)
-	{
-		result.value.doubleVal = MovingSpeed();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_SPEED;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_CURRENT_SPEED) == 0)
-	{
-		SegmentType segment = CurrentSpeed();
-		result.value.doubleVal = segment.value.doubleVal;
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_SPEED;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_SPEED) == 0)
-	{
-		SegmentType segment = FastestSpeed();
-		result.value.doubleVal = segment.value.doubleVal;
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_SPEED;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED) == 0)
-	{
-		result.value.doubleVal = DistanceTraveled();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_DISTANCE;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_PREVIOUS_DISTANCE_TRAVELED) == 0)
-	{
-		result.value.doubleVal = PrevDistanceTraveled();
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_DISTANCE;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_LATITUDE) == 0)
-	{
-		result.value.doubleVal = m_currentLoc.latitude;
-		result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
-		result.measureType = MEASURE_DEGREES;
-		result.startTime = m_currentLoc.time;
-		result.endTime = m_currentLoc.time;
-		result.valid = m_coordinates.size() > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_LONGITUDE) == 0)
-	{
-		result.value.doubleVal = m_currentLoc.longitude;
-		result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
-		result.measureType = MEASURE_DEGREES;
-		result.startTime = m_currentLoc.time;
-		result.endTime = m_currentLoc.time;
-		result.valid = m_coordinates.size() > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_HORIZONTAL_ACCURACY) == 0)
-	{
-		result.value.doubleVal = m_currentLoc.horizontalAccuracy;
-		result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
-		result.measureType = MEASURE_GPS_ACCURACY;
-		result.startTime = m_currentLoc.time;
-		result.endTime = m_currentLoc.time;
-		result.valid = m_coordinates.size() > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_VERTICAL_ACCURACY) == 0)
-	{
-		result.value.doubleVal = m_currentLoc.verticalAccuracy;
-		result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
-		result.measureType = MEASURE_GPS_ACCURACY;
-		result.startTime = m_currentLoc.time;
-		result.endTime = m_currentLoc.time;
-		result.valid = m_coordinates.size() > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_ALTITUDE) == 0)
-	{
-		result.value.doubleVal = UnitMgr::ConvertToPreferredAltitudeFromMeters(m_currentLoc.altitude);
-		result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
-		result.measureType = MEASURE_ALTITUDE;
-		result.startTime = m_currentLoc.time;
-		result.endTime = m_currentLoc.time;
-		result.valid = m_coordinates.size() > 0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_STARTING_LATITUDE) == 0)
-	{
-		try
-		{
-			if (m_coordinates.size() > 0)
-				result.value.doubleVal = m_coordinates.at(0).latitude;
-			else
-				result.value.intVal = 0;
-			result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
-			result.measureType = MEASURE_DEGREES;
-			result.valid = m_coordinates.size() > 0;
-		}
-		catch (...)
-		{
-			result.valid = false;
-		}
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_STARTING_LONGITUDE) == 0)
-	{
-		try
-		{
-			if (m_coordinates.size() > 0)
-				result.value.doubleVal = m_coordinates.at(0).longitude;
-			else
-				result.value.intVal = 0;
-			result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
-			result.measureType = MEASURE_DEGREES;
-			result.valid = m_coordinates.size() > 0;
-		}
-		catch (...)
-		{
-			result.valid = false;
-		}
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_CENTURY) == 0)
-	{
-		SegmentType segment = FastestCentury();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)METERS_PER_CENTURY;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_METRIC_CENTURY) == 0)
-	{
-		SegmentType segment = FastestMetricCentury();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)100000;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_MARATHON) == 0)
-	{
-		SegmentType segment = FastestMarathon();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)METERS_PER_MARATHON;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_HALF_MARATHON) == 0)
-	{
-		SegmentType segment = FastestHalfMarathon();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)METERS_PER_HALF_MARATHON;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_10K) == 0)
-	{
-		SegmentType segment = Fastest10K();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)10000.0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_5K) == 0)
-	{
-		SegmentType segment = Fastest5K();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)5000.0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_MILE) == 0)
-	{
-		SegmentType segment = FastestMile();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)METERS_PER_MILE;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_KM) == 0)
-	{
-		SegmentType segment = FastestKilometer();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)1000.0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_FASTEST_400M) == 0)
-	{
-		SegmentType segment = Fastest400M();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)400.0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_LAST_10K) == 0)
-	{
-		SegmentType segment = Last10K();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)10000.0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_LAST_5K) == 0)
-	{
-		SegmentType segment = Last5K();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)5000.0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_LAST_MILE) == 0)
-	{
-		SegmentType segment = LastMile();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)METERS_PER_MILE;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_LAST_KM) == 0)
-	{
-		SegmentType segment = LastKilometer();
-		result.value.timeVal = segment.value.intVal;
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = DistanceTraveledInMeters() >= (double)1000.0;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_CURRENT_CLIMB) == 0)
-	{
-		SegmentType segment = CurrentClimb();
-		result.value.doubleVal = segment.value.doubleVal;
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_ALTITUDE;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_BIGGEST_CLIMB) == 0)
-	{
-		SegmentType segment = BiggestClimb();
-		result.value.doubleVal = segment.value.doubleVal;
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_ALTITUDE;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = true;
-	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_VERTICAL_SPEED) == 0)
-	{
-		SegmentType segment = CurrentVerticalSpeed();
-		result.value.doubleVal = segment.value.doubleVal;
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_SPEED;
-		result.startTime = segment.startTime;
-		result.endTime = segment.endTime;
-		result.valid = true;
-	}
-	else if (attributeName.find(ACTIVITY_ATTRIBUTE_SPLIT_TIME) == 0)
+	if (attributeName.find(ACTIVITY_ATTRIBUTE_SPLIT_TIME) == 0)
 	{
 		ActivityAttributeMap::const_iterator splitTimesIter = m_splitTimes.find(attributeName);
 		if (splitTimesIter != m_splitTimes.end())
@@ -872,48 +577,440 @@ ActivityAttributeType MovingActivity::QueryActivityAttribute(const std::string&
 			result.valid = true;
 		}
 	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_CURRENT_LAP_TIME) == 0)
+	else
 	{
-		if (m_laps.size() == 0)
-		{
-			result.value.timeVal = ElapsedTimeInSeconds();
-		}
+		result = Activity::QueryNamedActivityAttribute(attributeName);
+	}
+	return result;
+}
+
+void MovingActivity::QueryMovingTimeAttribute(ActivityAttributeType& result) const
+{
+	result.value.timeVal = MovingTimeInSeconds();
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.valid = true;
+}
+
+void MovingActivity::QueryMinAltitudeAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = MinimumAltitude();
+	result.value.doubleVal = segment.value.doubleVal;
+	result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
+	result.measureType = MEASURE_ALTITUDE;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = m_track.NumPositions() > 0;
+}
+
+void MovingActivity::QueryMaxAltitudeAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = MaximumAltitude();
+	result.value.doubleVal = segment.value.doubleVal;
+	result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
+	result.measureType = MEASURE_ALTITUDE;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = m_track.NumPositions() > 0;
+}
+
+void MovingActivity::QueryAvgPaceAttribute(ActivityAttributeType& result) const
+{
+	result.value.timeVal = (time_t)AveragePace();
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_PACE;
+	result.valid = true;
+}
+
+void MovingActivity::QueryMovingPaceAttribute(ActivityAttributeType& result) const
+{
+	result.value.timeVal = (time_t)MovingPace();
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_PACE;
+	result.valid = true;
+}
+
+void MovingActivity::QueryCurrentPaceAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = CurrentPace();
+	result.value.timeVal = (time_t)segment.value.doubleVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_PACE;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = true;
+}
+
+void MovingActivity::QueryFastestPaceAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = FastestPace();
+	result.value.timeVal = (time_t)segment.value.doubleVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_PACE;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = true;
+}
+
+void MovingActivity::QueryGapToTargetPaceAttribute(ActivityAttributeType& result) const
+{
+	result.value.timeVal = GapToTargetPace();
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_PACE;
+	result.valid = m_pacePlan.planId.size() > 0;
+}
+
+void MovingActivity::QueryAvgSpeedAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = AverageSpeed();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_SPEED;
+	result.valid = true;
+}
+
+void MovingActivity::QueryMovingSpeedAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = MovingSpeed();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_SPEED;
+	result.valid = true;
+}
+
+void MovingActivity::QueryCurrentSpeedAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = CurrentSpeed();
+	result.value.doubleVal = segment.value.doubleVal;
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_SPEED;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = true;
+}
+
+void MovingActivity::QueryFastestSpeedAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = FastestSpeed();
+	result.value.doubleVal = segment.value.doubleVal;
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_SPEED;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = true;
+}
+
+void MovingActivity::QueryDistanceTraveledAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = DistanceTraveled();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_DISTANCE;
+	result.valid = true;
+}
+
+void MovingActivity::QueryPreviousDistanceTraveledAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = PrevDistanceTraveled();
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_DISTANCE;
+	result.valid = true;
+}
+
+void MovingActivity::QueryLatitudeAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = m_currentLoc.latitude;
+	result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
+	result.measureType = MEASURE_DEGREES;
+	result.startTime = m_currentLoc.time;
+	result.endTime = m_currentLoc.time;
+	result.valid = m_track.NumPositions() > 0;
+}
+
+void MovingActivity::QueryLongitudeAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = m_currentLoc.longitude;
+	result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
+	result.measureType = MEASURE_DEGREES;
+	result.startTime = m_currentLoc.time;
+	result.endTime = m_currentLoc.time;
+	result.valid = m_track.NumPositions() > 0;
+}
+
+void MovingActivity::QueryHorizontalAccuracyAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = m_currentLoc.horizontalAccuracy;
+	result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
+	result.measureType = MEASURE_GPS_ACCURACY;
+	result.startTime = m_currentLoc.time;
+	result.endTime = m_currentLoc.time;
+	result.valid = m_track.NumPositions() > 0;
+}
+
+void MovingActivity::QueryVerticalAccuracyAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = m_currentLoc.verticalAccuracy;
+	result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
+	result.measureType = MEASURE_GPS_ACCURACY;
+	result.startTime = m_currentLoc.time;
+	result.endTime = m_currentLoc.time;
+	result.valid = m_track.NumPositions() > 0;
+}
+
+void MovingActivity::QueryAltitudeAttribute(ActivityAttributeType& result) const
+{
+	result.value.doubleVal = UnitMgr::ConvertToPreferredAltitudeFromMeters(m_currentLoc.altitude);
+	result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
+	result.measureType = MEASURE_ALTITUDE;
+	result.startTime = m_currentLoc.time;
+	result.endTime = m_currentLoc.time;
+	result.valid = m_track.NumPositions() > 0;
+}
+
+void MovingActivity::QueryStartingLatitudeAttribute(ActivityAttributeType& result) const
+{
+	try
+	{
+		if (m_track.NumPositions() > 0)
+			result.value.doubleVal = m_track.Latitude(0);
 		else
-		{
-			time_t lapStartTimeSecs = (time_t)(m_laps.at(m_laps.size() - 1).startTimeMs / 1000);
-			result.value.timeVal = ElapsedTimeInSeconds() - (lapStartTimeSecs - GetStartTimeSecs());
-		}
-		result.valueType = TYPE_TIME;
-		result.measureType = MEASURE_TIME;
-		result.valid = true;
+			result.value.intVal = 0;
+		result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
+		result.measureType = MEASURE_DEGREES;
+		result.valid = m_track.NumPositions() > 0;
 	}
-	else if (attributeName.compare(ACTIVITY_ATTRIBUTE_TOTAL_ASCENT) == 0)
+	catch (...)
 	{
-		result.value.doubleVal = m_totalAscentM;
-		result.valueType = TYPE_DOUBLE;
-		result.measureType = MEASURE_ALTITUDE;
-		result.valid = true;
+		result.valid = false;
+	}
+}
+
+void MovingActivity::QueryStartingLongitudeAttribute(ActivityAttributeType& result) const
+{
+	try
+	{
+		if (m_track.NumPositions() > 0)
+			result.value.doubleVal = m_track.Longitude(0);
+		else
+			result.value.intVal = 0;
+		result.valueType = m_previousLocSet ? TYPE_DOUBLE : TYPE_NOT_SET;
+		result.measureType = MEASURE_DEGREES;
+		result.valid = m_track.NumPositions() > 0;
+	}
+	catch (...)
+	{
+		result.valid = false;
+	}
+}
+
+void MovingActivity::QueryFastestCenturyAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = FastestCentury();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)METERS_PER_CENTURY;
+}
+
+void MovingActivity::QueryFastestMetricCenturyAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = FastestMetricCentury();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)100000;
+}
+
+void MovingActivity::QueryFastestMarathonAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = FastestMarathon();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)METERS_PER_MARATHON;
+}
+
+void MovingActivity::QueryFastestHalfMarathonAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = FastestHalfMarathon();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)METERS_PER_HALF_MARATHON;
+}
+
+void MovingActivity::QueryFastest10KAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = Fastest10K();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)10000.0;
+}
+
+void MovingActivity::QueryFastest5KAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = Fastest5K();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)5000.0;
+}
+
+void MovingActivity::QueryFastestMileAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = FastestMile();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)METERS_PER_MILE;
+}
+
+void MovingActivity::QueryFastestKmAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = FastestKilometer();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)1000.0;
+}
+
+void MovingActivity::QueryFastest400MAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = Fastest400M();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)400.0;
+}
+
+void MovingActivity::QueryLast10KAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = Last10K();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)10000.0;
+}
+
+void MovingActivity::QueryLast5KAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = Last5K();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)5000.0;
+}
+
+void MovingActivity::QueryLastMileAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = LastMile();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)METERS_PER_MILE;
+}
+
+void MovingActivity::QueryLastKmAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = LastKilometer();
+	result.value.timeVal = segment.value.intVal;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = DistanceTraveledInMeters() >= (double)1000.0;
+}
+
+void MovingActivity::QueryCurrentClimbAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = CurrentClimb();
+	result.value.doubleVal = segment.value.doubleVal;
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_ALTITUDE;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = true;
+}
+
+void MovingActivity::QueryBiggestClimbAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = BiggestClimb();
+	result.value.doubleVal = segment.value.doubleVal;
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_ALTITUDE;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = true;
+}
+
+void MovingActivity::QueryVerticalSpeedAttribute(ActivityAttributeType& result) const
+{
+	SegmentType segment = CurrentVerticalSpeed();
+	result.value.doubleVal = segment.value.doubleVal;
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_SPEED;
+	result.startTime = segment.startTime;
+	result.endTime = segment.endTime;
+	result.valid = true;
+}
+
+void MovingActivity::QueryCurrentLapTimeAttribute(ActivityAttributeType& result) const
+{
+	if (m_laps.size() == 0)
+	{
+		result.value.timeVal = ElapsedTimeInSeconds();
 	}
 	else
 	{
-		result = Activity::QueryActivityAttribute(attributeName);
+		time_t lapStartTimeSecs = (time_t)(m_laps.at(m_laps.size() - 1).startTimeMs / 1000);
+		result.value.timeVal = ElapsedTimeInSeconds() - (lapStartTimeSecs - GetStartTimeSecs());
 	}
-	return result;
+	result.valueType = TYPE_TIME;
+	result.measureType = MEASURE_TIME;
+	result.valid = true;
 }
 
-time_t MovingActivity::MovingTimeInSeconds() const
+void MovingActivity::QueryTotalAscentAttribute(ActivityAttributeType& result) const
 {
-	static time_t lastMovingTimeSecs = 0;
+	result.value.doubleVal = m_totalAscentM;
+	result.valueType = TYPE_DOUBLE;
+	result.measureType = MEASURE_ALTITUDE;
+	result.valid = true;
+}
 
+time_t MovingActivity::MovingTimeInSeconds() const
+{
 	uint64_t elapsedTimeMs = ElapsedTimeInMs();
 	if (elapsedTimeMs > m_stoppedTimeMS)
 	{
 		time_t currentMovingTimeSecs = (time_t)((elapsedTimeMs - m_stoppedTimeMS) / 1000);
-		if (currentMovingTimeSecs < lastMovingTimeSecs)
-			currentMovingTimeSecs = lastMovingTimeSecs;
+		if (currentMovingTimeSecs < m_lastMovingTimeSecs)
+			currentMovingTimeSecs = m_lastMovingTimeSecs;
 		if (currentMovingTimeSecs > (elapsedTimeMs / 1000))
 			currentMovingTimeSecs = (time_t)(elapsedTimeMs / 1000);
-		lastMovingTimeSecs = currentMovingTimeSecs;
+		m_lastMovingTimeSecs = currentMovingTimeSecs;
 		return currentMovingTimeSecs;
 	}
 	return 0;
@@ -951,51 +1048,48 @@ double MovingActivity::MovingPace() const
 
 SegmentType MovingActivity::CurrentPace() const
 {
-	static NumericList values;
-	static uint16_t stationaryMS = 0;
-
 	SegmentType segment = { 0, 0, 0 };
 
-	if (m_distances.size() >= 2)
+	if (m_track.NumDistances() >= 2)
 	{
 		const size_t NUM_POINTS = 7;
 		
-		const TimeDistancePair& tdPair2 = m_distances.at(m_distances.size() - 1);
-		const TimeDistancePair& tdPair1 = m_distances.at(m_distances.size() - 2);
+		TimeDistancePair tdPair2 = m_track.GetDistance(m_track.NumDistances() - 1);
+		TimeDistancePair tdPair1 = m_track.GetDistance(m_track.NumDistances() - 2);
 		
 		uint64_t elapsedTimeMS = tdPair2.time - tdPair1.time;
 		
 		if (elapsedTimeMS > 0)
 		{
-			while (values.size() >= NUM_POINTS)
+			while (m_recentPaces.size() >= NUM_POINTS)
 			{
-				values.erase(values.begin());
+				m_recentPaces.erase(m_recentPaces.begin());
 			}
 
 			double convertedDistance = UnitMgr::ConvertToPreferredDistanceFromMeters(tdPair2.distanceM);
 			double currentPace = (double)elapsedTimeMS / convertedDistance;
 			currentPace       /= (double)1000.0;
 
-			values.push_back(currentPace);
+			m_recentPaces.push_back(currentPace);
 
 			if (tdPair2.distanceM >= MIN_METERS_MOVED)
 			{
 				double sum = (double)0.0;
-				for (auto iter = values.begin(); iter != values.end(); ++iter)
+				for (auto iter = m_recentPaces.begin(); iter != m_recentPaces.end(); ++iter)
 				{
 					sum += (*iter);
 				}
 				segment.startTime = tdPair1.time;
 				segment.endTime = tdPair2.time;
-				segment.value.doubleVal = sum / values.size();
-				stationaryMS = 0;
+				segment.value.doubleVal = sum / m_recentPaces.size();
+				m_paceStationaryMS = 0;
 			}
-			else if (stationaryMS >= 3000)
+			else if (m_paceStationaryMS >= 3000)
 			{
 				segment.startTime = 0;
 				segment.endTime = 0;
 				segment.value.doubleVal = (double)0.0;
-				stationaryMS += elapsedTimeMS;
+				m_paceStationaryMS += elapsedTimeMS;
 			}
 		}
 
@@ -1081,21 +1175,21 @@ SegmentType MovingActivity::CurrentSpeed() const
 {
 	SegmentType segment = { 0, 0, 0 };
 
-	if (m_distances.size() > 0)
+	if (m_track.NumDistances() > 0)
 	{
 		const size_t MAX_POINTS_TO_USE = 10;
 
 		uint8_t numPoints      = 0;
 		double  distanceMeters = (double)0.0;
-		size_t  pointsToUse    = m_distances.size();
+		size_t  pointsToUse    = m_track.NumDistances();
 
 		if (pointsToUse > MAX_POINTS_TO_USE)
 			pointsToUse = MAX_POINTS_TO_USE;
 
-		TimeDistancePairList::const_reverse_iterator iter = m_distances.rbegin();
-		while ((iter != m_distances.rend()) && (numPoints < pointsToUse))
+		size_t distanceIndex = m_track.NumDistances();
+		while ((distanceIndex > 0) && (numPoints < pointsToUse))
 		{
-			const TimeDistancePair& pair = (*iter);
+			TimeDistancePair pair = m_track.GetDistance(--distanceIndex);
 
 			if (numPoints < (pointsToUse - 1))
 				distanceMeters += pair.distanceM;
@@ -1107,7 +1201,6 @@ SegmentType MovingActivity::CurrentSpeed() const
 				break;
 
 			++numPoints;
-			++iter;
 		}
 
 		uint64_t elapsedTimeMS = segment.endTime - segment.startTime;
@@ -1141,21 +1234,21 @@ SegmentType MovingActivity::CurrentVerticalSpeed() const
 {
 	SegmentType segment = { 0, 0, 0 };
 	
-	if (m_distances.size() > 0)
+	if (m_track.NumDistances() > 0)
 	{
 		const size_t MAX_POINTS_TO_USE = 3;
 
 		uint8_t numPoints      = 0;
 		double  distanceMeters = (double)0.0;
-		size_t  pointsToUse    = m_distances.size();
+		size_t  pointsToUse    = m_track.NumDistances();
 		
 		if (pointsToUse > MAX_POINTS_TO_USE)
 			pointsToUse = MAX_POINTS_TO_USE;
 		
-		TimeDistancePairList::const_reverse_iterator iter = m_distances.rbegin();
-		while ((iter != m_distances.rend()) && (numPoints < pointsToUse))
+		size_t distanceIndex = m_track.NumDistances();
+		while ((distanceIndex > 0) && (numPoints < pointsToUse))
 		{
-			const TimeDistancePair& pair = (*iter);
+			TimeDistancePair pair = m_track.GetDistance(--distanceIndex);
 			
 			if (numPoints < (pointsToUse - 1))
 				distanceMeters += pair.verticalDistanceM;
@@ -1164,7 +1257,6 @@ SegmentType MovingActivity::CurrentVerticalSpeed() const
 			segment.startTime = pair.time;
 			
 			++numPoints;
-			++iter;
 		}
 		
 		uint64_t elapsedTimeMS = segment.endTime - segment.startTime;
@@ -1188,16 +1280,16 @@ SegmentType MovingActivity::CurrentClimb() const
 {
 	SegmentType segment = { 0, 0, 0 };
 	
-	if (m_distances.size() > 0)
+	if (m_track.NumDistances() > 0)
 	{
 		uint8_t numPoints  = 0;
 		double  climbM = (double)0.0;
 		double  maxClimbM = (double)0.0;
 
-		TimeDistancePairList::const_reverse_iterator iter = m_distances.rbegin();
-		while (iter != m_distances.rend())
+		size_t distanceIndex = m_track.NumDistances();
+		while (distanceIndex > 0)
 		{
-			const TimeDistancePair& pair = (*iter);
+			TimeDistancePair pair = m_track.GetDistance(--distanceIndex);
 			
 			climbM += pair.verticalDistanceM;
 			if (climbM < (double)0.0)
@@ -1216,7 +1308,6 @@ SegmentType MovingActivity::CurrentClimb() const
 			}
 
 			++numPoints;
-			++iter;
 		}
 	}
 	return segment;
@@ -10,24 +10,17 @@
 
 #include "Activity.h"
 #include "Coordinate.h"
+#include "TrackStore.h"
 
 #include <stdint.h>
 #include <vector>
 
-typedef struct TimeDistancePair
-{
-	double   distanceM;
-	double   verticalDistanceM;
-	uint64_t time;
-} TimeDistancePair;
-
 typedef struct LapSummary
 {
 	uint64_t startTimeMs;
 } LapSummary;
 
 typedef std::vector<Coordinate>       CoordinateList;
-typedef std::vector<TimeDistancePair> TimeDistancePairList;
 typedef std::vector<LapSummary>       LapSummaryList;
 
 /**
@@ -50,7 +43,7 @@ public:
 
 	virtual bool GetCoordinate(size_t pointIndex, Coordinate* const pCoordinate) const;
 
-	virtual ActivityAttributeType QueryActivityAttribute(const std::string& attributeName) const;
+	virtual ActivityAttributeType QueryActivityAttributeById(ActivityAttributeId attributeId) const;
 
 	virtual time_t MovingTimeInSeconds() const;
 	virtual double MovingTimeInMinutes() const { return MovingTimeInSeconds() / (double)60.0; };
@@ -107,11 +100,12 @@ public:
 	virtual void BuildAttributeList(std::vector<std::string>& attributes) const;
 	virtual void BuildSummaryAttributeList(std::vector<std::string>& attributes) const;
 
-	const CoordinateList& GetCoordinates() const { return m_coordinates; };
-	const TimeDistancePairList& GetDistances() const { return m_distances; };
+	const TrackStore& GetTrack() const { return m_track; };
 	const LapSummaryList& GetLaps() const { return m_laps; };
 
 protected:
+	virtual ActivityAttributeType QueryNamedActivityAttribute(const std::string& attributeName) const;
+
 	Coordinate           m_currentLoc;              // most recent point
 	Coordinate           m_previousLoc;             // second most recent point
 	bool                 m_previousLocSet;
@@ -120,6 +114,9 @@ protected:
 	double               m_totalAscentM;            // sum of all ascents (in meters)
 	std::vector<double>  m_altitudeBuffer;          // for computing a running average of altitude
 	uint64_t             m_stoppedTimeMS;           // amount of time spent not moving (in milliseconds)
+	mutable time_t       m_lastMovingTimeSecs;      // most recently reported moving time, so it never goes backwards
+	mutable NumericList  m_recentPaces;             // most recent instantaneous paces, averaged to give the current pace
+	mutable uint16_t     m_paceStationaryMS;        // amount of time the current pace has been reported as zero
 	SegmentType          m_minAltitudeM;
 	SegmentType          m_maxAltitudeM;
 	SegmentType          m_biggestClimbM;
@@ -144,8 +141,7 @@ protected:
 	SegmentType          m_lastMileSec;             // most recent mile time
 	SegmentType          m_lastKmSec;               // most recent KM time
 	SegmentType          m_last400MSec;             // most recent 400M time
-	CoordinateList       m_coordinates;             // list of all coordinates comprising the activity
-	TimeDistancePairList m_distances;               // list of all time/distance pairs comprising the activity
+	TrackStore           m_track;                   // all coordinates and time/distance pairs comprising the activity
 	LapSummaryList       m_laps;
 	ActivityAttributeMap m_splitTimes;
 
@@ -159,6 +155,50 @@ protected:
 	virtual void AdvanceIntervalState();
 
 	virtual double RunningAltitudeAverage() const;
+
+private:
+	static const ActivityAttributeHandlerTable<MovingActivity>& AttributeHandlers();
+	static ActivityAttributeHandlerTable<MovingActivity> BuildAttributeHandlers();
+
+	void QueryMovingTimeAttribute(ActivityAttributeType& result) const;
+	void QueryMinAltitudeAttribute(ActivityAttributeType& result) const;
+	void QueryMaxAltitudeAttribute(ActivityAttributeType& result) const;
+	void QueryAvgPaceAttribute(ActivityAttributeType& result) const;
+	void QueryMovingPaceAttribute(ActivityAttributeType& result) const;
+	void QueryCurrentPaceAttribute(ActivityAttributeType& result) const;
+	void QueryFastestPaceAttribute(ActivityAttributeType& result) const;
+	void QueryGapToTargetPaceAttribute(ActivityAttributeType& result) const;
+	void QueryAvgSpeedAttribute(ActivityAttributeType& result) const;
+	void QueryMovingSpeedAttribute(ActivityAttributeType& result) const;
+	void QueryCurrentSpeedAttribute(ActivityAttributeType& result) const;
+	void QueryFastestSpeedAttribute(ActivityAttributeType& result) const;
+	void QueryDistanceTraveledAttribute(ActivityAttributeType& result) const;
+	void QueryPreviousDistanceTraveledAttribute(ActivityAttributeType& result) const;
+	void QueryLatitudeAttribute(ActivityAttributeType& result) const;
+	void QueryLongitudeAttribute(ActivityAttributeType& result) const;
+	void QueryHorizontalAccuracyAttribute(ActivityAttributeType& result) const;
+	void QueryVerticalAccuracyAttribute(ActivityAttributeType& result) const;
+	void QueryAltitudeAttribute(ActivityAttributeType& result) const;
+	void QueryStartingLatitudeAttribute(ActivityAttributeType& result) const;
+	void QueryStartingLongitudeAttribute(ActivityAttributeType& result) const;
+	void QueryFastestCenturyAttribute(ActivityAttributeType& result) const;
+	void QueryFastestMetricCenturyAttribute(ActivityAttributeType& result) const;
+	void QueryFastestMarathonAttribute(ActivityAttributeType& result) const;
+	void QueryFastestHalfMarathonAttribute(ActivityAttributeType& result) const;
+	void QueryFastest10KAttribute(ActivityAttributeType& result) const;
+	void QueryFastest5KAttribute(ActivityAttributeType& result) const;
+	void QueryFastestMileAttribute(ActivityAttributeType& result) const;
+	void QueryFastestKmAttribute(ActivityAttributeType& result) const;
+	void QueryFastest400MAttribute(ActivityAttributeType& result) const;
+	void QueryLast10KAttribute(ActivityAttributeType& result) const;
+	void QueryLast5KAttribute(ActivityAttributeType& result) const;
+	void QueryLastMileAttribute(ActivityAttributeType& result) const;
+	void QueryLastKmAttribute(ActivityAttributeType& result) const;
+	void QueryCurrentClimbAttribute(ActivityAttributeType& result) const;
+	void QueryBiggestClimbAttribute(ActivityAttributeType& result) const;
+	void QueryVerticalSpeedAttribute(ActivityAttributeType& result) const;
+	void QueryCurrentLapTimeAttribute(ActivityAttributeType& result) const;
+	void QueryTotalAscentAttribute(ActivityAttributeType& result) const;
 };
 
 #endif
@@ -15,6 +15,7 @@ PullUp::PullUp(GForceAnalyzer* const analyzer) : LiftingActivity(analyzer)
 
 PullUp::~PullUp()
 {
+	ReleaseGForceAnalyzer();
 }
 
 double PullUp::CaloriesBurned() const
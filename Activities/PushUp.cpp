@@ -15,6 +15,7 @@ PushUp::PushUp(GForceAnalyzer* const analyzer) : LiftingActivity(analyzer)
 
 PushUp::~PushUp()
 {
+	ReleaseGForceAnalyzer();
 }
 
 double PushUp::CaloriesBurned() const
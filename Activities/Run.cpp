@@ -6,6 +6,8 @@
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "Run.h"
+#include "TrainingPaceCalculator.h"
+#include "TrainingStressCalculator.h"
 
 Run::Run() : Walk()
 {
@@ -14,3 +16,25 @@ Run::Run() : Walk()
 Run::~Run()
 {
 }
+
+// Scored from pace, the athlete's threshold pace being estimated from their VO2Max.
+double Run::TrainingStress() const
+{
+	double movingTimeMin = MovingTimeInMinutes();
+
+	if (movingTimeMin <= (double)0.0)
+	{
+		return Walk::TrainingStress();
+	}
+
+	TrainingPaceCalculator paceCalc;
+	TrainingStressCalculator stressCalc;
+	std::map<TrainingPaceType, double> paces = paceCalc.CalcFromVO2Max(m_athlete.EstimateVO2Max());
+
+	double stress = stressCalc.EstimateFromPace(MovingTimeInSeconds(), DistanceTraveledInMeters() / movingTimeMin, paces.at(FUNCTIONAL_THRESHOLD_PACE));
+	if (stress <= (double)0.0)
+	{
+		return Walk::TrainingStress();
+	}
+	return stress;
+}
@@ -18,6 +18,8 @@ public:
 	
 	static std::string Type() { return ACTIVITY_TYPE_RUNNING; };
 	virtual std::string GetType() const { return Run::Type(); };
+
+	virtual double TrainingStress() const;
 };
 
 #endif
@@ -0,0 +1,88 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "SensorReadingColumns.h"
+
+#include <math.h>
+
+SensorReadingColumns::SensorReadingColumns()
+{
+	m_type = SENSOR_TYPE_UNKNOWN;
+}
+
+SensorReadingColumns::~SensorReadingColumns()
+{
+}
+
+void SensorReadingColumns::Append(const SensorReading& reading)
+{
+	size_t readingIndex = m_times.size();
+
+	m_type = reading.type;
+	m_times.push_back(reading.time);
+
+	for (auto iter = reading.reading.begin(); iter != reading.reading.end(); ++iter)
+	{
+		std::vector<double>& column = m_columns[(*iter).first];
+
+		// A value that was missing from earlier readings is padded so the columns stay parallel. The padding is NAN
+		// rather than zero, since zero is a real value for most sensors and GetReading has to be able to leave it out.
+		column.resize(readingIndex, NAN);
+		column.push_back((*iter).second);
+	}
+}
+
+void SensorReadingColumns::Clear()
+{
+	std::vector<uint64_t>().swap(m_times);
+	m_columns.clear();
+}
+
+size_t SensorReadingColumns::NumBytes() const
+{
+	size_t numBytes = m_times.capacity() * sizeof(uint64_t);
+
+	for (auto iter = m_columns.begin(); iter != m_columns.end(); ++iter)
+	{
+		numBytes += (*iter).first.size() + (*iter).second.capacity() * sizeof(double);
+	}
+	return numBytes;
+}
+
+bool SensorReadingColumns::GetReading(size_t readingIndex, SensorReading& reading) const
+{
+	if (readingIndex >= m_times.size())
+	{
+		return false;
+	}
+
+	reading.type = m_type;
+	reading.time = m_times.at(readingIndex);
+	reading.reading.clear();
+
+	for (auto iter = m_columns.begin(); iter != m_columns.end(); ++iter)
+	{
+		const std::vector<double>& column = (*iter).second;
+
+		if ((readingIndex < column.size()) && !isnan(column.at(readingIndex)))
+		{
+			reading.reading.insert(SensorNameValuePair((*iter).first, column.at(readingIndex)));
+		}
+	}
+	return true;
+}
+
+const std::vector<double>* SensorReadingColumns::GetColumn(const std::string& valueName) const
+{
+	auto iter = m_columns.find(valueName);
+
+	if (iter == m_columns.end())
+	{
+		return NULL;
+	}
+	return &((*iter).second);
+}
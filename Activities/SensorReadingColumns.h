@@ -0,0 +1,48 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __SENSOR_READING_COLUMNS__
+#define __SENSOR_READING_COLUMNS__
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SensorReading.h"
+
+/**
+* Column oriented storage for the readings of a single sensor.
+*
+* Every reading of a sensor reports the same set of values, so instead of keeping a map per reading
+* this keeps one time array plus one array per value name, all of them parallel to each other.
+*/
+class SensorReadingColumns
+{
+public:
+	SensorReadingColumns();
+	virtual ~SensorReadingColumns();
+
+	void Append(const SensorReading& reading);
+	void Clear();
+
+	size_t NumReadings() const { return m_times.size(); };
+	size_t NumBytes() const;
+
+	bool GetReading(size_t readingIndex, SensorReading& reading) const;
+	const std::vector<uint64_t>& GetTimes() const { return m_times; };
+
+	/// The column may be shorter than the time array, and readings that didn't report the value are NAN.
+	const std::vector<double>* GetColumn(const std::string& valueName) const;
+
+private:
+	SensorType                                 m_type;
+	std::vector<uint64_t>                      m_times;
+	std::map<std::string, std::vector<double>> m_columns;
+};
+
+#endif
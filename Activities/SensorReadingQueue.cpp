@@ -0,0 +1,106 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "SensorReadingQueue.h"
+
+#define SENSOR_READING_QUEUE_MASK (SENSOR_READING_QUEUE_CAPACITY - 1)
+
+SensorReadingQueue::SensorReadingQueue() :
+	m_pushPos(0),
+	m_popPos(0),
+	m_numRejected(0)
+{
+	for (size_t i = 0; i < SENSOR_READING_QUEUE_CAPACITY; ++i)
+	{
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+SensorReadingQueue::~SensorReadingQueue()
+{
+}
+
+void SensorReadingQueue::AddValue(QueuedSensorReading& reading, const char* const name, double value)
+{
+	if (reading.numValues < SENSOR_READING_MAX_VALUES)
+	{
+		reading.names[reading.numValues] = name;
+		reading.values[reading.numValues] = value;
+		++reading.numValues;
+	}
+}
+
+void SensorReadingQueue::ToSensorReading(const QueuedSensorReading& queued, SensorReading& reading)
+{
+	reading.type = queued.type;
+	reading.time = queued.time;
+	reading.reading.clear();
+
+	for (size_t i = 0; i < queued.numValues; ++i)
+	{
+		reading.reading.insert(SensorNameValuePair(queued.names[i], queued.values[i]));
+	}
+}
+
+bool SensorReadingQueue::Push(const QueuedSensorReading& reading)
+{
+	size_t pos = m_pushPos.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		Slot& slot = m_slots[pos & SENSOR_READING_QUEUE_MASK];
+		size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+		if (diff == 0)
+		{
+			// The slot is free, try to claim it. On failure, pos is reloaded with the current value.
+			if (m_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				slot.reading = reading;
+				slot.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+		{
+			// The slot still holds a reading from the previous lap, so the queue is full.
+			m_numRejected.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else
+		{
+			// Another producer claimed the slot first.
+			pos = m_pushPos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool SensorReadingQueue::Pop(QueuedSensorReading& reading)
+{
+	size_t pos = m_popPos.load(std::memory_order_relaxed);
+	Slot& slot = m_slots[pos & SENSOR_READING_QUEUE_MASK];
+	size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+	// Either nothing has been pushed here or the producer hasn't finished copying it in.
+	if (sequence != pos + 1)
+	{
+		return false;
+	}
+
+	reading = slot.reading;
+
+	// Hand the slot back to the producers for their next lap around the buffer.
+	slot.sequence.store(pos + SENSOR_READING_QUEUE_CAPACITY, std::memory_order_release);
+	m_popPos.store(pos + 1, std::memory_order_relaxed);
+	return true;
+}
+
+bool SensorReadingQueue::IsEmpty() const
+{
+	return m_pushPos.load(std::memory_order_acquire) == m_popPos.load(std::memory_order_acquire);
+}
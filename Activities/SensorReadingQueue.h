@@ -0,0 +1,76 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __SENSOR_READING_QUEUE__
+#define __SENSOR_READING_QUEUE__
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "SensorReading.h"
+
+#define SENSOR_READING_QUEUE_CAPACITY 1024 // must be a power of two
+#define SENSOR_READING_MAX_VALUES     5    // the location reading has the most values
+#define CACHE_LINE_SIZE               64
+
+/**
+* A sensor reading in a form that can be copied without allocating. The value names
+* are the string constants from ActivityAttribute.h and AxisName.h, so only the pointers are stored.
+*/
+typedef struct QueuedSensorReading
+{
+	SensorType  type;
+	uint64_t    time;
+	size_t      numValues;
+	const char* names[SENSOR_READING_MAX_VALUES];
+	double      values[SENSOR_READING_MAX_VALUES];
+} QueuedSensorReading;
+
+/**
+* Bounded, lock-free, multiple producer/single consumer queue of sensor readings.
+*
+* Sensor callbacks (on whatever thread CoreLocation or CoreBluetooth uses) push readings and return
+* immediately. The one thread that owns the current activity pops them. Each slot carries a sequence number
+* that tells producers when it is free and the consumer when it has been filled, so neither side takes a lock.
+* When the queue is full the push is rejected, and counted, rather than blocking.
+*/
+class SensorReadingQueue
+{
+public:
+	SensorReadingQueue();
+	virtual ~SensorReadingQueue();
+
+	static void AddValue(QueuedSensorReading& reading, const char* const name, double value);
+	static void ToSensorReading(const QueuedSensorReading& queued, SensorReading& reading);
+
+	/// Safe to call from any thread. Returns false if the queue is full.
+	bool Push(const QueuedSensorReading& reading);
+
+	/// Must only be called by one thread at a time. Returns false if the queue is empty.
+	bool Pop(QueuedSensorReading& reading);
+
+	bool IsEmpty() const;
+	uint64_t GetNumRejected() const { return m_numRejected; };
+
+private:
+	typedef struct Slot
+	{
+		std::atomic<size_t> sequence;
+		QueuedSensorReading reading;
+	} Slot;
+
+	Slot m_slots[SENSOR_READING_QUEUE_CAPACITY];
+
+	// Kept on separate cache lines so that producers and the consumer don't invalidate each other's line.
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t>   m_pushPos;    // next slot to be claimed by a producer
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t>   m_popPos;     // next slot to be read, only written by the consumer
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_numRejected; // pushes rejected because the queue was full
+};
+
+#endif
@@ -15,6 +15,7 @@ Squat::Squat(GForceAnalyzer* const analyzer) : LiftingActivity(analyzer)
 
 Squat::~Squat()
 {
+	ReleaseGForceAnalyzer();
 }
 
 double Squat::CaloriesBurned() const
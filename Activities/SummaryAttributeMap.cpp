@@ -0,0 +1,53 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "SummaryAttributeMap.h"
+
+#include <algorithm>
+
+static bool CompareAttributeId(const SummaryAttribute& attribute, ActivityAttributeId attributeId)
+{
+	return attribute.first < attributeId;
+}
+
+SummaryAttributeMap::SummaryAttributeMap()
+{
+}
+
+SummaryAttributeMap::~SummaryAttributeMap()
+{
+}
+
+void SummaryAttributeMap::Set(ActivityAttributeId attributeId, const ActivityAttributeType& value)
+{
+	if (attributeId == ACTIVITY_ATTRIBUTE_ID_NOT_FOUND)
+		return;
+
+	std::vector<SummaryAttribute>::iterator iter = std::lower_bound(m_attributes.begin(), m_attributes.end(), attributeId, CompareAttributeId);
+	if ((iter != m_attributes.end()) && ((*iter).first == attributeId))
+		(*iter).second = value;
+	else
+		m_attributes.insert(iter, SummaryAttribute(attributeId, value));
+}
+
+void SummaryAttributeMap::Set(const std::string& attributeName, const ActivityAttributeType& value)
+{
+	Set(ActivityAttributeRegistry::Intern(attributeName), value);
+}
+
+const ActivityAttributeType* SummaryAttributeMap::Find(ActivityAttributeId attributeId) const
+{
+	const_iterator iter = std::lower_bound(m_attributes.begin(), m_attributes.end(), attributeId, CompareAttributeId);
+	if ((iter != m_attributes.end()) && ((*iter).first == attributeId))
+		return &(*iter).second;
+	return NULL;
+}
+
+const ActivityAttributeType* SummaryAttributeMap::Find(const std::string& attributeName) const
+{
+	return Find(ActivityAttributeRegistry::Lookup(attributeName));
+}
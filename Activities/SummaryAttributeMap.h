@@ -0,0 +1,53 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __SUMMARY_ATTRIBUTE_MAP__
+#define __SUMMARY_ATTRIBUTE_MAP__
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ActivityAttributeRegistry.h"
+#include "ActivityAttributeType.h"
+
+typedef std::pair<ActivityAttributeId, ActivityAttributeType> SummaryAttribute;
+
+/**
+* The summary attributes of one activity.
+*
+* Stored as a vector sorted by interned attribute ID rather than a map keyed by name, so each activity holds
+* one contiguous block instead of a tree node and a copy of the name per attribute. The names themselves
+* live once in the ActivityAttributeRegistry.
+*/
+class SummaryAttributeMap
+{
+public:
+	typedef std::vector<SummaryAttribute>::const_iterator const_iterator;
+
+	SummaryAttributeMap();
+	~SummaryAttributeMap();
+
+	void Set(ActivityAttributeId attributeId, const ActivityAttributeType& value);
+	void Set(const std::string& attributeName, const ActivityAttributeType& value);
+
+	/// Returns NULL if the attribute isn't present.
+	const ActivityAttributeType* Find(ActivityAttributeId attributeId) const;
+	const ActivityAttributeType* Find(const std::string& attributeName) const;
+
+	void Clear() { m_attributes.clear(); };
+	void Compact() { m_attributes.shrink_to_fit(); };
+	size_t Size() const { return m_attributes.size(); };
+
+	const_iterator begin() const { return m_attributes.begin(); };
+	const_iterator end() const { return m_attributes.end(); };
+
+private:
+	std::vector<SummaryAttribute> m_attributes; // sorted by attribute ID
+};
+
+#endif
@@ -12,6 +12,8 @@
 
 Swim::Swim()
 {
+	AttributeHandlers(); // interns our attribute names before the first query
+
 	m_lastPeakCalculationTime = 0;
 	m_strokesTaken = 0;
 	m_currentCalories = (double)0.0;
@@ -65,28 +67,39 @@ bool Swim::ProcessAccelerometerReading(const SensorReading& reading)
 	return MovingActivity::ProcessAccelerometerReading(reading);
 }
 
-ActivityAttributeType Swim::QueryActivityAttribute(const std::string& attributeName) const
+const ActivityAttributeHandlerTable<Swim>& Swim::AttributeHandlers()
 {
-	ActivityAttributeType result;
+	static const ActivityAttributeHandlerTable<Swim> handlers = BuildAttributeHandlers();
+	return handlers;
+}
 
-	result.startTime = 0;
-	result.endTime = 0;
-	result.unitSystem = UnitMgr::GetUnitSystem();
+ActivityAttributeHandlerTable<Swim> Swim::BuildAttributeHandlers()
+{
+	ActivityAttributeHandlerTable<Swim> handlers;
 
-	if (attributeName.compare(ACTIVITY_ATTRIBUTE_SWIM_STROKES) == 0)
-	{
-		result.value.intVal = StrokesTaken();
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_COUNT;
-		result.valid = true;
-	}
-	else
+	handlers.Register(ACTIVITY_ATTRIBUTE_SWIM_STROKES, &Swim::QuerySwimStrokesAttribute);
+	return handlers;
+}
+
+ActivityAttributeType Swim::QueryActivityAttributeById(ActivityAttributeId attributeId) const
+{
+	ActivityAttributeType result;
+
+	if (!AttributeHandlers().Query(this, attributeId, result))
 	{
-		result = MovingActivity::QueryActivityAttribute(attributeName);
+		result = MovingActivity::QueryActivityAttributeById(attributeId);
 	}
 	return result;
 }
 
+void Swim::QuerySwimStrokesAttribute(ActivityAttributeType& result) const
+{
+	result.value.intVal = StrokesTaken();
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_COUNT;
+	result.valid = true;
+}
+
 void Swim::BuildAttributeList(std::vector<std::string>& attributes) const
 {
 	attributes.push_back(ACTIVITY_ATTRIBUTE_SWIM_STROKES);
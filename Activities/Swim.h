@@ -23,7 +23,7 @@ public:
 	Swim();
 	virtual ~Swim();
 
-	virtual ActivityAttributeType QueryActivityAttribute(const std::string& attributeName) const;
+	virtual ActivityAttributeType QueryActivityAttributeById(ActivityAttributeId attributeId) const;
 
 	virtual bool Stop();
 	virtual void Pause();
@@ -47,6 +47,12 @@ protected:
 
 protected:
 	void CalculateStrokesTaken();
+
+private:
+	static const ActivityAttributeHandlerTable<Swim>& AttributeHandlers();
+	static ActivityAttributeHandlerTable<Swim> BuildAttributeHandlers();
+
+	void QuerySwimStrokesAttribute(ActivityAttributeType& result) const;
 };
 
 #endif
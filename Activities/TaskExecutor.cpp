@@ -0,0 +1,238 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "TaskExecutor.h"
+
+#include <chrono>
+
+// Which executor, and which of its queues, the current thread works for.
+static thread_local const TaskExecutor* g_currentExecutor = NULL;
+static thread_local size_t g_currentQueueIndex = 0;
+
+TaskExecutor::TaskExecutor(size_t numThreads)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::thread::hardware_concurrency();
+	}
+	if (numThreads == 0)
+	{
+		numThreads = 1;
+	}
+
+	m_running = true;
+	m_numQueued = 0;
+
+	for (size_t i = 0; i <= numThreads; ++i)
+	{
+		m_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	}
+	for (size_t i = 0; i < numThreads; ++i)
+	{
+		m_threads.push_back(std::thread(&TaskExecutor::WorkerThread, this, i));
+	}
+}
+
+TaskExecutor::~TaskExecutor()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_idleMutex);
+		m_running = false;
+	}
+	m_idle.notify_all();
+
+	for (auto iter = m_threads.begin(); iter != m_threads.end(); ++iter)
+	{
+		(*iter).join();
+	}
+}
+
+void TaskExecutor::Submit(const Task& task)
+{
+	size_t queueIndex = SharedQueueIndex();
+
+	if (g_currentExecutor == this)
+	{
+		queueIndex = g_currentQueueIndex;
+	}
+
+	// Counted before it is queued so that the count never drops below zero when it is taken straight away.
+	// Taking the idle mutex means a worker can't miss this between checking for work and going to sleep.
+	{
+		std::lock_guard<std::mutex> lock(m_idleMutex);
+		++m_numQueued;
+	}
+
+	{
+		WorkQueue& queue = *m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(task);
+	}
+	m_idle.notify_one();
+}
+
+bool TaskExecutor::RunPendingTask()
+{
+	Task task;
+	size_t queueIndex = (g_currentExecutor == this) ? g_currentQueueIndex : SharedQueueIndex();
+
+	if (FindTask(queueIndex, task))
+	{
+		task();
+		return true;
+	}
+	return false;
+}
+
+bool TaskExecutor::TakeTask(size_t queueIndex, bool fromBack, Task& task)
+{
+	WorkQueue& queue = *m_queues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+
+	if (queue.tasks.empty())
+	{
+		return false;
+	}
+
+	if (fromBack)
+	{
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+	}
+	else
+	{
+		task = queue.tasks.front();
+		queue.tasks.pop_front();
+	}
+	--m_numQueued;
+	return true;
+}
+
+bool TaskExecutor::FindTask(size_t queueIndex, Task& task)
+{
+	if (m_numQueued == 0)
+	{
+		return false;
+	}
+
+	// Newest of our own tasks first.
+	if ((queueIndex != SharedQueueIndex()) && TakeTask(queueIndex, true, task))
+	{
+		return true;
+	}
+
+	// Then the oldest task submitted from outside.
+	if (TakeTask(SharedQueueIndex(), false, task))
+	{
+		return true;
+	}
+
+	// Then steal the oldest task of another worker, starting with our neighbor so thieves spread out.
+	size_t numWorkers = m_threads.size();
+	for (size_t i = 1; i <= numWorkers; ++i)
+	{
+		size_t victim = (queueIndex + i) % numWorkers;
+
+		if ((victim != queueIndex) && TakeTask(victim, false, task))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void TaskExecutor::WorkerThread(size_t queueIndex)
+{
+	g_currentExecutor = this;
+	g_currentQueueIndex = queueIndex;
+
+	while (true)
+	{
+		Task task;
+
+		if (FindTask(queueIndex, task))
+		{
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_idleMutex);
+
+		if (!m_running && (m_numQueued == 0))
+		{
+			break;
+		}
+		m_idle.wait(lock, [this] { return !m_running || (m_numQueued > 0); });
+	}
+
+	g_currentExecutor = NULL;
+}
+
+TaskGroup::TaskGroup(TaskExecutor& executor, ExportProgressCallback progressCallback, void* context) :
+	m_executor(executor),
+	m_progressCallback(progressCallback),
+	m_context(context),
+	m_numTotal(0),
+	m_numCompleted(0)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+	Wait();
+}
+
+void TaskGroup::Run(const Task& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_numTotal;
+	}
+
+	m_executor.Submit([this, task]
+	{
+		if (!IsCancelled())
+		{
+			task();
+		}
+		TaskFinished();
+	});
+}
+
+void TaskGroup::Wait()
+{
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (m_numCompleted >= m_numTotal)
+			{
+				return;
+			}
+		}
+
+		// Help out rather than block a thread (which may be one of the executor's own) while there is work queued.
+		if (!m_executor.RunPendingTask())
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_finished.wait_for(lock, std::chrono::milliseconds(10), [this] { return m_numCompleted >= m_numTotal; });
+		}
+	}
+}
+
+void TaskGroup::TaskFinished()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	++m_numCompleted;
+	if (m_progressCallback)
+	{
+		m_progressCallback(m_numCompleted, m_numTotal, m_context);
+	}
+	m_finished.notify_all();
+}
@@ -0,0 +1,116 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __TASKEXECUTOR__
+#define __TASKEXECUTOR__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Callbacks.h"
+
+typedef std::function<void()> Task;
+
+/**
+* Set to ask long running tasks to stop early. Tasks are expected to check it between units of work.
+*/
+class CancellationToken
+{
+public:
+	CancellationToken() : m_cancelled(false) {};
+
+	void Cancel() { m_cancelled = true; };
+	bool IsCancelled() const { return m_cancelled; };
+
+private:
+	std::atomic<bool> m_cancelled;
+};
+
+/**
+* A fixed set of worker threads that run submitted tasks.
+*
+* Each worker has its own deque. Tasks submitted from a worker go on the back of that worker's deque and
+* the worker takes its next task from the back too, so related work stays on a warm cache. A worker that
+* runs out takes from the front of the shared queue (where tasks submitted from other threads go) and then
+* steals from the front of the other workers' deques, so one long list of tasks is spread over every core.
+*/
+class TaskExecutor
+{
+public:
+	/// Zero threads means one per core.
+	TaskExecutor(size_t numThreads);
+
+	/// Runs everything that is still queued before returning.
+	virtual ~TaskExecutor();
+
+	size_t GetNumThreads() const { return m_threads.size(); };
+
+	void Submit(const Task& task);
+
+	/// Runs one queued task on the calling thread, if there is one. Lets a waiting thread help out.
+	bool RunPendingTask();
+
+private:
+	typedef struct WorkQueue
+	{
+		std::mutex       mutex;
+		std::deque<Task> tasks;
+	} WorkQueue;
+
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;    // One per worker, then the shared queue
+	std::vector<std::thread>                m_threads;
+	std::atomic<bool>                       m_running;
+	std::atomic<size_t>                     m_numQueued; // Tasks in any of the queues
+	std::mutex                              m_idleMutex;
+	std::condition_variable                 m_idle;      // Signalled when a task is submitted
+
+	size_t SharedQueueIndex() const { return m_queues.size() - 1; };
+	bool TakeTask(size_t queueIndex, bool fromBack, Task& task);
+	bool FindTask(size_t queueIndex, Task& task);
+	void WorkerThread(size_t queueIndex);
+};
+
+/**
+* A set of tasks that can be waited on, and cancelled, together.
+* The progress callback, if any, is called each time one of the tasks finishes.
+*/
+class TaskGroup
+{
+public:
+	TaskGroup(TaskExecutor& executor, ExportProgressCallback progressCallback = NULL, void* context = NULL);
+
+	/// Waits for any tasks that are still outstanding.
+	virtual ~TaskGroup();
+
+	/// Tasks that haven't started when the group is cancelled are skipped.
+	void Run(const Task& task);
+	void Wait();
+
+	void Cancel() { m_token.Cancel(); };
+	bool IsCancelled() const { return m_token.IsCancelled(); };
+	const CancellationToken& GetCancellationToken() const { return m_token; };
+
+private:
+	TaskExecutor&           m_executor;
+	CancellationToken       m_token;
+	ExportProgressCallback  m_progressCallback;
+	void*                   m_context;
+	std::mutex              m_mutex;        // Protects the counts
+	std::condition_variable m_finished;     // Signalled when a task finishes
+	size_t                  m_numTotal;
+	size_t                  m_numCompleted;
+
+	void TaskFinished();
+};
+
+#endif
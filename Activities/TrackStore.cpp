@@ -0,0 +1,179 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "TrackStore.h"
+
+#include <math.h>
+
+#define FIXED_POINT_DEGREES_SCALE (double)10000000.0
+#define TRACK_CHUNK_SIZE 1024
+
+template <typename T>
+static void ReserveChunk(std::vector<T>& values)
+{
+	// Grow by half again, in whole chunks, rather than doubling on every reallocation.
+	if (values.size() == values.capacity())
+	{
+		size_t growth = values.capacity() / 2;
+		if (growth < TRACK_CHUNK_SIZE)
+			growth = TRACK_CHUNK_SIZE;
+		growth = ((growth + TRACK_CHUNK_SIZE - 1) / TRACK_CHUNK_SIZE) * TRACK_CHUNK_SIZE;
+		values.reserve(values.capacity() + growth);
+	}
+}
+
+template <typename T>
+static void ReleaseValues(std::vector<T>& values)
+{
+	std::vector<T>().swap(values);
+}
+
+template <typename T>
+static size_t NumValueBytes(const std::vector<T>& values)
+{
+	return values.capacity() * sizeof(T);
+}
+
+static int32_t DegreesToFixedPoint(double degrees)
+{
+	return (int32_t)lround(degrees * FIXED_POINT_DEGREES_SCALE);
+}
+
+TrackStore::TrackStore(bool fixedPointPositions)
+{
+	m_fixedPointPositions = fixedPointPositions;
+}
+
+TrackStore::~TrackStore()
+{
+}
+
+void TrackStore::Clear()
+{
+	ReleaseValues(m_positionTimes);
+	ReleaseValues(m_latitudes);
+	ReleaseValues(m_longitudes);
+	ReleaseValues(m_fixedPointLatitudes);
+	ReleaseValues(m_fixedPointLongitudes);
+	ReleaseValues(m_altitudes);
+	ReleaseValues(m_distanceTimes);
+	ReleaseValues(m_cumulativeDistances);
+	ReleaseValues(m_verticalDistances);
+}
+
+void TrackStore::AppendPosition(const Coordinate& coordinate)
+{
+	ReserveChunk(m_positionTimes);
+	ReserveChunk(m_altitudes);
+
+	m_positionTimes.push_back(coordinate.time);
+	m_altitudes.push_back((float)coordinate.altitude);
+
+	if (m_fixedPointPositions)
+	{
+		ReserveChunk(m_fixedPointLatitudes);
+		ReserveChunk(m_fixedPointLongitudes);
+
+		m_fixedPointLatitudes.push_back(DegreesToFixedPoint(coordinate.latitude));
+		m_fixedPointLongitudes.push_back(DegreesToFixedPoint(coordinate.longitude));
+	}
+	else
+	{
+		ReserveChunk(m_latitudes);
+		ReserveChunk(m_longitudes);
+
+		m_latitudes.push_back(coordinate.latitude);
+		m_longitudes.push_back(coordinate.longitude);
+	}
+}
+
+void TrackStore::AppendDistance(uint64_t time, double distanceM, double verticalDistanceM)
+{
+	double cumulativeDistanceM = distanceM;
+
+	if (m_cumulativeDistances.size() > 0)
+	{
+		cumulativeDistanceM += m_cumulativeDistances.back();
+	}
+
+	ReserveChunk(m_distanceTimes);
+	ReserveChunk(m_cumulativeDistances);
+	ReserveChunk(m_verticalDistances);
+
+	m_distanceTimes.push_back(time);
+	m_cumulativeDistances.push_back(cumulativeDistanceM);
+	m_verticalDistances.push_back((float)verticalDistanceM);
+}
+
+size_t TrackStore::NumBytes() const
+{
+	size_t numBytes = 0;
+
+	numBytes += NumValueBytes(m_positionTimes);
+	numBytes += NumValueBytes(m_latitudes);
+	numBytes += NumValueBytes(m_longitudes);
+	numBytes += NumValueBytes(m_fixedPointLatitudes);
+	numBytes += NumValueBytes(m_fixedPointLongitudes);
+	numBytes += NumValueBytes(m_altitudes);
+	numBytes += NumValueBytes(m_distanceTimes);
+	numBytes += NumValueBytes(m_cumulativeDistances);
+	numBytes += NumValueBytes(m_verticalDistances);
+	return numBytes;
+}
+
+bool TrackStore::GetPosition(size_t positionIndex, Coordinate& coordinate) const
+{
+	if (positionIndex >= m_positionTimes.size())
+	{
+		return false;
+	}
+
+	coordinate.latitude = Latitude(positionIndex);
+	coordinate.longitude = Longitude(positionIndex);
+	coordinate.altitude = Altitude(positionIndex);
+	coordinate.horizontalAccuracy = (double)0.0;
+	coordinate.verticalAccuracy = (double)0.0;
+	coordinate.time = m_positionTimes[positionIndex];
+	return true;
+}
+
+double TrackStore::Latitude(size_t positionIndex) const
+{
+	if (m_fixedPointPositions)
+	{
+		return (double)m_fixedPointLatitudes[positionIndex] / FIXED_POINT_DEGREES_SCALE;
+	}
+	return m_latitudes[positionIndex];
+}
+
+double TrackStore::Longitude(size_t positionIndex) const
+{
+	if (m_fixedPointPositions)
+	{
+		return (double)m_fixedPointLongitudes[positionIndex] / FIXED_POINT_DEGREES_SCALE;
+	}
+	return m_longitudes[positionIndex];
+}
+
+TimeDistancePair TrackStore::GetDistance(size_t distanceIndex) const
+{
+	TimeDistancePair pair;
+
+	pair.distanceM = SegmentDistance(distanceIndex);
+	pair.verticalDistanceM = (double)m_verticalDistances[distanceIndex];
+	pair.time = m_distanceTimes[distanceIndex];
+	return pair;
+}
+
+double TrackStore::SegmentDistance(size_t distanceIndex) const
+{
+	if (distanceIndex == 0)
+	{
+		return m_cumulativeDistances[0];
+	}
+	return m_cumulativeDistances[distanceIndex] - m_cumulativeDistances[distanceIndex - 1];
+}
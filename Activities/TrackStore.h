@@ -0,0 +1,78 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __TRACK_STORE__
+#define __TRACK_STORE__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Coordinate.h"
+
+typedef struct TimeDistancePair
+{
+	double   distanceM;
+	double   verticalDistanceM;
+	uint64_t time;
+} TimeDistancePair;
+
+/**
+* Structure of arrays storage for the track of a moving activity.
+*
+* Positions are kept as parallel time, latitude, longitude, and altitude arrays. Latitude and longitude can
+* optionally be stored as fixed point values (1e-7 degrees, about a centimeter) to halve their size.
+* Distances are kept as parallel time, cumulative distance, and vertical distance arrays, so the distance
+* covered between any two entries is a subtraction. Arrays grow in chunks rather than one element at a time.
+*/
+class TrackStore
+{
+public:
+	TrackStore(bool fixedPointPositions = false);
+	virtual ~TrackStore();
+
+	void Clear();
+
+	void AppendPosition(const Coordinate& coordinate);
+	void AppendDistance(uint64_t time, double distanceM, double verticalDistanceM);
+
+	size_t NumPositions() const { return m_positionTimes.size(); };
+	size_t NumDistances() const { return m_distanceTimes.size(); };
+	size_t NumBytes() const;
+
+	bool GetPosition(size_t positionIndex, Coordinate& coordinate) const;
+	uint64_t PositionTime(size_t positionIndex) const { return m_positionTimes[positionIndex]; };
+	double Latitude(size_t positionIndex) const;
+	double Longitude(size_t positionIndex) const;
+	double Altitude(size_t positionIndex) const { return (double)m_altitudes[positionIndex]; };
+
+	TimeDistancePair GetDistance(size_t distanceIndex) const;
+	uint64_t DistanceTime(size_t distanceIndex) const { return m_distanceTimes[distanceIndex]; };
+	double SegmentDistance(size_t distanceIndex) const;
+	double CumulativeDistance(size_t distanceIndex) const { return m_cumulativeDistances[distanceIndex]; };
+
+	// Raw arrays, for scanning the whole track.
+	const uint64_t* PositionTimes() const { return m_positionTimes.data(); };
+	const float* Altitudes() const { return m_altitudes.data(); };
+	const uint64_t* DistanceTimes() const { return m_distanceTimes.data(); };
+	const double* CumulativeDistances() const { return m_cumulativeDistances.data(); };
+	const float* VerticalDistances() const { return m_verticalDistances.data(); };
+
+private:
+	bool                  m_fixedPointPositions; // true if latitude and longitude are stored in m_fixedPointLatitudes and m_fixedPointLongitudes
+	std::vector<uint64_t> m_positionTimes;       // time of each position, in milliseconds
+	std::vector<double>   m_latitudes;
+	std::vector<double>   m_longitudes;
+	std::vector<int32_t>  m_fixedPointLatitudes;
+	std::vector<int32_t>  m_fixedPointLongitudes;
+	std::vector<float>    m_altitudes;           // altitude of each position, in meters
+	std::vector<uint64_t> m_distanceTimes;       // time of each distance entry, in milliseconds
+	std::vector<double>   m_cumulativeDistances; // distance covered up to and including each entry, in meters
+	std::vector<float>    m_verticalDistances;   // vertical distance covered by each entry, in meters
+};
+
+#endif
@@ -0,0 +1,74 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "TrainingStressCalculator.h"
+
+#include <math.h>
+
+TrainingStressCalculator::TrainingStressCalculator()
+{
+}
+
+TrainingStressCalculator::~TrainingStressCalculator()
+{
+}
+
+double TrainingStressCalculator::EstimateFromPower(double durationSecs, double normalizedPower, double ftp)
+{
+	if ((durationSecs <= 0.0) || (normalizedPower <= 0.0) || (ftp <= 0.0))
+	{
+		return (double)0.0;
+	}
+
+	double intensityFactor = normalizedPower / ftp;
+	return ((durationSecs * normalizedPower * intensityFactor) / (ftp * 3600.0)) * 100.0;
+}
+
+double TrainingStressCalculator::EstimateFromPace(double durationSecs, double avgSpeed, double thresholdSpeed)
+{
+	if ((durationSecs <= 0.0) || (avgSpeed <= 0.0) || (thresholdSpeed <= 0.0))
+	{
+		return (double)0.0;
+	}
+
+	double intensityFactor = avgSpeed / thresholdSpeed;
+	return (durationSecs / 3600.0) * intensityFactor * intensityFactor * 100.0;
+}
+
+double TrainingStressCalculator::EstimateFromHeartRate(double durationSecs, double avgHeartRate, double restingHeartRate, double maxHeartRate, Gender gender)
+{
+	if ((durationSecs <= 0.0) || (avgHeartRate <= restingHeartRate) || (maxHeartRate <= restingHeartRate))
+	{
+		return (double)0.0;
+	}
+
+	double heartRateReserve = (avgHeartRate - restingHeartRate) / (maxHeartRate - restingHeartRate);
+	if (heartRateReserve > 1.0)
+	{
+		heartRateReserve = 1.0;
+	}
+
+	double thresholdHour = TrainingImpulse(3600.0, TRAINING_STRESS_THRESHOLD_HEART_RATE_RESERVE, gender);
+	return (TrainingImpulse(durationSecs, heartRateReserve, gender) / thresholdHour) * 100.0;
+}
+
+// Source: Banister, E.W. (1991), Modeling elite athletic performance.
+double TrainingStressCalculator::TrainingImpulse(double durationSecs, double heartRateReserve, Gender gender)
+{
+	double weighting = (double)0.0;
+
+	switch (gender)
+	{
+		case GENDER_MALE:
+			weighting = 0.64 * exp(1.92 * heartRateReserve);
+			break;
+		case GENDER_FEMALE:
+			weighting = 0.86 * exp(1.67 * heartRateReserve);
+			break;
+	}
+	return (durationSecs / 60.0) * heartRateReserve * weighting;
+}
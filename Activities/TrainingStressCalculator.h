@@ -0,0 +1,38 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __TRAININGSTRESSCALCULATOR__
+#define __TRAININGSTRESSCALCULATOR__
+
+#include "Gender.h"
+
+#define TRAINING_STRESS_THRESHOLD_HEART_RATE_RESERVE 0.85 // Fraction of the heart rate reserve assumed to be the lactate threshold
+
+/**
+* Estimates the training stress of a completed activity. All three estimates are scaled so that one hour
+* at the athlete's threshold scores 100, so activities scored different ways can be summed into the same training load.
+*/
+class TrainingStressCalculator
+{
+public:
+	TrainingStressCalculator();
+	virtual ~TrainingStressCalculator();
+
+	/// Training Stress Score, from normalized power and the athlete's functional threshold power.
+	double EstimateFromPower(double durationSecs, double normalizedPower, double ftp);
+
+	/// Running training stress, from the average speed and the athlete's threshold speed (both in meters per minute).
+	double EstimateFromPace(double durationSecs, double avgSpeed, double thresholdSpeed);
+
+	/// Banister's training impulse (TRIMP), relative to the TRIMP of an hour at the lactate threshold heart rate.
+	double EstimateFromHeartRate(double durationSecs, double avgHeartRate, double restingHeartRate, double maxHeartRate, Gender gender);
+
+private:
+	double TrainingImpulse(double durationSecs, double heartRateReserve, Gender gender);
+};
+
+#endif
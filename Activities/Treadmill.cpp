@@ -58,11 +58,7 @@ bool Treadmill::ProcessFootPodReading(const SensorReading& reading)
 				SetPrevDistanceTraveledInMeters(oldTotalDistance);
 				SetDistanceTraveledInMeters(totalDistance);
 
-				TimeDistancePair distanceInfo;
-				distanceInfo.verticalDistanceM = (double)0.0;
-				distanceInfo.distanceM = segmentDistance;
-				distanceInfo.time = reading.time;
-				m_distances.push_back(distanceInfo);
+				m_track.AppendDistance(reading.time, segmentDistance, (double)0.0);
 				
 				m_prevDistanceReading = currentDistanceReading;
 			}
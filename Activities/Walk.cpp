@@ -15,6 +15,8 @@
 
 Walk::Walk() : MovingActivity()
 {
+	AttributeHandlers(); // interns our attribute names before the first query
+
 	m_lastPeakCalculationTime = 0;
 	m_stepsTaken = 0;
 	m_lastAvgAltitudeM = (double)0.0;
@@ -97,28 +99,39 @@ bool Walk::ProcessAccelerometerReading(const SensorReading& reading)
 	return MovingActivity::ProcessAccelerometerReading(reading);
 }
 
-ActivityAttributeType Walk::QueryActivityAttribute(const std::string& attributeName) const
+const ActivityAttributeHandlerTable<Walk>& Walk::AttributeHandlers()
 {
-	ActivityAttributeType result;
+	static const ActivityAttributeHandlerTable<Walk> handlers = BuildAttributeHandlers();
+	return handlers;
+}
 
-	result.startTime = 0;
-	result.endTime = 0;
-	result.unitSystem = UnitMgr::GetUnitSystem();
+ActivityAttributeHandlerTable<Walk> Walk::BuildAttributeHandlers()
+{
+	ActivityAttributeHandlerTable<Walk> handlers;
 
-	if (attributeName.compare(ACTIVITY_ATTRIBUTE_STEPS_TAKEN) == 0)
-	{
-		result.value.intVal = StepsTaken();
-		result.valueType = TYPE_INTEGER;
-		result.measureType = MEASURE_COUNT;
-		result.valid = m_graphLine.size() > 0;
-	}
-	else
+	handlers.Register(ACTIVITY_ATTRIBUTE_STEPS_TAKEN, &Walk::QueryStepsTakenAttribute);
+	return handlers;
+}
+
+ActivityAttributeType Walk::QueryActivityAttributeById(ActivityAttributeId attributeId) const
+{
+	ActivityAttributeType result;
+
+	if (!AttributeHandlers().Query(this, attributeId, result))
 	{
-		result = MovingActivity::QueryActivityAttribute(attributeName);
+		result = MovingActivity::QueryActivityAttributeById(attributeId);
 	}
 	return result;
 }
 
+void Walk::QueryStepsTakenAttribute(ActivityAttributeType& result) const
+{
+	result.value.intVal = StepsTaken();
+	result.valueType = TYPE_INTEGER;
+	result.measureType = MEASURE_COUNT;
+	result.valid = m_graphLine.size() > 0;
+}
+
 double Walk::CaloriesBetweenPoints(const Coordinate& pt1, const Coordinate& pt2)
 {
 	double movingTimeMin = (double)(pt1.time - pt2.time) / (double)60000.0;
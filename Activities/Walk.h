@@ -28,7 +28,7 @@ public:
 
 	virtual void OnFinishedLoadingSensorData();
 
-	virtual ActivityAttributeType QueryActivityAttribute(const std::string& attributeName) const;
+	virtual ActivityAttributeType QueryActivityAttributeById(ActivityAttributeId attributeId) const;
 
 	virtual double CaloriesBurned() const;
 
@@ -52,6 +52,12 @@ protected:
 protected:
 	double CaloriesBetweenPoints(const Coordinate& pt1, const Coordinate& pt2);
 	void CalculateStepsTaken();
+
+private:
+	static const ActivityAttributeHandlerTable<Walk>& AttributeHandlers();
+	static ActivityAttributeHandlerTable<Walk> BuildAttributeHandlers();
+
+	void QueryStepsTakenAttribute(ActivityAttributeType& result) const;
 };
 
 #endif
@@ -25,16 +25,14 @@ WorkoutPlanGenerator::~WorkoutPlanGenerator()
 {
 }
 
-std::map<std::string, double> WorkoutPlanGenerator::CalculateInputs(const ActivitySummaryList& historicalActivities)
+std::map<std::string, double> WorkoutPlanGenerator::CalculateInputs(Database& database)
 {
 	const uint64_t SECS_PER_WEEK = 7.0 * 24.0 * 60.0 * 60.0;
 
 	std::map<std::string, double> inputs;
 
-	time_t fourWeekCutoffTime = time(NULL) - (4.0 * SECS_PER_WEEK); // last four weeks
-	time_t threeWeekCutoffTime = time(NULL) - (3.0 * SECS_PER_WEEK); // last three weeks
-	time_t twoWeekCutoffTime = time(NULL) - (2.0 * SECS_PER_WEEK); // last two weeks
-	time_t oneWeekCutoffTime = time(NULL) - SECS_PER_WEEK; // last week
+	time_t now = time(NULL);
+	time_t fourWeekCutoffTime = now - (4 * SECS_PER_WEEK); // last four weeks
 
 	// Need the user's goals.
 	inputs.insert(std::pair<std::string, double>(WORKOUT_INPUT_GOAL_RUN_DISTANCE, 0.0));
@@ -45,10 +43,11 @@ std::map<std::string, double> WorkoutPlanGenerator::CalculateInputs(const Activi
 	
 	// Need cycling FTP.
 	FtpCalculator ftpCalc;
-	double estimatedFtp = ftpCalc.Estimate(historicalActivities);
+	double estimatedFtp = ftpCalc.Estimate(database);
 	inputs.insert(std::pair<std::string, double>(WORKOUT_INPUT_THRESHOLD_POWER, estimatedFtp));
 
-	// Need last four weeks averages, bests, etc.
+	// Need last four weeks averages, bests, etc. These are rolling windows ending now, so they don't depend on the day
+	// of the week. Week 0 is the last seven days, week 1 the seven days before that, and so on.
 	double best5K = (double)0.0; // needed to compute training paces.
 	double longestRunInFourWeeks = (double)0.0;
 	double longestRunWeek1 = (double)0.0;
@@ -56,73 +55,21 @@ std::map<std::string, double> WorkoutPlanGenerator::CalculateInputs(const Activi
 	double longestRunWeek3 = (double)0.0;
 	double avgCyclingDistanceFourWeeks = (double)0.0;
 	double avgRunningDistanceFourWeeks = (double)0.0;
-	size_t bikeCount = 0; // For average bike distance
-	size_t runCount = 0; // for average run distance
-	for (auto iter = historicalActivities.begin(); iter != historicalActivities.end(); ++iter)
-	{
-		const ActivitySummary& summary = (*iter);
-
-		// Only consider activities within the last four weeks.
-		if (summary.startTime > fourWeekCutoffTime)
-		{
-			// Examine run activity.
-			if (summary.type.compare(Run::Type()) == 0)
-			{
-				if (summary.summaryAttributes.find(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED) != summary.summaryAttributes.end())
-				{
-					ActivityAttributeType attr = summary.summaryAttributes.at(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED);
-
-					if (attr.valid)
-					{
-						double activityDistance = attr.value.doubleVal;
-
-						if (activityDistance > longestRunInFourWeeks)
-						{
-							longestRunInFourWeeks = activityDistance;
-						}
-
-						if ((summary.startTime > threeWeekCutoffTime) && (activityDistance > longestRunWeek3))
-						{
-							longestRunWeek3 = activityDistance;
-						}
-						else if ((summary.startTime > twoWeekCutoffTime) && (summary.startTime < threeWeekCutoffTime) && (activityDistance > longestRunWeek2))
-						{
-							longestRunWeek2 = activityDistance;
-						}
-						else if ((summary.startTime > oneWeekCutoffTime) && (summary.startTime < twoWeekCutoffTime) && (activityDistance > longestRunWeek1))
-						{
-							longestRunWeek1 = activityDistance;
-						}
-
-						avgRunningDistanceFourWeeks += activityDistance;
-						++runCount;
-					}
-				}
-			}
-
-			// Examine cycling activity.
-			else if (summary.type.compare(Cycling::Type()) == 0)
-			{
-				if (summary.summaryAttributes.find(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED) != summary.summaryAttributes.end())
-				{
-					ActivityAttributeType attr = summary.summaryAttributes.at(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED);
-
-					if (attr.valid)
-					{
-						double activityDistance = attr.value.doubleVal;
-
-						avgCyclingDistanceFourWeeks += activityDistance;
-						++bikeCount;
-					}
-				}
-			}
-		}
-	}
-	if (runCount > 0)
+	uint64_t bikeCount = 0; // For average bike distance
+	uint64_t runCount = 0; // for average run distance
+
+	// Examine run activity.
+	database.RetrieveLargestSummaryValue(Run::Type(), ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, fourWeekCutoffTime + 1, now + 1, longestRunInFourWeeks);
+	database.RetrieveLargestSummaryValue(Run::Type(), ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, now - (2 * SECS_PER_WEEK) + 1, now - SECS_PER_WEEK + 1, longestRunWeek1);
+	database.RetrieveLargestSummaryValue(Run::Type(), ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, now - (3 * SECS_PER_WEEK) + 1, now - (2 * SECS_PER_WEEK) + 1, longestRunWeek2);
+	database.RetrieveLargestSummaryValue(Run::Type(), ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, fourWeekCutoffTime + 1, now - (3 * SECS_PER_WEEK) + 1, longestRunWeek3);
+	if (database.RetrieveSummaryValueTotal(Run::Type(), ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, fourWeekCutoffTime + 1, now + 1, avgRunningDistanceFourWeeks, runCount) && (runCount > 0))
 	{
 		avgRunningDistanceFourWeeks /= (double)runCount;
 	}
-	if (bikeCount > 0)
+
+	// Examine cycling activity.
+	if (database.RetrieveSummaryValueTotal(Cycling::Type(), ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, fourWeekCutoffTime + 1, now + 1, avgCyclingDistanceFourWeeks, bikeCount) && (bikeCount > 0))
 	{
 		avgCyclingDistanceFourWeeks /= (double)bikeCount;
 	}
@@ -12,7 +12,7 @@
 #include <string>
 #include <vector>
 
-#include "ActivitySummary.h"
+#include "Database.h"
 #include "Workout.h"
 
 class WorkoutPlanGenerator
@@ -21,7 +21,8 @@ public:
 	WorkoutPlanGenerator();
 	virtual ~WorkoutPlanGenerator();
 
-	std::map<std::string, double> CalculateInputs(const ActivitySummaryList& historicalActivities);
+	/// Reads the inputs from the database's indexes and rollups, so history doesn't need to be loaded.
+	std::map<std::string, double> CalculateInputs(Database& database);
 	std::vector<Workout*> GenerateWorkouts(std::map<std::string, double>& inputs);
 
 private:
@@ -10,3 +10,5 @@
 #define APP_NAME "Straen"
 
 #define OMIT_BROADCAST FALSE
+
+#define SECS_PER_DAY 86400
@@ -13,6 +13,8 @@
 #define NOTIFICATION_NAME_LOGGED_OUT               "LogoutProcessed"
 #define NOTIFICATION_NAME_REQUEST_TO_FOLLOW_RESULT "RequestToFollowResult"
 #define NOTIFICATION_NAME_PRINT_MESSAGE            "PrintMessage"
+#define NOTIFICATION_NAME_REPROCESSING_PROGRESS    "ReprocessingProgress"
+#define NOTIFICATION_NAME_REPROCESSING_FINISHED    "ReprocessingFinished"
 
 #define KEY_NAME_ACTIVITY_ID                       "ActivityId"
 #define KEY_NAME_ACTIVITY_TYPE                     "ActivityType"
@@ -27,6 +29,8 @@
 #define KEY_NAME_URL                               "URL"
 #define KEY_NAME_TAG                               "Tag"
 #define KEY_NAME_MESSAGE                           "Message"
+#define KEY_NAME_NUM_COMPLETED                     "NumCompleted"
+#define KEY_NAME_NUM_TOTAL                         "NumTotal"
 
 #define NOTIFICATION_NAME_INTERVAL_UPDATED         "IntervalUpdated"
 #define NOTIFICATION_NAME_INTERVAL_COMPLETE        "IntervalComplete"
@@ -0,0 +1,247 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "ActivityReprocessor.h"
+#include "ActivityAttributeRegistry.h"
+#include "MovingActivity.h"
+#include "UnitMgr.h"
+
+ActivityReprocessor::ActivityReprocessor()
+{
+	m_nextIndex = 0;
+	m_cancelled = false;
+	m_failed = false;
+	m_numWorkersRunning = 0;
+}
+
+ActivityReprocessor::~ActivityReprocessor()
+{
+}
+
+void ActivityReprocessor::BuildSummaryValues(const Activity* const pActivity, SummaryAttributeMap& values)
+{
+	std::vector<std::string> attributes;
+	pActivity->BuildSummaryAttributeList(attributes);
+
+	for (auto iter = attributes.begin(); iter != attributes.end(); ++iter)
+	{
+		const std::string& attribute = (*iter);
+		ActivityAttributeType value = pActivity->QueryActivityAttribute(attribute);
+
+		if (value.valid)
+		{
+			UnitMgr::ConvertActivityAttributeToCustomaryUnits(value);
+			values.Set(attribute, value);
+		}
+	}
+}
+
+bool ActivityReprocessor::RecomputeSummary(Database& database, ActivityFactory& factory, ActivitySummary& summary)
+{
+	factory.CreateActivity(summary, database);
+
+	// Activity types that are no longer supported keep the summary they have.
+	if (!summary.pActivity)
+	{
+		return true;
+	}
+
+	// Values the user entered (corrected reps, additional weight) only live in the stored summary, so they are
+	// applied before anything is recomputed, the same as when a historical activity is loaded for display.
+	SummaryAttributeMap storedValues;
+	bool result = database.RetrieveSummaryData(summary.activityId, storedValues);
+
+	for (auto attributeIter = storedValues.begin(); attributeIter != storedValues.end() && result; ++attributeIter)
+	{
+		summary.pActivity->SetActivityAttribute(ActivityAttributeRegistry::Name((*attributeIter).first), (*attributeIter).second);
+	}
+
+	MovingActivity* pMovingActivity = dynamic_cast<MovingActivity*>(summary.pActivity);
+
+	if (pMovingActivity && result)
+	{
+		LapSummaryList laps;
+
+		result = database.RetrieveLaps(summary.activityId, laps);
+		pMovingActivity->SetLaps(laps);
+	}
+
+	std::vector<SensorType> sensorTypes;
+	summary.pActivity->ListUsableSensors(sensorTypes);
+
+	for (auto sensorIter = sensorTypes.begin(); sensorIter != sensorTypes.end() && result; ++sensorIter)
+	{
+		SensorType sensor = (*sensorIter);
+
+		// Replays the same sensors as when a historical activity is loaded for display.
+		if ((sensor == SENSOR_TYPE_WHEEL_SPEED) || (sensor == SENSOR_TYPE_FOOT_POD))
+		{
+			continue;
+		}
+
+		SensorReadingList readings;
+
+		result = database.RetrieveSensorReadingsOfType(summary.activityId, sensor, readings);
+		for (auto iter = readings.begin(); iter != readings.end() && result; ++iter)
+		{
+			summary.pActivity->ProcessSensorReading((*iter));
+		}
+	}
+
+	if (result)
+	{
+		summary.pActivity->OnFinishedLoadingSensorData();
+		BuildSummaryValues(summary.pActivity, summary.summaryAttributes);
+	}
+
+	delete summary.pActivity;
+	summary.pActivity = NULL;
+
+	return result;
+}
+
+void ActivityReprocessor::ReprocessWorker(const std::string& dbFileName, const ActivityFactory& factory)
+{
+	ActivityFactory workerFactory = factory; // the factory isn't thread safe, so each worker creates activities with its own copy
+	Database database;
+
+	if (database.OpenReadOnly(dbFileName))
+	{
+		size_t activityIndex = 0;
+
+		while (!m_cancelled && !m_failed && ((activityIndex = m_nextIndex++) < m_activities.size()))
+		{
+			ActivitySummary summary = m_activities.at(activityIndex);
+
+			if (!RecomputeSummary(database, workerFactory, summary))
+			{
+				m_failed = true;
+				break;
+			}
+
+			// Don't get too far ahead of the writer.
+			std::unique_lock<std::mutex> lock(m_pendingMutex);
+			m_pendingChanged.wait(lock, [this] { return (m_pending.size() < REPROCESS_MAX_PENDING) || m_cancelled || m_failed; });
+			m_pending.push_back(summary);
+			lock.unlock();
+			m_pendingChanged.notify_all();
+		}
+	}
+	else
+	{
+		m_failed = true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_pendingMutex);
+		--m_numWorkersRunning;
+	}
+	m_pendingChanged.notify_all();
+}
+
+bool ActivityReprocessor::WriteSummaries(Database& database, const ActivitySummaryList& summaries)
+{
+	if (!database.BeginTransaction())
+	{
+		return false;
+	}
+
+	// The version is written with the summary, so an activity is only skipped next time if its summary made it to disk.
+	bool result = database.CreateSummaryData(summaries);
+	for (auto iter = summaries.begin(); iter != summaries.end() && result; ++iter)
+	{
+		result = database.UpdateSummaryVersion((*iter).activityId, SUMMARY_ALGORITHM_VERSION);
+	}
+
+	if (result)
+	{
+		result = database.CommitTransaction();
+	}
+	else
+	{
+		database.RollbackTransaction();
+	}
+	return result;
+}
+
+bool ActivityReprocessor::ReprocessAllFromDatabase(const std::string& dbFileName, bool restart, ActivityFactory& factory, TaskExecutor& executor, ExportProgressCallback progressCallback, void* context)
+{
+	// The summaries are written on our own connection, so we don't hold up the caller's.
+	Database database;
+
+	if (!database.Open(dbFileName))
+	{
+		return false;
+	}
+	if (restart && !database.DeleteSummaryVersions())
+	{
+		return false;
+	}
+	if (!database.RetrieveActivitiesWithOldSummaries(SUMMARY_ALGORITHM_VERSION, m_activities))
+	{
+		return false;
+	}
+
+	m_nextIndex = 0;
+	m_failed = false;
+	m_pending.clear();
+
+	// One task per thread rather than per activity, so each opens one database connection and then
+	// claims activities until there are none left.
+	size_t numWorkers = executor.GetNumThreads();
+	if (numWorkers > m_activities.size())
+		numWorkers = m_activities.size();
+
+	m_numWorkersRunning = numWorkers;
+
+	TaskGroup workers(executor);
+	for (size_t i = 0; i < numWorkers; ++i)
+	{
+		workers.Run([this, dbFileName, &factory] { ReprocessWorker(dbFileName, factory); });
+	}
+
+	size_t numCompleted = 0;
+	bool finished = (numWorkers == 0);
+
+	while (!finished)
+	{
+		ActivitySummaryList batch;
+
+		{
+			std::unique_lock<std::mutex> lock(m_pendingMutex);
+			m_pendingChanged.wait(lock, [this] { return (m_pending.size() >= REPROCESS_BATCH_SIZE) || (m_numWorkersRunning == 0); });
+			batch.swap(m_pending);
+			finished = (m_numWorkersRunning == 0);
+		}
+		m_pendingChanged.notify_all();
+
+		// Once something has failed the rest are discarded, but still taken, so the workers aren't left waiting.
+		if ((batch.size() > 0) && !m_failed)
+		{
+			if (WriteSummaries(database, batch))
+			{
+				numCompleted += batch.size();
+				if (progressCallback)
+				{
+					progressCallback(numCompleted, m_activities.size(), context);
+				}
+			}
+			else
+			{
+				m_failed = true;
+			}
+		}
+	}
+	workers.Wait();
+
+	bool result = !(m_cancelled || m_failed);
+
+	m_activities.clear();
+	m_pending.clear();
+
+	return result;
+}
@@ -0,0 +1,65 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __ACTIVITYREPROCESSOR__
+#define __ACTIVITYREPROCESSOR__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include "Activity.h"
+#include "ActivityFactory.h"
+#include "ActivitySummary.h"
+#include "Callbacks.h"
+#include "Database.h"
+#include "SummaryAttributeMap.h"
+#include "TaskExecutor.h"
+
+#define SUMMARY_ALGORITHM_VERSION 2   // Bump whenever a change to the activity calculations changes their summary data
+#define REPROCESS_BATCH_SIZE      32  // Recomputed summaries written per transaction
+#define REPROCESS_MAX_PENDING     128 // Recomputed summaries that can wait to be written before the workers wait for the writer
+
+/**
+* Recomputes the summary data of every activity whose summary was written by an older version of the calculations.
+*
+* Activities are replayed by tasks on the shared executor, each with its own read only database connection and
+* its own activity objects. The results are funneled back to the calling thread, which writes them in batches on
+* its own connection, recording the version of each activity in the same transaction as its summary. An interrupted
+* run therefore resumes where it left off, and a completed one doesn't redo anything until the version changes.
+*/
+class ActivityReprocessor
+{
+public:
+	ActivityReprocessor();
+	virtual ~ActivityReprocessor();
+
+	/// Queries the summary attributes of the given activity, converted to the units in which they are stored.
+	static void BuildSummaryValues(const Activity* const pActivity, SummaryAttributeMap& values);
+
+	/// Blocks until done, must not be called from one of the executor's tasks. If restart is set then every
+	/// activity is reprocessed, rather than only those not already done.
+	bool ReprocessAllFromDatabase(const std::string& dbFileName, bool restart, ActivityFactory& factory, TaskExecutor& executor, ExportProgressCallback progressCallback, void* context);
+	void Cancel() { m_cancelled = true; };
+
+private:
+	ActivitySummaryList     m_activities;        // Activities being reprocessed, metadata only
+	std::atomic<size_t>     m_nextIndex;         // Next activity to be claimed by a worker
+	std::atomic<bool>       m_cancelled;
+	std::atomic<bool>       m_failed;
+	std::mutex              m_pendingMutex;      // Protects m_pending and m_numWorkersRunning
+	std::condition_variable m_pendingChanged;    // Signalled when a summary is added or the pending list is taken
+	ActivitySummaryList     m_pending;           // Recomputed summaries waiting to be written
+	size_t                  m_numWorkersRunning;
+
+	bool RecomputeSummary(Database& database, ActivityFactory& factory, ActivitySummary& summary);
+	void ReprocessWorker(const std::string& dbFileName, const ActivityFactory& factory);
+	bool WriteSummaries(Database& database, const ActivitySummaryList& summaries);
+};
+
+#endif
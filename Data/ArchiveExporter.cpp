@@ -0,0 +1,212 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <stdio.h>
+
+#include "ArchiveExporter.h"
+#include "DataExporter.h"
+#include "Database.h"
+
+#define ARCHIVE_MANIFEST_NAME "manifest.csv"
+
+ArchiveExporter::ArchiveExporter()
+{
+	m_nextIndex = 0;
+	m_cancelled = false;
+	m_failed = false;
+	m_numCompleted = 0;
+}
+
+ArchiveExporter::~ArchiveExporter()
+{
+}
+
+static std::string QuoteCsvValue(const std::string& value)
+{
+	std::string quoted = "\"";
+
+	for (auto iter = value.begin(); iter != value.end(); ++iter)
+	{
+		if ((*iter) == '"')
+			quoted.push_back('"');
+		quoted.push_back((*iter));
+	}
+	quoted.push_back('"');
+	return quoted;
+}
+
+bool ArchiveExporter::AddToArchive(const ActivitySummary& summary, const std::string& entryName, const FileLib::ZipEntry& entry, ExportProgressCallback progressCallback, void* context)
+{
+	std::lock_guard<std::mutex> lock(m_archiveMutex);
+
+	bool result = true;
+
+	if (entryName.size() > 0)
+	{
+		// Activities that started in the same second with the same type would otherwise collide.
+		FileLib::ZipEntry namedEntry = entry;
+		if (m_entryNames.count(entryName) > 0)
+		{
+			namedEntry.name = summary.activityId + "-" + entryName;
+		}
+		else
+		{
+			namedEntry.name = entryName;
+		}
+		m_entryNames.insert(namedEntry.name);
+
+		result = m_archive.WriteEntry(namedEntry);
+		if (result)
+		{
+			char buf[64];
+			snprintf(buf, sizeof(buf) - 1, ",%ld,%ld\n", (long)summary.startTime, (long)summary.endTime);
+
+			m_manifest.append(QuoteCsvValue(namedEntry.name));
+			m_manifest.append(",");
+			m_manifest.append(QuoteCsvValue(summary.activityId));
+			m_manifest.append(",");
+			m_manifest.append(QuoteCsvValue(summary.type));
+			m_manifest.append(",");
+			m_manifest.append(QuoteCsvValue(summary.name));
+			m_manifest.append(buf);
+		}
+	}
+
+	++m_numCompleted;
+	if (progressCallback)
+	{
+		progressCallback(m_numCompleted, m_activities.size(), context);
+	}
+	return result;
+}
+
+void ArchiveExporter::ExportWorker(FileFormat format, const std::string& dbFileName, const ActivityFactory& factory, ExportProgressCallback progressCallback, void* context)
+{
+	ActivityFactory workerFactory = factory; // the factory isn't thread safe, so each worker creates activities with its own copy
+	Database database;
+
+	if (!database.OpenReadOnly(dbFileName))
+	{
+		m_failed = true;
+		return;
+	}
+
+	size_t activityIndex = 0;
+
+	while (!m_cancelled && !m_failed && ((activityIndex = m_nextIndex++) < m_activities.size()))
+	{
+		ActivitySummary summary = m_activities.at(activityIndex);
+		std::string entryName;
+		FileLib::ZipEntry entry;
+
+		workerFactory.CreateActivity(summary, database);
+
+		if (summary.pActivity)
+		{
+			// Moving activities build their track from the location data, so replay it.
+			SensorReadingList locationPoints;
+
+			if (database.RetrieveActivityPositionReadings(summary.activityId, locationPoints))
+			{
+				for (auto iter = locationPoints.begin(); iter != locationPoints.end(); ++iter)
+				{
+					summary.pActivity->ProcessSensorReading((*iter));
+				}
+			}
+
+			// Activities that can't be represented in the requested format are skipped, not treated as errors.
+			std::string contents;
+			DataExporter exporter;
+
+			if (exporter.ExportFromDatabaseToBuffer(format, contents, false, &database, summary.pActivity))
+			{
+				entryName = exporter.GenerateFileName(format, summary.startTime, summary.type);
+
+				if (!FileLib::ZipFileWriter::PrepareEntry(entryName, contents, summary.startTime, entry))
+				{
+					entryName.clear();
+				}
+			}
+
+			delete summary.pActivity;
+			summary.pActivity = NULL;
+		}
+
+		if (!AddToArchive(summary, entryName, entry, progressCallback, context))
+		{
+			m_failed = true;
+		}
+	}
+}
+
+bool ArchiveExporter::ExportAllFromDatabase(FileFormat format, std::string& fileName, const std::string& dbFileName, ActivityFactory& factory, TaskExecutor& executor, ExportProgressCallback progressCallback, void* context)
+{
+	bool result = false;
+
+	// Take a snapshot of the activity list using our own connection, so we don't touch the caller's state.
+	{
+		Database database;
+
+		if (!(database.OpenReadOnly(dbFileName) && database.RetrieveActivities(m_activities)))
+		{
+			return false;
+		}
+	}
+
+	time_t now = time(NULL);
+	struct tm nowTm;
+	char buf[32];
+
+	localtime_r(&now, &nowTm);
+	strftime(buf, sizeof(buf) - 1, "%Y-%m-%dT%H-%M-%S", &nowTm);
+
+	fileName.append("/");
+	fileName.append(buf);
+	fileName.append("-Archive.zip");
+
+	if (m_archive.CreateFile(fileName))
+	{
+		m_nextIndex = 0;
+		m_numCompleted = 0;
+		m_failed = false;
+		m_manifest = "file,activity_id,type,name,start_time,end_time\n";
+		m_entryNames.clear();
+
+		// One task per thread rather than per activity, so each opens one database connection and then
+		// claims activities until there are none left.
+		size_t numWorkers = executor.GetNumThreads();
+		if (numWorkers > m_activities.size())
+			numWorkers = m_activities.size();
+		if (numWorkers == 0)
+			numWorkers = 1;
+
+		TaskGroup workers(executor);
+		for (size_t i = 0; i < numWorkers; ++i)
+		{
+			workers.Run([this, format, dbFileName, &factory, progressCallback, context] { ExportWorker(format, dbFileName, factory, progressCallback, context); });
+		}
+		workers.Wait();
+
+		if (!(m_cancelled || m_failed))
+		{
+			result = m_archive.AddFile(ARCHIVE_MANIFEST_NAME, m_manifest, now);
+		}
+		result &= m_archive.CloseFile();
+
+		// Don't leave a partial archive behind.
+		if (!result)
+		{
+			remove(fileName.c_str());
+		}
+	}
+
+	m_activities.clear();
+	m_manifest.clear();
+	m_entryNames.clear();
+
+	return result;
+}
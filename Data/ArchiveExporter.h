@@ -0,0 +1,53 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __ARCHIVEEXPORTER__
+#define __ARCHIVEEXPORTER__
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "ActivityFactory.h"
+#include "ActivitySummary.h"
+#include "Callbacks.h"
+#include "FileFormat.h"
+#include "TaskExecutor.h"
+#include "ZipFileWriter.h"
+
+/**
+* Exports every activity in the database into a single zip archive, along with a manifest.
+* Activities are exported by tasks on the shared executor, each with its own read only database connection.
+* Workers do the expensive work (loading, formatting, compressing) in parallel and only
+* serialize on appending the finished entry to the archive.
+*/
+class ArchiveExporter
+{
+public:
+	ArchiveExporter();
+	virtual ~ArchiveExporter();
+
+	bool ExportAllFromDatabase(FileFormat format, std::string& fileName, const std::string& dbFileName, ActivityFactory& factory, TaskExecutor& executor, ExportProgressCallback progressCallback, void* context);
+	void Cancel() { m_cancelled = true; };
+
+private:
+	ActivitySummaryList    m_activities;   // Activities being exported, metadata only
+	std::atomic<size_t>    m_nextIndex;    // Next activity to be claimed by a worker
+	std::atomic<bool>      m_cancelled;
+	std::atomic<bool>      m_failed;
+	size_t                 m_numCompleted;
+	std::mutex             m_archiveMutex; // Protects the archive, the manifest and the progress count
+	FileLib::ZipFileWriter m_archive;
+	std::string            m_manifest;
+	std::set<std::string>  m_entryNames;
+
+	void ExportWorker(FileFormat format, const std::string& dbFileName, const ActivityFactory& factory, ExportProgressCallback progressCallback, void* context);
+	bool AddToArchive(const ActivitySummary& summary, const std::string& entryName, const FileLib::ZipEntry& entry, ExportProgressCallback progressCallback, void* context);
+};
+
+#endif
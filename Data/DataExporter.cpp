@@ -15,14 +15,37 @@
 #include "MovingActivity.h"
 #include "TcxTags.h"
 
+#include <algorithm>
+
 DataExporter::DataExporter()
 {
+	ResetOutput();
 }
 
 DataExporter::~DataExporter()
 {
 }
 
+void DataExporter::ConfigureOutput(FileLib::File& writer)
+{
+	if (m_pOutputBuffer)
+	{
+		writer.RedirectToBuffer(m_pOutputBuffer, m_compressOutput);
+	}
+	else if (m_outputCallback)
+	{
+		writer.RedirectToCallback(m_outputCallback, m_outputContext, m_compressOutput);
+	}
+}
+
+void DataExporter::ResetOutput()
+{
+	m_pOutputBuffer = NULL;
+	m_outputCallback = NULL;
+	m_outputContext = NULL;
+	m_compressOutput = false;
+}
+
 bool DataExporter::NearestSensorReading(uint64_t timeMs, const SensorReadingList& list, SensorReadingList::const_iterator& iter)
 {
 	while ((iter != list.end()) && ((*iter).time < timeMs))
@@ -53,6 +76,8 @@ bool DataExporter::ExportToTcxUsingCallbacks(const std::string& fileName, time_t
 	bool result = false;
 	FileLib::TcxFileWriter writer;
 
+	ConfigureOutput(writer);
+
 	if (writer.CreateFile(fileName))
 	{
 		if (writer.StartActivity(activityType))
@@ -99,7 +124,7 @@ bool DataExporter::ExportToTcxUsingCallbacks(const std::string& fileName, time_t
 			writer.EndActivity();
 		}
 
-		writer.CloseFile();
+		result &= writer.CloseFile();
 	}
 	return result;
 }
@@ -109,6 +134,8 @@ bool DataExporter::ExportToGpxUsingCallbacks(const std::string& fileName, time_t
 	bool result = false;
 	FileLib::GpxFileWriter writer;
 
+	ConfigureOutput(writer);
+
 	if (writer.CreateFile(fileName, APP_NAME))
 	{
 		writer.WriteMetadata((time_t)startTime);
@@ -134,7 +161,7 @@ bool DataExporter::ExportToGpxUsingCallbacks(const std::string& fileName, time_t
 			result = true;
 		}
 
-		writer.CloseFile();
+		result &= writer.CloseFile();
 	}
 	return result;
 }
@@ -150,14 +177,15 @@ bool DataExporter::ExportFromDatabaseToTcx(const std::string& fileName, Database
 	bool result = false;
 	FileLib::TcxFileWriter writer;
 
+	ConfigureOutput(writer);
+
 	if (writer.CreateFile(fileName))
 	{
 		if (writer.StartActivity(pActivity->GetType()))
 		{
 			std::string activityId = pActivity->GetId();
 
-			const CoordinateList& coordinateList = pMovingActivity->GetCoordinates();
-			const TimeDistancePairList& distanceList = pMovingActivity->GetDistances();
+			const TrackStore& track = pMovingActivity->GetTrack();
 
 			LapSummaryList lapList;
 			SensorReadingList hrList;
@@ -169,8 +197,8 @@ bool DataExporter::ExportFromDatabaseToTcx(const std::string& fileName, Database
 			pDatabase->RetrieveSensorReadingsOfType(activityId, SENSOR_TYPE_CADENCE, cadenceList);
 			pDatabase->RetrieveSensorReadingsOfType(activityId, SENSOR_TYPE_POWER, powerList);
 
-			CoordinateList::const_iterator coordinateIter = coordinateList.begin();
-			TimeDistancePairList::const_iterator distanceIter = distanceList.begin();
+			size_t positionIndex = 0;
+			size_t distanceIndex = 0;
 			LapSummaryList::const_iterator lapIter = lapList.begin();
 			SensorReadingList::const_iterator hrIter = hrList.begin();
 			SensorReadingList::const_iterator cadenceIter = cadenceList.begin();
@@ -199,11 +227,11 @@ bool DataExporter::ExportFromDatabaseToTcx(const std::string& fileName, Database
 				{
 					if (writer.StartTrack())
 					{
-						while ((coordinateIter != coordinateList.end()) && (distanceIter != distanceList.end()))
+						while ((positionIndex < track.NumPositions()) && (distanceIndex < track.NumDistances()))
 						{
-							const Coordinate& coordinate = (*coordinateIter);
-							const TimeDistancePair& timeDistance = (*distanceIter);
-							
+							Coordinate coordinate;
+							track.GetPosition(positionIndex, coordinate);
+
 							if ((coordinate.time > lapEndTimeMs) && (lapEndTimeMs != 0))
 							{
 								break;
@@ -214,10 +242,10 @@ bool DataExporter::ExportFromDatabaseToTcx(const std::string& fileName, Database
 							writer.StorePosition(coordinate.latitude, coordinate.longitude);
 							writer.StoreAltitudeMeters(coordinate.altitude);
 
-							if (coordinateIter != coordinateList.begin())
+							if (positionIndex > 0)
 							{
-								writer.StoreDistanceMeters(timeDistance.distanceM);
-								distanceIter++;
+								writer.StoreDistanceMeters(track.SegmentDistance(distanceIndex));
+								distanceIndex++;
 							}
 							else
 							{
@@ -248,7 +276,7 @@ bool DataExporter::ExportFromDatabaseToTcx(const std::string& fileName, Database
 							
 							writer.EndTrackpoint();
 
-							coordinateIter++;
+							positionIndex++;
 						}
 
 						writer.EndTrack();
@@ -274,7 +302,7 @@ bool DataExporter::ExportFromDatabaseToTcx(const std::string& fileName, Database
 			cadenceList.clear();
 		}
 
-		writer.CloseFile();
+		result &= writer.CloseFile();
 	}
 	return result;
 }
@@ -284,6 +312,8 @@ bool DataExporter::ExportFromDatabaseToGpx(const std::string& fileName, Database
 	bool result = false;
 	FileLib::GpxFileWriter writer;
 
+	ConfigureOutput(writer);
+
 	if (writer.CreateFile(fileName, APP_NAME))
 	{
 		std::string activityId = pActivity->GetId();
@@ -405,7 +435,7 @@ bool DataExporter::ExportFromDatabaseToGpx(const std::string& fileName, Database
 		hrList.clear();
 		cadenceList.clear();
 		
-		writer.CloseFile();
+		result &= writer.CloseFile();
 	}
 	return result;
 }
@@ -414,10 +444,9 @@ bool DataExporter::ExportPositionDataToCsv(FileLib::CsvFileWriter& writer, const
 {
 	bool result = true;
 
-	const CoordinateList& coordinateList = pMovingActivity->GetCoordinates();
-	const TimeDistancePairList& distanceList = pMovingActivity->GetDistances();
+	const TrackStore& track = pMovingActivity->GetTrack();
 
-	if (coordinateList.size() > 0)
+	if (track.NumPositions() > 0)
 	{
 		std::vector<std::string> titles;
 		titles.push_back(ACTIVITY_ATTRIBUTE_ELAPSED_TIME);
@@ -428,30 +457,27 @@ bool DataExporter::ExportPositionDataToCsv(FileLib::CsvFileWriter& writer, const
 
 		result = writer.WriteValues(titles);
 
-		CoordinateList::const_iterator coordinateIter = coordinateList.begin();
-		TimeDistancePairList::const_iterator distanceIter = distanceList.begin();
+		size_t positionIndex = 0;
+		size_t distanceIndex = 0;
 		
-		while ((coordinateIter != coordinateList.end()) && (distanceIter != distanceList.end()) && result)
+		while ((positionIndex < track.NumPositions()) && (distanceIndex < track.NumDistances()) && result)
 		{
-			const Coordinate& coordinate = (*coordinateIter);
-			const TimeDistancePair& timeDistance = (*distanceIter);
-			
 			std::vector<double> values;
-			values.push_back(coordinate.time);
-			values.push_back(coordinate.latitude);
-			values.push_back(coordinate.longitude);
-			values.push_back(coordinate.altitude);
+			values.push_back(track.PositionTime(positionIndex));
+			values.push_back(track.Latitude(positionIndex));
+			values.push_back(track.Longitude(positionIndex));
+			values.push_back(track.Altitude(positionIndex));
 			
-			if (coordinateIter != coordinateList.begin())
+			if (positionIndex > 0)
 			{
-				values.push_back(timeDistance.distanceM);
-				distanceIter++;
+				values.push_back(track.SegmentDistance(distanceIndex));
+				distanceIndex++;
 			}
 			else
 			{
 				values.push_back((double)0.0);
 			}
-			coordinateIter++;
+			positionIndex++;
 			
 			result = writer.WriteValues(values);
 		}
@@ -572,6 +598,8 @@ bool DataExporter::ExportFromDatabaseToCsv(const std::string& fileName, Database
 	bool result = false;
 	FileLib::CsvFileWriter writer;
 
+	ConfigureOutput(writer);
+
 	if (writer.CreateFile(fileName))
 	{
 		const MovingActivity* const pMovingActivity = dynamic_cast<const MovingActivity* const>(pActivity);
@@ -588,7 +616,201 @@ bool DataExporter::ExportFromDatabaseToCsv(const std::string& fileName, Database
 		result &= ExportHeartRateDataToCsv(writer, pActivity->GetId(), pDatabase);
 		result &= ExportCadenceDataToCsv(writer, pActivity->GetId(), pDatabase);
 
-		writer.CloseFile();
+		result &= writer.CloseFile();
+	}
+	return result;
+}
+
+// Returns the index of the reading taken exactly at the given time, or list.size() if there isn't one.
+// Assumes the list is sorted by time and that successive calls are made with increasing times.
+static size_t ReadingAtTime(uint64_t timeMs, const SensorReadingList& list, size_t& index)
+{
+	while ((index < list.size()) && (list.at(index).time < timeMs))
+	{
+		++index;
+	}
+	if ((index < list.size()) && (list.at(index).time == timeMs))
+	{
+		return index;
+	}
+	return list.size();
+}
+
+static bool ReadingTimeLessThan(const SensorReading& a, const SensorReading& b) { return a.time < b.time; }
+
+static void AddParquetColumn(FileLib::ParquetRowGroup& columns, const std::string& name, FileLib::ParquetColumnType type, bool optional)
+{
+	FileLib::ParquetColumn column;
+	column.name = name;
+	column.type = type;
+	column.optional = optional;
+	columns.push_back(column);
+}
+
+// Builds one row per distinct sensor timestamp, with nulls wherever a sensor has no reading at that time.
+bool DataExporter::BuildSensorRowGroup(const std::string& activityId, Database* const pDatabase, FileLib::ParquetRowGroup& columns, size_t& numRows)
+{
+	enum { COL_ACTIVITY_ID, COL_TIME, COL_LATITUDE, COL_LONGITUDE, COL_ALTITUDE, COL_HEART_RATE, COL_CADENCE, COL_POWER };
+
+	SensorReadingList locationList;
+	SensorReadingList hrList;
+	SensorReadingList cadenceList;
+	SensorReadingList powerList;
+
+	pDatabase->RetrieveSensorReadingsOfType(activityId, SENSOR_TYPE_LOCATION, locationList);
+	pDatabase->RetrieveSensorReadingsOfType(activityId, SENSOR_TYPE_HEART_RATE, hrList);
+	pDatabase->RetrieveSensorReadingsOfType(activityId, SENSOR_TYPE_CADENCE, cadenceList);
+	pDatabase->RetrieveSensorReadingsOfType(activityId, SENSOR_TYPE_POWER, powerList);
+
+	SensorReadingList* lists[] = { &locationList, &hrList, &cadenceList, &powerList };
+	std::vector<uint64_t> times;
+
+	for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); ++i)
+	{
+		SensorReadingList& list = *(lists[i]);
+
+		// Rows come back in insertion order, which is almost always time order.
+		if (!std::is_sorted(list.begin(), list.end(), ReadingTimeLessThan))
+		{
+			std::stable_sort(list.begin(), list.end(), ReadingTimeLessThan);
+		}
+		for (auto iter = list.begin(); iter != list.end(); ++iter)
+		{
+			times.push_back((*iter).time);
+		}
+	}
+	std::sort(times.begin(), times.end());
+	times.erase(std::unique(times.begin(), times.end()), times.end());
+
+	columns.clear();
+	AddParquetColumn(columns, "activity_id", FileLib::PARQUET_COLUMN_STRING, false);
+	AddParquetColumn(columns, "time", FileLib::PARQUET_COLUMN_TIMESTAMP_MS, false);
+	AddParquetColumn(columns, "latitude", FileLib::PARQUET_COLUMN_DOUBLE, true);
+	AddParquetColumn(columns, "longitude", FileLib::PARQUET_COLUMN_DOUBLE, true);
+	AddParquetColumn(columns, "altitude", FileLib::PARQUET_COLUMN_DOUBLE, true);
+	AddParquetColumn(columns, "heart_rate", FileLib::PARQUET_COLUMN_DOUBLE, true);
+	AddParquetColumn(columns, "cadence", FileLib::PARQUET_COLUMN_DOUBLE, true);
+	AddParquetColumn(columns, "power", FileLib::PARQUET_COLUMN_DOUBLE, true);
+
+	for (auto iter = columns.begin(); iter != columns.end(); ++iter)
+	{
+		if ((*iter).optional)
+		{
+			(*iter).defined.reserve(times.size());
+			(*iter).doubleValues.reserve(times.size());
+		}
+	}
+	columns.at(COL_ACTIVITY_ID).stringValues.assign(times.size(), activityId);
+
+	size_t locationIndex = 0;
+	size_t hrIndex = 0;
+	size_t cadenceIndex = 0;
+	size_t powerIndex = 0;
+
+	for (auto iter = times.begin(); iter != times.end(); ++iter)
+	{
+		uint64_t timeMs = (*iter);
+
+		columns.at(COL_TIME).intValues.push_back((int64_t)timeMs);
+
+		size_t i = ReadingAtTime(timeMs, locationList, locationIndex);
+		bool defined = (i < locationList.size());
+		columns.at(COL_LATITUDE).defined.push_back(defined);
+		columns.at(COL_LONGITUDE).defined.push_back(defined);
+		columns.at(COL_ALTITUDE).defined.push_back(defined);
+		if (defined)
+		{
+			const SensorValues& values = locationList.at(i).reading;
+			columns.at(COL_LATITUDE).doubleValues.push_back(values.at(ACTIVITY_ATTRIBUTE_LATITUDE));
+			columns.at(COL_LONGITUDE).doubleValues.push_back(values.at(ACTIVITY_ATTRIBUTE_LONGITUDE));
+			columns.at(COL_ALTITUDE).doubleValues.push_back(values.at(ACTIVITY_ATTRIBUTE_ALTITUDE));
+		}
+
+		i = ReadingAtTime(timeMs, hrList, hrIndex);
+		defined = (i < hrList.size());
+		columns.at(COL_HEART_RATE).defined.push_back(defined);
+		if (defined)
+			columns.at(COL_HEART_RATE).doubleValues.push_back(hrList.at(i).reading.at(ACTIVITY_ATTRIBUTE_HEART_RATE));
+
+		i = ReadingAtTime(timeMs, cadenceList, cadenceIndex);
+		defined = (i < cadenceList.size());
+		columns.at(COL_CADENCE).defined.push_back(defined);
+		if (defined)
+			columns.at(COL_CADENCE).doubleValues.push_back(cadenceList.at(i).reading.at(ACTIVITY_ATTRIBUTE_CADENCE));
+
+		i = ReadingAtTime(timeMs, powerList, powerIndex);
+		defined = (i < powerList.size());
+		columns.at(COL_POWER).defined.push_back(defined);
+		if (defined)
+			columns.at(COL_POWER).doubleValues.push_back(powerList.at(i).reading.at(ACTIVITY_ATTRIBUTE_POWER));
+	}
+
+	numRows = times.size();
+	return true;
+}
+
+bool DataExporter::ExportFromDatabaseToParquet(const std::string& fileName, Database* const pDatabase, const Activity* const pActivity)
+{
+	bool result = false;
+	FileLib::ParquetFileWriter writer;
+
+	ConfigureOutput(writer);
+
+	if (writer.CreateFile(fileName))
+	{
+		FileLib::ParquetRowGroup columns;
+		size_t numRows = 0;
+
+		if (BuildSensorRowGroup(pActivity->GetId(), pDatabase, columns, numRows))
+		{
+			result = writer.WriteRowGroup(columns, numRows);
+		}
+		result &= writer.CloseFile();
+	}
+	return result;
+}
+
+// Writes the sensor data for every activity in the database to a single file, one row group per activity,
+// so the analysis tools can skip activities using the row group statistics.
+bool DataExporter::ExportSensorHistoryToParquet(std::string& fileName, Database* const pDatabase)
+{
+	bool result = false;
+	FileLib::ParquetFileWriter writer;
+	ActivitySummaryList activities;
+
+	if (!pDatabase->RetrieveActivities(activities))
+	{
+		return false;
+	}
+
+	time_t now = time(NULL);
+	struct tm nowTm;
+	char buf[32];
+
+	localtime_r(&now, &nowTm);
+	strftime(buf, sizeof(buf) - 1, "%Y-%m-%dT%H-%M-%S", &nowTm);
+
+	fileName.append("/");
+	fileName.append(buf);
+	fileName.append("-SensorHistory.parquet");
+
+	ConfigureOutput(writer);
+
+	if (writer.CreateFile(fileName))
+	{
+		result = true;
+
+		for (auto iter = activities.begin(); iter != activities.end() && result; ++iter)
+		{
+			FileLib::ParquetRowGroup columns;
+			size_t numRows = 0;
+
+			if (BuildSensorRowGroup((*iter).activityId, pDatabase, columns, numRows) && (numRows > 0))
+			{
+				result = writer.WriteRowGroup(columns, numRows);
+			}
+		}
+		result &= writer.CloseFile();
 	}
 	return result;
 }
@@ -597,8 +819,10 @@ std::string DataExporter::GenerateFileName(FileFormat format, time_t startTime,
 {
 	std::string fileName;
 
+	struct tm startTm;
 	char buf[32];
-	strftime(buf, sizeof(buf) - 1, "%Y-%m-%dT%H-%M-%S", localtime(&startTime));
+	localtime_r(&startTime, &startTm);
+	strftime(buf, sizeof(buf) - 1, "%Y-%m-%dT%H-%M-%S", &startTm);
 
 	fileName.append(buf);
 	fileName.append("-");
@@ -623,6 +847,9 @@ std::string DataExporter::GenerateFileName(FileFormat format, time_t startTime,
 		case FILE_ZWO:
 			fileName.append(".zwo");
 			break;
+		case FILE_PARQUET:
+			fileName.append(".parquet");
+			break;
 		default:
 			break;
 	}
@@ -630,6 +857,29 @@ std::string DataExporter::GenerateFileName(FileFormat format, time_t startTime,
 	return fileName;
 }
 
+bool DataExporter::ExportFromDatabaseUsingFormat(FileFormat format, const std::string& fileName, Database* const pDatabase, const Activity* const pActivity)
+{
+	switch (format)
+	{
+		case FILE_UNKNOWN:
+			return false;
+		case FILE_TEXT:
+			return false;
+		case FILE_TCX:
+			return ExportFromDatabaseToTcx(fileName, pDatabase, pActivity);
+		case FILE_GPX:
+			return ExportFromDatabaseToGpx(fileName, pDatabase, pActivity);
+		case FILE_CSV:
+			return ExportFromDatabaseToCsv(fileName, pDatabase, pActivity);
+		case FILE_PARQUET:
+			return ExportFromDatabaseToParquet(fileName, pDatabase, pActivity);
+		case FILE_ZWO:
+		default:
+			return false;
+	}
+	return false;
+}
+
 bool DataExporter::ExportFromDatabase(FileFormat format, std::string& fileName, Database* const pDatabase, const Activity* const pActivity)
 {
 	if (pActivity)
@@ -637,26 +887,44 @@ bool DataExporter::ExportFromDatabase(FileFormat format, std::string& fileName,
 		fileName.append("/");
 		fileName.append(GenerateFileName(format, pActivity->GetStartTimeSecs(), pActivity->GetType()));
 
-		switch (format)
-		{
-			case FILE_UNKNOWN:
-				return false;
-			case FILE_TEXT:
-				return false;
-			case FILE_TCX:
-				return ExportFromDatabaseToTcx(fileName, pDatabase, pActivity);
-			case FILE_GPX:
-				return ExportFromDatabaseToGpx(fileName, pDatabase, pActivity);
-			case FILE_CSV:
-				return ExportFromDatabaseToCsv(fileName, pDatabase, pActivity);
-			case FILE_ZWO:
-			default:
-				return false;
-		}
+		return ExportFromDatabaseUsingFormat(format, fileName, pDatabase, pActivity);
 	}
 	return false;
 }
 
+bool DataExporter::ExportFromDatabaseToBuffer(FileFormat format, std::string& buffer, bool compress, Database* const pDatabase, const Activity* const pActivity)
+{
+	bool result = false;
+
+	if (pActivity)
+	{
+		m_pOutputBuffer = &buffer;
+		m_compressOutput = compress;
+
+		result = ExportFromDatabaseUsingFormat(format, GenerateFileName(format, pActivity->GetStartTimeSecs(), pActivity->GetType()), pDatabase, pActivity);
+
+		ResetOutput();
+	}
+	return result;
+}
+
+bool DataExporter::ExportFromDatabaseUsingWriteCallback(FileFormat format, FileLib::WriteCallback writeCallback, void* writeContext, bool compress, Database* const pDatabase, const Activity* const pActivity)
+{
+	bool result = false;
+
+	if (pActivity && writeCallback)
+	{
+		m_outputCallback = writeCallback;
+		m_outputContext = writeContext;
+		m_compressOutput = compress;
+
+		result = ExportFromDatabaseUsingFormat(format, GenerateFileName(format, pActivity->GetStartTimeSecs(), pActivity->GetType()), pDatabase, pActivity);
+
+		ResetOutput();
+	}
+	return result;
+}
+
 bool DataExporter::ExportUsingCallbackData(FileFormat format, std::string& fileName, time_t startTime, const std::string& sportType, const std::string& activityId, GetNextCoordinateCallback nextCoordinateCallback, void* context)
 {
 	fileName.append("/");
@@ -674,6 +942,8 @@ bool DataExporter::ExportUsingCallbackData(FileFormat format, std::string& fileN
 			return ExportToGpxUsingCallbacks(fileName, startTime, activityId, nextCoordinateCallback, context);
 		case FILE_CSV:
 			return false;
+		case FILE_PARQUET:
+			return false;
 		case FILE_ZWO:
 		default:
 			return false;
@@ -726,9 +996,15 @@ bool DataExporter::ExportActivitySummary(const ActivitySummaryList& activities,
 				{
 					const std::string& attrName = (*attrIter);
 
-					try
+					const ActivityAttributeType* pValue = summary.summaryAttributes.Find(attrName);
+
+					if (pValue == NULL)
 					{
-						ActivityAttributeType value = summary.summaryAttributes.at(attrName);
+						values.push_back("-");
+					}
+					else
+					{
+						const ActivityAttributeType& value = *pValue;
 						switch (value.valueType)
 						{
 							case TYPE_NOT_SET:
@@ -760,10 +1036,6 @@ bool DataExporter::ExportActivitySummary(const ActivitySummaryList& activities,
 								break;
 						}
 					}
-					catch (...)
-					{
-						values.push_back("-");
-					}
 
 					attrIter++;
 				}
@@ -776,7 +1048,7 @@ bool DataExporter::ExportActivitySummary(const ActivitySummaryList& activities,
 		
 		result = true;
 
-		writer.CloseFile();
+		result &= writer.CloseFile();
 	}
 
 	return result;
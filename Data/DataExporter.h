@@ -18,6 +18,7 @@
 #include "Database.h"
 #include "MovingActivity.h"
 #include "FileFormat.h"
+#include "ParquetFileWriter.h"
 
 class DataExporter
 {
@@ -26,9 +27,14 @@ public:
 	virtual ~DataExporter();
 
 	bool ExportFromDatabase(FileFormat format, std::string& fileName, Database* const pDatabase, const Activity* const pActivity);
+	bool ExportFromDatabaseToBuffer(FileFormat format, std::string& buffer, bool compress, Database* const pDatabase, const Activity* const pActivity);
+	bool ExportFromDatabaseUsingWriteCallback(FileFormat format, FileLib::WriteCallback writeCallback, void* writeContext, bool compress, Database* const pDatabase, const Activity* const pActivity);
 	bool ExportUsingCallbackData(FileFormat format, std::string& fileName, time_t startTime, const std::string& sportType, const std::string& activityId, GetNextCoordinateCallback nextCoordinateCallback, void* context);
 
 	bool ExportActivitySummary(const ActivitySummaryList& activities, std::string& activityType, std::string& fileName);
+	bool ExportSensorHistoryToParquet(std::string& fileName, Database* const pDatabase);
+
+	std::string GenerateFileName(FileFormat format, time_t startTime, const std::string& sportType);
 
 protected:
 	bool ExportToTcxUsingCallbacks(const std::string& fileName, time_t startTime, const std::string& activityId, const std::string& activityType, GetNextCoordinateCallback nextCoordinateCallback, void* context);
@@ -37,8 +43,19 @@ protected:
 	bool ExportFromDatabaseToTcx(const std::string& fileName, Database* const pDatabase, const Activity* const pActivity);
 	bool ExportFromDatabaseToGpx(const std::string& fileName, Database* const pDatabase, const Activity* const pActivity);
 	bool ExportFromDatabaseToCsv(const std::string& fileName, Database* const pDatabase, const Activity* const pActivity);
+	bool ExportFromDatabaseToParquet(const std::string& fileName, Database* const pDatabase, const Activity* const pActivity);
 
 private:
+	std::string*           m_pOutputBuffer;  // When set, exports are appended to this buffer instead of written to a file
+	FileLib::WriteCallback m_outputCallback; // When set, exports are streamed through this callback instead of written to a file
+	void*                  m_outputContext;  // Passed to the output callback
+	bool                   m_compressOutput; // TRUE if the buffer/callback output should be gzip encoded
+
+	void ConfigureOutput(FileLib::File& writer);
+	void ResetOutput();
+
+	bool ExportFromDatabaseUsingFormat(FileFormat format, const std::string& fileName, Database* const pDatabase, const Activity* const pActivity);
+
 	bool NearestSensorReading(uint64_t time, const SensorReadingList& list, SensorReadingList::const_iterator& iter);
 
 	bool ExportPositionDataToCsv(FileLib::CsvFileWriter& writer, const MovingActivity* const pMovingActivity);
@@ -46,7 +63,7 @@ private:
 	bool ExportHeartRateDataToCsv(FileLib::CsvFileWriter& writer, const std::string& activityId, Database* const pDatabase);
 	bool ExportCadenceDataToCsv(FileLib::CsvFileWriter& writer, const std::string& activityId, Database* const pDatabase);
 
-	std::string GenerateFileName(FileFormat format, time_t startTime, const std::string& sportType);
+	bool BuildSensorRowGroup(const std::string& activityId, Database* const pDatabase, FileLib::ParquetRowGroup& columns, size_t& numRows);
 };
 
 #endif
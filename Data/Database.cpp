@@ -8,17 +8,94 @@
 #include "Database.h"
 #include "ActivityAttribute.h"
 #include "AxisName.h"
+#include "Defines.h"
 
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Summary attributes that are summed into the rollups.
+static const char* const g_rollupAttributes[] =
+{
+	ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED,
+	ACTIVITY_ATTRIBUTE_ELAPSED_TIME,
+	ACTIVITY_ATTRIBUTE_CALORIES_BURNED,
+	ACTIVITY_ATTRIBUTE_TOTAL_ASCENT,
+	ACTIVITY_ATTRIBUTE_TRAINING_STRESS,
+};
+
+static void ClearActivityRollup(ActivityRollup& rollup)
+{
+	rollup.granularity = ROLLUP_WEEK;
+	rollup.bucketStart = 0;
+	rollup.activityType.clear();
+	rollup.activityCount = 0;
+	rollup.distance = (double)0.0;
+	rollup.longestDistance = (double)0.0;
+	rollup.elapsedTime = (double)0.0;
+	rollup.calories = (double)0.0;
+	rollup.ascent = (double)0.0;
+	rollup.trainingStress = (double)0.0;
+}
+
+// Returns the rollup field that sums the given summary attribute, or NULL if it isn't rolled up.
+static double* ActivityRollupField(ActivityRollup& rollup, const std::string& attribute)
+{
+	if (attribute.compare(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED) == 0)
+		return &rollup.distance;
+	if (attribute.compare(ACTIVITY_ATTRIBUTE_ELAPSED_TIME) == 0)
+		return &rollup.elapsedTime;
+	if (attribute.compare(ACTIVITY_ATTRIBUTE_CALORIES_BURNED) == 0)
+		return &rollup.calories;
+	if (attribute.compare(ACTIVITY_ATTRIBUTE_TOTAL_ASCENT) == 0)
+		return &rollup.ascent;
+	if (attribute.compare(ACTIVITY_ATTRIBUTE_TRAINING_STRESS) == 0)
+		return &rollup.trainingStress;
+	return NULL;
+}
+
+static time_t ActivityRollupBucketEnd(RollupGranularity granularity, time_t bucketStart)
+{
+	struct tm bucketTm;
+
+	gmtime_r(&bucketStart, &bucketTm);
+	switch (granularity)
+	{
+		case ROLLUP_WEEK:
+			bucketTm.tm_mday += 7;
+			break;
+		case ROLLUP_MONTH:
+			bucketTm.tm_mon += 1;
+			break;
+		case ROLLUP_YEAR:
+		case NUM_ROLLUP_GRANULARITIES:
+			bucketTm.tm_year += 1;
+			break;
+	}
+	return timegm(&bucketTm);
+}
 
 Database::Database()
 {
 	m_pDb = NULL;
+	m_pCreateSummaryStatement = NULL;
+	m_pRetrieveSummaryValueStatement = NULL;
+	m_pRetrieveActivityTypeStatement = NULL;
+	m_pDataVersionStatement = NULL;
+	m_dataVersion = 0;
+	m_weightTimelineLoaded = false;
+	m_attributeAggregatesLoaded = false;
+	m_trainingLoadStale = false;
+	m_trainingLoadStaleFrom = 0;
 }
 
 Database::~Database()
 {
+	FinalizeStatements();
+
 	if (m_pDb)
 	{
 		sqlite3_close(m_pDb);
@@ -28,12 +105,151 @@ Database::~Database()
 
 bool Database::Open(const std::string& dbFileName)
 {
-	return (sqlite3_open(dbFileName.c_str(), &m_pDb) == SQLITE_OK);
+	m_fileName = dbFileName;
+
+	// Serialized, since the connection may be shared between threads.
+	if (sqlite3_open_v2(dbFileName.c_str(), &m_pDb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL) == SQLITE_OK)
+	{
+		ConfigureConnection(false);
+		return true;
+	}
+	return false;
+}
+
+// Opens a second, read only, connection to an existing database. Each thread that needs to read
+// from the database concurrently with the main connection should open its own.
+bool Database::OpenReadOnly(const std::string& dbFileName)
+{
+	m_fileName = dbFileName;
+
+	if (sqlite3_open_v2(dbFileName.c_str(), &m_pDb, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL) == SQLITE_OK)
+	{
+		ConfigureConnection(true);
+		return true;
+	}
+	return false;
+}
+
+void Database::ConfigureConnection(bool readOnly)
+{
+	// Other connections to the same file (the sensor reading writer's, for example) can hold the write lock,
+	// so wait for them rather than fail.
+	sqlite3_busy_timeout(m_pDb, DATABASE_BUSY_TIMEOUT_MS);
+
+	// Write ahead logging lets readers carry on while something is being written, and the reverse. The mode is
+	// stored in the file, so only a writable connection can set it. In WAL mode, normal synchronization can't
+	// corrupt the database, at worst the last few commits are lost if the device loses power.
+	if (!readOnly)
+	{
+		ExecuteQuery("pragma journal_mode = WAL");
+		ExecuteQuery("pragma synchronous = NORMAL");
+	}
+
+	std::ostringstream pragmas;
+	pragmas << "pragma mmap_size = " << DATABASE_MMAP_SIZE;
+	ExecuteQuery(pragmas.str());
+
+	pragmas.str("");
+	pragmas << "pragma cache_size = -" << DATABASE_CACHE_SIZE_KB;
+	ExecuteQuery(pragmas.str());
+
+	ExecuteQuery("pragma temp_store = MEMORY");
+}
+
+bool Database::SetDurableCommits(bool durable)
+{
+	return ExecuteQuery(durable ? "pragma synchronous = FULL" : "pragma synchronous = NORMAL") == SQLITE_DONE;
 }
 
 bool Database::Close()
 {
-	return (sqlite3_close(m_pDb) == SQLITE_OK);
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
+	FinalizeStatements();
+
+	if (sqlite3_close(m_pDb) == SQLITE_OK)
+	{
+		m_pDb = NULL;
+		m_weightTimeline.clear();
+		m_weightTimelineLoaded = false;
+		m_attributeAggregates.clear();
+		m_attributeAggregatesLoaded = false;
+		return true;
+	}
+	return false;
+}
+
+void Database::FinalizeStatements()
+{
+	if (m_pCreateSummaryStatement)
+	{
+		sqlite3_finalize(m_pCreateSummaryStatement);
+		m_pCreateSummaryStatement = NULL;
+	}
+	if (m_pRetrieveSummaryValueStatement)
+	{
+		sqlite3_finalize(m_pRetrieveSummaryValueStatement);
+		m_pRetrieveSummaryValueStatement = NULL;
+	}
+	if (m_pRetrieveActivityTypeStatement)
+	{
+		sqlite3_finalize(m_pRetrieveActivityTypeStatement);
+		m_pRetrieveActivityTypeStatement = NULL;
+	}
+	if (m_pDataVersionStatement)
+	{
+		sqlite3_finalize(m_pDataVersionStatement);
+		m_pDataVersionStatement = NULL;
+	}
+}
+
+bool Database::BeginTransaction()
+{
+	return ExecuteQuery("begin transaction") == SQLITE_DONE;
+}
+
+bool Database::CommitTransaction()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
+	// The training loads are recomputed once per transaction, from the earliest day whose stress changed.
+	if (m_trainingLoadStale)
+	{
+		m_trainingLoadStale = false;
+
+		if (!RecomputeTrainingLoads(m_trainingLoadStaleFrom))
+		{
+			RollbackTransaction();
+			return false;
+		}
+	}
+	return ExecuteQuery("commit transaction") == SQLITE_DONE;
+}
+
+bool Database::RollbackTransaction()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
+	// The cached aggregates may include changes that are being rolled back.
+	m_attributeAggregates.clear();
+	m_attributeAggregatesLoaded = false;
+	m_trainingLoadStale = false;
+
+	return ExecuteQuery("rollback transaction") == SQLITE_DONE;
+}
+
+bool Database::IsInTransaction() const
+{
+	return (m_pDb != NULL) && (sqlite3_get_autocommit(m_pDb) == 0);
+}
+
+int Database::GetLastErrorCode() const
+{
+	return m_pDb ? sqlite3_errcode(m_pDb) : SQLITE_CANTOPEN;
+}
+
+bool Database::IsTransientError(int errorCode)
+{
+	// Extended result codes (SQLITE_BUSY_SNAPSHOT, etc.) keep the primary code in the low byte.
+	int primaryCode = errorCode & 0xff;
+	return (primaryCode == SQLITE_BUSY) || (primaryCode == SQLITE_LOCKED);
 }
 
 bool Database::DoesTableHaveColumn(const std::string& tableName, const std::string& columnName)
@@ -81,6 +297,7 @@ bool Database::DropTable(const std::string& tableName)
 
 bool Database::CreateTables()
 {
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
 	std::vector<std::string> queries;
 	std::string sql;
 
@@ -218,13 +435,91 @@ bool Database::CreateTables()
 		sql = "create table activity_hash (id integer primary key, activity_id text, hash text)";
 		queries.push_back(sql);
 	}
+	if (!DoesTableExist("summary_version"))
+	{
+		sql = "create table summary_version (id integer primary key, activity_id text, version integer, unique(activity_id) on conflict replace)";
+		queries.push_back(sql);
+	}
+
+	bool rebuildAggregates = false;
+	if (!DoesTableExist("attribute_aggregate"))
+	{
+		sql = "create table attribute_aggregate (id integer primary key, activity_type text, attribute text, value_type integer, measure_type integer, units integer, count integer, total double, "
+			"smallest_value double, smallest_start_time unsigned big int, smallest_end_time unsigned big int, smallest_activity_id text, "
+			"largest_value double, largest_start_time unsigned big int, largest_end_time unsigned big int, largest_activity_id text, "
+			"unique(activity_type, attribute) on conflict replace)";
+		queries.push_back(sql);
+		rebuildAggregates = true;
+	}
+	bool rebuildRecords = false;
+	if (!DoesTableExist("personal_record"))
+	{
+		sql = "create table personal_record (id integer primary key, activity_type text, attribute text, activity_id text, activity_start_time unsigned big int, year integer, "
+			"value double, start_time unsigned big int, end_time unsigned big int, value_type integer, measure_type integer, units integer, "
+			"unique(activity_type, attribute, activity_id) on conflict replace)";
+		queries.push_back(sql);
+		sql = "create index personal_record_index on personal_record (activity_type, attribute, year)";
+		queries.push_back(sql);
+		rebuildRecords = true;
+	}
+	bool rebuildRollups = false;
+	if (!DoesTableExist("activity_rollup"))
+	{
+		sql = "create table activity_rollup (id integer primary key, granularity integer, bucket_start unsigned big int, activity_type text, activity_count integer, "
+			"distance double, longest_distance double, elapsed_time double, calories double, ascent double, training_stress double, "
+			"unique(granularity, bucket_start, activity_type) on conflict replace)";
+		queries.push_back(sql);
+		sql = "create index activity_rollup_index on activity_rollup (granularity, activity_type, bucket_start)";
+		queries.push_back(sql);
+		rebuildRollups = true;
+	}
+	bool rebuildTrainingLoads = false;
+	if (!DoesTableExist("training_load"))
+	{
+		sql = "create table training_load (id integer primary key, day unsigned big int, stress double, chronic_load double, acute_load double, unique(day) on conflict replace)";
+		queries.push_back(sql);
+		rebuildTrainingLoads = true;
+	}
+
+	// Indexes added after the tables were first released, so they need to be created on existing databases too.
+	sql = "create index if not exists weight_time_index on weight (time)";
+	queries.push_back(sql);
+	sql = "create index if not exists activity_start_time_index on activity (start_time, id, activity_id, user_id, type, name, end_time)";
+	queries.push_back(sql);
+	sql = "create index if not exists activity_id_index on activity (activity_id, type)";
+	queries.push_back(sql);
+	sql = "create index if not exists activity_type_index on activity (type, start_time, activity_id)";
+	queries.push_back(sql);
 
 	int result = ExecuteQueries(queries);
-	return (result == SQLITE_OK || result == SQLITE_DONE);
+	if (result != SQLITE_OK && result != SQLITE_DONE)
+	{
+		return false;
+	}
+
+	// Databases created before the aggregates and records existed need them computed from the summaries they already have.
+	if (rebuildAggregates && !RebuildAttributeAggregates())
+	{
+		return false;
+	}
+	if (rebuildRecords && !RebuildPersonalRecords())
+	{
+		return false;
+	}
+	if (rebuildRollups && !RebuildActivityRollups())
+	{
+		return false;
+	}
+	if (rebuildTrainingLoads && !RebuildTrainingLoads())
+	{
+		return false;
+	}
+	return true;
 }
 
 bool Database::Reset()
 {
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
 	std::vector<std::string> queries;
 	std::string sql;
 
@@ -266,10 +561,27 @@ bool Database::Reset()
 	queries.push_back(sql);
 	sql = "delete from weight";
 	queries.push_back(sql);
+
+	m_weightTimeline.clear();
+	m_weightTimelineLoaded = false;
 	sql = "delete from tag";
 	queries.push_back(sql);
 	sql = "delete from activity_summary";
 	queries.push_back(sql);
+	sql = "delete from attribute_aggregate";
+	queries.push_back(sql);
+	sql = "delete from personal_record";
+	queries.push_back(sql);
+	sql = "delete from activity_rollup";
+	queries.push_back(sql);
+	sql = "delete from summary_version";
+	queries.push_back(sql);
+	sql = "delete from training_load";
+	queries.push_back(sql);
+
+	m_attributeAggregates.clear();
+	m_attributeAggregatesLoaded = false;
+	m_trainingLoadStale = false;
 	
 	int result = ExecuteQueries(queries);
 	return (result == SQLITE_OK || result == SQLITE_DONE);
@@ -854,7 +1166,14 @@ bool Database::StartActivity(const std::string& activityId, const std::string& u
 		result = sqlite3_step(statement);
 		sqlite3_finalize(statement);
 	}
-	return result == SQLITE_DONE;
+	if (result != SQLITE_DONE)
+	{
+		return false;
+	}
+
+	ActivityRollup delta;
+	ClearActivityRollup(delta);
+	return AdjustActivityRollups(activityType, startTime, 1, delta, false);
 }
 
 bool Database::StopActivity(time_t endTime, const std::string& activityId)
@@ -872,10 +1191,28 @@ bool Database::StopActivity(time_t endTime, const std::string& activityId)
 	return result == SQLITE_DONE;
 }
 
+// The activity, and what it contributed to the aggregates, rollups, training load, and records, are removed
+// in one transaction (unless the caller already has one open), so a failure part way through changes nothing.
 bool Database::DeleteActivity(const std::string& activityId)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
 	std::vector<std::string> queries;
 	std::ostringstream sqlStream;
+	bool ownTransaction = !IsInTransaction();
+
+	if (ownTransaction && !BeginTransaction())
+	{
+		return false;
+	}
+
+	// Remember what the activity contributed to the aggregates and rollups before its summary is deleted.
+	std::string activityType;
+	SummaryAttributeMap summaryValues;
+	time_t activityStartTime = 0;
+	time_t activityEndTime = 0;
+	RetrieveActivityType(activityId, activityType);
+	RetrieveSummaryData(activityId, summaryValues);
+	bool hasStartTime = RetrieveActivityStartAndEndTime(activityId, activityStartTime, activityEndTime);
 
 	sqlStream << "delete from bike_activity where activity_id = '" << activityId << "'";
 	queries.push_back(sqlStream.str());
@@ -937,8 +1274,43 @@ bool Database::DeleteActivity(const std::string& activityId)
 	sqlStream.str(std::string());
 	sqlStream.clear();
 
-	int result = ExecuteQueries(queries);
-	return (result == SQLITE_OK || result == SQLITE_DONE);
+	sqlStream << "delete from summary_version where activity_id = '" << activityId << "'";
+	queries.push_back(sqlStream.str());
+	sqlStream.str(std::string());
+	sqlStream.clear();
+
+	int queryResult = ExecuteQueries(queries);
+	bool result = (queryResult == SQLITE_OK || queryResult == SQLITE_DONE);
+
+	if (result && (activityType.size() > 0))
+	{
+		for (auto iter = summaryValues.begin(); iter != summaryValues.end() && result; ++iter)
+		{
+			result = RemoveFromAttributeAggregate(activityType, activityId, ActivityAttributeRegistry::Name((*iter).first), (*iter).second);
+		}
+		if (result && hasStartTime)
+		{
+			result  = RemoveFromActivityRollups(activityType, activityStartTime, summaryValues);
+			result &= RemoveFromTrainingLoad(activityStartTime, summaryValues);
+		}
+	}
+	if (result)
+	{
+		result = DeletePersonalRecords(activityId);
+	}
+
+	if (ownTransaction)
+	{
+		if (result)
+		{
+			result = CommitTransaction();
+		}
+		else
+		{
+			RollbackTransaction();
+		}
+	}
+	return result;
 }
 
 bool Database::RetrieveActivity(const std::string& activityId, ActivitySummary& summary)
@@ -972,7 +1344,7 @@ bool Database::RetrieveActivities(ActivitySummaryList& activities)
 	bool result = false;
 	sqlite3_stmt* statement = NULL;
 	
-	if (sqlite3_prepare_v2(m_pDb, "select activity_id, user_id, type, name, start_time, end_time from activity order by start_time", -1, &statement, 0) == SQLITE_OK)
+	if (sqlite3_prepare_v2(m_pDb, "select activity_id, user_id, type, name, start_time, end_time from activity order by start_time, id", -1, &statement, 0) == SQLITE_OK)
 	{
 		while (sqlite3_step(statement) == SQLITE_ROW)
 		{
@@ -995,10 +1367,92 @@ bool Database::RetrieveActivities(ActivitySummaryList& activities)
 	return result;
 }
 
+// Keyset pagination, each page starts after the (start_time, id) of the last row of the previous page so that
+// the cost of reading a page does not depend on how far into the history it is. The index on
+// (start_time, id, ...) covers every column that is selected.
+bool Database::RetrieveActivityPage(ActivityPageCursor& cursor, size_t maxActivities, bool newestFirst, ActivitySummaryList& activities)
+{
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
+	std::string sql = "select id, activity_id, user_id, type, name, start_time, end_time from activity";
+
+	if (cursor.valid)
+	{
+		if (newestFirst)
+		{
+			sql += " where (start_time, id) < (?, ?)";
+		}
+		else
+		{
+			sql += " where (start_time, id) > (?, ?)";
+		}
+	}
+	if (newestFirst)
+	{
+		sql += " order by start_time desc, id desc limit ?";
+	}
+	else
+	{
+		sql += " order by start_time, id limit ?";
+	}
+
+	if (sqlite3_prepare_v2(m_pDb, sql.c_str(), -1, &statement, 0) == SQLITE_OK)
+	{
+		int paramIndex = 1;
+
+		if (cursor.valid)
+		{
+			sqlite3_bind_int64(statement, paramIndex++, cursor.startTime);
+			sqlite3_bind_int64(statement, paramIndex++, cursor.rowId);
+		}
+		sqlite3_bind_int64(statement, paramIndex, maxActivities);
+
+		while (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			ActivitySummary summary;
+
+			cursor.rowId = (uint64_t)sqlite3_column_int64(statement, 0);
+			summary.activityId.append((const char*)sqlite3_column_text(statement, 1));
+			summary.userId = sqlite3_column_int64(statement, 2);
+			summary.type.append((const char*)sqlite3_column_text(statement, 3));
+			summary.name.append((const char*)sqlite3_column_text(statement, 4));
+			summary.startTime = (time_t)sqlite3_column_int64(statement, 5);
+			summary.endTime = (time_t)sqlite3_column_int64(statement, 6);
+			summary.pActivity = NULL;
+
+			cursor.startTime = summary.startTime;
+			cursor.valid = true;
+
+			activities.push_back(summary);
+		}
+
+		sqlite3_finalize(statement);
+		result = true;
+	}
+	return result;
+}
+
+// Done in one transaction (unless the caller already has one open), like DeleteActivity.
 bool Database::MergeActivities(const std::string& activityId1, const std::string& activityId2)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
 	std::vector<std::string> queries;
 	std::ostringstream sqlStream;
+	bool ownTransaction = !IsInTransaction();
+
+	if (ownTransaction && !BeginTransaction())
+	{
+		return false;
+	}
+
+	// The second activity's summary is deleted, so it no longer contributes to the aggregates or rollups.
+	std::string activityType;
+	SummaryAttributeMap summaryValues;
+	time_t activityStartTime = 0;
+	time_t activityEndTime = 0;
+	RetrieveActivityType(activityId2, activityType);
+	RetrieveSummaryData(activityId2, summaryValues);
+	bool hasStartTime = RetrieveActivityStartAndEndTime(activityId2, activityStartTime, activityEndTime);
 	
 	sqlStream << "update bike_activity set activity_id = " << activityId1 << " where activity_id = " << activityId2;
 	queries.push_back(sqlStream.str());
@@ -1060,8 +1514,38 @@ bool Database::MergeActivities(const std::string& activityId1, const std::string
 	sqlStream.str(std::string());
 	sqlStream.clear();
 	
-	int result = ExecuteQueries(queries);
-	return (result == SQLITE_OK || result == SQLITE_DONE);
+	int queryResult = ExecuteQueries(queries);
+	bool result = (queryResult == SQLITE_OK || queryResult == SQLITE_DONE);
+
+	if (result && (activityType.size() > 0))
+	{
+		for (auto iter = summaryValues.begin(); iter != summaryValues.end() && result; ++iter)
+		{
+			result = RemoveFromAttributeAggregate(activityType, activityId2, ActivityAttributeRegistry::Name((*iter).first), (*iter).second);
+		}
+		if (result && hasStartTime)
+		{
+			result  = RemoveFromActivityRollups(activityType, activityStartTime, summaryValues);
+			result &= RemoveFromTrainingLoad(activityStartTime, summaryValues);
+		}
+	}
+	if (result)
+	{
+		result = DeletePersonalRecords(activityId2);
+	}
+
+	if (ownTransaction)
+	{
+		if (result)
+		{
+			result = CommitTransaction();
+		}
+		else
+		{
+			RollbackTransaction();
+		}
+	}
+	return result;
 }
 
 bool Database::RetrieveActivityStartAndEndTime(const std::string& activityId, time_t& startTime, time_t& endTime)
@@ -1069,7 +1553,7 @@ bool Database::RetrieveActivityStartAndEndTime(const std::string& activityId, ti
 	bool result = false;
 	sqlite3_stmt* statement = NULL;
 	
-	if (sqlite3_prepare_v2(m_pDb, "select start_time,end_time from activity where id = ?", -1, &statement, 0) == SQLITE_OK)
+	if (sqlite3_prepare_v2(m_pDb, "select start_time,end_time from activity where activity_id = ?", -1, &statement, 0) == SQLITE_OK)
 	{
 		sqlite3_bind_text(statement, 1, activityId.c_str(), -1, SQLITE_TRANSIENT);
 
@@ -1077,10 +1561,10 @@ bool Database::RetrieveActivityStartAndEndTime(const std::string& activityId, ti
 		{
 			startTime = (time_t)sqlite3_column_int64(statement, 0);
 			endTime = (time_t)sqlite3_column_int64(statement, 1);
+			result = true;
 		}
 		
 		sqlite3_finalize(statement);
-		result = true;
 	}
 	return result;
 }
@@ -1271,10 +1755,45 @@ bool Database::SearchForTags(const std::string& searchStr, std::vector<std::stri
 	return result;
 }
 
-bool Database::CreateSummaryData(const std::string& activityId, const std::string& attribute, ActivityAttributeType value)
+// Summary values are stored in a double column regardless of their type, the aggregates do the same.
+static double SummaryValueAsDouble(const ActivityAttributeType& value)
+{
+	switch (value.valueType)
+	{
+		case TYPE_DOUBLE:
+			return value.value.doubleVal;
+		case TYPE_INTEGER:
+			return (double)value.value.intVal;
+		case TYPE_TIME:
+			return (double)value.value.timeVal;
+		case TYPE_NOT_SET:
+			break;
+	}
+	return (double)0.0;
+}
+
+static void SetSummaryValueFromDouble(ActivityAttributeType& value, double doubleVal)
+{
+	switch (value.valueType)
+	{
+		case TYPE_DOUBLE:
+			value.value.doubleVal = doubleVal;
+			break;
+		case TYPE_INTEGER:
+			value.value.intVal = (uint64_t)doubleVal;
+			break;
+		case TYPE_TIME:
+			value.value.timeVal = (time_t)doubleVal;
+			break;
+		case TYPE_NOT_SET:
+			value.value.intVal = 0;
+			break;
+	}
+}
+
+// Writes (or replaces) one summary attribute, keeping the aggregates for the activity's type up to date.
+bool Database::WriteSummaryData(const std::string& activityId, const std::string& activityType, const std::string& attribute, const ActivityAttributeType& value)
 {
-	sqlite3_stmt* statement = NULL;
-	
 	if (attribute.length() == 0)
 	{
 		return false;
@@ -1283,93 +1802,1917 @@ bool Database::CreateSummaryData(const std::string& activityId, const std::strin
 	{
 		return false;
 	}
-	
-	int result = sqlite3_prepare_v2(m_pDb, "insert into activity_summary values (NULL,?,?,?,?,?,?,?,?)", -1, &statement, 0);
-	if (result == SQLITE_OK)
-	{
-		bool valid = true;
 
-		sqlite3_bind_text(statement, 1, activityId.c_str(), -1, SQLITE_TRANSIENT);
-		sqlite3_bind_text(statement, 2, attribute.c_str(), -1, SQLITE_TRANSIENT);
-		switch (value.valueType)
-		{
-			case TYPE_DOUBLE:
-				sqlite3_bind_double(statement, 3, value.value.doubleVal);
-				break;
-			case TYPE_INTEGER:
-				sqlite3_bind_double(statement, 3, value.value.intVal);
-				break;
-			case TYPE_TIME:
-				sqlite3_bind_double(statement, 3, value.value.timeVal);
-				break;
-			case TYPE_NOT_SET:
-				valid = false;
-				break;
-		}
-		if (valid)
-		{
-			sqlite3_bind_int64(statement, 4, value.startTime);
-			sqlite3_bind_int64(statement, 5, value.endTime);
-			sqlite3_bind_int(statement, 6, value.valueType);
-			sqlite3_bind_int(statement, 7, value.measureType);
-			sqlite3_bind_int(statement, 8, value.unitSystem);
-			result = sqlite3_step(statement);
+	ActivityAttributeType oldValue;
+	bool hadOldValue = (activityType.size() > 0) && RetrieveSummaryValue(activityId, attribute, oldValue);
+
+	if (m_pCreateSummaryStatement == NULL)
+	{
+		if (sqlite3_prepare_v2(m_pDb, "insert into activity_summary values (NULL,?,?,?,?,?,?,?,?)", -1, &m_pCreateSummaryStatement, 0) != SQLITE_OK)
+		{
+			m_pCreateSummaryStatement = NULL;
+			return false;
 		}
-		sqlite3_finalize(statement);
 	}
-	return result == SQLITE_DONE;
-}
 
-bool Database::RetrieveSummaryData(const std::string& activityId, ActivityAttributeMap& values)
-{
-	bool result = false;
-	sqlite3_stmt* statement = NULL;
+	sqlite3_stmt* statement = m_pCreateSummaryStatement;
+	int result = SQLITE_ERROR;
+	bool valid = true;
+
+	sqlite3_bind_text(statement, 1, activityId.c_str(), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text(statement, 2, attribute.c_str(), -1, SQLITE_TRANSIENT);
+	switch (value.valueType)
+	{
+		case TYPE_DOUBLE:
+			sqlite3_bind_double(statement, 3, value.value.doubleVal);
+			break;
+		case TYPE_INTEGER:
+			sqlite3_bind_double(statement, 3, value.value.intVal);
+			break;
+		case TYPE_TIME:
+			sqlite3_bind_double(statement, 3, value.value.timeVal);
+			break;
+		case TYPE_NOT_SET:
+			valid = false;
+			break;
+	}
+	if (valid)
+	{
+		sqlite3_bind_int64(statement, 4, value.startTime);
+		sqlite3_bind_int64(statement, 5, value.endTime);
+		sqlite3_bind_int(statement, 6, value.valueType);
+		sqlite3_bind_int(statement, 7, value.measureType);
+		sqlite3_bind_int(statement, 8, value.unitSystem);
+		result = sqlite3_step(statement);
+	}
+	sqlite3_reset(statement);
+	sqlite3_clear_bindings(statement);
+
+	if (result != SQLITE_DONE)
+	{
+		return false;
+	}
+	if (activityType.size() == 0)
+	{
+		return true;
+	}
+
+	// Re-saving an unchanged value (the common case) leaves the aggregates and records alone.
+	if (hadOldValue)
+	{
+		if ((oldValue.valueType == value.valueType) && (SummaryValueAsDouble(oldValue) == SummaryValueAsDouble(value)))
+		{
+			return true;
+		}
+		if (!RemoveFromAttributeAggregate(activityType, activityId, attribute, oldValue))
+		{
+			return false;
+		}
+	}
+	if (!AddToAttributeAggregate(activityType, activityId, attribute, value))
+	{
+		return false;
+	}
+	if (!UpdateActivityRollups(activityType, activityId, attribute, value, hadOldValue ? &oldValue : NULL))
+	{
+		return false;
+	}
+	if (!UpdateTrainingLoad(activityId, attribute, value, hadOldValue ? &oldValue : NULL))
+	{
+		return false;
+	}
+	return UpdatePersonalRecord(activityType, activityId, attribute, value, hadOldValue ? &oldValue : NULL);
+}
+
+bool Database::CreateSummaryData(const std::string& activityId, const std::string& attribute, ActivityAttributeType value)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
+	std::string activityType;
+
+	RetrieveActivityType(activityId, activityType);
+	return WriteSummaryData(activityId, activityType, attribute, value);
+}
+
+// Writes all of the attributes in one transaction (unless the caller already has one open).
+bool Database::CreateSummaryData(const std::string& activityId, const SummaryAttributeMap& values)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
+	bool ownTransaction = !IsInTransaction();
+	bool result = true;
+	std::string activityType;
+
+	if (ownTransaction && !BeginTransaction())
+	{
+		return false;
+	}
+
+	RetrieveActivityType(activityId, activityType);
+
+	for (auto iter = values.begin(); iter != values.end() && result; ++iter)
+	{
+		result = WriteSummaryData(activityId, activityType, ActivityAttributeRegistry::Name((*iter).first), (*iter).second);
+	}
+
+	if (ownTransaction)
+	{
+		if (result)
+		{
+			result = CommitTransaction();
+		}
+		else
+		{
+			RollbackTransaction();
+		}
+	}
+	return result;
+}
+
+// Writes the summary attributes of every activity in the list in one transaction (unless the caller already has one open).
+bool Database::CreateSummaryData(const ActivitySummaryList& activities)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
+	bool ownTransaction = !IsInTransaction();
+	bool result = true;
+
+	if (ownTransaction && !BeginTransaction())
+	{
+		return false;
+	}
+
+	for (auto activityIter = activities.begin(); activityIter != activities.end() && result; ++activityIter)
+	{
+		const ActivitySummary& summary = (*activityIter);
+		std::string activityType = summary.type;
+
+		if (activityType.size() == 0)
+		{
+			RetrieveActivityType(summary.activityId, activityType);
+		}
+
+		for (auto iter = summary.summaryAttributes.begin(); iter != summary.summaryAttributes.end() && result; ++iter)
+		{
+			result = WriteSummaryData(summary.activityId, activityType, ActivityAttributeRegistry::Name((*iter).first), (*iter).second);
+		}
+	}
+
+	if (ownTransaction)
+	{
+		if (result)
+		{
+			result = CommitTransaction();
+		}
+		else
+		{
+			RollbackTransaction();
+		}
+	}
+	return result;
+}
+
+bool Database::UpdateSummaryVersion(const std::string& activityId, uint32_t version)
+{
+	sqlite3_stmt* statement = NULL;
+
+	int result = sqlite3_prepare_v2(m_pDb, "insert into summary_version values (NULL,?,?)", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, activityId.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int64(statement, 2, version);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	return result == SQLITE_DONE;
+}
+
+// Lists the finished activities whose summary data was written by an older version of the summary algorithms,
+// or by one that wasn't recorded, oldest first.
+bool Database::RetrieveActivitiesWithOldSummaries(uint32_t version, ActivitySummaryList& activities)
+{
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
+
+	if (sqlite3_prepare_v2(m_pDb, "select activity.activity_id, activity.user_id, activity.type, activity.name, activity.start_time, activity.end_time from activity "
+		"left join summary_version on summary_version.activity_id = activity.activity_id "
+		"where activity.end_time > 0 and (summary_version.version is null or summary_version.version < ?) "
+		"order by activity.start_time, activity.id", -1, &statement, 0) == SQLITE_OK)
+	{
+		sqlite3_bind_int64(statement, 1, version);
+
+		while (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			ActivitySummary summary;
+
+			summary.activityId.append((const char*)sqlite3_column_text(statement, 0));
+			summary.userId = sqlite3_column_int64(statement, 1);
+			summary.type.append((const char*)sqlite3_column_text(statement, 2));
+			summary.name.append((const char*)sqlite3_column_text(statement, 3));
+			summary.startTime = (time_t)sqlite3_column_int64(statement, 4);
+			summary.endTime = (time_t)sqlite3_column_int64(statement, 5);
+			summary.pActivity = NULL;
+
+			activities.push_back(summary);
+		}
+
+		sqlite3_finalize(statement);
+		result = true;
+	}
+	return result;
+}
+
+// Same as RetrieveActivitiesWithOldSummaries, except that it stops at the first one. Returns false if the query failed.
+bool Database::HasActivitiesWithOldSummaries(uint32_t version)
+{
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
+
+	if (sqlite3_prepare_v2(m_pDb, "select 1 from activity "
+		"left join summary_version on summary_version.activity_id = activity.activity_id "
+		"where activity.end_time > 0 and (summary_version.version is null or summary_version.version < ?) "
+		"limit 1", -1, &statement, 0) == SQLITE_OK)
+	{
+		sqlite3_bind_int64(statement, 1, version);
+		result = (sqlite3_step(statement) == SQLITE_ROW);
+		sqlite3_finalize(statement);
+	}
+	return result;
+}
+
+bool Database::DeleteSummaryVersions()
+{
+	int result = ExecuteQuery("delete from summary_version");
+	return (result == SQLITE_OK || result == SQLITE_DONE);
+}
+
+// Decodes one activity_summary row, starting with the attribute name column.
+static void ReadSummaryDataRow(sqlite3_stmt* statement, int firstColumn, std::string& attributeName, ActivityAttributeType& value)
+{
+	attributeName.append((const char*)sqlite3_column_text(statement, firstColumn));
+	value.startTime = (u_int64_t)sqlite3_column_int64(statement, firstColumn + 2);
+	value.endTime = (u_int64_t)sqlite3_column_int64(statement, firstColumn + 3);
+	value.valueType = (ActivityAttributeValueType)sqlite3_column_int(statement, firstColumn + 4);
+	value.measureType = (ActivityAttributeMeasureType)sqlite3_column_int(statement, firstColumn + 5);
+	value.unitSystem = (UnitSystem)sqlite3_column_int(statement, firstColumn + 6);
+
+	switch (value.valueType)
+	{
+		case TYPE_DOUBLE:
+			value.value.doubleVal = sqlite3_column_double(statement, firstColumn + 1);
+			value.valid = true;
+			break;
+		case TYPE_INTEGER:
+			value.value.intVal = sqlite3_column_double(statement, firstColumn + 1);
+			value.valid = true;
+			break;
+		case TYPE_TIME:
+			value.value.timeVal = sqlite3_column_double(statement, firstColumn + 1);
+			value.valid = true;
+			break;
+		case TYPE_NOT_SET:
+			value.valid = false;
+			break;
+	}
+}
+
+bool Database::RetrieveSummaryData(const std::string& activityId, SummaryAttributeMap& values)
+{
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
 	
-	values.clear();
+	values.Clear();
 	
-	if (sqlite3_prepare_v2(m_pDb, "select * from activity_summary where activity_id = ?", -1, &statement, 0) == SQLITE_OK)
+	if (sqlite3_prepare_v2(m_pDb, "select attribute, value, start_time, end_time, value_type, measure_type, units from activity_summary where activity_id = ?", -1, &statement, 0) == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, activityId.c_str(), -1, SQLITE_TRANSIENT);
+
+		while (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			std::string attributeName;
+			ActivityAttributeType value;
+
+			ReadSummaryDataRow(statement, 0, attributeName, value);
+			values.Set(attributeName, value);
+		}
+		
+		sqlite3_finalize(statement);
+		values.Compact();
+		result = true;
+	}
+	return result;
+}
+
+// Fills in the summary attributes of every activity in the list using a single scan of the summary table,
+// instead of one query per activity. Rows for activities that aren't in the list are skipped.
+bool Database::RetrieveAllSummaryData(ActivitySummaryList& activities)
+{
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
+
+	std::unordered_map<std::string, ActivitySummary*> activityMap;
+	activityMap.reserve(activities.size());
+
+	for (auto iter = activities.begin(); iter != activities.end(); ++iter)
+	{
+		ActivitySummary& summary = (*iter);
+
+		summary.summaryAttributes.Clear();
+		activityMap[summary.activityId] = &summary;
+	}
+
+	// Ordering by activity ID walks the (activity_id, attribute) index, so consecutive rows belong to the same activity.
+	if (sqlite3_prepare_v2(m_pDb, "select activity_id, attribute, value, start_time, end_time, value_type, measure_type, units from activity_summary order by activity_id", -1, &statement, 0) == SQLITE_OK)
+	{
+		ActivitySummary* pCurrentSummary = NULL;
+		std::string currentActivityId;
+
+		while (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			const char* activityId = (const char*)sqlite3_column_text(statement, 0);
+
+			if (activityId == NULL)
+			{
+				continue;
+			}
+			if (currentActivityId.compare(activityId) != 0)
+			{
+				currentActivityId = activityId;
+
+				auto mapIter = activityMap.find(currentActivityId);
+				pCurrentSummary = (mapIter == activityMap.end()) ? NULL : (*mapIter).second;
+			}
+			if (pCurrentSummary)
+			{
+				std::string attributeName;
+				ActivityAttributeType value;
+
+				ReadSummaryDataRow(statement, 1, attributeName, value);
+				pCurrentSummary->summaryAttributes.Set(attributeName, value);
+			}
+		}
+
+		sqlite3_finalize(statement);
+		result = true;
+
+		for (auto iter = activities.begin(); iter != activities.end(); ++iter)
+		{
+			(*iter).summaryAttributes.Compact();
+		}
+	}
+	return result;
+}
+
+bool Database::RetrieveActivityType(const std::string& activityId, std::string& activityType)
+{
+	bool result = false;
+
+	if (m_pRetrieveActivityTypeStatement == NULL)
+	{
+		if (sqlite3_prepare_v2(m_pDb, "select type from activity where activity_id = ? limit 1", -1, &m_pRetrieveActivityTypeStatement, 0) != SQLITE_OK)
+		{
+			m_pRetrieveActivityTypeStatement = NULL;
+			return false;
+		}
+	}
+
+	sqlite3_stmt* statement = m_pRetrieveActivityTypeStatement;
+
+	sqlite3_bind_text(statement, 1, activityId.c_str(), -1, SQLITE_TRANSIENT);
+
+	if (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		const char* type = (const char*)sqlite3_column_text(statement, 0);
+
+		if (type)
+		{
+			activityType = type;
+			result = true;
+		}
+	}
+
+	sqlite3_reset(statement);
+	sqlite3_clear_bindings(statement);
+	return result;
+}
+
+bool Database::RetrieveSummaryValue(const std::string& activityId, const std::string& attribute, ActivityAttributeType& value)
+{
+	bool result = false;
+
+	if (m_pRetrieveSummaryValueStatement == NULL)
+	{
+		if (sqlite3_prepare_v2(m_pDb, "select attribute, value, start_time, end_time, value_type, measure_type, units from activity_summary where activity_id = ? and attribute = ?", -1, &m_pRetrieveSummaryValueStatement, 0) != SQLITE_OK)
+		{
+			m_pRetrieveSummaryValueStatement = NULL;
+			return false;
+		}
+	}
+
+	sqlite3_stmt* statement = m_pRetrieveSummaryValueStatement;
+
+	sqlite3_bind_text(statement, 1, activityId.c_str(), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text(statement, 2, attribute.c_str(), -1, SQLITE_TRANSIENT);
+
+	if (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		std::string attributeName;
+
+		ReadSummaryDataRow(statement, 0, attributeName, value);
+		result = value.valid;
+	}
+
+	sqlite3_reset(statement);
+	sqlite3_clear_bindings(statement);
+	return result;
+}
+
+// Sums the aggregate rows for the activity type (or all types). Like the summaries themselves, values whose type
+// doesn't match the first one found are skipped.
+bool Database::RetrieveAttributeTotal(const std::string& activityType, const std::string& attribute, ActivityAttributeType& total)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
+	DropStaleCaches();
+	if (!m_attributeAggregatesLoaded && !LoadAttributeAggregates())
+	{
+		return false;
+	}
+
+	bool result = false;
+	double sum = (double)0.0;
+
+	for (auto typeIter = m_attributeAggregates.begin(); typeIter != m_attributeAggregates.end(); ++typeIter)
+	{
+		if ((activityType.size() > 0) && ((*typeIter).first.compare(activityType) != 0))
+		{
+			continue;
+		}
+
+		auto aggregateIter = (*typeIter).second.find(attribute);
+		if (aggregateIter == (*typeIter).second.end())
+		{
+			continue;
+		}
+
+		const AttributeAggregate& aggregate = (*aggregateIter).second;
+
+		if (!result)
+		{
+			total = aggregate.smallest;
+			total.startTime = 0;
+			total.endTime = 0;
+			total.valid = true;
+			result = true;
+		}
+		else if (total.valueType != aggregate.smallest.valueType)
+		{
+			continue;
+		}
+		sum += aggregate.total;
+	}
+
+	if (result)
+	{
+		SetSummaryValueFromDouble(total, sum);
+	}
+	return result;
+}
+
+bool Database::RetrieveBestAttributeValue(const std::string& activityType, const std::string& attribute, bool smallestIsBest, ActivityAttributeType& value, std::string& activityId)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
+	DropStaleCaches();
+	if (!m_attributeAggregatesLoaded && !LoadAttributeAggregates())
+	{
+		return false;
+	}
+
+	bool result = false;
+
+	for (auto typeIter = m_attributeAggregates.begin(); typeIter != m_attributeAggregates.end(); ++typeIter)
+	{
+		if ((activityType.size() > 0) && ((*typeIter).first.compare(activityType) != 0))
+		{
+			continue;
+		}
+
+		auto aggregateIter = (*typeIter).second.find(attribute);
+		if (aggregateIter == (*typeIter).second.end())
+		{
+			continue;
+		}
+
+		const AttributeAggregate& aggregate = (*aggregateIter).second;
+		const ActivityAttributeType& candidate = smallestIsBest ? aggregate.smallest : aggregate.largest;
+		const std::string& candidateId = smallestIsBest ? aggregate.smallestActivityId : aggregate.largestActivityId;
+
+		if (!result)
+		{
+			value = candidate;
+			activityId = candidateId;
+			result = true;
+		}
+		else if (value.valueType == candidate.valueType)
+		{
+			double bestVal = SummaryValueAsDouble(value);
+			double candidateVal = SummaryValueAsDouble(candidate);
+
+			if (smallestIsBest ? (candidateVal < bestVal) : (candidateVal > bestVal))
+			{
+				value = candidate;
+				activityId = candidateId;
+			}
+		}
+	}
+	return result;
+}
+
+bool Database::RetrieveLargestSummaryValue(const std::string& activityType, const std::string& attribute, time_t startTime, time_t endTime, double& value)
+{
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
+
+	if (sqlite3_prepare_v2(m_pDb, "select max(s.value) from activity a join activity_summary s on s.activity_id = a.activity_id and s.attribute = ? "
+		"where a.type = ? and a.start_time >= ? and a.start_time < ?", -1, &statement, 0) == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 2, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int64(statement, 3, startTime);
+		sqlite3_bind_int64(statement, 4, endTime);
+
+		// The max of no rows is null.
+		if ((sqlite3_step(statement) == SQLITE_ROW) && (sqlite3_column_type(statement, 0) != SQLITE_NULL))
+		{
+			value = sqlite3_column_double(statement, 0);
+			result = true;
+		}
+		sqlite3_finalize(statement);
+	}
+	return result;
+}
+
+bool Database::RetrieveSummaryValueTotal(const std::string& activityType, const std::string& attribute, time_t startTime, time_t endTime, double& total, uint64_t& count)
+{
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
+
+	if (sqlite3_prepare_v2(m_pDb, "select sum(s.value), count(s.value) from activity a join activity_summary s on s.activity_id = a.activity_id and s.attribute = ? "
+		"where a.type = ? and a.start_time >= ? and a.start_time < ?", -1, &statement, 0) == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 2, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int64(statement, 3, startTime);
+		sqlite3_bind_int64(statement, 4, endTime);
+
+		// The sum of no rows is null.
+		if ((sqlite3_step(statement) == SQLITE_ROW) && (sqlite3_column_type(statement, 0) != SQLITE_NULL))
+		{
+			total = sqlite3_column_double(statement, 0);
+			count = (uint64_t)sqlite3_column_int64(statement, 1);
+			result = true;
+		}
+		sqlite3_finalize(statement);
+	}
+	return result;
+}
+
+bool Database::LoadAttributeAggregates()
+{
+	sqlite3_stmt* statement = NULL;
+
+	m_attributeAggregates.clear();
+	m_attributeAggregatesLoaded = false;
+
+	if (sqlite3_prepare_v2(m_pDb, "select activity_type, attribute, value_type, measure_type, units, count, total, "
+		"smallest_value, smallest_start_time, smallest_end_time, smallest_activity_id, "
+		"largest_value, largest_start_time, largest_end_time, largest_activity_id from attribute_aggregate", -1, &statement, 0) == SQLITE_OK)
+	{
+		while (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			const char* activityType = (const char*)sqlite3_column_text(statement, 0);
+			const char* attribute = (const char*)sqlite3_column_text(statement, 1);
+			const char* smallestActivityId = (const char*)sqlite3_column_text(statement, 10);
+			const char* largestActivityId = (const char*)sqlite3_column_text(statement, 14);
+
+			if (!(activityType && attribute && smallestActivityId && largestActivityId))
+			{
+				continue;
+			}
+
+			AttributeAggregate aggregate;
+
+			aggregate.smallest.valueType = (ActivityAttributeValueType)sqlite3_column_int(statement, 2);
+			aggregate.smallest.measureType = (ActivityAttributeMeasureType)sqlite3_column_int(statement, 3);
+			aggregate.smallest.unitSystem = (UnitSystem)sqlite3_column_int(statement, 4);
+			aggregate.smallest.valid = true;
+			aggregate.largest = aggregate.smallest;
+			aggregate.count = (uint64_t)sqlite3_column_int64(statement, 5);
+			aggregate.total = sqlite3_column_double(statement, 6);
+
+			SetSummaryValueFromDouble(aggregate.smallest, sqlite3_column_double(statement, 7));
+			aggregate.smallest.startTime = (uint64_t)sqlite3_column_int64(statement, 8);
+			aggregate.smallest.endTime = (uint64_t)sqlite3_column_int64(statement, 9);
+			aggregate.smallestActivityId = smallestActivityId;
+
+			SetSummaryValueFromDouble(aggregate.largest, sqlite3_column_double(statement, 11));
+			aggregate.largest.startTime = (uint64_t)sqlite3_column_int64(statement, 12);
+			aggregate.largest.endTime = (uint64_t)sqlite3_column_int64(statement, 13);
+			aggregate.largestActivityId = largestActivityId;
+
+			m_attributeAggregates[activityType][attribute] = aggregate;
+		}
+
+		sqlite3_finalize(statement);
+		m_attributeAggregatesLoaded = true;
+	}
+	return m_attributeAggregatesLoaded;
+}
+
+// Recomputes every aggregate from the summary table. Only needed when upgrading a database that predates the aggregates.
+// Activities are visited in start time order so that ties go to the earliest activity, as they do when the records
+// are computed from the activity list.
+bool Database::RebuildAttributeAggregates()
+{
+	sqlite3_stmt* statement = NULL;
+
+	m_attributeAggregates.clear();
+	m_attributeAggregatesLoaded = false;
+
+	if (sqlite3_prepare_v2(m_pDb, "select a.type, s.activity_id, s.attribute, s.value, s.start_time, s.end_time, s.value_type, s.measure_type, s.units "
+		"from activity_summary s join activity a on a.activity_id = s.activity_id order by a.start_time, a.id", -1, &statement, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		const char* activityType = (const char*)sqlite3_column_text(statement, 0);
+		const char* activityId = (const char*)sqlite3_column_text(statement, 1);
+
+		if (!(activityType && activityId))
+		{
+			continue;
+		}
+
+		std::string attribute;
+		ActivityAttributeType value;
+
+		ReadSummaryDataRow(statement, 2, attribute, value);
+		if (!value.valid)
+		{
+			continue;
+		}
+
+		AttributeAggregateMap& aggregates = m_attributeAggregates[activityType];
+		auto aggregateIter = aggregates.find(attribute);
+		double doubleVal = SummaryValueAsDouble(value);
+
+		if (aggregateIter == aggregates.end())
+		{
+			AttributeAggregate aggregate;
+
+			aggregate.count = 1;
+			aggregate.total = doubleVal;
+			aggregate.smallest = value;
+			aggregate.smallestActivityId = activityId;
+			aggregate.largest = value;
+			aggregate.largestActivityId = activityId;
+			aggregates[attribute] = aggregate;
+		}
+		else
+		{
+			AttributeAggregate& aggregate = (*aggregateIter).second;
+
+			if (aggregate.smallest.valueType != value.valueType)
+			{
+				continue;
+			}
+
+			aggregate.count++;
+			aggregate.total += doubleVal;
+
+			if (doubleVal < SummaryValueAsDouble(aggregate.smallest))
+			{
+				aggregate.smallest = value;
+				aggregate.smallestActivityId = activityId;
+			}
+			if (doubleVal > SummaryValueAsDouble(aggregate.largest))
+			{
+				aggregate.largest = value;
+				aggregate.largestActivityId = activityId;
+			}
+		}
+	}
+	sqlite3_finalize(statement);
+
+	bool ownTransaction = !IsInTransaction();
+
+	if (ownTransaction && !BeginTransaction())
+	{
+		return false;
+	}
+
+	bool result = ExecuteQuery("delete from attribute_aggregate") == SQLITE_DONE;
+
+	for (auto typeIter = m_attributeAggregates.begin(); typeIter != m_attributeAggregates.end() && result; ++typeIter)
+	{
+		for (auto aggregateIter = (*typeIter).second.begin(); aggregateIter != (*typeIter).second.end() && result; ++aggregateIter)
+		{
+			result = WriteAttributeAggregate((*typeIter).first, (*aggregateIter).first, (*aggregateIter).second);
+		}
+	}
+
+	if (ownTransaction)
+	{
+		if (result)
+		{
+			result = CommitTransaction();
+		}
+		else
+		{
+			RollbackTransaction();
+		}
+	}
+
+	m_attributeAggregatesLoaded = result;
+	return result;
+}
+
+bool Database::AddToAttributeAggregate(const std::string& activityType, const std::string& activityId, const std::string& attribute, const ActivityAttributeType& value)
+{
+	DropStaleCaches();
+	if (!m_attributeAggregatesLoaded && !LoadAttributeAggregates())
+	{
+		return false;
+	}
+
+	AttributeAggregateMap& aggregates = m_attributeAggregates[activityType];
+	auto aggregateIter = aggregates.find(attribute);
+	double doubleVal = SummaryValueAsDouble(value);
+
+	if (aggregateIter == aggregates.end())
+	{
+		AttributeAggregate aggregate;
+
+		aggregate.count = 1;
+		aggregate.total = doubleVal;
+		aggregate.smallest = value;
+		aggregate.smallestActivityId = activityId;
+		aggregate.largest = value;
+		aggregate.largestActivityId = activityId;
+		aggregates[attribute] = aggregate;
+		return WriteAttributeAggregate(activityType, attribute, aggregate);
+	}
+
+	AttributeAggregate& aggregate = (*aggregateIter).second;
+
+	// Values of a different type than the ones already aggregated are ignored, same as when totaling the summaries.
+	if (aggregate.smallest.valueType != value.valueType)
+	{
+		return true;
+	}
+
+	aggregate.count++;
+	aggregate.total += doubleVal;
+
+	if (doubleVal < SummaryValueAsDouble(aggregate.smallest))
+	{
+		aggregate.smallest = value;
+		aggregate.smallestActivityId = activityId;
+	}
+	if (doubleVal > SummaryValueAsDouble(aggregate.largest))
+	{
+		aggregate.largest = value;
+		aggregate.largestActivityId = activityId;
+	}
+	return WriteAttributeAggregate(activityType, attribute, aggregate);
+}
+
+// Must be called after the value has been removed (or replaced) in the summary table, since the smallest and
+// largest values are searched for again if the activity being removed held either of them.
+bool Database::RemoveFromAttributeAggregate(const std::string& activityType, const std::string& activityId, const std::string& attribute, const ActivityAttributeType& value)
+{
+	DropStaleCaches();
+	if (!m_attributeAggregatesLoaded && !LoadAttributeAggregates())
+	{
+		return false;
+	}
+
+	auto typeIter = m_attributeAggregates.find(activityType);
+	if (typeIter == m_attributeAggregates.end())
+	{
+		return true;
+	}
+
+	AttributeAggregateMap& aggregates = (*typeIter).second;
+	auto aggregateIter = aggregates.find(attribute);
+	if (aggregateIter == aggregates.end())
+	{
+		return true;
+	}
+
+	AttributeAggregate& aggregate = (*aggregateIter).second;
+
+	if (aggregate.smallest.valueType != value.valueType)
+	{
+		return true;
+	}
+	if (aggregate.count <= 1)
+	{
+		aggregates.erase(aggregateIter);
+		return DeleteAttributeAggregate(activityType, attribute);
+	}
+
+	aggregate.count--;
+	aggregate.total -= SummaryValueAsDouble(value);
+
+	// There's at least one other value left, so failing to find one is an error. The cache is left modified,
+	// but the caller rolls back, which drops it.
+	bool result = true;
+	if (aggregate.smallestActivityId.compare(activityId) == 0)
+	{
+		result = RetrieveExtremeSummaryValue(activityType, attribute, value.valueType, true, aggregate.smallest, aggregate.smallestActivityId);
+	}
+	if (result && (aggregate.largestActivityId.compare(activityId) == 0))
+	{
+		result = RetrieveExtremeSummaryValue(activityType, attribute, value.valueType, false, aggregate.largest, aggregate.largestActivityId);
+	}
+	return result && WriteAttributeAggregate(activityType, attribute, aggregate);
+}
+
+bool Database::RetrieveExtremeSummaryValue(const std::string& activityType, const std::string& attribute, ActivityAttributeValueType valueType, bool smallest, ActivityAttributeType& value, std::string& activityId)
+{
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
+
+	std::string sql = "select s.attribute, s.value, s.start_time, s.end_time, s.value_type, s.measure_type, s.units, s.activity_id "
+		"from activity_summary s join activity a on a.activity_id = s.activity_id where a.type = ? and s.attribute = ? and s.value_type = ? order by s.value ";
+	sql += smallest ? "asc" : "desc";
+	sql += ", a.start_time, a.id limit 1";
+
+	if (sqlite3_prepare_v2(m_pDb, sql.c_str(), -1, &statement, 0) == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 2, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int(statement, 3, valueType);
+
+		if (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			std::string attributeName;
+			ActivityAttributeType rowValue;
+
+			ReadSummaryDataRow(statement, 0, attributeName, rowValue);
+			if (rowValue.valid)
+			{
+				value = rowValue;
+				activityId = (const char*)sqlite3_column_text(statement, 7);
+				result = true;
+			}
+		}
+
+		sqlite3_finalize(statement);
+	}
+	return result;
+}
+
+bool Database::WriteAttributeAggregate(const std::string& activityType, const std::string& attribute, const AttributeAggregate& aggregate)
+{
+	sqlite3_stmt* statement = NULL;
+
+	int result = sqlite3_prepare_v2(m_pDb, "insert into attribute_aggregate values (NULL,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 2, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int(statement, 3, aggregate.smallest.valueType);
+		sqlite3_bind_int(statement, 4, aggregate.smallest.measureType);
+		sqlite3_bind_int(statement, 5, aggregate.smallest.unitSystem);
+		sqlite3_bind_int64(statement, 6, aggregate.count);
+		sqlite3_bind_double(statement, 7, aggregate.total);
+		sqlite3_bind_double(statement, 8, SummaryValueAsDouble(aggregate.smallest));
+		sqlite3_bind_int64(statement, 9, aggregate.smallest.startTime);
+		sqlite3_bind_int64(statement, 10, aggregate.smallest.endTime);
+		sqlite3_bind_text(statement, 11, aggregate.smallestActivityId.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_double(statement, 12, SummaryValueAsDouble(aggregate.largest));
+		sqlite3_bind_int64(statement, 13, aggregate.largest.startTime);
+		sqlite3_bind_int64(statement, 14, aggregate.largest.endTime);
+		sqlite3_bind_text(statement, 15, aggregate.largestActivityId.c_str(), -1, SQLITE_TRANSIENT);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	return result == SQLITE_DONE;
+}
+
+bool Database::DeleteAttributeAggregate(const std::string& activityType, const std::string& attribute)
+{
+	sqlite3_stmt* statement = NULL;
+
+	int result = sqlite3_prepare_v2(m_pDb, "delete from attribute_aggregate where activity_type = ? and attribute = ?", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 2, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	return result == SQLITE_DONE;
+}
+
+typedef struct PersonalRecordAttribute
+{
+	const char* name;
+	bool        smallestIsBest;
+} PersonalRecordAttribute;
+
+typedef struct PersonalRecordBucket
+{
+	std::string activityType;
+	std::string attribute;
+	int         year;
+} PersonalRecordBucket;
+
+static const PersonalRecordAttribute g_personalRecordAttributes[] =
+{
+	{ ACTIVITY_ATTRIBUTE_FASTEST_400M, true },
+	{ ACTIVITY_ATTRIBUTE_FASTEST_KM, true },
+	{ ACTIVITY_ATTRIBUTE_FASTEST_MILE, true },
+	{ ACTIVITY_ATTRIBUTE_FASTEST_5K, true },
+	{ ACTIVITY_ATTRIBUTE_FASTEST_10K, true },
+	{ ACTIVITY_ATTRIBUTE_FASTEST_HALF_MARATHON, true },
+	{ ACTIVITY_ATTRIBUTE_FASTEST_MARATHON, true },
+	{ ACTIVITY_ATTRIBUTE_FASTEST_METRIC_CENTURY, true },
+	{ ACTIVITY_ATTRIBUTE_FASTEST_CENTURY, true },
+	{ ACTIVITY_ATTRIBUTE_FASTEST_PACE, true },
+	{ ACTIVITY_ATTRIBUTE_FASTEST_SPEED, false },
+	{ ACTIVITY_ATTRIBUTE_HIGHEST_3_SEC_POWER, false },
+	{ ACTIVITY_ATTRIBUTE_HIGHEST_20_MIN_POWER, false },
+	{ ACTIVITY_ATTRIBUTE_HIGHEST_1_HOUR_POWER, false },
+	{ ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, false },
+};
+
+// Records are bucketed by UTC year so the index doesn't depend on the device's time zone.
+static int PersonalRecordYear(time_t activityStartTime)
+{
+	struct tm startTm;
+
+	gmtime_r(&activityStartTime, &startTm);
+	return startTm.tm_year + 1900;
+}
+
+static time_t PersonalRecordYearStart(int year)
+{
+	struct tm startTm;
+
+	memset(&startTm, 0, sizeof(startTm));
+	startTm.tm_year = year - 1900;
+	startTm.tm_mday = 1;
+	return timegm(&startTm);
+}
+
+bool Database::IsPersonalRecordAttribute(const std::string& attribute, bool& smallestIsBest)
+{
+	for (size_t i = 0; i < sizeof(g_personalRecordAttributes) / sizeof(g_personalRecordAttributes[0]); ++i)
+	{
+		if (attribute.compare(g_personalRecordAttributes[i].name) == 0)
+		{
+			smallestIsBest = g_personalRecordAttributes[i].smallestIsBest;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Database::RetrievePersonalRecords(const std::string& activityType, const std::string& attribute, time_t startTime, time_t endTime, size_t maxRecords, PersonalRecordList& records)
+{
+	bool smallestIsBest = false;
+
+	if (!IsPersonalRecordAttribute(attribute, smallestIsBest))
+	{
+		return false;
+	}
+
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
+
+	std::string sql = "select activity_id, activity_start_time, attribute, value, start_time, end_time, value_type, measure_type, units from personal_record "
+		"where activity_type = ? and attribute = ? and activity_start_time >= ? and activity_start_time < ? order by value ";
+	sql += smallestIsBest ? "asc" : "desc";
+	sql += ", activity_start_time, id limit ?";
+
+	if (sqlite3_prepare_v2(m_pDb, sql.c_str(), -1, &statement, 0) == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 2, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int64(statement, 3, startTime);
+		sqlite3_bind_int64(statement, 4, endTime);
+		sqlite3_bind_int64(statement, 5, maxRecords);
+
+		while (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			PersonalRecord record;
+			std::string attributeName;
+
+			record.activityId = (const char*)sqlite3_column_text(statement, 0);
+			record.activityStartTime = (time_t)sqlite3_column_int64(statement, 1);
+			ReadSummaryDataRow(statement, 2, attributeName, record.value);
+			records.push_back(record);
+		}
+
+		sqlite3_finalize(statement);
+		result = true;
+	}
+	return result;
+}
+
+// Adds or replaces the activity's effort in its year's records. pOldValue is the value the activity had before,
+// if any, since an effort that got worse may need to give its place back to one that was trimmed earlier.
+bool Database::UpdatePersonalRecord(const std::string& activityType, const std::string& activityId, const std::string& attribute, const ActivityAttributeType& value, const ActivityAttributeType* pOldValue)
+{
+	bool smallestIsBest = false;
+
+	if (!IsPersonalRecordAttribute(attribute, smallestIsBest))
+	{
+		return true;
+	}
+
+	time_t activityStartTime = 0;
+	time_t activityEndTime = 0;
+
+	if (!RetrieveActivityStartAndEndTime(activityId, activityStartTime, activityEndTime))
+	{
+		return false;
+	}
+
+	int year = PersonalRecordYear(activityStartTime);
+
+	if (pOldValue && (pOldValue->valueType == value.valueType))
+	{
+		double oldVal = SummaryValueAsDouble(*pOldValue);
+		double newVal = SummaryValueAsDouble(value);
+
+		if (smallestIsBest ? (newVal > oldVal) : (newVal < oldVal))
+		{
+			return RefillPersonalRecords(activityType, attribute, year);
+		}
+	}
+
+	sqlite3_stmt* statement = NULL;
+
+	int result = sqlite3_prepare_v2(m_pDb, "insert into personal_record values (NULL,?,?,?,?,?,?,?,?,?,?,?)", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 2, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 3, activityId.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int64(statement, 4, activityStartTime);
+		sqlite3_bind_int(statement, 5, year);
+		sqlite3_bind_double(statement, 6, SummaryValueAsDouble(value));
+		sqlite3_bind_int64(statement, 7, value.startTime);
+		sqlite3_bind_int64(statement, 8, value.endTime);
+		sqlite3_bind_int(statement, 9, value.valueType);
+		sqlite3_bind_int(statement, 10, value.measureType);
+		sqlite3_bind_int(statement, 11, value.unitSystem);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	if (result != SQLITE_DONE)
+	{
+		return false;
+	}
+	return TrimPersonalRecords(activityType, attribute, year);
+}
+
+// Removes the activity's efforts, letting the next best efforts of the same years take their places.
+// Must be called after the activity's summary data has been deleted.
+bool Database::DeletePersonalRecords(const std::string& activityId)
+{
+	std::vector<PersonalRecordBucket> buckets;
+	sqlite3_stmt* statement = NULL;
+
+	if (sqlite3_prepare_v2(m_pDb, "select activity_type, attribute, year from personal_record where activity_id = ?", -1, &statement, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+
+	sqlite3_bind_text(statement, 1, activityId.c_str(), -1, SQLITE_TRANSIENT);
+
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		PersonalRecordBucket bucket;
+
+		bucket.activityType = (const char*)sqlite3_column_text(statement, 0);
+		bucket.attribute = (const char*)sqlite3_column_text(statement, 1);
+		bucket.year = sqlite3_column_int(statement, 2);
+		buckets.push_back(bucket);
+	}
+	sqlite3_finalize(statement);
+
+	bool result = true;
+
+	for (auto iter = buckets.begin(); iter != buckets.end() && result; ++iter)
+	{
+		result = RefillPersonalRecords((*iter).activityType, (*iter).attribute, (*iter).year);
+	}
+	return result;
+}
+
+// Recomputes one year's records for an activity type and attribute from the summary table.
+bool Database::RefillPersonalRecords(const std::string& activityType, const std::string& attribute, int year)
+{
+	bool smallestIsBest = false;
+
+	if (!IsPersonalRecordAttribute(attribute, smallestIsBest))
+	{
+		return false;
+	}
+
+	sqlite3_stmt* statement = NULL;
+
+	int result = sqlite3_prepare_v2(m_pDb, "delete from personal_record where activity_type = ? and attribute = ? and year = ?", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 2, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int(statement, 3, year);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	if (result != SQLITE_DONE)
+	{
+		return false;
+	}
+
+	std::string sql = "insert into personal_record select NULL, a.type, s.attribute, s.activity_id, a.start_time, ?, s.value, s.start_time, s.end_time, s.value_type, s.measure_type, s.units "
+		"from activity_summary s join activity a on a.activity_id = s.activity_id "
+		"where a.type = ? and s.attribute = ? and a.start_time >= ? and a.start_time < ? order by s.value ";
+	sql += smallestIsBest ? "asc" : "desc";
+	sql += ", a.start_time, a.id limit ?";
+
+	result = sqlite3_prepare_v2(m_pDb, sql.c_str(), -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_int(statement, 1, year);
+		sqlite3_bind_text(statement, 2, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 3, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int64(statement, 4, PersonalRecordYearStart(year));
+		sqlite3_bind_int64(statement, 5, PersonalRecordYearStart(year + 1));
+		sqlite3_bind_int(statement, 6, PERSONAL_RECORDS_PER_YEAR);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	return result == SQLITE_DONE;
+}
+
+// Drops whatever no longer makes the top PERSONAL_RECORDS_PER_YEAR for the year.
+bool Database::TrimPersonalRecords(const std::string& activityType, const std::string& attribute, int year)
+{
+	bool smallestIsBest = false;
+
+	if (!IsPersonalRecordAttribute(attribute, smallestIsBest))
+	{
+		return false;
+	}
+
+	sqlite3_stmt* statement = NULL;
+
+	std::string sql = "delete from personal_record where activity_type = ? and attribute = ? and year = ? and id not in "
+		"(select id from personal_record where activity_type = ? and attribute = ? and year = ? order by value ";
+	sql += smallestIsBest ? "asc" : "desc";
+	sql += ", activity_start_time, id limit ?)";
+
+	int result = sqlite3_prepare_v2(m_pDb, sql.c_str(), -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 2, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int(statement, 3, year);
+		sqlite3_bind_text(statement, 4, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 5, attribute.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int(statement, 6, year);
+		sqlite3_bind_int(statement, 7, PERSONAL_RECORDS_PER_YEAR);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	return result == SQLITE_DONE;
+}
+
+// Computes the records index from the summary table. Only needed when upgrading a database that predates it.
+bool Database::RebuildPersonalRecords()
+{
+	std::vector<PersonalRecordBucket> buckets;
+	sqlite3_stmt* statement = NULL;
+
+	if (sqlite3_prepare_v2(m_pDb, "select distinct a.type, s.attribute, cast(strftime('%Y', a.start_time, 'unixepoch') as integer) from activity_summary s join activity a on a.activity_id = s.activity_id", -1, &statement, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		const char* activityType = (const char*)sqlite3_column_text(statement, 0);
+		const char* attribute = (const char*)sqlite3_column_text(statement, 1);
+		bool smallestIsBest = false;
+
+		if (activityType && attribute && IsPersonalRecordAttribute(attribute, smallestIsBest))
+		{
+			PersonalRecordBucket bucket;
+
+			bucket.activityType = activityType;
+			bucket.attribute = attribute;
+			bucket.year = sqlite3_column_int(statement, 2);
+			buckets.push_back(bucket);
+		}
+	}
+	sqlite3_finalize(statement);
+
+	bool ownTransaction = !IsInTransaction();
+	bool result = true;
+
+	if (ownTransaction && !BeginTransaction())
+	{
+		return false;
+	}
+
+	for (auto iter = buckets.begin(); iter != buckets.end() && result; ++iter)
+	{
+		result = RefillPersonalRecords((*iter).activityType, (*iter).attribute, (*iter).year);
+	}
+
+	if (ownTransaction)
+	{
+		if (result)
+		{
+			result = CommitTransaction();
+		}
+		else
+		{
+			RollbackTransaction();
+		}
+	}
+	return result;
+}
+
+// Buckets are in UTC, like the personal records, so they don't move if the device's time zone changes.
+time_t Database::RollupBucketStart(RollupGranularity granularity, time_t time)
+{
+	struct tm bucketTm;
+
+	gmtime_r(&time, &bucketTm);
+	bucketTm.tm_hour = 0;
+	bucketTm.tm_min = 0;
+	bucketTm.tm_sec = 0;
+
+	switch (granularity)
+	{
+		case ROLLUP_WEEK:
+			bucketTm.tm_mday -= (bucketTm.tm_wday + 6) % 7; // back to Monday
+			break;
+		case ROLLUP_MONTH:
+			bucketTm.tm_mday = 1;
+			break;
+		case ROLLUP_YEAR:
+		case NUM_ROLLUP_GRANULARITIES:
+			bucketTm.tm_mday = 1;
+			bucketTm.tm_mon = 0;
+			break;
+	}
+	return timegm(&bucketTm);
+}
+
+bool Database::RetrieveActivityRollups(RollupGranularity granularity, const std::string& activityType, time_t startTime, time_t endTime, ActivityRollupList& rollups)
+{
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
+
+	std::string sql = "select bucket_start, activity_type, activity_count, distance, longest_distance, elapsed_time, calories, ascent, training_stress from activity_rollup "
+		"where granularity = ? and bucket_start >= ? and bucket_start < ?";
+	if (activityType.size() > 0)
+	{
+		sql += " and activity_type = ?";
+	}
+	sql += " order by bucket_start, activity_type";
+
+	if (sqlite3_prepare_v2(m_pDb, sql.c_str(), -1, &statement, 0) == SQLITE_OK)
+	{
+		sqlite3_bind_int(statement, 1, granularity);
+		sqlite3_bind_int64(statement, 2, RollupBucketStart(granularity, startTime));
+		sqlite3_bind_int64(statement, 3, endTime);
+		if (activityType.size() > 0)
+		{
+			sqlite3_bind_text(statement, 4, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		}
+
+		while (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			ActivityRollup rollup;
+
+			rollup.granularity = granularity;
+			rollup.bucketStart = (time_t)sqlite3_column_int64(statement, 0);
+			rollup.activityType = (const char*)sqlite3_column_text(statement, 1);
+			rollup.activityCount = (uint64_t)sqlite3_column_int64(statement, 2);
+			rollup.distance = sqlite3_column_double(statement, 3);
+			rollup.longestDistance = sqlite3_column_double(statement, 4);
+			rollup.elapsedTime = sqlite3_column_double(statement, 5);
+			rollup.calories = sqlite3_column_double(statement, 6);
+			rollup.ascent = sqlite3_column_double(statement, 7);
+			rollup.trainingStress = sqlite3_column_double(statement, 8);
+			rollups.push_back(rollup);
+		}
+
+		sqlite3_finalize(statement);
+		result = true;
+	}
+	return result;
+}
+
+// Adds the deltas to the week, month, and year that contain the activity. The delta's longest distance is a candidate
+// for the new longest, the longest is searched for again instead when the activity may have held it and got shorter.
+bool Database::AdjustActivityRollups(const std::string& activityType, time_t activityStartTime, int64_t activityCountDelta, const ActivityRollup& delta, bool recomputeLongest)
+{
+	bool result = true;
+
+	for (int granularity = ROLLUP_WEEK; granularity < NUM_ROLLUP_GRANULARITIES && result; ++granularity)
+	{
+		time_t bucketStart = RollupBucketStart((RollupGranularity)granularity, activityStartTime);
+		sqlite3_stmt* statement = NULL;
+
+		// The OR IGNORE overrides the table's ON CONFLICT REPLACE, so an existing bucket is left alone.
+		int status = sqlite3_prepare_v2(m_pDb, "insert or ignore into activity_rollup values (NULL,?,?,?,0,0,0,0,0,0,0)", -1, &statement, 0);
+		if (status == SQLITE_OK)
+		{
+			sqlite3_bind_int(statement, 1, granularity);
+			sqlite3_bind_int64(statement, 2, bucketStart);
+			sqlite3_bind_text(statement, 3, activityType.c_str(), -1, SQLITE_TRANSIENT);
+			status = sqlite3_step(statement);
+			sqlite3_finalize(statement);
+		}
+		if (status != SQLITE_DONE)
+		{
+			return false;
+		}
+
+		status = sqlite3_prepare_v2(m_pDb, "update activity_rollup set activity_count = activity_count + ?, distance = distance + ?, longest_distance = max(longest_distance, ?), "
+			"elapsed_time = elapsed_time + ?, calories = calories + ?, ascent = ascent + ?, training_stress = training_stress + ? "
+			"where granularity = ? and bucket_start = ? and activity_type = ?", -1, &statement, 0);
+		if (status == SQLITE_OK)
+		{
+			sqlite3_bind_int64(statement, 1, activityCountDelta);
+			sqlite3_bind_double(statement, 2, delta.distance);
+			sqlite3_bind_double(statement, 3, delta.longestDistance);
+			sqlite3_bind_double(statement, 4, delta.elapsedTime);
+			sqlite3_bind_double(statement, 5, delta.calories);
+			sqlite3_bind_double(statement, 6, delta.ascent);
+			sqlite3_bind_double(statement, 7, delta.trainingStress);
+			sqlite3_bind_int(statement, 8, granularity);
+			sqlite3_bind_int64(statement, 9, bucketStart);
+			sqlite3_bind_text(statement, 10, activityType.c_str(), -1, SQLITE_TRANSIENT);
+			status = sqlite3_step(statement);
+			sqlite3_finalize(statement);
+		}
+		if (status != SQLITE_DONE)
+		{
+			return false;
+		}
+
+		if (recomputeLongest)
+		{
+			result = RecomputeLongestDistance((RollupGranularity)granularity, bucketStart, activityType);
+		}
+	}
+	return result;
+}
+
+// Must be called after the activity's summary data has been deleted.
+bool Database::RemoveFromActivityRollups(const std::string& activityType, time_t activityStartTime, const SummaryAttributeMap& values)
+{
+	ActivityRollup delta;
+	bool recomputeLongest = false;
+
+	ClearActivityRollup(delta);
+
+	for (auto iter = values.begin(); iter != values.end(); ++iter)
+	{
+		std::string attribute = ActivityAttributeRegistry::Name((*iter).first);
+		double* pField = ActivityRollupField(delta, attribute);
+
+		if (pField)
+		{
+			(*pField) -= SummaryValueAsDouble((*iter).second);
+			recomputeLongest |= (pField == &delta.distance);
+		}
+	}
+
+	if (!AdjustActivityRollups(activityType, activityStartTime, -1, delta, recomputeLongest))
+	{
+		return false;
+	}
+
+	// Drop the buckets that no longer have any activities in them.
+	for (int granularity = ROLLUP_WEEK; granularity < NUM_ROLLUP_GRANULARITIES; ++granularity)
+	{
+		sqlite3_stmt* statement = NULL;
+
+		int result = sqlite3_prepare_v2(m_pDb, "delete from activity_rollup where granularity = ? and bucket_start = ? and activity_type = ? and activity_count <= 0", -1, &statement, 0);
+		if (result == SQLITE_OK)
+		{
+			sqlite3_bind_int(statement, 1, granularity);
+			sqlite3_bind_int64(statement, 2, RollupBucketStart((RollupGranularity)granularity, activityStartTime));
+			sqlite3_bind_text(statement, 3, activityType.c_str(), -1, SQLITE_TRANSIENT);
+			result = sqlite3_step(statement);
+			sqlite3_finalize(statement);
+		}
+		if (result != SQLITE_DONE)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Database::UpdateActivityRollups(const std::string& activityType, const std::string& activityId, const std::string& attribute, const ActivityAttributeType& value, const ActivityAttributeType* pOldValue)
+{
+	ActivityRollup delta;
+
+	ClearActivityRollup(delta);
+
+	double* pField = ActivityRollupField(delta, attribute);
+	if (pField == NULL)
+	{
+		return true;
+	}
+
+	time_t activityStartTime = 0;
+	time_t activityEndTime = 0;
+
+	if (!RetrieveActivityStartAndEndTime(activityId, activityStartTime, activityEndTime))
+	{
+		return false;
+	}
+
+	double newVal = SummaryValueAsDouble(value);
+	double oldVal = pOldValue ? SummaryValueAsDouble(*pOldValue) : (double)0.0;
+	bool recomputeLongest = false;
+
+	(*pField) = newVal - oldVal;
+	if (pField == &delta.distance)
+	{
+		delta.longestDistance = newVal;
+		recomputeLongest = newVal < oldVal;
+	}
+	return AdjustActivityRollups(activityType, activityStartTime, 0, delta, recomputeLongest);
+}
+
+bool Database::RecomputeLongestDistance(RollupGranularity granularity, time_t bucketStart, const std::string& activityType)
+{
+	sqlite3_stmt* statement = NULL;
+
+	int result = sqlite3_prepare_v2(m_pDb, "update activity_rollup set longest_distance = coalesce((select max(s.value) from activity_summary s join activity a on a.activity_id = s.activity_id "
+		"where a.type = ? and s.attribute = ? and a.start_time >= ? and a.start_time < ?), 0) "
+		"where granularity = ? and bucket_start = ? and activity_type = ?", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_text(statement, 1, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(statement, 2, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int64(statement, 3, bucketStart);
+		sqlite3_bind_int64(statement, 4, ActivityRollupBucketEnd(granularity, bucketStart));
+		sqlite3_bind_int(statement, 5, granularity);
+		sqlite3_bind_int64(statement, 6, bucketStart);
+		sqlite3_bind_text(statement, 7, activityType.c_str(), -1, SQLITE_TRANSIENT);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	return result == SQLITE_DONE;
+}
+
+// Computes the rollups from the activity and summary tables. Only needed when upgrading a database that predates them.
+bool Database::RebuildActivityRollups()
+{
+	typedef std::map<std::pair<time_t, std::string>, ActivityRollup> RollupBuckets; // keyed by bucket start and activity type
+
+	RollupBuckets buckets[NUM_ROLLUP_GRANULARITIES];
+	sqlite3_stmt* statement = NULL;
+
+	std::string sql = "select a.id, a.type, a.start_time, s.attribute, s.value from activity a left join activity_summary s on s.activity_id = a.activity_id and s.attribute in (";
+	for (size_t i = 0; i < sizeof(g_rollupAttributes) / sizeof(g_rollupAttributes[0]); ++i)
+	{
+		sql += (i == 0) ? "'" : ",'";
+		sql += g_rollupAttributes[i];
+		sql += "'";
+	}
+	sql += ") order by a.id";
+
+	if (sqlite3_prepare_v2(m_pDb, sql.c_str(), -1, &statement, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+
+	uint64_t currentRowId = 0;
+	bool haveCurrentRow = false;
+
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		uint64_t rowId = (uint64_t)sqlite3_column_int64(statement, 0);
+		const char* activityType = (const char*)sqlite3_column_text(statement, 1);
+		time_t activityStartTime = (time_t)sqlite3_column_int64(statement, 2);
+		const char* attribute = (const char*)sqlite3_column_text(statement, 3);
+		bool newActivity = !haveCurrentRow || (rowId != currentRowId);
+
+		if (activityType == NULL)
+		{
+			continue;
+		}
+
+		currentRowId = rowId;
+		haveCurrentRow = true;
+
+		for (int granularity = ROLLUP_WEEK; granularity < NUM_ROLLUP_GRANULARITIES; ++granularity)
+		{
+			time_t bucketStart = RollupBucketStart((RollupGranularity)granularity, activityStartTime);
+			std::pair<time_t, std::string> key(bucketStart, activityType);
+			auto bucketIter = buckets[granularity].find(key);
+
+			if (bucketIter == buckets[granularity].end())
+			{
+				ActivityRollup rollup;
+
+				ClearActivityRollup(rollup);
+				rollup.granularity = (RollupGranularity)granularity;
+				rollup.bucketStart = bucketStart;
+				rollup.activityType = activityType;
+				bucketIter = buckets[granularity].insert(std::make_pair(key, rollup)).first;
+			}
+
+			ActivityRollup& rollup = (*bucketIter).second;
+
+			if (newActivity)
+			{
+				rollup.activityCount++;
+			}
+			if (attribute)
+			{
+				double value = sqlite3_column_double(statement, 4);
+				double* pField = ActivityRollupField(rollup, attribute);
+
+				if (pField)
+				{
+					(*pField) += value;
+				}
+				if ((pField == &rollup.distance) && (value > rollup.longestDistance))
+				{
+					rollup.longestDistance = value;
+				}
+			}
+		}
+	}
+	sqlite3_finalize(statement);
+
+	bool ownTransaction = !IsInTransaction();
+
+	if (ownTransaction && !BeginTransaction())
 	{
-		sqlite3_bind_text(statement, 1, activityId.c_str(), -1, SQLITE_TRANSIENT);
+		return false;
+	}
 
-		while (sqlite3_step(statement) == SQLITE_ROW)
+	bool result = ExecuteQuery("delete from activity_rollup") == SQLITE_DONE;
+
+	for (int granularity = ROLLUP_WEEK; granularity < NUM_ROLLUP_GRANULARITIES && result; ++granularity)
+	{
+		for (auto bucketIter = buckets[granularity].begin(); bucketIter != buckets[granularity].end() && result; ++bucketIter)
 		{
-			std::string attributeName;
-			ActivityAttributeType value;
+			const ActivityRollup& rollup = (*bucketIter).second;
 
-			attributeName.append((const char*)sqlite3_column_text(statement, 2));
-			value.startTime = (u_int64_t)sqlite3_column_int64(statement, 4);
-			value.endTime = (u_int64_t)sqlite3_column_int64(statement, 5);
-			value.valueType = (ActivityAttributeValueType)sqlite3_column_int(statement, 6);
-			value.measureType = (ActivityAttributeMeasureType)sqlite3_column_int(statement, 7);
-			value.unitSystem = (UnitSystem)sqlite3_column_int(statement, 8);
-			
-			switch (value.valueType)
+			int status = sqlite3_prepare_v2(m_pDb, "insert into activity_rollup values (NULL,?,?,?,?,?,?,?,?,?,?)", -1, &statement, 0);
+			if (status == SQLITE_OK)
 			{
-				case TYPE_DOUBLE:
-					value.value.doubleVal = sqlite3_column_double(statement, 3);
-					value.valid = true;
-					break;
-				case TYPE_INTEGER:
-					value.value.intVal = sqlite3_column_double(statement, 3);
-					value.valid = true;
-					break;
-				case TYPE_TIME:
-					value.value.timeVal = sqlite3_column_double(statement, 3);
-					value.valid = true;
-					break;
-				case TYPE_NOT_SET:
-					value.valid = false;
-					break;
+				sqlite3_bind_int(statement, 1, rollup.granularity);
+				sqlite3_bind_int64(statement, 2, rollup.bucketStart);
+				sqlite3_bind_text(statement, 3, rollup.activityType.c_str(), -1, SQLITE_TRANSIENT);
+				sqlite3_bind_int64(statement, 4, rollup.activityCount);
+				sqlite3_bind_double(statement, 5, rollup.distance);
+				sqlite3_bind_double(statement, 6, rollup.longestDistance);
+				sqlite3_bind_double(statement, 7, rollup.elapsedTime);
+				sqlite3_bind_double(statement, 8, rollup.calories);
+				sqlite3_bind_double(statement, 9, rollup.ascent);
+				sqlite3_bind_double(statement, 10, rollup.trainingStress);
+				status = sqlite3_step(statement);
+				sqlite3_finalize(statement);
 			}
-			values[attributeName] = value;
+			result = (status == SQLITE_DONE);
+		}
+	}
+
+	if (ownTransaction)
+	{
+		if (result)
+		{
+			result = CommitTransaction();
+		}
+		else
+		{
+			RollbackTransaction();
 		}
-		
-		sqlite3_finalize(statement);
-		result = true;
 	}
 	return result;
 }
 
+// Carries the loads forward from one day to a later one, the days in between having no training stress.
+static void AdvanceTrainingLoad(double& chronicLoad, double& acuteLoad, time_t fromDay, time_t toDay, double stress)
+{
+	double restDays = (double)((toDay - fromDay) / SECS_PER_DAY) - 1.0;
+
+	if (restDays > 0.0)
+	{
+		chronicLoad *= pow(1.0 - (1.0 / TRAINING_LOAD_CHRONIC_DAYS), restDays);
+		acuteLoad *= pow(1.0 - (1.0 / TRAINING_LOAD_ACUTE_DAYS), restDays);
+	}
+	chronicLoad += (stress - chronicLoad) / TRAINING_LOAD_CHRONIC_DAYS;
+	acuteLoad += (stress - acuteLoad) / TRAINING_LOAD_ACUTE_DAYS;
+}
+
+time_t Database::TrainingLoadDay(time_t time)
+{
+	return time - (time % SECS_PER_DAY);
+}
+
+bool Database::RetrieveTrainingLoads(time_t startTime, time_t endTime, TrainingLoadList& loads)
+{
+	time_t startDay = TrainingLoadDay(startTime);
+	time_t lastDay = 0;
+	bool haveLastDay = false;
+	double chronicLoad = (double)0.0;
+	double acuteLoad = (double)0.0;
+	TrainingLoadList storedLoads;
+	sqlite3_stmt* statement = NULL;
+
+	// One entry is made for every day, so an open ended range (e.g. everything up to INT64_MAX) has to be cut short.
+	if ((endTime > startDay) && ((endTime - startDay) / SECS_PER_DAY > TRAINING_LOAD_MAX_DAYS))
+	{
+		endTime = startDay + (time_t)TRAINING_LOAD_MAX_DAYS * SECS_PER_DAY;
+	}
+
+	// The loads going into the time range come from the last day before it that had any training stress.
+	if (sqlite3_prepare_v2(m_pDb, "select day, chronic_load, acute_load from training_load where day < ? order by day desc limit 1", -1, &statement, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+	sqlite3_bind_int64(statement, 1, startDay);
+	if (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		lastDay = (time_t)sqlite3_column_int64(statement, 0);
+		chronicLoad = sqlite3_column_double(statement, 1);
+		acuteLoad = sqlite3_column_double(statement, 2);
+		haveLastDay = true;
+	}
+	sqlite3_finalize(statement);
+
+	if (sqlite3_prepare_v2(m_pDb, "select day, stress, chronic_load, acute_load from training_load where day >= ? and day < ? order by day", -1, &statement, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+	sqlite3_bind_int64(statement, 1, startDay);
+	sqlite3_bind_int64(statement, 2, endTime);
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		TrainingLoad load;
+
+		load.day = (time_t)sqlite3_column_int64(statement, 0);
+		load.stress = sqlite3_column_double(statement, 1);
+		load.chronicLoad = sqlite3_column_double(statement, 2);
+		load.acuteLoad = sqlite3_column_double(statement, 3);
+		storedLoads.push_back(load);
+	}
+	sqlite3_finalize(statement);
+
+	// Fill in the days that had no training stress.
+	auto storedIter = storedLoads.begin();
+
+	for (time_t day = startDay; day < endTime; day += SECS_PER_DAY)
+	{
+		TrainingLoad load;
+
+		if ((storedIter != storedLoads.end()) && ((*storedIter).day == day))
+		{
+			load = (*storedIter);
+			++storedIter;
+		}
+		else
+		{
+			if (haveLastDay)
+			{
+				AdvanceTrainingLoad(chronicLoad, acuteLoad, lastDay, day, (double)0.0);
+			}
+			load.day = day;
+			load.stress = (double)0.0;
+			load.chronicLoad = chronicLoad;
+			load.acuteLoad = acuteLoad;
+		}
+
+		lastDay = day;
+		haveLastDay = true;
+		chronicLoad = load.chronicLoad;
+		acuteLoad = load.acuteLoad;
+		loads.push_back(load);
+	}
+	return true;
+}
+
+// Adds the change in an activity's training stress to the day it started on. The loads of that day and the days after it
+// are recomputed now, or when the transaction is committed so that saving many activities only does it once.
+bool Database::AdjustTrainingLoad(time_t activityStartTime, double stressDelta)
+{
+	if (stressDelta == (double)0.0)
+	{
+		return true;
+	}
+
+	time_t day = TrainingLoadDay(activityStartTime);
+	sqlite3_stmt* statement = NULL;
+
+	// The OR IGNORE overrides the table's ON CONFLICT REPLACE, so an existing day is left alone.
+	int result = sqlite3_prepare_v2(m_pDb, "insert or ignore into training_load values (NULL,?,0,0,0)", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_int64(statement, 1, day);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	if (result != SQLITE_DONE)
+	{
+		return false;
+	}
+
+	result = sqlite3_prepare_v2(m_pDb, "update training_load set stress = stress + ? where day = ?", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_double(statement, 1, stressDelta);
+		sqlite3_bind_int64(statement, 2, day);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	if (result != SQLITE_DONE)
+	{
+		return false;
+	}
+
+	// A day whose activities have all been deleted is the same as a day that never had any.
+	result = sqlite3_prepare_v2(m_pDb, "delete from training_load where day = ? and abs(stress) < 0.0001", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_int64(statement, 1, day);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	if (result != SQLITE_DONE)
+	{
+		return false;
+	}
+
+	if (IsInTransaction())
+	{
+		if (!m_trainingLoadStale || (day < m_trainingLoadStaleFrom))
+		{
+			m_trainingLoadStaleFrom = day;
+		}
+		m_trainingLoadStale = true;
+		return true;
+	}
+	return RecomputeTrainingLoads(day);
+}
+
+bool Database::UpdateTrainingLoad(const std::string& activityId, const std::string& attribute, const ActivityAttributeType& value, const ActivityAttributeType* pOldValue)
+{
+	if (attribute.compare(ACTIVITY_ATTRIBUTE_TRAINING_STRESS) != 0)
+	{
+		return true;
+	}
+
+	time_t activityStartTime = 0;
+	time_t activityEndTime = 0;
+
+	if (!RetrieveActivityStartAndEndTime(activityId, activityStartTime, activityEndTime))
+	{
+		return false;
+	}
+
+	double oldVal = pOldValue ? SummaryValueAsDouble(*pOldValue) : (double)0.0;
+	return AdjustTrainingLoad(activityStartTime, SummaryValueAsDouble(value) - oldVal);
+}
+
+// Must be called after the activity's summary data has been deleted.
+bool Database::RemoveFromTrainingLoad(time_t activityStartTime, const SummaryAttributeMap& values)
+{
+	const ActivityAttributeType* pStress = values.Find(ACTIVITY_ATTRIBUTE_TRAINING_STRESS);
+
+	if (pStress == NULL)
+	{
+		return true;
+	}
+	return AdjustTrainingLoad(activityStartTime, -SummaryValueAsDouble(*pStress));
+}
+
+// Recomputes the loads of the given day and every stored day after it. The days before it are unaffected.
+bool Database::RecomputeTrainingLoads(time_t fromDay)
+{
+	TrainingLoadList loads;
+	time_t lastDay = 0;
+	bool haveLastDay = false;
+	double chronicLoad = (double)0.0;
+	double acuteLoad = (double)0.0;
+	sqlite3_stmt* statement = NULL;
+
+	if (sqlite3_prepare_v2(m_pDb, "select day, chronic_load, acute_load from training_load where day < ? order by day desc limit 1", -1, &statement, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+	sqlite3_bind_int64(statement, 1, fromDay);
+	if (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		lastDay = (time_t)sqlite3_column_int64(statement, 0);
+		chronicLoad = sqlite3_column_double(statement, 1);
+		acuteLoad = sqlite3_column_double(statement, 2);
+		haveLastDay = true;
+	}
+	sqlite3_finalize(statement);
+
+	if (sqlite3_prepare_v2(m_pDb, "select day, stress from training_load where day >= ? order by day", -1, &statement, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+	sqlite3_bind_int64(statement, 1, fromDay);
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		TrainingLoad load;
+
+		load.day = (time_t)sqlite3_column_int64(statement, 0);
+		load.stress = sqlite3_column_double(statement, 1);
+		AdvanceTrainingLoad(chronicLoad, acuteLoad, haveLastDay ? lastDay : load.day - SECS_PER_DAY, load.day, load.stress);
+		load.chronicLoad = chronicLoad;
+		load.acuteLoad = acuteLoad;
+		loads.push_back(load);
+
+		lastDay = load.day;
+		haveLastDay = true;
+	}
+	sqlite3_finalize(statement);
+
+	if (loads.size() == 0)
+	{
+		return true;
+	}
+
+	bool ownTransaction = !IsInTransaction();
+
+	if (ownTransaction && !BeginTransaction())
+	{
+		return false;
+	}
+
+	int result = sqlite3_prepare_v2(m_pDb, "update training_load set chronic_load = ?, acute_load = ? where day = ?", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		result = SQLITE_DONE;
+
+		for (auto iter = loads.begin(); iter != loads.end() && result == SQLITE_DONE; ++iter)
+		{
+			sqlite3_bind_double(statement, 1, (*iter).chronicLoad);
+			sqlite3_bind_double(statement, 2, (*iter).acuteLoad);
+			sqlite3_bind_int64(statement, 3, (*iter).day);
+			result = sqlite3_step(statement);
+			sqlite3_reset(statement);
+		}
+		sqlite3_finalize(statement);
+	}
+
+	if (ownTransaction)
+	{
+		if (result == SQLITE_DONE)
+		{
+			return CommitTransaction();
+		}
+		RollbackTransaction();
+	}
+	return result == SQLITE_DONE;
+}
+
+// Computes the training loads from the activity and summary tables. Only needed when upgrading a database that predates them.
+bool Database::RebuildTrainingLoads()
+{
+	sqlite3_stmt* statement = NULL;
+
+	int result = sqlite3_prepare_v2(m_pDb, "insert into training_load (day, stress, chronic_load, acute_load) "
+		"select a.start_time - (a.start_time % ?), sum(s.value), 0, 0 from activity a join activity_summary s on s.activity_id = a.activity_id "
+		"where s.attribute = ? group by 1", -1, &statement, 0);
+	if (result == SQLITE_OK)
+	{
+		sqlite3_bind_int64(statement, 1, SECS_PER_DAY);
+		sqlite3_bind_text(statement, 2, ACTIVITY_ATTRIBUTE_TRAINING_STRESS, -1, SQLITE_TRANSIENT);
+		result = sqlite3_step(statement);
+		sqlite3_finalize(statement);
+	}
+	if (result != SQLITE_DONE)
+	{
+		return false;
+	}
+	return RecomputeTrainingLoads(0);
+}
+
 bool Database::CreateActivityHash(const std::string& activityId, const std::string& hash)
 {
 	sqlite3_stmt* statement = NULL;
@@ -1444,6 +3787,7 @@ bool Database::UpdateActivityHash(const std::string& activityId, const std::stri
 
 bool Database::CreateWeightMeasurement(time_t measurementTime, double weightKg)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
 	int result = SQLITE_ERROR;
 	sqlite3_stmt* statement = NULL;
 	
@@ -1455,46 +3799,107 @@ bool Database::CreateWeightMeasurement(time_t measurementTime, double weightKg)
 		result = sqlite3_step(statement);
 		sqlite3_finalize(statement);
 	}
+
+	// The cached timeline is reloaded on the next lookup.
+	m_weightTimeline.clear();
+	m_weightTimelineLoaded = false;
+
 	return result == SQLITE_DONE;
 }
 
-bool Database::RetrieveNearestWeightMeasurement(time_t measurementTime, double& weightKg)
+// Other connections (the sensor writer, the reprocessor) write to the same file. A commit by any of them changes
+// the data version, in which case the caches may no longer match the tables and are reloaded on their next use.
+// Commits on this connection don't change it, and neither do uncommitted changes, which the caches already include.
+void Database::DropStaleCaches()
 {
-	bool result = false;
-	sqlite3_stmt* statement = NULL;
+	if (!m_pDataVersionStatement && (sqlite3_prepare_v2(m_pDb, "pragma data_version", -1, &m_pDataVersionStatement, 0) != SQLITE_OK))
+	{
+		return;
+	}
 
-	if (sqlite3_prepare_v2(m_pDb, "select id, time, value from weight order by time asc", -1, &statement, 0) == SQLITE_OK)
+	if (sqlite3_step(m_pDataVersionStatement) == SQLITE_ROW)
 	{
-		uint64_t currentTime = 0;
-		uint64_t lastTime = 0;
-		
-		double currentWeight = (double)0.0;
-		double lastWeight = (double)0.0;
+		int64_t dataVersion = sqlite3_column_int64(m_pDataVersionStatement, 0);
 
-		while ((sqlite3_step(statement) == SQLITE_ROW) && (currentTime < measurementTime))
+		if (dataVersion != m_dataVersion)
 		{
-			lastTime = currentTime;
-			lastWeight = currentWeight;
-			currentTime = (u_int64_t)sqlite3_column_int64(statement, 1);
-			currentWeight = sqlite3_column_double(statement, 2);
+			m_dataVersion = dataVersion;
+			m_weightTimeline.clear();
+			m_weightTimelineLoaded = false;
+			m_attributeAggregates.clear();
+			m_attributeAggregatesLoaded = false;
 		}
+	}
+	sqlite3_reset(m_pDataVersionStatement);
+}
+
+bool Database::LoadWeightTimeline()
+{
+	sqlite3_stmt* statement = NULL;
 
-		if (currentTime > 0)
+	m_weightTimeline.clear();
+	m_weightTimelineLoaded = false;
+
+	if (sqlite3_prepare_v2(m_pDb, "select time, value from weight order by time asc", -1, &statement, 0) == SQLITE_OK)
+	{
+		while (sqlite3_step(statement) == SQLITE_ROW)
 		{
-			if (lastTime == 0)
-			{
-				weightKg = currentWeight;
-			}
-			else
-			{
-				weightKg = lastWeight + (currentWeight - lastWeight) * (measurementTime - lastTime) / (currentTime - lastTime);
-			}
-			result = true;
+			WeightMeasurement measurement;
+
+			measurement.time = (time_t)sqlite3_column_int64(statement, 0);
+			measurement.weightKg = sqlite3_column_double(statement, 1);
+			m_weightTimeline.push_back(measurement);
 		}
 
 		sqlite3_finalize(statement);
+		m_weightTimelineLoaded = true;
 	}
-	return result;
+	return m_weightTimelineLoaded;
+}
+
+static bool WeightMeasurementTimeLessThan(const WeightMeasurement& measurement, time_t measurementTime) { return measurement.time < measurementTime; }
+
+// Interpolates between the measurements on either side of the given time. Uses the nearest measurement when
+// the time is before the first one, and extends the trend of the last two when it is after the last one.
+bool Database::RetrieveNearestWeightMeasurement(time_t measurementTime, double& weightKg)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_cacheMutex);
+	DropStaleCaches();
+	if (!m_weightTimelineLoaded && !LoadWeightTimeline())
+	{
+		return false;
+	}
+	if (m_weightTimeline.size() == 0)
+	{
+		return false;
+	}
+
+	auto currentIter = std::lower_bound(m_weightTimeline.begin(), m_weightTimeline.end(), measurementTime, WeightMeasurementTimeLessThan);
+	if (currentIter == m_weightTimeline.end())
+	{
+		--currentIter;
+	}
+
+	const WeightMeasurement& current = (*currentIter);
+
+	if (currentIter == m_weightTimeline.begin())
+	{
+		weightKg = current.weightKg;
+	}
+	else
+	{
+		const WeightMeasurement& last = *(currentIter - 1);
+
+		if (current.time == last.time)
+		{
+			weightKg = current.weightKg;
+		}
+		else
+		{
+			weightKg = last.weightKg + (current.weightKg - last.weightKg) * (double)(measurementTime - last.time) / (double)(current.time - last.time);
+		}
+	}
+	return true;
 }
 
 bool Database::RetrieveNewestWeightMeasurement(time_t& measurementTime, double& weightKg)
@@ -1711,6 +4116,40 @@ bool Database::ProcessAllCoordinates(coordinateCallback callback, void* context)
 	return result;
 }
 
+bool Database::ProcessActivityPositionReadings(const std::string& activityId, sensorReadingCallback callback, void* context)
+{
+	bool result = false;
+	sqlite3_stmt* statement = NULL;
+
+	if (sqlite3_prepare_v2(m_pDb, "select time,latitude,longitude,altitude from gps where activity_id = ?", -1, &statement, 0) == SQLITE_OK)
+	{
+		if (sqlite3_bind_text(statement, 1, activityId.c_str(), -1, SQLITE_TRANSIENT) == SQLITE_OK)
+		{
+			result = true;
+
+			while (result && (sqlite3_step(statement) == SQLITE_ROW))
+			{
+				SensorReading reading;
+
+				reading.type = SENSOR_TYPE_LOCATION;
+				reading.time = sqlite3_column_int64(statement, 0);
+
+				double latitude  = sqlite3_column_double(statement, 1);
+				double longitude = sqlite3_column_double(statement, 2);
+				double altitude  = sqlite3_column_double(statement, 3);
+
+				reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_LATITUDE, latitude));
+				reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_LONGITUDE, longitude));
+				reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_ALTITUDE, altitude));
+
+				result = callback(reading, context);
+			}
+		}
+		sqlite3_finalize(statement);
+	}
+	return result;
+}
+
 bool Database::CreateSensorReading(const std::string& activityId, const SensorReading& reading)
 {
 	switch (reading.type)
@@ -2308,12 +4747,17 @@ int Database::ExecuteQuery(const std::string& query)
 	return result;
 }
 
+// Stops at the first query that fails and returns its result.
 int Database::ExecuteQueries(const std::vector<std::string>& queries)
 {
 	int result = SQLITE_OK;
 	for (auto iter = queries.begin(); iter != queries.end(); ++iter)
 	{
 		result = ExecuteQuery((*iter));
+		if (result != SQLITE_OK && result != SQLITE_DONE)
+		{
+			break;
+		}
 	}
 	return result;
 }
@@ -8,6 +8,8 @@
 #ifndef __DATABASE__
 #define __DATABASE__
 
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <sstream>
 #include <sqlite3.h>
@@ -25,6 +27,84 @@
 #include "Shoes.h"
 #include "Workout.h"
 
+#define DATABASE_BUSY_TIMEOUT_MS 5000                // How long a connection waits for another connection to release its lock
+#define DATABASE_MMAP_SIZE       (64 * 1024 * 1024)  // Bytes of the database file each connection may memory map
+#define DATABASE_CACHE_SIZE_KB   8192                // Page cache per connection
+
+typedef struct WeightMeasurement
+{
+	time_t time;
+	double weightKg;
+} WeightMeasurement;
+
+typedef struct ActivityPageCursor
+{
+	bool     valid;     // False until the first page has been read
+	time_t   startTime; // Start time of the last activity returned
+	uint64_t rowId;     // Row of the last activity returned, breaks ties between activities with the same start time
+} ActivityPageCursor;
+
+typedef struct AttributeAggregate
+{
+	uint64_t              count;              // Number of activities that have the attribute
+	double                total;              // Sum of the attribute over those activities
+	ActivityAttributeType smallest;           // Smallest value, also supplies the value, measure, and unit types
+	std::string           smallestActivityId; // Activity the smallest value came from
+	ActivityAttributeType largest;            // Largest value
+	std::string           largestActivityId;  // Activity the largest value came from
+} AttributeAggregate;
+
+typedef std::unordered_map<std::string, AttributeAggregate> AttributeAggregateMap; // Keyed by attribute name
+
+#define PERSONAL_RECORDS_PER_YEAR 10 // Number of efforts kept per activity type, attribute, and (UTC) calendar year
+
+typedef struct PersonalRecord
+{
+	std::string           activityId;
+	time_t                activityStartTime;
+	ActivityAttributeType value;             // The start and end times are those of the segment, where the attribute has one
+} PersonalRecord;
+
+typedef std::vector<PersonalRecord> PersonalRecordList;
+
+typedef enum RollupGranularity
+{
+	ROLLUP_WEEK = 0, // Weeks start on Monday
+	ROLLUP_MONTH,
+	ROLLUP_YEAR,
+	NUM_ROLLUP_GRANULARITIES
+} RollupGranularity;
+
+typedef struct ActivityRollup
+{
+	RollupGranularity granularity;
+	time_t            bucketStart;     // UTC start of the week, month, or year
+	std::string       activityType;
+	uint64_t          activityCount;
+	double            distance;        // Sum of the summary values of the same name, in the units they were saved in
+	double            longestDistance;
+	double            elapsedTime;     // Seconds
+	double            calories;
+	double            ascent;
+	double            trainingStress;
+} ActivityRollup;
+
+typedef std::vector<ActivityRollup> ActivityRollupList;
+
+#define TRAINING_LOAD_CHRONIC_DAYS 42 // Time constant of the chronic training load (fitness)
+#define TRAINING_LOAD_ACUTE_DAYS   7  // Time constant of the acute training load (fatigue)
+#define TRAINING_LOAD_MAX_DAYS     3660 // Most days returned by one query, about ten years
+
+typedef struct TrainingLoad
+{
+	time_t day;         // UTC start of the day
+	double stress;      // Sum of the training stress of the activities that started that day
+	double chronicLoad; // Exponentially weighted averages of the daily stress, up to and including this day
+	double acuteLoad;   // The stress balance (form) is the chronic load minus the acute load
+} TrainingLoad;
+
+typedef std::vector<TrainingLoad> TrainingLoadList;
+
 class Database
 {
 public:
@@ -32,8 +112,27 @@ public:
 	virtual ~Database();
 
 	bool Open(const std::string& dbFileName);
+	bool OpenReadOnly(const std::string& dbFileName);
 	bool Close();
 
+	const std::string& GetFileName() const { return m_fileName; };
+
+	/// Normally a commit is safe from a crash of the app but not of the OS. Durable commits are also synced to storage.
+	bool SetDurableCommits(bool durable);
+
+	// Methods for grouping writes. Transactions do not nest, use IsInTransaction to check for an outer transaction.
+
+	bool BeginTransaction();
+	bool CommitTransaction();
+	bool RollbackTransaction();
+	bool IsInTransaction() const;
+
+	/// The result code of the most recent call on this connection that failed, SQLITE_OK if it succeeded.
+	int GetLastErrorCode() const;
+
+	/// True for errors that go away if the operation is tried again later, i.e. another connection holding a lock.
+	static bool IsTransientError(int errorCode);
+
 	bool CreateTables();
 	bool Reset();
 
@@ -96,6 +195,7 @@ public:
 	bool DeleteActivity(const std::string& activityId);
 	bool RetrieveActivity(const std::string& activityId, ActivitySummary& summary);
 	bool RetrieveActivities(ActivitySummaryList& activities);
+	bool RetrieveActivityPage(ActivityPageCursor& cursor, size_t maxActivities, bool newestFirst, ActivitySummaryList& activities);
 	bool MergeActivities(const std::string& activityId1, const std::string& activityId2);
 
 	bool RetrieveActivityStartAndEndTime(const std::string& activityId, time_t& startTime, time_t& endTime);
@@ -118,7 +218,51 @@ public:
 	// Methods for creating and retrieving summary data. Delete is handled by DeleteActivity.
 
 	bool CreateSummaryData(const std::string& activityId, const std::string& attribute, ActivityAttributeType value);
-	bool RetrieveSummaryData(const std::string& activityId, ActivityAttributeMap& values);
+	bool CreateSummaryData(const std::string& activityId, const SummaryAttributeMap& values);
+	bool CreateSummaryData(const ActivitySummaryList& activities);
+	bool RetrieveSummaryData(const std::string& activityId, SummaryAttributeMap& values);
+	bool RetrieveAllSummaryData(ActivitySummaryList& activities);
+
+	// Methods for tracking which version of the summary algorithms produced each activity's summary data, so that
+	// reprocessing can skip activities that are already up to date and resume where it left off.
+
+	bool UpdateSummaryVersion(const std::string& activityId, uint32_t version);
+	bool RetrieveActivitiesWithOldSummaries(uint32_t version, ActivitySummaryList& activities);
+	bool HasActivitiesWithOldSummaries(uint32_t version);
+	bool DeleteSummaryVersions(void);
+
+	// Methods for reading lifetime totals and records. These are maintained as summary data is written and deleted,
+	// so they don't require any activity summaries to be loaded. An empty activity type means all activity types.
+
+	bool RetrieveAttributeTotal(const std::string& activityType, const std::string& attribute, ActivityAttributeType& total);
+	bool RetrieveBestAttributeValue(const std::string& activityType, const std::string& attribute, bool smallestIsBest, ActivityAttributeType& value, std::string& activityId);
+
+	// Methods for reading summary values over a time range. These use the activity table's (type, start time) index,
+	// so they don't require any activity summaries to be loaded. Returns false if no activity in the range has the attribute.
+
+	bool RetrieveLargestSummaryValue(const std::string& activityType, const std::string& attribute, time_t startTime, time_t endTime, double& value);
+	bool RetrieveSummaryValueTotal(const std::string& activityType, const std::string& attribute, time_t startTime, time_t endTime, double& total, uint64_t& count);
+
+	// Methods for reading the personal records index, the best efforts (fastest 5K, highest 20 minute power, etc.)
+	// of each activity type. The best PERSONAL_RECORDS_PER_YEAR efforts of each year are kept, so the results are
+	// exact for time ranges made up of whole years. Records are listed best first.
+
+	static bool IsPersonalRecordAttribute(const std::string& attribute, bool& smallestIsBest);
+	bool RetrievePersonalRecords(const std::string& activityType, const std::string& attribute, time_t startTime, time_t endTime, size_t maxRecords, PersonalRecordList& records);
+
+	// Methods for reading the weekly, monthly, and yearly rollups. These are maintained as activities are created and
+	// deleted and as their summary data is written. Returns the buckets that overlap the given time range, oldest first.
+	// An empty activity type means all activity types, with one rollup per type per bucket.
+
+	static time_t RollupBucketStart(RollupGranularity granularity, time_t time);
+	bool RetrieveActivityRollups(RollupGranularity granularity, const std::string& activityType, time_t startTime, time_t endTime, ActivityRollupList& rollups);
+
+	// Methods for reading the daily training load. Only the days with training stress are stored, and when an activity's
+	// stress changes only the days from then on are updated (once per transaction). Returns every day in the time range,
+	// up to TRAINING_LOAD_MAX_DAYS of them counting from the start.
+
+	static time_t TrainingLoadDay(time_t time);
+	bool RetrieveTrainingLoads(time_t startTime, time_t endTime, TrainingLoadList& loads);
 
 	// Methods for managing activity hashes.
 
@@ -138,6 +282,11 @@ public:
 	typedef void (*coordinateCallback)(uint64_t time, double latitude, double longitude, double altitude, void* context);
 	bool ProcessAllCoordinates(coordinateCallback callback, void* context);
 
+	/// Hands the activity's locations to the callback as each row is read, rather than reading them into a list first.
+	/// Stops, and returns false, if the callback returns false.
+	typedef bool (*sensorReadingCallback)(const SensorReading& reading, void* context);
+	bool ProcessActivityPositionReadings(const std::string& activityId, sensorReadingCallback callback, void* context);
+
 	bool CreateSensorReading(const std::string& activityId, const SensorReading& reading);
 	bool RetrieveSensorReadingsOfType(const std::string& activityId, SensorType type, SensorReadingList& readings);
 	bool RetrieveActivityCoordinates(const std::string& activityId, CoordinateList& coordinates);
@@ -160,7 +309,24 @@ public:
 	bool TrimActivityFootPodReadings(const std::string& activityId, uint64_t timeStamp, bool fromStart);
 
 private:
-	sqlite3* m_pDb;
+	sqlite3*      m_pDb;
+	std::string   m_fileName;
+	std::recursive_mutex m_cacheMutex; // Protects the prepared statements and caches below, the connection may be shared between threads
+
+	sqlite3_stmt* m_pCreateSummaryStatement; // Prepared once and reused, summaries are written in bulk
+	sqlite3_stmt* m_pRetrieveSummaryValueStatement; // Prepared once and reused, looked up for every summary attribute written
+	sqlite3_stmt* m_pRetrieveActivityTypeStatement; // Prepared once and reused, looked up for every summary written
+	sqlite3_stmt* m_pDataVersionStatement;   // Prepared once and reused, checked before every use of the caches
+	int64_t       m_dataVersion;             // SQLite's data version when the caches were last checked
+
+	std::vector<WeightMeasurement> m_weightTimeline; // Cache of the weight table, sorted by time
+	bool                           m_weightTimelineLoaded;
+
+	std::unordered_map<std::string, AttributeAggregateMap> m_attributeAggregates; // Cache of the attribute_aggregate table, keyed by activity type
+	bool                                                   m_attributeAggregatesLoaded;
+
+	bool   m_trainingLoadStale;     // Set when stress changes inside a transaction, the loads are recomputed on commit
+	time_t m_trainingLoadStaleFrom; // Earliest day whose stress changed
 
 	bool DoesTableHaveColumn(const std::string& tableName, const std::string& columnName);
 	bool DoesTableExist(const std::string& tableName);
@@ -174,6 +340,41 @@ private:
 	bool CreatePowerMeterReading(const std::string& activityId, const SensorReading& reading);
 	bool CreateFootPodReading(const std::string& activityId, const SensorReading& reading);
 
+	void DropStaleCaches();
+	bool LoadWeightTimeline();
+
+	bool RetrieveActivityType(const std::string& activityId, std::string& activityType);
+	bool RetrieveSummaryValue(const std::string& activityId, const std::string& attribute, ActivityAttributeType& value);
+	bool WriteSummaryData(const std::string& activityId, const std::string& activityType, const std::string& attribute, const ActivityAttributeType& value);
+
+	bool LoadAttributeAggregates();
+	bool RebuildAttributeAggregates();
+	bool AddToAttributeAggregate(const std::string& activityType, const std::string& activityId, const std::string& attribute, const ActivityAttributeType& value);
+	bool RemoveFromAttributeAggregate(const std::string& activityType, const std::string& activityId, const std::string& attribute, const ActivityAttributeType& value);
+	bool RetrieveExtremeSummaryValue(const std::string& activityType, const std::string& attribute, ActivityAttributeValueType valueType, bool smallest, ActivityAttributeType& value, std::string& activityId);
+	bool WriteAttributeAggregate(const std::string& activityType, const std::string& attribute, const AttributeAggregate& aggregate);
+	bool DeleteAttributeAggregate(const std::string& activityType, const std::string& attribute);
+
+	bool UpdatePersonalRecord(const std::string& activityType, const std::string& activityId, const std::string& attribute, const ActivityAttributeType& value, const ActivityAttributeType* pOldValue);
+	bool DeletePersonalRecords(const std::string& activityId);
+	bool RefillPersonalRecords(const std::string& activityType, const std::string& attribute, int year);
+	bool TrimPersonalRecords(const std::string& activityType, const std::string& attribute, int year);
+	bool RebuildPersonalRecords();
+
+	bool AdjustActivityRollups(const std::string& activityType, time_t activityStartTime, int64_t activityCountDelta, const ActivityRollup& delta, bool recomputeLongest);
+	bool RemoveFromActivityRollups(const std::string& activityType, time_t activityStartTime, const SummaryAttributeMap& values);
+	bool UpdateActivityRollups(const std::string& activityType, const std::string& activityId, const std::string& attribute, const ActivityAttributeType& value, const ActivityAttributeType* pOldValue);
+	bool RecomputeLongestDistance(RollupGranularity granularity, time_t bucketStart, const std::string& activityType);
+	bool RebuildActivityRollups();
+
+	bool AdjustTrainingLoad(time_t activityStartTime, double stressDelta);
+	bool UpdateTrainingLoad(const std::string& activityId, const std::string& attribute, const ActivityAttributeType& value, const ActivityAttributeType* pOldValue);
+	bool RemoveFromTrainingLoad(time_t activityStartTime, const SummaryAttributeMap& values);
+	bool RecomputeTrainingLoads(time_t fromDay);
+	bool RebuildTrainingLoads();
+	void FinalizeStatements();
+	void ConfigureConnection(bool readOnly);
+
 	int ExecuteQuery(const std::string& query);
 	int ExecuteQueries(const std::vector<std::string>& queries);
 };
@@ -0,0 +1,66 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "DatabaseReaderPool.h"
+
+DatabaseReaderPool::DatabaseReaderPool(const std::string& dbFileName, size_t maxReaders) :
+	m_dbFileName(dbFileName),
+	m_maxReaders(maxReaders)
+{
+	if (m_maxReaders == 0)
+	{
+		m_maxReaders = 1;
+	}
+}
+
+DatabaseReaderPool::~DatabaseReaderPool()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto iter = m_all.begin(); iter != m_all.end(); ++iter)
+	{
+		delete (*iter);
+	}
+	m_all.clear();
+	m_available.clear();
+}
+
+Database* DatabaseReaderPool::Acquire()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (m_available.empty() && (m_all.size() < m_maxReaders))
+	{
+		Database* pDatabase = new Database();
+
+		if (!pDatabase->OpenReadOnly(m_dbFileName))
+		{
+			delete pDatabase;
+			return NULL;
+		}
+		m_all.push_back(pDatabase);
+		return pDatabase;
+	}
+
+	m_released.wait(lock, [this] { return !m_available.empty(); });
+
+	Database* pDatabase = m_available.back();
+	m_available.pop_back();
+	return pDatabase;
+}
+
+void DatabaseReaderPool::Release(Database* pDatabase)
+{
+	if (pDatabase)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_available.push_back(pDatabase);
+		}
+		m_released.notify_one();
+	}
+}
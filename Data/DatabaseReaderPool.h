@@ -0,0 +1,69 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __DATABASEREADERPOOL__
+#define __DATABASEREADERPOOL__
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Database.h"
+
+#define DATABASE_READER_POOL_SIZE 3
+
+/**
+* A set of read only connections to the database, for history queries and exports.
+* With the database in WAL mode, these read from the last commit while the main connection
+* (and the sensor reading writer) keep writing, so neither waits for the other.
+* Connections are opened as they are first needed and each is used by one thread at a time.
+*/
+class DatabaseReaderPool
+{
+public:
+	DatabaseReaderPool(const std::string& dbFileName, size_t maxReaders);
+	virtual ~DatabaseReaderPool();
+
+	/// Blocks while every connection is in use. Returns NULL if a new connection can't be opened.
+	Database* Acquire();
+	void Release(Database* pDatabase);
+
+private:
+	std::string             m_dbFileName;
+	size_t                  m_maxReaders;
+	std::mutex              m_mutex;     // Protects everything below
+	std::condition_variable m_released;  // Signalled when a connection is returned to the pool
+	std::vector<Database*>  m_all;       // Every connection that has been opened
+	std::vector<Database*>  m_available; // Connections not currently in use
+};
+
+/**
+* Holds a pooled connection for the lifetime of the object.
+*/
+class PooledDatabaseReader
+{
+public:
+	PooledDatabaseReader(DatabaseReaderPool* pPool) : m_pPool(pPool), m_pDatabase(NULL)
+	{
+		if (m_pPool)
+			m_pDatabase = m_pPool->Acquire();
+	};
+	~PooledDatabaseReader()
+	{
+		if (m_pPool && m_pDatabase)
+			m_pPool->Release(m_pDatabase);
+	};
+
+	Database* Get() const { return m_pDatabase; };
+
+private:
+	DatabaseReaderPool* m_pPool;
+	Database*           m_pDatabase;
+};
+
+#endif
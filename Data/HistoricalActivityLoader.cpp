@@ -0,0 +1,234 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "HistoricalActivityLoader.h"
+#include "MovingActivity.h"
+
+#include <vector>
+
+HistoricalActivityLoader::HistoricalActivityLoader(HistoryLoadHandle handle, const ActivitySummary& summary, const std::set<SensorType>& sensors, const ActivityFactory& factory) :
+	m_handle(handle),
+	m_sensors(sensors),
+	m_factory(factory)
+{
+	m_summary.activityId = summary.activityId;
+	m_summary.userId = summary.userId;
+	m_summary.type = summary.type;
+	m_summary.name = summary.name;
+	m_summary.startTime = summary.startTime;
+	m_summary.endTime = summary.endTime;
+	m_summary.pActivity = NULL;
+	m_state = HISTORY_LOAD_IN_PROGRESS;
+	m_numPointsSent = 0;
+}
+
+HistoricalActivityLoader::~HistoricalActivityLoader()
+{
+	if (m_summary.pActivity)
+	{
+		delete m_summary.pActivity;
+		m_summary.pActivity = NULL;
+	}
+}
+
+void HistoricalActivityLoader::SendNewPoints(HistoryLoadCallback callback, void* context)
+{
+	const MovingActivity* pMovingActivity = dynamic_cast<const MovingActivity*>(m_summary.pActivity);
+
+	if (!(callback && pMovingActivity))
+	{
+		return;
+	}
+
+	const TrackStore& track = pMovingActivity->GetTrack();
+	size_t numPoints = track.NumPositions();
+
+	if (numPoints > m_numPointsSent)
+	{
+		std::vector<Coordinate> points(numPoints - m_numPointsSent);
+
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			track.GetPosition(m_numPointsSent + i, points[i]);
+		}
+		m_numPointsSent = numPoints;
+
+		callback(m_handle, HISTORY_LOAD_IN_PROGRESS, points.data(), points.size(), context);
+	}
+}
+
+bool HistoricalActivityLoader::ProcessLocation(const SensorReading& reading, void* context)
+{
+	LocationLoadState* pState = (LocationLoadState*)context;
+	HistoricalActivityLoader* pLoader = pState->pLoader;
+
+	pLoader->m_summary.pActivity->ProcessSensorReading(reading);
+
+	if ((++pState->numProcessed % HISTORY_LOAD_POINTS_PER_UPDATE) == 0)
+	{
+		if (pLoader->m_token.IsCancelled())
+		{
+			return false;
+		}
+		pLoader->SendNewPoints(pState->callback, pState->context);
+	}
+	return true;
+}
+
+// Locations are by far the most numerous readings, so they are replayed a row at a time as they're read.
+bool HistoricalActivityLoader::LoadLocations(Database& database, HistoryLoadCallback callback, void* context)
+{
+	LocationLoadState state;
+
+	state.pLoader = this;
+	state.callback = callback;
+	state.context = context;
+	state.numProcessed = 0;
+
+	if (!database.ProcessActivityPositionReadings(m_summary.activityId, ProcessLocation, &state))
+	{
+		return false;
+	}
+
+	m_summary.loadedSensors.insert(SENSOR_TYPE_LOCATION);
+	SendNewPoints(callback, context);
+	return true;
+}
+
+// Reads and replays one sensor's readings, in the same way as LoadHistoricalActivitySensorData.
+bool HistoricalActivityLoader::LoadSensor(Database& database, SensorType sensor, HistoryLoadCallback callback, void* context)
+{
+	bool result = false;
+	SensorReadingList readings;
+	SensorReadingColumns* pColumns = NULL;
+
+	switch (sensor)
+	{
+		case SENSOR_TYPE_UNKNOWN:
+			break;
+		case SENSOR_TYPE_ACCELEROMETER:
+			result = database.RetrieveActivityAccelerometerReadings(m_summary.activityId, readings);
+			pColumns = &m_summary.accelerometerReadings;
+			break;
+		case SENSOR_TYPE_LOCATION:
+			return LoadLocations(database, callback, context);
+		case SENSOR_TYPE_HEART_RATE:
+			result = database.RetrieveActivityHeartRateMonitorReadings(m_summary.activityId, readings);
+			break;
+		case SENSOR_TYPE_CADENCE:
+			result = database.RetrieveActivityCadenceReadings(m_summary.activityId, readings);
+			break;
+		case SENSOR_TYPE_WHEEL_SPEED:
+			result = true;
+			break;
+		case SENSOR_TYPE_POWER:
+			result = database.RetrieveActivityPowerMeterReadings(m_summary.activityId, readings);
+			break;
+		case SENSOR_TYPE_FOOT_POD:
+			result = true;
+			break;
+		case SENSOR_TYPE_SCALE:
+		case SENSOR_TYPE_LIGHT:
+		case SENSOR_TYPE_RADAR:
+		case SENSOR_TYPE_GOPRO:
+		case NUM_SENSOR_TYPES:
+			result = false;
+			break;
+	}
+
+	if (result)
+	{
+		size_t numProcessed = 0;
+
+		for (auto iter = readings.begin(); iter != readings.end(); ++iter)
+		{
+			const SensorReading& reading = (*iter);
+
+			m_summary.pActivity->ProcessSensorReading(reading);
+			if (pColumns)
+				pColumns->Append(reading);
+
+			if (((++numProcessed % HISTORY_LOAD_POINTS_PER_UPDATE) == 0) && m_token.IsCancelled())
+			{
+				return false;
+			}
+		}
+		m_summary.loadedSensors.insert(sensor);
+	}
+	return result;
+}
+
+void HistoricalActivityLoader::Load(DatabaseReaderPool* pReaders, HistoryLoadCallback callback, void* context)
+{
+	HistoryLoadState state = HISTORY_LOAD_FAILED;
+
+	if (pReaders && !m_token.IsCancelled())
+	{
+		PooledDatabaseReader reader(pReaders);
+		Database* pDatabase = reader.Get();
+
+		if (pDatabase)
+		{
+			m_factory.CreateActivity(m_summary, *pDatabase);
+		}
+		if (pDatabase && m_summary.pActivity)
+		{
+			bool loadingAll = m_sensors.empty();
+			bool result = true;
+
+			if (loadingAll)
+			{
+				std::vector<SensorType> sensorTypes;
+				m_summary.pActivity->ListUsableSensors(sensorTypes);
+				m_sensors.insert(sensorTypes.begin(), sensorTypes.end());
+			}
+
+			for (auto iter = m_sensors.begin(); iter != m_sensors.end() && result && !m_token.IsCancelled(); ++iter)
+			{
+				result = LoadSensor(*pDatabase, (*iter), callback, context);
+			}
+
+			if (result && !m_token.IsCancelled())
+			{
+				if (loadingAll)
+				{
+					m_summary.pActivity->OnFinishedLoadingSensorData();
+				}
+				state = HISTORY_LOAD_COMPLETE;
+			}
+		}
+	}
+
+	if (m_token.IsCancelled())
+	{
+		state = HISTORY_LOAD_CANCELLED;
+	}
+	m_state = state;
+
+	if (callback)
+	{
+		callback(m_handle, state, NULL, 0, context);
+	}
+}
+
+bool HistoricalActivityLoader::TakeResult(ActivitySummary& summary)
+{
+	if ((m_state != HISTORY_LOAD_COMPLETE) || (m_summary.pActivity == NULL))
+	{
+		return false;
+	}
+
+	summary.pActivity = m_summary.pActivity;
+	summary.accelerometerReadings = m_summary.accelerometerReadings;
+	summary.loadedSensors = m_summary.loadedSensors;
+
+	m_summary.pActivity = NULL;
+	m_summary.accelerometerReadings.Clear();
+	m_summary.loadedSensors.clear();
+
+	return true;
+}
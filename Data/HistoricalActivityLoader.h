@@ -0,0 +1,72 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __HISTORICALACTIVITYLOADER__
+#define __HISTORICALACTIVITYLOADER__
+
+#include <atomic>
+#include <set>
+
+#include "ActivityFactory.h"
+#include "ActivitySummary.h"
+#include "Callbacks.h"
+#include "DatabaseReaderPool.h"
+#include "HistoryLoadState.h"
+#include "TaskExecutor.h"
+
+#define HISTORY_LOAD_POINTS_PER_UPDATE 256 // Locations processed between updates to the callback
+
+/**
+* Loads the sensor data of one historical activity away from the thread that asked for it.
+*
+* The loader builds its own activity object, from its own copy of the activity's metadata, and feeds it readings
+* from a pooled read only connection. Nothing the UI can see is touched until the load is complete and the result
+* is taken. Locations are processed as they are read from the database, and handed to the callback in batches,
+* so a map can start drawing before the whole activity has been read. A cancelled load stops at the next batch.
+*/
+class HistoricalActivityLoader
+{
+public:
+	/// An empty set of sensors means every sensor the activity can use.
+	HistoricalActivityLoader(HistoryLoadHandle handle, const ActivitySummary& summary, const std::set<SensorType>& sensors, const ActivityFactory& factory);
+	virtual ~HistoricalActivityLoader();
+
+	/// Called on a worker thread, the callback is called on the same thread.
+	void Load(DatabaseReaderPool* pReaders, HistoryLoadCallback callback, void* context);
+	void Cancel() { m_token.Cancel(); };
+
+	HistoryLoadHandle GetHandle() const { return m_handle; };
+	HistoryLoadState GetState() const { return m_state; };
+	const std::string& GetActivityId() const { return m_summary.activityId; };
+
+	/// Once complete, moves the activity object and its sensor data into the given summary, which takes ownership.
+	bool TakeResult(ActivitySummary& summary);
+
+private:
+	HistoryLoadHandle             m_handle;
+	ActivitySummary               m_summary; // Our own copy, the activity object and readings belong to us until they are taken
+	std::set<SensorType>          m_sensors;
+	ActivityFactory               m_factory;
+	CancellationToken             m_token;
+	std::atomic<HistoryLoadState> m_state;
+	size_t                        m_numPointsSent;
+
+	typedef struct LocationLoadState
+	{
+		HistoricalActivityLoader* pLoader;
+		HistoryLoadCallback       callback;
+		void*                     context;
+		size_t                    numProcessed;
+	} LocationLoadState;
+
+	bool LoadSensor(Database& database, SensorType sensor, HistoryLoadCallback callback, void* context);
+	bool LoadLocations(Database& database, HistoryLoadCallback callback, void* context);
+	static bool ProcessLocation(const SensorReading& reading, void* context);
+	void SendNewPoints(HistoryLoadCallback callback, void* context);
+};
+
+#endif
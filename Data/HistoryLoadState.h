@@ -0,0 +1,23 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __HISTORYLOADSTATE__
+#define __HISTORYLOADSTATE__
+
+#include <stdint.h>
+
+typedef uint64_t HistoryLoadHandle; // Identifies an asynchronous history load, zero is never a valid handle
+
+typedef enum HistoryLoadState
+{
+	HISTORY_LOAD_IN_PROGRESS = 0, // Partial results, more will follow
+	HISTORY_LOAD_COMPLETE,        // Everything was loaded, the load can now be finished
+	HISTORY_LOAD_CANCELLED,
+	HISTORY_LOAD_FAILED
+} HistoryLoadState;
+
+#endif
@@ -0,0 +1,319 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "SensorReadingWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+SensorReadingWriter::SensorReadingWriter()
+{
+	m_running = false;
+	m_numFlushWaiters = 0;
+	m_numCompleted = 0;
+	m_hasPendingBike = false;
+	m_numBikeUpdates = 0;
+	m_numBikeUpdatesCompleted = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+SensorReadingWriter::~SensorReadingWriter()
+{
+	Stop();
+}
+
+bool SensorReadingWriter::Start(const std::string& dbFileName)
+{
+	if (m_thread.joinable())
+	{
+		return true;
+	}
+	if (!m_db.Open(dbFileName))
+	{
+		return false;
+	}
+
+	// Commits are only once a second, so they can afford to be synced all the way to storage, which is
+	// what makes Flush a durable barrier.
+	m_db.SetDurableCommits(true);
+
+	m_running = true;
+	m_thread = std::thread(&SensorReadingWriter::WriterThread, this);
+	return true;
+}
+
+// Writes everything that is still queued before returning.
+void SensorReadingWriter::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_readingsQueued.notify_all();
+
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+	m_db.Close();
+}
+
+// Backpressure: the producer waits for the writer to make room rather than let the queue grow without bound.
+void SensorReadingWriter::WaitForRoom()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (m_running && (m_queue.size() >= SENSOR_WRITER_QUEUE_CAPACITY))
+	{
+		std::chrono::steady_clock::time_point stallStart = std::chrono::steady_clock::now();
+
+		m_readingsWritten.wait(lock, [this] { return (m_queue.size() < SENSOR_WRITER_QUEUE_CAPACITY) || !m_running; });
+
+		++m_stats.numStalls;
+		m_stats.stallTimeMs += std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stallStart).count();
+	}
+}
+
+bool SensorReadingWriter::Write(const std::string& activityId, const SensorReading& reading)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_running)
+	{
+		return false;
+	}
+
+	PendingSensorReading pending;
+	pending.activityId = activityId;
+	pending.reading = reading;
+	m_queue.push_back(pending);
+
+	++m_stats.numQueued;
+	if (m_queue.size() > m_stats.maxQueueDepth)
+	{
+		m_stats.maxQueueDepth = m_queue.size();
+	}
+
+	// Only wake the writer once it has a full batch, otherwise let it sleep until its delay expires.
+	if (m_queue.size() >= SENSOR_WRITER_BATCH_SIZE)
+	{
+		m_readingsQueued.notify_one();
+	}
+	return true;
+}
+
+bool SensorReadingWriter::UpdateBike(const Bike& bike)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_running)
+	{
+		return false;
+	}
+
+	m_pendingBike = bike;
+	m_hasPendingBike = true;
+	++m_numBikeUpdates;
+	return true;
+}
+
+bool SensorReadingWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// Once stopped, everything that was queued has already been written.
+	if (!m_running)
+	{
+		return true;
+	}
+
+	uint64_t target = m_stats.numQueued;
+	uint64_t bikeTarget = m_numBikeUpdates;
+	uint64_t numFailed = m_stats.numFailed;
+
+	++m_numFlushWaiters;
+	m_readingsQueued.notify_one();
+	m_readingsWritten.wait(lock, [this, target, bikeTarget] { return (m_numCompleted >= target) && (m_numBikeUpdatesCompleted >= bikeTarget); });
+	--m_numFlushWaiters;
+
+	return m_stats.numFailed == numFailed;
+}
+
+SensorWriterStats SensorReadingWriter::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	SensorWriterStats stats = m_stats;
+	stats.queueDepth = m_queue.size();
+	return stats;
+}
+
+void SensorReadingWriter::WriterThread()
+{
+	std::deque<PendingSensorReading> batch;
+	Bike bike;
+	bool hasBike = false;
+	uint64_t numBikeUpdates = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			// Wait for a full batch, a flush, a stop, or for the oldest reading to have waited long enough.
+			m_readingsQueued.wait_for(lock, std::chrono::milliseconds(SENSOR_WRITER_MAX_DELAY_MS), [this] { return (m_queue.size() >= SENSOR_WRITER_BATCH_SIZE) || (m_numFlushWaiters > 0) || !m_running; });
+
+			if (m_queue.empty() && !m_hasPendingBike)
+			{
+				if (!m_running)
+				{
+					break;
+				}
+				continue;
+			}
+
+			while (!m_queue.empty() && (batch.size() < SENSOR_WRITER_BATCH_SIZE))
+			{
+				batch.push_back(m_queue.front());
+				m_queue.pop_front();
+			}
+
+			hasBike = m_hasPendingBike;
+			if (hasBike)
+			{
+				bike = m_pendingBike;
+				m_hasPendingBike = false;
+				numBikeUpdates = m_numBikeUpdates;
+			}
+		}
+
+		// Room has been made in the queue.
+		m_readingsWritten.notify_all();
+
+		WriteBatch(batch, hasBike ? &bike : NULL);
+		batch.clear();
+
+		if (hasBike)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_numBikeUpdatesCompleted = numBikeUpdates;
+			}
+			m_readingsWritten.notify_all();
+		}
+	}
+
+	// Wake anyone still waiting on a flush.
+	m_readingsWritten.notify_all();
+}
+
+void SensorReadingWriter::WriteBatch(std::deque<PendingSensorReading>& batch, const Bike* bike)
+{
+	std::chrono::steady_clock::time_point batchStart = std::chrono::steady_clock::now();
+	uint64_t numWritten = 0;
+	uint32_t retryDelayMs = SENSOR_WRITER_RETRY_DELAY_MS;
+	size_t numStopRetries = 0;
+	int errorCode = SQLITE_OK;
+	bool committed = TryWriteBatch(batch, bike, numWritten, errorCode);
+
+	// Each attempt has already waited out the busy timeout, so a connection that is still holding the lock is
+	// probably in the middle of something long (a reprocessing batch, a merge). Give it time and try again.
+	while (!committed && Database::IsTransientError(errorCode))
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			// Don't hold up a stop forever.
+			if (!m_running && (numStopRetries++ >= SENSOR_WRITER_STOP_RETRIES))
+			{
+				break;
+			}
+
+			++m_stats.numRetries;
+			m_readingsQueued.wait_for(lock, std::chrono::milliseconds(retryDelayMs), [this] { return !m_running; });
+		}
+
+		retryDelayMs = std::min(retryDelayMs * 2, (uint32_t)SENSOR_WRITER_MAX_RETRY_MS);
+		committed = TryWriteBatch(batch, bike, numWritten, errorCode);
+	}
+
+	uint64_t batchTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - batchStart).count();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!committed)
+		{
+			numWritten = 0;
+		}
+		if (numWritten < batch.size())
+		{
+			m_stats.lastError = errorCode;
+		}
+		m_stats.numWritten += numWritten;
+		m_stats.numFailed += batch.size() - numWritten;
+		++m_stats.numBatches;
+		if (batchTimeMs > m_stats.maxBatchTimeMs)
+		{
+			m_stats.maxBatchTimeMs = batchTimeMs;
+		}
+		m_numCompleted += batch.size();
+	}
+	m_readingsWritten.notify_all();
+}
+
+// Writes the batch, and the bike update if there is one, in one transaction. A reading that can't be written for a reason that retrying won't fix is
+// skipped, anything else rolls back the whole batch so it can be tried again.
+bool SensorReadingWriter::TryWriteBatch(const std::deque<PendingSensorReading>& batch, const Bike* bike, uint64_t& numWritten, int& errorCode)
+{
+	numWritten = 0;
+
+	if (!m_db.BeginTransaction())
+	{
+		errorCode = m_db.GetLastErrorCode();
+		return false;
+	}
+
+	// The mileage will be updated again by the next wheel reading, so it is only worth retrying for a busy database.
+	if (bike && !m_db.UpdateBike(*bike) && Database::IsTransientError(m_db.GetLastErrorCode()))
+	{
+		errorCode = m_db.GetLastErrorCode();
+		m_db.RollbackTransaction();
+		return false;
+	}
+
+	for (auto iter = batch.begin(); iter != batch.end(); ++iter)
+	{
+		if (m_db.CreateSensorReading((*iter).activityId, (*iter).reading))
+		{
+			++numWritten;
+		}
+		else
+		{
+			errorCode = m_db.GetLastErrorCode();
+			if (Database::IsTransientError(errorCode))
+			{
+				m_db.RollbackTransaction();
+				return false;
+			}
+		}
+	}
+
+	if (m_db.CommitTransaction())
+	{
+		return true;
+	}
+
+	// A failed commit can leave the transaction open, or may already have rolled it back.
+	errorCode = m_db.GetLastErrorCode();
+	if (m_db.IsInTransaction())
+	{
+		m_db.RollbackTransaction();
+	}
+	return false;
+}
@@ -0,0 +1,89 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __SENSORREADINGWRITER__
+#define __SENSORREADINGWRITER__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Database.h"
+#include "SensorReading.h"
+#include "SensorWriterStats.h"
+
+#define SENSOR_WRITER_QUEUE_CAPACITY 4096 // readings waiting to be written before WaitForRoom blocks
+#define SENSOR_WRITER_BATCH_SIZE     256  // most readings written in one transaction
+#define SENSOR_WRITER_MAX_DELAY_MS   1000 // longest a reading waits for its batch to fill up
+#define SENSOR_WRITER_RETRY_DELAY_MS 100  // wait before retrying a batch the database was too busy for, doubled each time
+#define SENSOR_WRITER_MAX_RETRY_MS   2000 // longest wait between retries
+#define SENSOR_WRITER_STOP_RETRIES   3    // retries a batch still gets once the writer is stopping
+
+/**
+* Persists sensor readings on a background thread, with its own database connection, so that a slow
+* write (a checkpoint, an fsync, contention with a backup) doesn't hold up processing of the readings.
+* Readings are committed in batches, one transaction per batch rather than one per reading.
+* Write never blocks, since it's called with the current activity locked. Instead the producer calls
+* WaitForRoom before taking that lock, which blocks while the queue is full and records the time spent
+* waiting in the stats. The queue can only grow past its capacity by what is written between the two.
+* A batch that fails because another connection has the database locked is retried, with a growing delay,
+* until it is written. Other failures, like a full disk, are counted in the stats and reported by Flush.
+* The bike's mileage, which changes with every wheel reading, is written by the same thread. Only the
+* latest update is kept, and it is committed with the next batch.
+*/
+class SensorReadingWriter
+{
+public:
+	SensorReadingWriter();
+	virtual ~SensorReadingWriter();
+
+	bool Start(const std::string& dbFileName);
+	void Stop();
+
+	/// Waits until the queue is below its capacity, or the writer is stopped.
+	void WaitForRoom();
+
+	bool Write(const std::string& activityId, const SensorReading& reading);
+
+	/// Replaces any bike update that hasn't been written yet.
+	bool UpdateBike(const Bike& bike);
+
+	/// Waits until everything written so far, bike updates included, has been committed. Returns false if any of it failed.
+	bool Flush();
+
+	SensorWriterStats GetStats();
+
+private:
+	typedef struct PendingSensorReading
+	{
+		std::string   activityId;
+		SensorReading reading;
+	} PendingSensorReading;
+
+	Database                         m_db;
+	std::thread                      m_thread;
+	std::mutex                       m_mutex;           // Protects everything below
+	std::condition_variable          m_readingsQueued;  // Signalled when there is work for the writer
+	std::condition_variable          m_readingsWritten; // Signalled when the writer has made room or finished a flush
+	std::deque<PendingSensorReading> m_queue;
+	Bike                             m_pendingBike;
+	bool                             m_hasPendingBike;
+	uint64_t                         m_numBikeUpdates;          // Calls to UpdateBike so far
+	uint64_t                         m_numBikeUpdatesCompleted; // Calls to UpdateBike covered by a finished write
+	bool                             m_running;
+	uint64_t                         m_numFlushWaiters; // Callers of Flush waiting for the writer to empty the queue
+	uint64_t                         m_numCompleted;    // Readings written, or failed, so far
+	SensorWriterStats                m_stats;
+
+	void WriterThread();
+	void WriteBatch(std::deque<PendingSensorReading>& batch, const Bike* bike);
+	bool TryWriteBatch(const std::deque<PendingSensorReading>& batch, const Bike* bike, uint64_t& numWritten, int& errorCode);
+};
+
+#endif
@@ -0,0 +1,29 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __SENSORWRITERSTATS__
+#define __SENSORWRITERSTATS__
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct SensorWriterStats
+{
+	uint64_t numQueued;      // Readings handed to the writer
+	uint64_t numWritten;     // Readings committed to the database
+	uint64_t numFailed;      // Readings that could not be written, for a reason that retrying wouldn't fix
+	uint64_t numRetries;     // Times a batch was tried again after the database was busy
+	int      lastError;      // SQLite result code of the most recent failure, SQLITE_OK if there hasn't been one
+	uint64_t numBatches;     // Transactions committed
+	uint64_t numStalls;      // Times a reading had to wait because the queue was full
+	uint64_t stallTimeMs;    // Total time spent waiting on a full queue
+	uint64_t maxBatchTimeMs; // Longest time taken to write and commit one batch
+	size_t   queueDepth;     // Readings waiting to be written
+	size_t   maxQueueDepth;  // Most readings ever waiting to be written
+} SensorWriterStats;
+
+#endif
@@ -6,13 +6,24 @@
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <iostream>
+#include <string.h>
 
 #include "File.h"
 
+// Adding 16 to the window bits tells zlib to write a gzip header and trailer instead of a zlib one.
+#define GZIP_WINDOW_BITS (15 + 16)
+#define GZIP_CHUNK_SIZE  16384
+
 namespace FileLib
 {
 	File::File()
 	{
+		m_pBuffer = NULL;
+		m_callback = NULL;
+		m_context = NULL;
+		m_redirected = false;
+		m_compress = false;
+		memset(&m_zStream, 0, sizeof(m_zStream));
 	}
 
 	File::~File()
@@ -33,6 +44,23 @@ namespace FileLib
 
 	bool File::CreateFile(const std::string& fileName)
 	{
+		if (IsRedirectionConfigured())
+		{
+			if (m_redirected)
+			{
+				return false;
+			}
+			if (m_compress)
+			{
+				if (deflateInit2(&m_zStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+				{
+					return false;
+				}
+			}
+			m_fileName = fileName;
+			m_redirected = true;
+			return true;
+		}
 		if (!m_file.is_open())
 		{
 			m_file.open(fileName.c_str(), std::ios::out);
@@ -44,6 +72,18 @@ namespace FileLib
 
 	bool File::CloseFile()
 	{
+		if (m_redirected)
+		{
+			bool result = true;
+
+			if (m_compress)
+			{
+				result = Deflate(NULL, 0, Z_FINISH);
+				deflateEnd(&m_zStream);
+			}
+			m_redirected = false;
+			return result;
+		}
 		if (m_file.is_open())
 		{
 			m_file.close();
@@ -54,11 +94,86 @@ namespace FileLib
 
 	bool File::IsOpen() const
 	{
-		return m_file.is_open();
+		return m_redirected || m_file.is_open();
+	}
+
+	void File::RedirectToBuffer(std::string* pBuffer, bool compress)
+	{
+		if (!IsOpen())
+		{
+			m_pBuffer = pBuffer;
+			m_callback = NULL;
+			m_context = NULL;
+			m_compress = compress;
+		}
+	}
+
+	void File::RedirectToCallback(WriteCallback callback, void* context, bool compress)
+	{
+		if (!IsOpen())
+		{
+			m_pBuffer = NULL;
+			m_callback = callback;
+			m_context = context;
+			m_compress = compress;
+		}
+	}
+
+	bool File::Emit(const uint8_t* data, size_t dataLen)
+	{
+		if (dataLen == 0)
+		{
+			return true;
+		}
+		if (m_pBuffer)
+		{
+			m_pBuffer->append((const char*)data, dataLen);
+			return true;
+		}
+		if (m_callback)
+		{
+			return m_callback(data, dataLen, m_context);
+		}
+		return false;
+	}
+
+	bool File::Deflate(const uint8_t* data, size_t dataLen, int flush)
+	{
+		uint8_t out[GZIP_CHUNK_SIZE];
+		int status = Z_OK;
+
+		m_zStream.next_in = (Bytef*)data;
+		m_zStream.avail_in = (uInt)dataLen;
+
+		do
+		{
+			m_zStream.next_out = out;
+			m_zStream.avail_out = sizeof(out);
+
+			status = deflate(&m_zStream, flush);
+			if (status == Z_STREAM_ERROR)
+			{
+				return false;
+			}
+			if (!Emit(out, sizeof(out) - m_zStream.avail_out))
+			{
+				return false;
+			}
+		} while (m_zStream.avail_out == 0);
+
+		return true;
 	}
 
 	bool File::WriteString(const std::string& str)
 	{
+		if (m_redirected)
+		{
+			if (m_compress)
+			{
+				return Deflate((const uint8_t*)str.c_str(), str.size(), Z_NO_FLUSH);
+			}
+			return Emit((const uint8_t*)str.c_str(), str.size());
+		}
 		if (m_file.is_open())
 		{
 			m_file << str;
@@ -12,9 +12,13 @@
 
 #include <iostream>
 #include <fstream>
+#include <zlib.h>
 
 namespace FileLib
 {
+	// Receives a chunk of output when writing to something other than a file on disk.
+	typedef bool (*WriteCallback)(const uint8_t* data, size_t dataLen, void* context);
+
 	class File
 	{
 	public:
@@ -26,11 +30,29 @@ namespace FileLib
 		bool CloseFile();
 		bool IsOpen() const;
 
+		// Output redirection. Must be called before CreateFile, in which case the file name is ignored
+		// and everything written is appended to the buffer (or handed to the callback) instead of going to disk.
+		// If compression is requested then the output is gzip encoded on the fly.
+		void RedirectToBuffer(std::string* pBuffer, bool compress);
+		void RedirectToCallback(WriteCallback callback, void* context, bool compress);
+
 		bool WriteString(const std::string& str);
 		
 	protected:
 		std::string  m_fileName;
 		std::fstream m_file;
+
+	private:
+		std::string*  m_pBuffer;    // Optional in-memory destination
+		WriteCallback m_callback;   // Optional streaming destination
+		void*         m_context;    // Passed to the callback
+		bool          m_redirected; // TRUE if the output is going to the buffer or callback, and has been created
+		bool          m_compress;   // TRUE if the redirected output should be gzip encoded
+		z_stream      m_zStream;
+
+		bool IsRedirectionConfigured() const { return (m_pBuffer != NULL) || (m_callback != NULL); };
+		bool Emit(const uint8_t* data, size_t dataLen);
+		bool Deflate(const uint8_t* data, size_t dataLen, int flush);
 	};
 }
 
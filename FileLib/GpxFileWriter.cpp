@@ -66,7 +66,9 @@ namespace FileLib
 
 	bool GpxFileWriter::CloseFile()
 	{
-		return CloseAllTags();
+		bool result = CloseAllTags();
+		result &= File::CloseFile();
+		return result;
 	}
 
 	bool GpxFileWriter::WriteMetadata(time_t startTime)
@@ -75,8 +77,10 @@ namespace FileLib
 
 		if (OpenTag(GPX_TAG_NAME_METADATA))
 		{
+			struct tm startTm;
 			char buf[32];
-			strftime(buf, sizeof(buf) - 1, "%Y-%m-%dT%H:%M:%SZ", gmtime(&startTime));
+			gmtime_r(&startTime, &startTm);
+			strftime(buf, sizeof(buf) - 1, "%Y-%m-%dT%H:%M:%SZ", &startTm);
 
 			WriteTagAndValue(GPX_TAG_NAME_TIME, buf);
 			CloseTag();
@@ -203,8 +207,10 @@ namespace FileLib
 		time_t sec  = (time_t)(t / 1000);
 		uint16_t ms = t % 1000;
 
+		struct tm secTm;
 		char buf1[32];
-		strftime(buf1, sizeof(buf1) - 1, "%Y-%m-%dT%H:%M:%S", gmtime(&sec));
+		gmtime_r(&sec, &secTm);
+		strftime(buf1, sizeof(buf1) - 1, "%Y-%m-%dT%H:%M:%S", &secTm);
 
 		char buf2[32];
 		snprintf(buf2, sizeof(buf2) - 1, "%s.%04uZ", buf1, ms);
@@ -0,0 +1,496 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <string.h>
+#include <zlib.h>
+
+#include "ParquetFileWriter.h"
+
+#define PARQUET_MAGIC "PAR1"
+
+// Values from parquet.thrift.
+#define PARQUET_TYPE_INT64            2
+#define PARQUET_TYPE_DOUBLE           5
+#define PARQUET_TYPE_BYTE_ARRAY       6
+#define PARQUET_REPETITION_REQUIRED   0
+#define PARQUET_REPETITION_OPTIONAL   1
+#define PARQUET_CONVERTED_UTF8        0
+#define PARQUET_CONVERTED_TIMESTAMP_MILLIS 9
+#define PARQUET_ENCODING_PLAIN        0
+#define PARQUET_ENCODING_RLE          3
+#define PARQUET_CODEC_GZIP            2
+#define PARQUET_PAGE_TYPE_DATA_PAGE   0
+
+// Thrift compact protocol type ids.
+#define THRIFT_TYPE_I32    5
+#define THRIFT_TYPE_I64    6
+#define THRIFT_TYPE_BINARY 8
+#define THRIFT_TYPE_LIST   9
+#define THRIFT_TYPE_STRUCT 12
+
+namespace FileLib
+{
+	/**
+	* Just enough of the Thrift compact protocol to serialize the Parquet page headers and file footer.
+	*/
+	class ThriftCompactEncoder
+	{
+	public:
+		ThriftCompactEncoder() { m_lastFieldId.push_back(0); };
+
+		std::string& Buffer() { return m_buf; };
+
+		void StructBegin() { m_lastFieldId.push_back(0); };
+		void StructEnd() { m_buf.push_back(0); m_lastFieldId.pop_back(); };
+
+		void FieldI32(int16_t id, int32_t value) { FieldBegin(id, THRIFT_TYPE_I32); Varint(ZigZag(value)); };
+		void FieldI64(int16_t id, int64_t value) { FieldBegin(id, THRIFT_TYPE_I64); Varint(ZigZag(value)); };
+		void FieldBinary(int16_t id, const std::string& value) { FieldBegin(id, THRIFT_TYPE_BINARY); Binary(value); };
+		void FieldStructBegin(int16_t id) { FieldBegin(id, THRIFT_TYPE_STRUCT); StructBegin(); };
+		void FieldListBegin(int16_t id, uint8_t elementType, size_t size) { FieldBegin(id, THRIFT_TYPE_LIST); ListBegin(elementType, size); };
+
+		void ListBegin(uint8_t elementType, size_t size)
+		{
+			if (size < 15)
+			{
+				m_buf.push_back((char)((size << 4) | elementType));
+			}
+			else
+			{
+				m_buf.push_back((char)(0xf0 | elementType));
+				Varint(size);
+			}
+		};
+		void ElementI32(int32_t value) { Varint(ZigZag(value)); };
+		void ElementBinary(const std::string& value) { Binary(value); };
+
+	private:
+		std::string         m_buf;
+		std::vector<int16_t> m_lastFieldId;
+
+		static uint64_t ZigZag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); };
+
+		void Varint(uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				m_buf.push_back((char)((value & 0x7f) | 0x80));
+				value >>= 7;
+			}
+			m_buf.push_back((char)value);
+		};
+		void Binary(const std::string& value)
+		{
+			Varint(value.size());
+			m_buf.append(value);
+		};
+		void FieldBegin(int16_t id, uint8_t type)
+		{
+			int16_t delta = id - m_lastFieldId.back();
+
+			if ((delta > 0) && (delta <= 15))
+			{
+				m_buf.push_back((char)((delta << 4) | type));
+			}
+			else
+			{
+				m_buf.push_back((char)type);
+				Varint(ZigZag(id));
+			}
+			m_lastFieldId.back() = id;
+		};
+	};
+
+	static void AppendU32(std::string& buf, uint32_t value)
+	{
+		for (size_t i = 0; i < sizeof(value); ++i)
+		{
+			buf.push_back((char)((value >> (i * 8)) & 0xff));
+		}
+	}
+
+	static void AppendU64(std::string& buf, uint64_t value)
+	{
+		for (size_t i = 0; i < sizeof(value); ++i)
+		{
+			buf.push_back((char)((value >> (i * 8)) & 0xff));
+		}
+	}
+
+	static void AppendDouble(std::string& buf, double value)
+	{
+		uint64_t bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+		AppendU64(buf, bits);
+	}
+
+	static int32_t PhysicalType(ParquetColumnType type)
+	{
+		switch (type)
+		{
+			case PARQUET_COLUMN_TIMESTAMP_MS:
+				return PARQUET_TYPE_INT64;
+			case PARQUET_COLUMN_DOUBLE:
+				return PARQUET_TYPE_DOUBLE;
+			case PARQUET_COLUMN_STRING:
+			default:
+				return PARQUET_TYPE_BYTE_ARRAY;
+		}
+	}
+
+	static bool GzipCompress(const std::string& in, std::string& out)
+	{
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+
+		if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			return false;
+		}
+
+		out.resize(deflateBound(&stream, (uLong)in.size()) + 32); // bound doesn't include the gzip wrapper
+		stream.next_in = (Bytef*)in.data();
+		stream.avail_in = (uInt)in.size();
+		stream.next_out = (Bytef*)&out[0];
+		stream.avail_out = (uInt)out.size();
+
+		int status = deflate(&stream, Z_FINISH);
+		out.resize(stream.total_out);
+		deflateEnd(&stream);
+
+		return status == Z_STREAM_END;
+	}
+
+	ParquetFileWriter::ParquetFileWriter()
+	{
+		m_bytesWritten = 0;
+	}
+
+	ParquetFileWriter::~ParquetFileWriter()
+	{
+		CloseFile();
+	}
+
+	bool ParquetFileWriter::CreateFile(const std::string& fileName)
+	{
+		m_rowGroups.clear();
+		m_rowGroupSizes.clear();
+		m_bytesWritten = 0;
+
+		if (File::CreateFile(fileName))
+		{
+			return WriteBytes(PARQUET_MAGIC);
+		}
+		return false;
+	}
+
+	bool ParquetFileWriter::CloseFile()
+	{
+		if (!IsOpen())
+		{
+			return false;
+		}
+
+		bool result = WriteFooter();
+		result &= File::CloseFile();
+		return result;
+	}
+
+	bool ParquetFileWriter::WriteBytes(const std::string& bytes)
+	{
+		if (File::WriteString(bytes))
+		{
+			m_bytesWritten += bytes.size();
+			return true;
+		}
+		return false;
+	}
+
+	bool ParquetFileWriter::WriteRowGroup(ParquetRowGroup& columns, size_t numRows)
+	{
+		// The schema is set by the first row group.
+		if (m_rowGroups.size() > 0)
+		{
+			const ParquetRowGroup& schema = m_rowGroups.at(0);
+
+			if (schema.size() != columns.size())
+			{
+				return false;
+			}
+			for (size_t i = 0; i < columns.size(); ++i)
+			{
+				if ((schema.at(i).name.compare(columns.at(i).name) != 0) || (schema.at(i).type != columns.at(i).type) || (schema.at(i).optional != columns.at(i).optional))
+				{
+					return false;
+				}
+			}
+		}
+
+		ParquetRowGroup metadata;
+
+		for (auto iter = columns.begin(); iter != columns.end(); ++iter)
+		{
+			ParquetColumn& column = (*iter);
+
+			if (!WriteColumnChunk(column, numRows))
+			{
+				return false;
+			}
+
+			// Only keep what's needed for the footer.
+			ParquetColumn chunk;
+			chunk.name = column.name;
+			chunk.type = column.type;
+			chunk.optional = column.optional;
+			chunk.dataPageOffset = column.dataPageOffset;
+			chunk.uncompressedSize = column.uncompressedSize;
+			chunk.compressedSize = column.compressedSize;
+			chunk.nullCount = column.nullCount;
+			chunk.minValue = column.minValue;
+			chunk.maxValue = column.maxValue;
+			metadata.push_back(chunk);
+		}
+
+		m_rowGroups.push_back(metadata);
+		m_rowGroupSizes.push_back(numRows);
+		return true;
+	}
+
+	bool ParquetFileWriter::WriteColumnChunk(ParquetColumn& column, size_t numRows)
+	{
+		std::string page;
+		size_t numDefined = numRows;
+
+		// Definition levels, RLE encoded with a bit width of one and prefixed with their length.
+		if (column.optional)
+		{
+			if (column.defined.size() != numRows)
+			{
+				return false;
+			}
+
+			std::string levels;
+			size_t row = 0;
+
+			numDefined = 0;
+			while (row < numRows)
+			{
+				bool value = column.defined.at(row);
+				size_t runLength = 0;
+
+				while ((row < numRows) && (column.defined.at(row) == value))
+				{
+					++runLength;
+					++row;
+				}
+				if (value)
+				{
+					numDefined += runLength;
+				}
+
+				uint64_t header = (uint64_t)runLength << 1;
+				while (header >= 0x80)
+				{
+					levels.push_back((char)((header & 0x7f) | 0x80));
+					header >>= 7;
+				}
+				levels.push_back((char)header);
+				levels.push_back((char)(value ? 1 : 0));
+			}
+
+			AppendU32(page, (uint32_t)levels.size());
+			page.append(levels);
+		}
+
+		column.nullCount = numRows - numDefined;
+		column.minValue.clear();
+		column.maxValue.clear();
+
+		// Values, plain encoded.
+		switch (column.type)
+		{
+			case PARQUET_COLUMN_TIMESTAMP_MS:
+				if (column.intValues.size() != numDefined)
+				{
+					return false;
+				}
+				for (auto iter = column.intValues.begin(); iter != column.intValues.end(); ++iter)
+				{
+					AppendU64(page, (uint64_t)(*iter));
+				}
+				if (numDefined > 0)
+				{
+					AppendU64(column.minValue, (uint64_t)*std::min_element(column.intValues.begin(), column.intValues.end()));
+					AppendU64(column.maxValue, (uint64_t)*std::max_element(column.intValues.begin(), column.intValues.end()));
+				}
+				break;
+			case PARQUET_COLUMN_DOUBLE:
+				if (column.doubleValues.size() != numDefined)
+				{
+					return false;
+				}
+				for (auto iter = column.doubleValues.begin(); iter != column.doubleValues.end(); ++iter)
+				{
+					AppendDouble(page, (*iter));
+				}
+				if (numDefined > 0)
+				{
+					AppendDouble(column.minValue, *std::min_element(column.doubleValues.begin(), column.doubleValues.end()));
+					AppendDouble(column.maxValue, *std::max_element(column.doubleValues.begin(), column.doubleValues.end()));
+				}
+				break;
+			case PARQUET_COLUMN_STRING:
+				if (column.stringValues.size() != numDefined)
+				{
+					return false;
+				}
+				for (auto iter = column.stringValues.begin(); iter != column.stringValues.end(); ++iter)
+				{
+					AppendU32(page, (uint32_t)(*iter).size());
+					page.append((*iter));
+				}
+				break;
+		}
+
+		std::string compressedPage;
+		if (!GzipCompress(page, compressedPage))
+		{
+			return false;
+		}
+
+		ThriftCompactEncoder header;
+		header.FieldI32(1, PARQUET_PAGE_TYPE_DATA_PAGE);
+		header.FieldI32(2, (int32_t)page.size());
+		header.FieldI32(3, (int32_t)compressedPage.size());
+		header.FieldStructBegin(5);          // DataPageHeader
+		header.FieldI32(1, (int32_t)numRows); // num_values, including nulls
+		header.FieldI32(2, PARQUET_ENCODING_PLAIN);
+		header.FieldI32(3, PARQUET_ENCODING_RLE);
+		header.FieldI32(4, PARQUET_ENCODING_RLE);
+		header.StructEnd();
+		header.StructEnd();
+
+		column.dataPageOffset = m_bytesWritten;
+		column.uncompressedSize = header.Buffer().size() + page.size();
+		column.compressedSize = header.Buffer().size() + compressedPage.size();
+
+		return WriteBytes(header.Buffer()) && WriteBytes(compressedPage);
+	}
+
+	bool ParquetFileWriter::WriteFooter()
+	{
+		ThriftCompactEncoder footer;
+		uint64_t totalRows = 0;
+
+		for (auto iter = m_rowGroupSizes.begin(); iter != m_rowGroupSizes.end(); ++iter)
+		{
+			totalRows += (*iter);
+		}
+
+		// FileMetaData
+		footer.FieldI32(1, 1); // version
+
+		// Schema, flattened: the root followed by one leaf per column.
+		ParquetRowGroup schema;
+		if (m_rowGroups.size() > 0)
+		{
+			schema = m_rowGroups.at(0);
+		}
+		footer.FieldListBegin(2, THRIFT_TYPE_STRUCT, schema.size() + 1);
+		footer.StructBegin();
+		footer.FieldBinary(4, "schema");
+		footer.FieldI32(5, (int32_t)schema.size());
+		footer.StructEnd();
+		for (auto iter = schema.begin(); iter != schema.end(); ++iter)
+		{
+			const ParquetColumn& column = (*iter);
+
+			footer.StructBegin();
+			footer.FieldI32(1, PhysicalType(column.type));
+			footer.FieldI32(3, column.optional ? PARQUET_REPETITION_OPTIONAL : PARQUET_REPETITION_REQUIRED);
+			footer.FieldBinary(4, column.name);
+			if (column.type == PARQUET_COLUMN_TIMESTAMP_MS)
+			{
+				footer.FieldI32(6, PARQUET_CONVERTED_TIMESTAMP_MILLIS);
+			}
+			else if (column.type == PARQUET_COLUMN_STRING)
+			{
+				footer.FieldI32(6, PARQUET_CONVERTED_UTF8);
+			}
+			footer.StructEnd();
+		}
+
+		footer.FieldI64(3, (int64_t)totalRows);
+
+		footer.FieldListBegin(4, THRIFT_TYPE_STRUCT, m_rowGroups.size());
+		for (size_t groupIndex = 0; groupIndex < m_rowGroups.size(); ++groupIndex)
+		{
+			const ParquetRowGroup& rowGroup = m_rowGroups.at(groupIndex);
+			uint64_t totalByteSize = 0;
+
+			footer.StructBegin(); // RowGroup
+			footer.FieldListBegin(1, THRIFT_TYPE_STRUCT, rowGroup.size());
+			for (auto iter = rowGroup.begin(); iter != rowGroup.end(); ++iter)
+			{
+				const ParquetColumn& column = (*iter);
+
+				totalByteSize += column.uncompressedSize;
+
+				footer.StructBegin(); // ColumnChunk
+				footer.FieldI64(2, (int64_t)column.dataPageOffset);
+				footer.FieldStructBegin(3); // ColumnMetaData
+				footer.FieldI32(1, PhysicalType(column.type));
+				footer.FieldListBegin(2, THRIFT_TYPE_I32, 2);
+				footer.ElementI32(PARQUET_ENCODING_PLAIN);
+				footer.ElementI32(PARQUET_ENCODING_RLE);
+				footer.FieldListBegin(3, THRIFT_TYPE_BINARY, 1);
+				footer.ElementBinary(column.name);
+				footer.FieldI32(4, PARQUET_CODEC_GZIP);
+				footer.FieldI64(5, (int64_t)m_rowGroupSizes.at(groupIndex));
+				footer.FieldI64(6, (int64_t)column.uncompressedSize);
+				footer.FieldI64(7, (int64_t)column.compressedSize);
+				footer.FieldI64(9, (int64_t)column.dataPageOffset);
+				footer.FieldStructBegin(12); // Statistics
+				footer.FieldI64(3, (int64_t)column.nullCount);
+				if (column.maxValue.size() > 0)
+				{
+					footer.FieldBinary(5, column.maxValue);
+					footer.FieldBinary(6, column.minValue);
+				}
+				footer.StructEnd();
+				footer.StructEnd();
+				footer.StructEnd();
+			}
+			footer.FieldI64(2, (int64_t)totalByteSize);
+			footer.FieldI64(3, (int64_t)m_rowGroupSizes.at(groupIndex));
+			footer.StructEnd();
+		}
+
+		footer.FieldBinary(6, "Straen");
+
+		// Readers ignore the min/max statistics unless told the columns use the type defined sort order.
+		footer.FieldListBegin(7, THRIFT_TYPE_STRUCT, schema.size());
+		for (size_t i = 0; i < schema.size(); ++i)
+		{
+			footer.StructBegin();       // ColumnOrder
+			footer.FieldStructBegin(1); // TypeDefinedOrder
+			footer.StructEnd();
+			footer.StructEnd();
+		}
+		footer.StructEnd();
+
+		std::string trailer;
+		AppendU32(trailer, (uint32_t)footer.Buffer().size());
+		trailer.append(PARQUET_MAGIC);
+
+		m_rowGroups.clear();
+		m_rowGroupSizes.clear();
+
+		return WriteBytes(footer.Buffer()) && WriteBytes(trailer);
+	}
+}
@@ -0,0 +1,79 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __PARQUETFILEWRITER__
+#define __PARQUETFILEWRITER__
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "File.h"
+
+namespace FileLib
+{
+	typedef enum ParquetColumnType
+	{
+		PARQUET_COLUMN_TIMESTAMP_MS, // INT64, annotated as milliseconds since the epoch
+		PARQUET_COLUMN_DOUBLE,
+		PARQUET_COLUMN_STRING        // BYTE_ARRAY, annotated as UTF8
+	} ParquetColumnType;
+
+	typedef struct ParquetColumn
+	{
+		std::string       name;
+		ParquetColumnType type;
+		bool              optional; // TRUE if the column may contain nulls
+
+		// Only the vector matching the type is used. For optional columns, values are only
+		// stored for rows where defined[row] is TRUE.
+		std::vector<int64_t>     intValues;
+		std::vector<double>      doubleValues;
+		std::vector<std::string> stringValues;
+		std::vector<bool>        defined;
+
+		// Filled in by the writer.
+		uint64_t    dataPageOffset;
+		uint64_t    uncompressedSize;
+		uint64_t    compressedSize;
+		uint64_t    nullCount;
+		std::string minValue; // Plain encoded statistics, numeric columns only
+		std::string maxValue;
+	} ParquetColumn;
+
+	typedef std::vector<ParquetColumn> ParquetRowGroup;
+
+	/**
+	* Writes Apache Parquet files (plain encoding, one gzip compressed data page per column chunk).
+	* The result can be memory mapped and queried in place by tools like pandas, pyarrow and DuckDB.
+	* Every row group must use the same column names, types and order.
+	*/
+	class ParquetFileWriter : public File
+	{
+	public:
+		ParquetFileWriter();
+		virtual ~ParquetFileWriter();
+
+		bool CreateFile(const std::string& fileName);
+		bool CloseFile();
+
+		bool WriteRowGroup(ParquetRowGroup& columns, size_t numRows);
+
+	private:
+		std::vector<ParquetRowGroup> m_rowGroups;     // Chunk metadata for each row group written so far, values are not retained
+		std::vector<size_t>          m_rowGroupSizes; // Number of rows in each row group
+		uint64_t                     m_bytesWritten;
+
+		bool WriteBytes(const std::string& bytes);
+		bool WriteColumnChunk(ParquetColumn& column, size_t numRows);
+		bool WriteFooter();
+	};
+}
+
+#endif
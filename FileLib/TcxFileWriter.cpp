@@ -63,13 +63,17 @@ namespace FileLib
 
 	bool TcxFileWriter::CloseFile()
 	{
-		return CloseAllTags();
+		bool result = CloseAllTags();
+		result &= File::CloseFile();
+		return result;
 	}
 
 	bool TcxFileWriter::WriteId(time_t startTime)
 	{
+		struct tm startTm;
 		char buf[32];
-		strftime(buf, sizeof(buf) - 1, "%Y-%m-%dT%H:%M:%SZ", gmtime(&startTime));
+		gmtime_r(&startTime, &startTm);
+		strftime(buf, sizeof(buf) - 1, "%Y-%m-%dT%H:%M:%SZ", &startTm);
 		return WriteTagAndValue(TCX_TAG_NAME_ID, buf);
 	}
 
@@ -262,8 +266,10 @@ namespace FileLib
 
 	std::string TcxFileWriter::FormatTimeSec(time_t t)
 	{
+		struct tm tTm;
 		char buf[32];
-		strftime(buf, sizeof(buf) - 1, "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+		gmtime_r(&t, &tTm);
+		strftime(buf, sizeof(buf) - 1, "%Y-%m-%dT%H:%M:%SZ", &tTm);
 		return buf;
 	}
 
@@ -272,8 +278,10 @@ namespace FileLib
 		time_t sec  = (time_t)(t / 1000);
 		uint16_t ms = t % 1000;
 
+		struct tm secTm;
 		char buf1[32];
-		strftime(buf1, sizeof(buf1) - 1, "%Y-%m-%dT%H:%M:%S", gmtime(&sec));
+		gmtime_r(&sec, &secTm);
+		strftime(buf1, sizeof(buf1) - 1, "%Y-%m-%dT%H:%M:%S", &secTm);
 
 		char buf2[32];
 		snprintf(buf2, sizeof(buf2) - 1, "%s.%04uZ", buf1, ms);
@@ -0,0 +1,220 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "ZipFileWriter.h"
+
+#define ZIP_LOCAL_HEADER_SIG       0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG     0x02014b50
+#define ZIP_END_OF_DIRECTORY_SIG   0x06054b50
+#define ZIP_VERSION                20
+#define ZIP_FLAG_UTF8_NAMES        0x0800
+#define ZIP_METHOD_STORED          0
+#define ZIP_METHOD_DEFLATED        8
+#define ZIP_MAX_ENTRIES            0xffff
+#define ZIP_MAX_OFFSET             0xffffffff
+
+namespace FileLib
+{
+	static void AppendU16(std::string& buf, uint16_t value)
+	{
+		buf.push_back((char)(value & 0xff));
+		buf.push_back((char)((value >> 8) & 0xff));
+	}
+
+	static void AppendU32(std::string& buf, uint32_t value)
+	{
+		AppendU16(buf, (uint16_t)(value & 0xffff));
+		AppendU16(buf, (uint16_t)((value >> 16) & 0xffff));
+	}
+
+	ZipFileWriter::ZipFileWriter()
+	{
+		m_bytesWritten = 0;
+	}
+
+	ZipFileWriter::~ZipFileWriter()
+	{
+		CloseFile();
+	}
+
+	bool ZipFileWriter::CreateFile(const std::string& fileName)
+	{
+		m_directory.clear();
+		m_bytesWritten = 0;
+		return File::CreateFile(fileName);
+	}
+
+	bool ZipFileWriter::CloseFile()
+	{
+		if (!IsOpen())
+		{
+			return false;
+		}
+
+		bool result = WriteCentralDirectory();
+		result &= File::CloseFile();
+		return result;
+	}
+
+	bool ZipFileWriter::PrepareEntry(const std::string& name, const std::string& contents, time_t modTime, ZipEntry& entry)
+	{
+		if (contents.size() > ZIP_MAX_OFFSET)
+		{
+			return false;
+		}
+
+		struct tm modTm;
+		localtime_r(&modTime, &modTm);
+
+		entry.name = name;
+		entry.crc = (uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef*)contents.data(), (uInt)contents.size());
+		entry.uncompressedSize = (uint32_t)contents.size();
+		entry.dosTime = (uint16_t)((modTm.tm_hour << 11) | (modTm.tm_min << 5) | (modTm.tm_sec / 2));
+		entry.dosDate = (uint16_t)(((modTm.tm_year > 80 ? modTm.tm_year - 80 : 0) << 9) | ((modTm.tm_mon + 1) << 5) | modTm.tm_mday);
+		entry.offset = 0;
+
+		// Raw deflate (negative window bits), since the zip headers take the place of the zlib wrapper.
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+
+		if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			return false;
+		}
+
+		entry.data.resize(deflateBound(&stream, (uLong)contents.size()));
+		stream.next_in = (Bytef*)contents.data();
+		stream.avail_in = (uInt)contents.size();
+		stream.next_out = (Bytef*)&entry.data[0];
+		stream.avail_out = (uInt)entry.data.size();
+
+		int status = deflate(&stream, Z_FINISH);
+		size_t compressedSize = stream.total_out;
+		deflateEnd(&stream);
+
+		// Fall back to storing the data if it didn't compress.
+		if ((status == Z_STREAM_END) && (compressedSize < contents.size()))
+		{
+			entry.data.resize(compressedSize);
+			entry.method = ZIP_METHOD_DEFLATED;
+		}
+		else
+		{
+			entry.data = contents;
+			entry.method = ZIP_METHOD_STORED;
+		}
+		entry.compressedSize = (uint32_t)entry.data.size();
+		return true;
+	}
+
+	bool ZipFileWriter::WriteEntry(const ZipEntry& entry)
+	{
+		if ((m_directory.size() >= ZIP_MAX_ENTRIES) || (m_bytesWritten > ZIP_MAX_OFFSET))
+		{
+			return false;
+		}
+
+		std::string header;
+		AppendU32(header, ZIP_LOCAL_HEADER_SIG);
+		AppendU16(header, ZIP_VERSION);
+		AppendU16(header, ZIP_FLAG_UTF8_NAMES);
+		AppendU16(header, entry.method);
+		AppendU16(header, entry.dosTime);
+		AppendU16(header, entry.dosDate);
+		AppendU32(header, entry.crc);
+		AppendU32(header, entry.compressedSize);
+		AppendU32(header, entry.uncompressedSize);
+		AppendU16(header, (uint16_t)entry.name.size());
+		AppendU16(header, 0); // extra field length
+		header.append(entry.name);
+
+		ZipEntry record = entry;
+		record.offset = (uint32_t)m_bytesWritten;
+		record.data.clear();
+
+		if (WriteBytes(header) && WriteBytes(entry.data))
+		{
+			m_directory.push_back(record);
+			return true;
+		}
+		return false;
+	}
+
+	bool ZipFileWriter::AddFile(const std::string& name, const std::string& contents, time_t modTime)
+	{
+		ZipEntry entry;
+
+		if (PrepareEntry(name, contents, modTime, entry))
+		{
+			return WriteEntry(entry);
+		}
+		return false;
+	}
+
+	bool ZipFileWriter::WriteBytes(const std::string& bytes)
+	{
+		if (File::WriteString(bytes))
+		{
+			m_bytesWritten += bytes.size();
+			return true;
+		}
+		return false;
+	}
+
+	bool ZipFileWriter::WriteCentralDirectory()
+	{
+		uint64_t directoryOffset = m_bytesWritten;
+		std::string directory;
+
+		if (directoryOffset > ZIP_MAX_OFFSET)
+		{
+			return false;
+		}
+
+		for (auto iter = m_directory.begin(); iter != m_directory.end(); ++iter)
+		{
+			const ZipEntry& entry = (*iter);
+
+			AppendU32(directory, ZIP_CENTRAL_HEADER_SIG);
+			AppendU16(directory, ZIP_VERSION); // version made by
+			AppendU16(directory, ZIP_VERSION); // version needed to extract
+			AppendU16(directory, ZIP_FLAG_UTF8_NAMES);
+			AppendU16(directory, entry.method);
+			AppendU16(directory, entry.dosTime);
+			AppendU16(directory, entry.dosDate);
+			AppendU32(directory, entry.crc);
+			AppendU32(directory, entry.compressedSize);
+			AppendU32(directory, entry.uncompressedSize);
+			AppendU16(directory, (uint16_t)entry.name.size());
+			AppendU16(directory, 0); // extra field length
+			AppendU16(directory, 0); // comment length
+			AppendU16(directory, 0); // disk number
+			AppendU16(directory, 0); // internal attributes
+			AppendU32(directory, 0); // external attributes
+			AppendU32(directory, entry.offset);
+			directory.append(entry.name);
+		}
+
+		uint32_t directorySize = (uint32_t)directory.size();
+
+		AppendU32(directory, ZIP_END_OF_DIRECTORY_SIG);
+		AppendU16(directory, 0); // this disk
+		AppendU16(directory, 0); // disk with the central directory
+		AppendU16(directory, (uint16_t)m_directory.size());
+		AppendU16(directory, (uint16_t)m_directory.size());
+		AppendU32(directory, directorySize);
+		AppendU32(directory, (uint32_t)directoryOffset);
+		AppendU16(directory, 0); // comment length
+
+		m_directory.clear();
+		return WriteBytes(directory);
+	}
+}
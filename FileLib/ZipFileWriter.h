@@ -0,0 +1,59 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __ZIPFILEWRITER__
+#define __ZIPFILEWRITER__
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "File.h"
+
+namespace FileLib
+{
+	// An archive member that has already been compressed, so that the (expensive) compression
+	// step can happen on any thread and only the (cheap) write needs to be serialized.
+	typedef struct ZipEntry
+	{
+		std::string name;
+		std::string data;             // Compressed (or stored) bytes
+		uint32_t    crc;              // CRC-32 of the uncompressed bytes
+		uint32_t    compressedSize;
+		uint32_t    uncompressedSize;
+		uint16_t    method;           // 0 = stored, 8 = deflated
+		uint16_t    dosTime;
+		uint16_t    dosDate;
+		uint32_t    offset;           // Offset of the local header, filled in by WriteEntry
+	} ZipEntry;
+
+	// Writes a plain (non-zip64) zip archive, so it is limited to 65535 members and 4 GB.
+	class ZipFileWriter : public File
+	{
+	public:
+		ZipFileWriter();
+		virtual ~ZipFileWriter();
+
+		bool CreateFile(const std::string& fileName);
+		bool CloseFile();
+
+		static bool PrepareEntry(const std::string& name, const std::string& contents, time_t modTime, ZipEntry& entry);
+		bool WriteEntry(const ZipEntry& entry);
+		bool AddFile(const std::string& name, const std::string& contents, time_t modTime);
+
+	private:
+		std::vector<ZipEntry> m_directory; // Central directory records, data is not retained
+		uint64_t m_bytesWritten;
+
+		bool WriteBytes(const std::string& bytes);
+		bool WriteCentralDirectory();
+	};
+}
+
+#endif
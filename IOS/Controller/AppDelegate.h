@@ -141,6 +141,7 @@
 // methods for loading and editing historical activities
 
 - (NSInteger)initializeHistoricalActivityList;
+- (BOOL)isReprocessingActivities;
 - (NSString*)getNextActivityId;
 - (NSInteger)getNumHistoricalActivities;
 - (NSInteger)getNumHistoricalActivityLocationPoints:(NSString*)activityId;
@@ -149,6 +150,8 @@
 - (BOOL)isHealthKitActivity:(NSString*)activityId;
 - (BOOL)loadHistoricalActivityByIndex:(NSInteger)activityIndex;
 - (BOOL)loadHistoricalActivity:(NSString*)activityId;
+- (uint64_t)loadHistoricalActivityAsync:(NSString*)activityId withCompletion:(void (^)(BOOL loaded))completion;
+- (void)cancelHistoricalActivityLoad:(uint64_t)loadHandle;
 - (void)loadHistoricalActivitySummaryData:(NSString*)activityId;
 - (void)saveHistoricalActivitySummaryData:(NSString*)activityId;
 - (void)getHistoricalActivityStartAndEndTime:(NSString*)activityId withStartTime:(time_t*)startTime withEndTime:(time_t*)endTime;
@@ -197,6 +200,7 @@
 - (BOOL)deleteFile:(NSString*)fileName;
 - (BOOL)exportFileToCloudService:(NSString*)fileName toService:(NSString*)serviceName;
 - (NSString*)exportActivityToTempFile:(NSString*)activityId withFileFormat:(FileFormat)format;
+- (NSData*)exportActivityToData:(NSString*)activityId withFileFormat:(FileFormat)format compressed:(BOOL)compress;
 - (NSString*)exportActivitySummary:(NSString*)activityType;
 - (void)clearExportDir;
 
@@ -62,6 +62,18 @@
 	return YES;
 }
 
+void reprocessProgressCallback(size_t numCompleted, size_t numTotal, void* context)
+{
+	NSDictionary* progressData = [[NSDictionary alloc] initWithObjectsAndKeys:
+								  [NSNumber numberWithUnsignedLong:numCompleted], @KEY_NAME_NUM_COMPLETED,
+								  [NSNumber numberWithUnsignedLong:numTotal], @KEY_NAME_NUM_TOTAL,
+								  nil];
+
+	dispatch_async(dispatch_get_main_queue(), ^{
+		[[NSNotificationCenter defaultCenter] postNotificationName:@NOTIFICATION_NAME_REPROCESSING_PROGRESS object:progressData];
+	});
+}
+
 - (BOOL)application:(UIApplication*)application didFinishLaunchingWithOptions:(NSDictionary*)launchOptions
 {	
 	NSArray*  paths = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES);
@@ -70,6 +82,21 @@
 
 	Initialize([dbFileName UTF8String]);
 
+	// Activities saved by older versions are missing the newer summary attributes, such as the training stress that the
+	// training load history is built from. Only those are reprocessed, and an interrupted run picks up where it left off.
+	// Once they are all done, a launch does nothing more than check their versions.
+	dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+		if (IsActivityReprocessingNeeded())
+		{
+			reprocessProgressCallback(0, 0, NULL);
+			ReprocessAllActivities(false, reprocessProgressCallback, NULL);
+
+			dispatch_async(dispatch_get_main_queue(), ^{
+				[[NSNotificationCenter defaultCenter] postNotificationName:@NOTIFICATION_NAME_REPROCESSING_FINISHED object:nil];
+			});
+		}
+	});
+
 	[self configureWatchSession];
 	[self clearExportDir];
 
@@ -171,6 +198,7 @@
 - (void)applicationWillTerminate:(UIApplication*)application
 {
 	// Called when the application is about to terminate. Save data if appropriate. See also applicationDidEnterBackground.
+	CancelReprocessAllActivities();
 	[self stopSensors];
 }
 
@@ -1161,6 +1189,12 @@ void startSensorCallback(SensorType type, void* context)
 	return 0;
 }
 
+// True while the summaries written by an older version of the app are being recomputed.
+- (BOOL)isReprocessingActivities
+{
+	return IsReprocessingActivities();
+}
+
 - (NSString*)getNextActivityId
 {
 	if (self->currentActivityIndex < [self getNumHistoricalActivities])
@@ -1294,27 +1328,33 @@ void startSensorCallback(SensorType type, void* context)
 		LoadHistoricalActivitySummaryData(activityIndex);
 		if (LoadAllHistoricalActivitySensorData(activityIndex))
 		{
-			time_t startTime = 0;
-			time_t endTime = 0;
+			result = [self finishLoadingHistoricalActivityByIndex:activityIndex];
+		}
+	}
+	return result;
+}
 
-			GetHistoricalActivityStartAndEndTime(activityIndex, &startTime, &endTime);
-			
-			// If the activity was orphaned then the end time will be zero.
-			if (endTime == 0)
-			{
-				FixHistoricalActivityEndTime(activityIndex);
-			}
+// Everything that's left to do once the sensor data is loaded.
+- (BOOL)finishLoadingHistoricalActivityByIndex:(NSInteger)activityIndex
+{
+	time_t startTime = 0;
+	time_t endTime = 0;
 
-			if (SaveHistoricalActivitySummaryData(activityIndex))
-			{
-				LoadHistoricalActivitySummaryData(activityIndex);
-				LoadHistoricalActivityLapData(activityIndex);
+	GetHistoricalActivityStartAndEndTime(activityIndex, &startTime, &endTime);
 
-				result = TRUE;
-			}
-		}
+	// If the activity was orphaned then the end time will be zero.
+	if (endTime == 0)
+	{
+		FixHistoricalActivityEndTime(activityIndex);
 	}
-	return result;
+
+	if (SaveHistoricalActivitySummaryData(activityIndex))
+	{
+		LoadHistoricalActivitySummaryData(activityIndex);
+		LoadHistoricalActivityLapData(activityIndex);
+		return TRUE;
+	}
+	return FALSE;
 }
 
 - (BOOL)loadHistoricalActivity:(NSString*)activityId
@@ -1336,6 +1376,76 @@ void startSensorCallback(SensorType type, void* context)
 	return FALSE;
 }
 
+void historicalActivityLoadCallback(HistoryLoadHandle handle, HistoryLoadState state, const Coordinate* points, size_t numPoints, void* context)
+{
+	// The batches of points are for drawing the route while it loads, only the outcome is needed here.
+	if (state == HISTORY_LOAD_IN_PROGRESS)
+	{
+		return;
+	}
+
+	// The outcome is reported exactly once, so this is where the block handed to the load is released.
+	void (^finish)(void) = CFBridgingRelease(context);
+
+	dispatch_async(dispatch_get_main_queue(), ^{
+		finish();
+	});
+}
+
+// Same as loadHistoricalActivity, except that the sensor data is read on a worker thread. Must be called on the main
+// thread, the completion is called on the main thread as well. Returns a handle for cancelling the load, or zero if
+// there was nothing to load.
+- (uint64_t)loadHistoricalActivityAsync:(NSString*)activityId withCompletion:(void (^)(BOOL loaded))completion
+{
+	@synchronized(self)
+	{
+		size_t activityIndex = ConvertActivityIdToActivityIndex([activityId UTF8String]);
+
+		// If the activity is not in the database, (i.e. it's from HealthKit), then there's nothing to load.
+		if (activityIndex == ACTIVITY_INDEX_UNKNOWN)
+		{
+			completion(TRUE);
+			return 0;
+		}
+
+		// The stored summary is given to the loaded activity object when the load is finished.
+		LoadHistoricalActivitySummaryData(activityIndex);
+
+		__block HistoryLoadHandle handle = 0;
+		void (^finish)(void) = ^{
+			BOOL result = FALSE;
+
+			@synchronized(self)
+			{
+				// Frees the handle whatever the outcome. The index is looked up again, since the history may have
+				// changed while the load was running.
+				if (FinishHistoricalActivityLoad(handle))
+				{
+					result = [self finishLoadingHistoricalActivityByIndex:ConvertActivityIdToActivityIndex([activityId UTF8String])];
+				}
+			}
+			completion(result);
+		};
+
+		// The block can't run before the handle is set, since it's queued to this thread.
+		void* context = (void*)CFBridgingRetain([finish copy]);
+		handle = LoadAllHistoricalActivitySensorDataAsync(activityIndex, historicalActivityLoadCallback, context);
+		if (handle == 0)
+		{
+			// Never started, so the callback won't be called to release the block.
+			CFBridgingRelease(context);
+			completion(FALSE);
+		}
+		return handle;
+	}
+	return 0;
+}
+
+- (void)cancelHistoricalActivityLoad:(uint64_t)loadHandle
+{
+	CancelHistoricalActivityLoad(loadHandle);
+}
+
 - (void)loadHistoricalActivitySummaryData:(NSString*)activityId
 {
 	@synchronized(self)
@@ -1812,6 +1922,19 @@ void startSensorCallback(SensorType type, void* context)
 	return exportFileName;
 }
 
+- (NSData*)exportActivityToData:(NSString*)activityId withFileFormat:(FileFormat)format compressed:(BOOL)compress
+{
+	NSData* exportData = nil;
+	uint8_t* buffer = NULL;
+	size_t bufferLen = 0;
+
+	if (ExportActivityFromDatabaseToBuffer([activityId UTF8String], format, compress, &buffer, &bufferLen))
+	{
+		exportData = [NSData dataWithBytesNoCopy:buffer length:bufferLen freeWhenDone:YES];
+	}
+	return exportData;
+}
+
 - (NSString*)exportActivitySummary:(NSString*)activityType
 {	
 	NSString* exportFileName = nil;
@@ -2277,12 +2400,8 @@ void attributeNameCallback(const char* name, void* context)
 - (BOOL)generateWorkouts
 {
 	// Gather inputs from HealthKit.
-	
-	// Load raw data from the local database.
-	InitializeHistoricalActivityList();
-	LoadAllHistoricalActivitySummaryData();
 
-	// Run the algorithm.
+	// Run the algorithm. It reads what it needs from the local database, so history doesn't need to be loaded.
 	return GenerateWorkouts();
 }
 
@@ -2518,7 +2637,7 @@ void attributeNameCallback(const char* name, void* context)
 					{
 						if ([locationPoints count] >= 5)
 						{
-							ProcessLocationReading([locationPoints[0] doubleValue], [locationPoints[1] doubleValue], [locationPoints[2] doubleValue], [locationPoints[3] longLongValue], [locationPoints[4] longLongValue], [locationPoints[5] longLongValue]);
+							ProcessImportedLocationReading([locationPoints[0] doubleValue], [locationPoints[1] doubleValue], [locationPoints[2] doubleValue], [locationPoints[3] longLongValue], [locationPoints[4] longLongValue], [locationPoints[5] longLongValue]);
 						}
 					}
 				}
@@ -39,9 +39,12 @@
 	NSMutableArray*            attributesToDisplay;
 	NSMutableArray*            valueLabels;
 	NSMutableArray*            titleLabels;
+	NSMutableDictionary*       attributeIds;
 	NSMutableArray*            unitsLabels;
 	NSMutableArray*            messages;
 	uint8_t                    messageDisplayCounter;
+	uint64_t                   lastNumDroppedReadings;
+	uint64_t                   lastNumUnsavedReadings;
 	uint8_t                    numAttributes;
 	double                     lastHeartRateValue;
 	double                     lastCadenceValue;
@@ -51,6 +51,8 @@
 #define INTERVAL_COMPLETE             NSLocalizedString(@"Interval Workout Complete", nil)
 
 #define MESSAGE_BAD_GPS               NSLocalizedString(@"Poor GPS Signal", nil)
+#define MESSAGE_DROPPED_READINGS      NSLocalizedString(@"Some sensor readings were lost", nil)
+#define MESSAGE_UNSAVED_READINGS      NSLocalizedString(@"Some sensor readings could not be saved", nil)
 #define MESSAGE_NO_LOCATION_SERVICES  NSLocalizedString(@"Location Services is disabled", nil)
 
 #define SECS_PER_MESSAGE              3
@@ -95,6 +97,7 @@
 	AppDelegate* appDelegate = (AppDelegate*)[[UIApplication sharedApplication] delegate];
 	self->activityPrefs = [[ActivityPreferences alloc] initWithBT:[appDelegate hasLeBluetooth]];
 	self->messages = [[NSMutableArray alloc] init];
+	self->attributeIds = [[NSMutableDictionary alloc] init];
 
 	[self.moreButton setTitle:BUTTON_TITLE_MORE];
 	[self.lapButton setTitle:BUTTON_TITLE_LAP];
@@ -308,6 +311,31 @@
 {
 	@synchronized(self->messages)
 	{
+		// Let the user know if live readings have been dropped since the last check.
+		uint64_t numDroppedReadings = GetSensorReadingQueueOverflowCount();
+		if (numDroppedReadings > self->lastNumDroppedReadings)
+		{
+			NSString* msg = [[NSString alloc] initWithString:MESSAGE_DROPPED_READINGS];
+			if (![self->messages containsObject:msg])
+			{
+				[self->messages addObject:msg];
+			}
+			self->lastNumDroppedReadings = numDroppedReadings;
+		}
+
+		// Same for readings the database wouldn't take.
+		SensorWriterStats writerStats;
+		GetSensorWriterStats(&writerStats);
+		if (writerStats.numFailed > self->lastNumUnsavedReadings)
+		{
+			NSString* msg = [[NSString alloc] initWithString:MESSAGE_UNSAVED_READINGS];
+			if (![self->messages containsObject:msg])
+			{
+				[self->messages addObject:msg];
+			}
+			self->lastNumUnsavedReadings = writerStats.numFailed;
+		}
+
 		if (([self->messages count] > 0) && (self->messageDisplayCounter == 0))
 		{
 			NSString* msg = [self->messages objectAtIndex:0];
@@ -331,6 +359,11 @@
 - (void)startTimer
 {
 	self->messageDisplayCounter = 0;
+	self->lastNumDroppedReadings = GetSensorReadingQueueOverflowCount();
+
+	SensorWriterStats writerStats;
+	GetSensorWriterStats(&writerStats);
+	self->lastNumUnsavedReadings = writerStats.numFailed;
 
 	self->refreshTimer = [[NSTimer alloc] initWithFireDate:[NSDate dateWithTimeIntervalSinceNow: 1.0]
 												  interval:1
@@ -919,6 +952,23 @@
 		[valueLabel setText:[[NSString alloc] initWithFormat:@"%0.0f", value]];
 }
 
+// The screen is refreshed several times a second, so the attribute names are only looked up the first time they're shown.
+- (ActivityAttributeId)attributeIdForName:(NSString*)attributeName
+{
+	if (!attributeName)
+	{
+		return ACTIVITY_ATTRIBUTE_ID_NOT_FOUND;
+	}
+
+	NSNumber* attributeId = [self->attributeIds objectForKey:attributeName];
+	if (!attributeId)
+	{
+		attributeId = [NSNumber numberWithUnsignedShort:GetActivityAttributeId([attributeName UTF8String])];
+		[self->attributeIds setObject:attributeId forKey:attributeName];
+	}
+	return [attributeId unsignedShortValue];
+}
+
 - (void)refreshScreen
 {
 	for (uint8_t i = 0; i < self->numAttributes; i++)
@@ -928,13 +978,13 @@
 
 		if (titleLabel && valueLabel)
 		{
-			ActivityAttributeType value = QueryLiveActivityAttribute([titleLabel.text cStringUsingEncoding:NSASCIIStringEncoding]);
+			ActivityAttributeType value = QueryLiveActivityAttributeById([self attributeIdForName:titleLabel.text]);
 
 			if ([titleLabel.text isEqualToString:@ACTIVITY_ATTRIBUTE_HEART_RATE])
 			{
 				AppDelegate* appDelegate = (AppDelegate*)[[UIApplication sharedApplication] delegate];
 				NSString* activityType = [appDelegate getCurrentActivityType];
-				ActivityAttributeType zoneValue = QueryLiveActivityAttribute(ACTIVITY_ATTRIBUTE_HEART_RATE_PERCENTAGE);
+				ActivityAttributeType zoneValue = QueryLiveActivityAttributeById([self attributeIdForName:@ACTIVITY_ATTRIBUTE_HEART_RATE_PERCENTAGE]);
 
 				if ([self->activityPrefs getShowHeartRatePercent:activityType] && zoneValue.valid)
 				{
@@ -8,11 +8,13 @@
 #import "HistoryViewController.h"
 #import "AppDelegate.h"
 #import "AppStrings.h"
+#import "Notifications.h"
 #import "Segues.h"
 #import "StaticSummaryViewController.h"
 #import "StringUtils.h"
 
 #define TITLE                       NSLocalizedString(@"History", nil)
+#define TITLE_REPROCESSING          NSLocalizedString(@"Updating Summaries", nil)
 
 #define ACTION_SHEET_TITLE_ACTIVITY NSLocalizedString(@"Export", nil)
 #define ACTION_SHEET_TITLE_EXPORT   NSLocalizedString(@"Export using", nil)
@@ -100,6 +102,16 @@
 	AppDelegate* appDelegate = (AppDelegate*)[[UIApplication sharedApplication] delegate];
 	[appDelegate initializeHistoricalActivityList];
 
+	// The summaries are still being recomputed, so what's shown may change when that finishes.
+	if ([appDelegate isReprocessingActivities])
+	{
+		self.title = TITLE_REPROCESSING;
+		[self.spinner startAnimating];
+	}
+
+	[[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(reprocessingProgress:) name:@NOTIFICATION_NAME_REPROCESSING_PROGRESS object:nil];
+	[[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(reprocessingFinished:) name:@NOTIFICATION_NAME_REPROCESSING_FINISHED object:nil];
+
 	[self buildDictionary];
 	[self.historyTableView reloadData];
 }
@@ -107,6 +119,8 @@
 - (void)viewDidDisappear:(BOOL)animated
 {
 	[super viewDidDisappear:animated];
+
+	[[NSNotificationCenter defaultCenter] removeObserver:self];
 }
 
 - (BOOL)shouldAutorotate
@@ -212,6 +226,38 @@
 	return [[[self->historyDictionary objectForKey:month] objectAtIndex:row] activityId];
 }
 
+#pragma mark methods for reporting on the summaries being recomputed
+
+- (void)reprocessingProgress:(NSNotification*)notification
+{
+	NSDictionary* progressData = [notification object];
+	NSNumber* numCompleted = [progressData objectForKey:@KEY_NAME_NUM_COMPLETED];
+	NSNumber* numTotal = [progressData objectForKey:@KEY_NAME_NUM_TOTAL];
+
+	if ([numTotal unsignedLongValue] > 0)
+	{
+		self.title = [NSString stringWithFormat:@"%@ (%lu/%lu)", TITLE_REPROCESSING, [numCompleted unsignedLongValue], [numTotal unsignedLongValue]];
+	}
+	else
+	{
+		self.title = TITLE_REPROCESSING;
+	}
+	[self.spinner startAnimating];
+}
+
+- (void)reprocessingFinished:(NSNotification*)notification
+{
+	self.title = TITLE;
+	[self.spinner stopAnimating];
+
+	// Picks up the new summaries.
+	AppDelegate* appDelegate = (AppDelegate*)[[UIApplication sharedApplication] delegate];
+	[appDelegate initializeHistoricalActivityList];
+
+	[self buildDictionary];
+	[self.historyTableView reloadData];
+}
+
 #pragma mark called when the user selects a row
 
 - (void)handleSelectedActivity:(NSIndexPath*)indexPath
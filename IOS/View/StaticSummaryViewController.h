@@ -41,6 +41,7 @@
 	NSString* selectedRowStr;
 
 	NSString* activityId;
+	uint64_t loadHandle;
 
 	time_t startTime;
 	time_t endTime;
@@ -124,6 +124,7 @@ typedef enum ExportFileTypeButtons
 	{
 		self->attributeIndex = 0;
 		self->activityId = nil;
+		self->loadHandle = 0;
 
 		self->startTime = 0;
 		self->endTime = 0;
@@ -178,7 +179,22 @@ typedef enum ExportFileTypeButtons
 		[self->liftingToolbar removeObjectIdenticalTo:self.bikeButton];
 	}
 
-	[self redraw];
+	// Reading the sensor data is the slow part of opening a long activity, so do it off the main thread.
+	[self.mapView setShowsUserLocation:FALSE];
+	self.spinner.hidden = FALSE;
+	[self.spinner startAnimating];
+
+	AppDelegate* appDelegate = (AppDelegate*)[[UIApplication sharedApplication] delegate];
+	self->loadHandle = [appDelegate loadHistoricalActivityAsync:self->activityId withCompletion:^(BOOL loaded) {
+		self->loadHandle = 0;
+		[self.spinner stopAnimating];
+
+		if (loaded)
+		{
+			[self drawActivity];
+			[self.summaryTableView reloadData];
+		}
+	}];
 }
 
 - (void)viewDidAppear:(BOOL)animated
@@ -188,6 +204,17 @@ typedef enum ExportFileTypeButtons
 	[self.toolbar setTintColor:[UIColor blackColor]];
 }
 
+- (void)viewWillDisappear:(BOOL)animated
+{
+	// No point in finishing the load if the user has already backed out of the screen.
+	if (self->loadHandle && self.isMovingFromParentViewController)
+	{
+		AppDelegate* appDelegate = (AppDelegate*)[[UIApplication sharedApplication] delegate];
+		[appDelegate cancelHistoricalActivityLoad:self->loadHandle];
+	}
+	[super viewWillDisappear:animated];
+}
+
 - (void)viewDidDisappear:(BOOL)animated
 {
 	[super viewDidDisappear:animated];
@@ -215,6 +242,16 @@ typedef enum ExportFileTypeButtons
 	
 	AppDelegate* appDelegate = (AppDelegate*)[[UIApplication sharedApplication] delegate];
 	if (appDelegate && [appDelegate loadHistoricalActivity:self->activityId])
+	{
+		[self drawActivity];
+	}
+}
+
+// Everything that's drawn from the loaded activity.
+- (void)drawActivity
+{
+	AppDelegate* appDelegate = (AppDelegate*)[[UIApplication sharedApplication] delegate];
+	if (appDelegate)
 	{
 		self->attributeNames = [[NSMutableArray alloc] init];
 		self->recordNames = [[NSMutableArray alloc] init];
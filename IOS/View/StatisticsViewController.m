@@ -41,6 +41,12 @@ typedef enum Sections
 
 @end
 
+void BestRecordCallback(const char* activityId, time_t activityStartTime, ActivityAttributeType value, void* context)
+{
+	AttrDictItem* attrDictItem = (__bridge AttrDictItem*)context;
+	attrDictItem->value = value;
+	attrDictItem->activityId = [NSString stringWithFormat:@"%s", activityId];
+}
 
 @interface StatisticsViewController ()
 
@@ -69,9 +75,8 @@ typedef enum Sections
 	[self.navigationController.navigationBar setTintColor:[UIColor blackColor]];
 	[self.spinner stopAnimating];
 
+	// Totals and records are read from the database's aggregates, so only the activity list itself is needed.
 	InitializeHistoricalActivityList();
-	CreateAllHistoricalActivityObjects();
-	LoadAllHistoricalActivitySummaryData();
 	
 	[self buildAttributeDictionary];
 }
@@ -367,10 +372,15 @@ typedef enum Sections
 					attrDictItem->value = QueryBestActivityAttributeByActivityType(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, [sectionTitle UTF8String], false, &activityId);
 				else if ([attribute isEqualToString:SUMMARY_ATTRIBUTE_TOTAL_REPS])
 					attrDictItem->value = QueryActivityAttributeTotalByActivityType(ACTIVITY_ATTRIBUTE_REPS, [sectionTitle UTF8String]);
-				else if ([attribute isEqualToString:@ACTIVITY_ATTRIBUTE_FASTEST_SPEED])
-					attrDictItem->value = QueryBestActivityAttributeByActivityType([attribute UTF8String], [sectionTitle UTF8String], false, &activityId);
 				else
-					attrDictItem->value = QueryBestActivityAttributeByActivityType([attribute UTF8String], [sectionTitle UTF8String], true, &activityId);
+				{
+					// Records (fastest 5K, etc.) come from the personal records index, which already knows which way is best.
+					if (QueryPersonalRecords([attribute UTF8String], [sectionTitle UTF8String], 0, LONG_MAX, 1, BestRecordCallback, (__bridge void*)attrDictItem) == 0)
+					{
+						bool smallestIsBest = ![attribute isEqualToString:@ACTIVITY_ATTRIBUTE_FASTEST_SPEED];
+						attrDictItem->value = QueryBestActivityAttributeByActivityType([attribute UTF8String], [sectionTitle UTF8String], smallestIsBest, &activityId);
+					}
+				}
 			}
 			
 			if (activityId)
@@ -0,0 +1,174 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#import <XCTest/XCTest.h>
+#import "ActivityAttribute.h"
+#import "ActivityFactory.h"
+#import "ActivityReprocessor.h"
+#import "ActivityType.h"
+#import "Database.h"
+#import "TaskExecutor.h"
+#import "TestDatabase.h"
+
+#define TEST_NUM_ACTIVITIES  (2 * REPROCESS_MAX_PENDING + 2 * REPROCESS_BATCH_SIZE) // More than can be done before a cancel is noticed
+#define TEST_NUM_POINTS      60
+
+@interface ActivityReprocessorTest : XCTestCase
+
+@end
+
+@implementation ActivityReprocessorTest
+
+typedef struct ReprocessProgress
+{
+	ActivityReprocessor* reprocessor; // Cancelled after the first batch, if set
+	size_t               numCalls;
+	size_t               lastTotal;
+} ReprocessProgress;
+
+// A run of TEST_NUM_POINTS one second apart, heading north.
+static bool CreateRun(Database& db, const std::string& activityId, time_t startTime)
+{
+	bool result = db.StartActivity(activityId, "", ACTIVITY_TYPE_RUNNING, startTime);
+
+	for (size_t i = 0; i < TEST_NUM_POINTS && result; ++i)
+	{
+		SensorReading reading;
+		reading.type = SENSOR_TYPE_LOCATION;
+		reading.time = (uint64_t)startTime * 1000 + i * 1000;
+		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_LATITUDE, 40.0 + i * 0.00003));
+		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_LONGITUDE, -80.0));
+		reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_ALTITUDE, 300.0));
+		result = db.CreateSensorReading(activityId, reading);
+	}
+	return result && db.StopActivity(startTime + TEST_NUM_POINTS, activityId);
+}
+
+static size_t NumActivitiesToReprocess(Database& db)
+{
+	ActivitySummaryList activities;
+	db.RetrieveActivitiesWithOldSummaries(SUMMARY_ALGORITHM_VERSION, activities);
+	return activities.size();
+}
+
+static void ProgressCallback(size_t numCompleted, size_t numTotal, void* context)
+{
+	ReprocessProgress* progress = (ReprocessProgress*)context;
+
+	++progress->numCalls;
+	progress->lastTotal = numTotal;
+
+	if (progress->reprocessor)
+	{
+		progress->reprocessor->Cancel();
+	}
+}
+
+- (void)setUp
+{
+	// Put setup code here. This method is called before the invocation of each test method in the class.
+}
+
+- (void)tearDown
+{
+	// Put teardown code here. This method is called after the invocation of each test method in the class.
+}
+
+- (void)testResumeAfterCancel
+{
+	// A cancelled run keeps what it has written, and the next run only does the activities that are left.
+	std::string dbFileName = TemporaryFileName(@"ActivityReprocessorTest.db");
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, dbFileName));
+
+	XCTAssert(db.BeginTransaction());
+	for (size_t i = 0; i < TEST_NUM_ACTIVITIES; ++i)
+	{
+		XCTAssert(CreateRun(db, std::to_string(6000 + i), TEST_START_TIME + i * TEST_DAY));
+	}
+	XCTAssert(db.CommitTransaction());
+	XCTAssertEqual(NumActivitiesToReprocess(db), TEST_NUM_ACTIVITIES);
+	XCTAssert(db.HasActivitiesWithOldSummaries(SUMMARY_ALGORITHM_VERSION));
+
+	ActivityFactory factory;
+	TaskExecutor executor(2);
+
+	ActivityReprocessor cancelledReprocessor;
+	ReprocessProgress progress = { &cancelledReprocessor, 0, 0 };
+	XCTAssertFalse(cancelledReprocessor.ReprocessAllFromDatabase(dbFileName, true, factory, executor, ProgressCallback, &progress));
+	XCTAssert(progress.numCalls > 0);
+	XCTAssertEqual(progress.lastTotal, TEST_NUM_ACTIVITIES);
+
+	size_t numLeft = NumActivitiesToReprocess(db);
+	XCTAssert(numLeft > 0);
+	XCTAssert(numLeft <= TEST_NUM_ACTIVITIES - REPROCESS_BATCH_SIZE);
+
+	ActivityReprocessor resumedReprocessor;
+	progress = { NULL, 0, 0 };
+	XCTAssert(resumedReprocessor.ReprocessAllFromDatabase(dbFileName, false, factory, executor, ProgressCallback, &progress));
+	XCTAssertEqual(progress.lastTotal, numLeft);
+	XCTAssertEqual(NumActivitiesToReprocess(db), 0);
+	XCTAssertFalse(db.HasActivitiesWithOldSummaries(SUMMARY_ALGORITHM_VERSION));
+
+	// Every activity has its summary, whichever run did it.
+	for (size_t i = 0; i < TEST_NUM_ACTIVITIES; ++i)
+	{
+		SummaryAttributeMap values;
+		XCTAssert(db.RetrieveSummaryData(std::to_string(6000 + i), values));
+
+		const ActivityAttributeType* distance = values.Find(ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED);
+		XCTAssert(distance && distance->valid && (distance->value.doubleVal > 0.0));
+	}
+
+	// Nothing is left for a third run to do.
+	ActivityReprocessor idleReprocessor;
+	progress = { NULL, 0, 0 };
+	XCTAssert(idleReprocessor.ReprocessAllFromDatabase(dbFileName, false, factory, executor, ProgressCallback, &progress));
+	XCTAssertEqual(progress.numCalls, 0);
+}
+
+- (void)testKeepsUserEnteredValues
+{
+	// Values the user entered aren't in the sensor data, so reprocessing has to carry them over from the stored summary.
+	std::string dbFileName = TemporaryFileName(@"ActivityReprocessorTest.db");
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, dbFileName));
+
+	const std::string activityId = "7000";
+	XCTAssert(db.StartActivity(activityId, "", ACTIVITY_TYPE_PUSHUP, TEST_START_TIME));
+	XCTAssert(db.StopActivity(TEST_START_TIME + TEST_HOUR, activityId));
+
+	ActivityAttributeType repsCorrected;
+	repsCorrected.value.intVal = 42;
+	repsCorrected.valueType = TYPE_INTEGER;
+	repsCorrected.measureType = MEASURE_COUNT;
+	repsCorrected.valid = true;
+
+	ActivitySummary summary;
+	summary.activityId = activityId;
+	summary.type = ACTIVITY_TYPE_PUSHUP;
+	summary.summaryAttributes.Set(ACTIVITY_ATTRIBUTE_REPS_CORRECTED, repsCorrected);
+
+	ActivitySummaryList summaries;
+	summaries.push_back(summary);
+	XCTAssert(db.CreateSummaryData(summaries));
+
+	ActivityFactory factory;
+	TaskExecutor executor(2);
+	ActivityReprocessor reprocessor;
+	XCTAssert(reprocessor.ReprocessAllFromDatabase(dbFileName, true, factory, executor, NULL, NULL));
+	XCTAssertEqual(NumActivitiesToReprocess(db), 0);
+
+	SummaryAttributeMap values;
+	XCTAssert(db.RetrieveSummaryData(activityId, values));
+
+	const ActivityAttributeType* storedReps = values.Find(ACTIVITY_ATTRIBUTE_REPS_CORRECTED);
+	XCTAssert(storedReps && storedReps->valid);
+	XCTAssertEqual(storedReps ? storedReps->value.intVal : 0, 42);
+}
+
+@end
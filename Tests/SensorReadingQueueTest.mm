@@ -0,0 +1,155 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#import <XCTest/XCTest.h>
+#import "ActivityAttribute.h"
+#import "SensorReadingQueue.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+@interface SensorReadingQueueTest : XCTestCase
+
+@end
+
+@implementation SensorReadingQueueTest
+
+static QueuedSensorReading HeartRateReading(uint64_t time, double value)
+{
+	QueuedSensorReading reading;
+	reading.type = SENSOR_TYPE_HEART_RATE;
+	reading.time = time;
+	reading.numValues = 0;
+	SensorReadingQueue::AddValue(reading, ACTIVITY_ATTRIBUTE_HEART_RATE, value);
+	return reading;
+}
+
+- (void)setUp
+{
+	// Put setup code here. This method is called before the invocation of each test method in the class.
+}
+
+- (void)tearDown
+{
+	// Put teardown code here. This method is called after the invocation of each test method in the class.
+}
+
+- (void)testEmptyAndFull
+{
+	std::unique_ptr<SensorReadingQueue> queue(new SensorReadingQueue());
+	QueuedSensorReading reading;
+
+	XCTAssert(queue->IsEmpty());
+	XCTAssertFalse(queue->Pop(reading));
+
+	for (uint64_t i = 0; i < SENSOR_READING_QUEUE_CAPACITY; ++i)
+	{
+		XCTAssert(queue->Push(HeartRateReading(i, 60.0)));
+	}
+
+	// A full queue rejects, and counts, the reading rather than blocking.
+	XCTAssertFalse(queue->Push(HeartRateReading(SENSOR_READING_QUEUE_CAPACITY, 60.0)));
+	XCTAssertEqual(queue->GetNumRejected(), 1);
+
+	// Taking one out makes room for exactly one more.
+	XCTAssert(queue->Pop(reading));
+	XCTAssertEqual(reading.time, 0);
+	XCTAssert(queue->Push(HeartRateReading(SENSOR_READING_QUEUE_CAPACITY, 60.0)));
+	XCTAssertFalse(queue->Push(HeartRateReading(SENSOR_READING_QUEUE_CAPACITY + 1, 60.0)));
+	XCTAssertEqual(queue->GetNumRejected(), 2);
+
+	for (uint64_t i = 1; i <= SENSOR_READING_QUEUE_CAPACITY; ++i)
+	{
+		XCTAssert(queue->Pop(reading));
+		XCTAssertEqual(reading.time, i);
+	}
+	XCTAssert(queue->IsEmpty());
+	XCTAssertFalse(queue->Pop(reading));
+}
+
+- (void)testWraparound
+{
+	// Several laps around the buffer, in batches that don't divide its size, so the positions wrap mid batch.
+	std::unique_ptr<SensorReadingQueue> queue(new SensorReadingQueue());
+	const uint64_t batchSize = SENSOR_READING_QUEUE_CAPACITY / 3 + 1;
+	uint64_t nextPush = 0;
+	uint64_t nextPop = 0;
+
+	while (nextPush < 5 * SENSOR_READING_QUEUE_CAPACITY)
+	{
+		for (uint64_t i = 0; i < batchSize; ++i, ++nextPush)
+		{
+			XCTAssert(queue->Push(HeartRateReading(nextPush, (double)(nextPush % 200))));
+		}
+
+		QueuedSensorReading queued;
+		while (queue->Pop(queued))
+		{
+			SensorReading reading;
+			SensorReadingQueue::ToSensorReading(queued, reading);
+
+			XCTAssertEqual(reading.type, SENSOR_TYPE_HEART_RATE);
+			XCTAssertEqual(reading.time, nextPop);
+			XCTAssertEqual(reading.reading.size(), 1);
+			XCTAssertEqualWithAccuracy(reading.reading[ACTIVITY_ATTRIBUTE_HEART_RATE], (double)(nextPop % 200), 0.001);
+			++nextPop;
+		}
+		XCTAssertEqual(nextPop, nextPush);
+		XCTAssert(queue->IsEmpty());
+	}
+	XCTAssertEqual(queue->GetNumRejected(), 0);
+}
+
+- (void)testConcurrentProducers
+{
+	// Every reading that is accepted comes out exactly once, and each producer's readings come out in order.
+	std::unique_ptr<SensorReadingQueue> queue(new SensorReadingQueue());
+	const size_t numProducers = 4;
+	const uint64_t readingsPerProducer = 4 * SENSOR_READING_QUEUE_CAPACITY;
+	std::vector<std::thread> producers;
+
+	for (size_t producer = 0; producer < numProducers; ++producer)
+	{
+		producers.push_back(std::thread([&queue, producer, readingsPerProducer]() {
+			for (uint64_t i = 0; i < readingsPerProducer; ++i)
+			{
+				while (!queue->Push(HeartRateReading(i, (double)producer)))
+				{
+					std::this_thread::yield();
+				}
+			}
+		}));
+	}
+
+	std::vector<uint64_t> nextTime(numProducers, 0);
+	uint64_t numPopped = 0;
+
+	while (numPopped < numProducers * readingsPerProducer)
+	{
+		QueuedSensorReading reading;
+		if (queue->Pop(reading))
+		{
+			size_t producer = (size_t)reading.values[0];
+			XCTAssert(producer < numProducers);
+			if (producer < numProducers)
+			{
+				XCTAssertEqual(reading.time, nextTime[producer]);
+				nextTime[producer] = reading.time + 1;
+			}
+			++numPopped;
+		}
+	}
+
+	for (auto iter = producers.begin(); iter != producers.end(); ++iter)
+	{
+		(*iter).join();
+	}
+	XCTAssert(queue->IsEmpty());
+}
+
+@end
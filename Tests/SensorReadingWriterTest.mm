@@ -0,0 +1,242 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#import <XCTest/XCTest.h>
+#import "ActivityAttribute.h"
+#import "ActivityType.h"
+#import "Database.h"
+#import "SensorReadingWriter.h"
+#import "TestDatabase.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+@interface SensorReadingWriterTest : XCTestCase
+
+@end
+
+@implementation SensorReadingWriterTest
+
+static SensorReading HeartRateReading(uint64_t time, double value)
+{
+	SensorReading reading;
+	reading.type = SENSOR_TYPE_HEART_RATE;
+	reading.time = time;
+	reading.reading.insert(SensorNameValuePair(ACTIVITY_ATTRIBUTE_HEART_RATE, value));
+	return reading;
+}
+
+static size_t NumHeartRateReadings(Database& db, const std::string& activityId)
+{
+	SensorReadingList readings;
+	db.RetrieveActivityHeartRateMonitorReadings(activityId, readings);
+	return readings.size();
+}
+
+- (void)setUp
+{
+	// Put setup code here. This method is called before the invocation of each test method in the class.
+}
+
+- (void)tearDown
+{
+	// Put teardown code here. This method is called after the invocation of each test method in the class.
+}
+
+- (void)testFlush
+{
+	// Flush doesn't wait for a partial batch to time out, and everything written before it is committed when it returns.
+	std::string dbFileName = TemporaryFileName(@"SensorReadingWriterTest.db");
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, dbFileName));
+	XCTAssert(db.StartActivity("5001", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME));
+
+	SensorReadingWriter writer;
+	XCTAssert(writer.Start(dbFileName));
+
+	const uint64_t numReadings = SENSOR_WRITER_BATCH_SIZE + 10;
+	for (uint64_t i = 0; i < numReadings; ++i)
+	{
+		XCTAssert(writer.Write("5001", HeartRateReading(TEST_START_TIME * 1000 + i * 1000, 120.0)));
+	}
+	XCTAssert(writer.Flush());
+	XCTAssertEqual(NumHeartRateReadings(db, "5001"), numReadings);
+
+	SensorWriterStats stats = writer.GetStats();
+	XCTAssertEqual(stats.numQueued, numReadings);
+	XCTAssertEqual(stats.numWritten, numReadings);
+	XCTAssertEqual(stats.numFailed, 0);
+	XCTAssertEqual(stats.queueDepth, 0);
+
+	// A flush with nothing queued returns straight away.
+	XCTAssert(writer.Flush());
+
+	writer.Stop();
+}
+
+- (void)testBackpressure
+{
+	// While another connection holds the write lock the writer can't drain its queue, so a producer that waits for room
+	// has to wait until the lock is released.
+	std::string dbFileName = TemporaryFileName(@"SensorReadingWriterTest.db");
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, dbFileName));
+	XCTAssert(db.StartActivity("5002", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME));
+
+	Database blocker;
+	XCTAssert(blocker.Open(dbFileName));
+	XCTAssert(blocker.BeginTransaction());
+	XCTAssert(blocker.StartActivity("5003", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME));
+
+	SensorReadingWriter writer;
+	XCTAssert(writer.Start(dbFileName));
+
+	const uint64_t numReadings = SENSOR_WRITER_BATCH_SIZE + SENSOR_WRITER_QUEUE_CAPACITY;
+	for (uint64_t i = 0; i < numReadings; ++i)
+	{
+		XCTAssert(writer.Write("5002", HeartRateReading(TEST_START_TIME * 1000 + i * 1000, 120.0)));
+	}
+	XCTAssert(writer.GetStats().queueDepth >= SENSOR_WRITER_QUEUE_CAPACITY);
+
+	std::atomic<bool> hasRoom(false);
+	std::thread producer([&writer, &hasRoom]() {
+		writer.WaitForRoom();
+		hasRoom = true;
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	XCTAssertFalse(hasRoom);
+
+	XCTAssert(blocker.CommitTransaction());
+	producer.join();
+	XCTAssert(hasRoom);
+
+	XCTAssert(writer.Flush());
+	XCTAssertEqual(NumHeartRateReadings(db, "5002"), numReadings);
+
+	SensorWriterStats stats = writer.GetStats();
+	XCTAssertEqual(stats.numStalls, 1);
+	XCTAssertEqual(stats.numWritten, numReadings);
+	XCTAssertEqual(stats.numFailed, 0);
+	XCTAssert(stats.maxQueueDepth >= SENSOR_WRITER_QUEUE_CAPACITY);
+
+	writer.Stop();
+}
+
+- (void)testRetryWhileLocked
+{
+	// A batch that is still locked out after the busy timeout is kept and tried again, rather than being lost.
+	std::string dbFileName = TemporaryFileName(@"SensorReadingWriterTest.db");
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, dbFileName));
+	XCTAssert(db.StartActivity("5005", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME));
+
+	Database blocker;
+	XCTAssert(blocker.Open(dbFileName));
+	XCTAssert(blocker.BeginTransaction());
+	XCTAssert(blocker.StartActivity("5006", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME));
+
+	SensorReadingWriter writer;
+	XCTAssert(writer.Start(dbFileName));
+
+	const uint64_t numReadings = SENSOR_WRITER_BATCH_SIZE;
+	for (uint64_t i = 0; i < numReadings; ++i)
+	{
+		XCTAssert(writer.Write("5005", HeartRateReading(TEST_START_TIME * 1000 + i * 1000, 120.0)));
+	}
+
+	// The first attempt gives up after the busy timeout, so wait for the writer to get to its first retry.
+	for (size_t i = 0; (i < 40) && (writer.GetStats().numRetries == 0); ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(DATABASE_BUSY_TIMEOUT_MS / 10));
+	}
+	XCTAssert(writer.GetStats().numRetries > 0);
+	XCTAssertEqual(writer.GetStats().numFailed, 0);
+	XCTAssert(blocker.CommitTransaction());
+
+	XCTAssert(writer.Flush());
+	XCTAssertEqual(NumHeartRateReadings(db, "5005"), numReadings);
+
+	SensorWriterStats stats = writer.GetStats();
+	XCTAssertEqual(stats.numWritten, numReadings);
+	XCTAssertEqual(stats.numFailed, 0);
+
+	writer.Stop();
+}
+
+- (void)testUpdateBike
+{
+	// Only the latest bike update is written, and a flush waits for it even when there are no readings.
+	std::string dbFileName = TemporaryFileName(@"SensorReadingWriterTest.db");
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, dbFileName));
+
+	Bike bike;
+	bike.id = BIKE_ID_NOT_SET;
+	bike.name = "Road";
+	bike.weightKg = 8.0;
+	bike.computedWheelCircumferenceMm = 2100.0;
+	bike.timeAdded = TEST_START_TIME;
+	bike.timeRetired = 0;
+	XCTAssert(db.CreateBike(bike));
+
+	std::vector<Bike> bikes;
+	XCTAssert(db.RetrieveBikes(bikes));
+	XCTAssertEqual(bikes.size(), 1);
+	bike = bikes.at(0);
+
+	SensorReadingWriter writer;
+	XCTAssert(writer.Start(dbFileName));
+
+	bike.computedWheelCircumferenceMm = 2105.0;
+	XCTAssert(writer.UpdateBike(bike));
+	bike.computedWheelCircumferenceMm = 2110.0;
+	XCTAssert(writer.UpdateBike(bike));
+	XCTAssert(writer.Flush());
+
+	Bike storedBike;
+	XCTAssert(db.RetrieveBike(bike.id, storedBike));
+	XCTAssertEqual(storedBike.computedWheelCircumferenceMm, 2110.0);
+
+	writer.Stop();
+	XCTAssertFalse(writer.UpdateBike(bike));
+}
+
+- (void)testStop
+{
+	// Stopping writes whatever is still queued, after which the writer refuses new readings and never blocks.
+	std::string dbFileName = TemporaryFileName(@"SensorReadingWriterTest.db");
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, dbFileName));
+	XCTAssert(db.StartActivity("5004", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME));
+
+	SensorReadingWriter writer;
+	XCTAssert(writer.Start(dbFileName));
+
+	const uint64_t numReadings = SENSOR_WRITER_BATCH_SIZE / 2;
+	for (uint64_t i = 0; i < numReadings; ++i)
+	{
+		XCTAssert(writer.Write("5004", HeartRateReading(TEST_START_TIME * 1000 + i * 1000, 120.0)));
+	}
+	writer.Stop();
+	XCTAssertEqual(NumHeartRateReadings(db, "5004"), numReadings);
+
+	XCTAssertFalse(writer.Write("5004", HeartRateReading(TEST_START_TIME * 1000 + numReadings * 1000, 120.0)));
+	XCTAssert(writer.Flush());
+	writer.WaitForRoom();
+
+	SensorWriterStats stats = writer.GetStats();
+	XCTAssertEqual(stats.numQueued, numReadings);
+	XCTAssertEqual(stats.numWritten, numReadings);
+	XCTAssertEqual(stats.queueDepth, 0);
+
+	// Stopping twice is harmless.
+	writer.Stop();
+}
+
+@end
@@ -0,0 +1,362 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#import <XCTest/XCTest.h>
+#import "ActivityAttribute.h"
+#import "ActivityType.h"
+#import "Database.h"
+#import "TestDatabase.h"
+
+#include <math.h>
+#include <vector>
+
+@interface SummaryIndexTest : XCTestCase
+
+@end
+
+@implementation SummaryIndexTest
+
+static ActivityAttributeType DoubleValue(double value, ActivityAttributeMeasureType measureType)
+{
+	ActivityAttributeType attr;
+	attr.value.doubleVal = value;
+	attr.valueType = TYPE_DOUBLE;
+	attr.measureType = measureType;
+	attr.unitSystem = UNIT_SYSTEM_METRIC;
+	attr.startTime = 0;
+	attr.endTime = 0;
+	attr.valid = true;
+	return attr;
+}
+
+static ActivityAttributeType TimeValue(time_t value)
+{
+	ActivityAttributeType attr;
+	attr.value.timeVal = value;
+	attr.valueType = TYPE_TIME;
+	attr.measureType = MEASURE_TIME;
+	attr.unitSystem = UNIT_SYSTEM_METRIC;
+	attr.startTime = 0;
+	attr.endTime = 0;
+	attr.valid = true;
+	return attr;
+}
+
+static double Total(Database& db, const std::string& activityType, const std::string& attribute)
+{
+	ActivityAttributeType total;
+	if (db.RetrieveAttributeTotal(activityType, attribute, total))
+	{
+		return total.value.doubleVal;
+	}
+	return (double)0.0;
+}
+
+// Compares the loads for the days starting at TEST_START_TIME with the same moving averages computed a day at a time.
+static bool TrainingLoadsMatch(Database& db, const std::vector<double>& dailyStress)
+{
+	TrainingLoadList loads;
+	if (!db.RetrieveTrainingLoads(TEST_START_TIME, TEST_START_TIME + dailyStress.size() * TEST_DAY, loads) || (loads.size() != dailyStress.size()))
+	{
+		return false;
+	}
+
+	double chronicLoad = (double)0.0;
+	double acuteLoad = (double)0.0;
+
+	for (size_t i = 0; i < loads.size(); ++i)
+	{
+		chronicLoad += (dailyStress[i] - chronicLoad) / TRAINING_LOAD_CHRONIC_DAYS;
+		acuteLoad += (dailyStress[i] - acuteLoad) / TRAINING_LOAD_ACUTE_DAYS;
+
+		if ((loads[i].day != (time_t)(TEST_START_TIME + i * TEST_DAY)) ||
+			(fabs(loads[i].stress - dailyStress[i]) > 0.001) ||
+			(fabs(loads[i].chronicLoad - chronicLoad) > 0.001) ||
+			(fabs(loads[i].acuteLoad - acuteLoad) > 0.001))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+- (void)setUp
+{
+	// Put setup code here. This method is called before the invocation of each test method in the class.
+}
+
+- (void)tearDown
+{
+	// Put teardown code here. This method is called after the invocation of each test method in the class.
+}
+
+- (void)testAttributeAggregates
+{
+	// The totals and records are kept up to date as summaries are written, replaced, deleted, and merged away.
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, TemporaryFileName(@"SummaryIndexTest.db")));
+
+	XCTAssert(db.StartActivity("1001", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME));
+	XCTAssert(db.StartActivity("1002", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + TEST_DAY));
+	XCTAssert(db.StartActivity("1003", "", ACTIVITY_TYPE_CYCLING, TEST_START_TIME + 2 * TEST_DAY));
+	XCTAssert(db.StartActivity("1004", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 3 * TEST_DAY));
+	XCTAssert(db.CreateSummaryData("1001", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(5.0, MEASURE_DISTANCE)));
+	XCTAssert(db.CreateSummaryData("1002", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(10.0, MEASURE_DISTANCE)));
+	XCTAssert(db.CreateSummaryData("1003", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(20.0, MEASURE_DISTANCE)));
+	XCTAssert(db.CreateSummaryData("1004", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(7.0, MEASURE_DISTANCE)));
+
+	ActivityAttributeType best;
+	std::string bestActivityId;
+
+	XCTAssertEqualWithAccuracy(Total(db, ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED), 22.0, 0.001);
+	XCTAssertEqualWithAccuracy(Total(db, "", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED), 42.0, 0.001);
+	XCTAssert(db.RetrieveBestAttributeValue(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, false, best, bestActivityId));
+	XCTAssertEqualWithAccuracy(best.value.doubleVal, 10.0, 0.001);
+	XCTAssert(bestActivityId.compare("1002") == 0);
+
+	// Replacing the record holder's value with a worse one hands the record to the next best activity.
+	XCTAssert(db.CreateSummaryData("1002", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(3.0, MEASURE_DISTANCE)));
+	XCTAssertEqualWithAccuracy(Total(db, ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED), 15.0, 0.001);
+	XCTAssert(db.RetrieveBestAttributeValue(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, false, best, bestActivityId));
+	XCTAssertEqualWithAccuracy(best.value.doubleVal, 7.0, 0.001);
+	XCTAssert(bestActivityId.compare("1004") == 0);
+	XCTAssert(db.RetrieveBestAttributeValue(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, true, best, bestActivityId));
+	XCTAssertEqualWithAccuracy(best.value.doubleVal, 3.0, 0.001);
+	XCTAssert(bestActivityId.compare("1002") == 0);
+
+	// Deleting the record holder does the same.
+	XCTAssert(db.DeleteActivity("1004"));
+	XCTAssertEqualWithAccuracy(Total(db, ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED), 8.0, 0.001);
+	XCTAssert(db.RetrieveBestAttributeValue(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, false, best, bestActivityId));
+	XCTAssertEqualWithAccuracy(best.value.doubleVal, 5.0, 0.001);
+	XCTAssert(bestActivityId.compare("1001") == 0);
+
+	// The activity that is merged away no longer counts, since its summary is deleted.
+	XCTAssert(db.MergeActivities("1002", "1001"));
+	XCTAssertEqualWithAccuracy(Total(db, ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED), 3.0, 0.001);
+	XCTAssert(db.RetrieveBestAttributeValue(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, false, best, bestActivityId));
+	XCTAssertEqualWithAccuracy(best.value.doubleVal, 3.0, 0.001);
+	XCTAssert(bestActivityId.compare("1002") == 0);
+
+	// Other activity types are left alone.
+	XCTAssertEqualWithAccuracy(Total(db, ACTIVITY_TYPE_CYCLING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED), 20.0, 0.001);
+	XCTAssertEqualWithAccuracy(Total(db, "", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED), 23.0, 0.001);
+}
+
+- (void)testPersonalRecords
+{
+	// Only the best efforts of each year are kept, so one that is trimmed has to come back when a better one goes away.
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, TemporaryFileName(@"SummaryIndexTest.db")));
+
+	const size_t numActivities = PERSONAL_RECORDS_PER_YEAR + 2;
+	const time_t yearStart = TEST_START_TIME - 152 * TEST_DAY; // January 1, 2020
+	const time_t yearEnd = yearStart + 366 * TEST_DAY;
+
+	for (size_t i = 0; i < numActivities; ++i)
+	{
+		std::string activityId = std::to_string(2000 + i);
+		XCTAssert(db.StartActivity(activityId, "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + i * TEST_DAY));
+		XCTAssert(db.CreateSummaryData(activityId, ACTIVITY_ATTRIBUTE_FASTEST_5K, TimeValue(1200 + i * 10)));
+	}
+
+	// A faster effort from the following year doesn't count towards this year's records.
+	XCTAssert(db.StartActivity("2100", "", ACTIVITY_TYPE_RUNNING, yearEnd + TEST_DAY));
+	XCTAssert(db.CreateSummaryData("2100", ACTIVITY_ATTRIBUTE_FASTEST_5K, TimeValue(1000)));
+
+	PersonalRecordList records;
+	XCTAssert(db.RetrievePersonalRecords(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_FASTEST_5K, yearStart, yearEnd, numActivities, records));
+	XCTAssertEqual(records.size(), PERSONAL_RECORDS_PER_YEAR);
+	XCTAssertEqual(records.front().value.value.timeVal, 1200);
+	XCTAssert(records.front().activityId.compare("2000") == 0);
+	XCTAssertEqual(records.back().value.value.timeVal, 1290);
+
+	records.clear();
+	XCTAssert(db.RetrievePersonalRecords(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_FASTEST_5K, 0, LONG_MAX, 1, records));
+	XCTAssertEqual(records.size(), 1);
+	XCTAssert(records.front().activityId.compare("2100") == 0);
+
+	// The best effort gets slower, so the best of the trimmed efforts takes the last place.
+	XCTAssert(db.CreateSummaryData("2000", ACTIVITY_ATTRIBUTE_FASTEST_5K, TimeValue(1500)));
+	records.clear();
+	XCTAssert(db.RetrievePersonalRecords(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_FASTEST_5K, yearStart, yearEnd, numActivities, records));
+	XCTAssertEqual(records.size(), PERSONAL_RECORDS_PER_YEAR);
+	XCTAssertEqual(records.front().value.value.timeVal, 1210);
+	XCTAssertEqual(records.back().value.value.timeVal, 1300);
+
+	// Deleting the best effort brings back the last trimmed one.
+	XCTAssert(db.DeleteActivity("2001"));
+	records.clear();
+	XCTAssert(db.RetrievePersonalRecords(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_FASTEST_5K, yearStart, yearEnd, numActivities, records));
+	XCTAssertEqual(records.size(), PERSONAL_RECORDS_PER_YEAR);
+	XCTAssertEqual(records.front().value.value.timeVal, 1220);
+	XCTAssertEqual(records.back().value.value.timeVal, 1310);
+
+	// So does merging it away, which leaves the slowed down effort in last place.
+	XCTAssert(db.MergeActivities("2011", "2002"));
+	records.clear();
+	XCTAssert(db.RetrievePersonalRecords(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_FASTEST_5K, yearStart, yearEnd, numActivities, records));
+	XCTAssertEqual(records.size(), PERSONAL_RECORDS_PER_YEAR);
+	XCTAssertEqual(records.front().value.value.timeVal, 1230);
+	XCTAssertEqual(records.back().value.value.timeVal, 1500);
+	XCTAssert(records.back().activityId.compare("2000") == 0);
+}
+
+- (void)testActivityRollups
+{
+	// The weekly, monthly, and yearly buckets are adjusted in place as activities come and go.
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, TemporaryFileName(@"SummaryIndexTest.db")));
+
+	XCTAssert(db.StartActivity("3001", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 8 * TEST_HOUR));
+	XCTAssert(db.StartActivity("3002", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 2 * TEST_DAY));
+	XCTAssert(db.StartActivity("3003", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 7 * TEST_DAY));
+	XCTAssert(db.StartActivity("3004", "", ACTIVITY_TYPE_CYCLING, TEST_START_TIME + TEST_DAY));
+	XCTAssert(db.CreateSummaryData("3001", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(5.0, MEASURE_DISTANCE)));
+	XCTAssert(db.CreateSummaryData("3001", ACTIVITY_ATTRIBUTE_ELAPSED_TIME, TimeValue(1800)));
+	XCTAssert(db.CreateSummaryData("3002", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(10.0, MEASURE_DISTANCE)));
+	XCTAssert(db.CreateSummaryData("3002", ACTIVITY_ATTRIBUTE_ELAPSED_TIME, TimeValue(3600)));
+	XCTAssert(db.CreateSummaryData("3003", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(8.0, MEASURE_DISTANCE)));
+	XCTAssert(db.CreateSummaryData("3004", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(30.0, MEASURE_DISTANCE)));
+
+	const time_t rangeEnd = TEST_START_TIME + 14 * TEST_DAY;
+	ActivityRollupList rollups;
+
+	XCTAssert(db.RetrieveActivityRollups(ROLLUP_WEEK, ACTIVITY_TYPE_RUNNING, TEST_START_TIME, rangeEnd, rollups));
+	XCTAssertEqual(rollups.size(), 2);
+	XCTAssertEqual(rollups[0].bucketStart, TEST_START_TIME);
+	XCTAssertEqual(rollups[0].activityCount, 2);
+	XCTAssertEqualWithAccuracy(rollups[0].distance, 15.0, 0.001);
+	XCTAssertEqualWithAccuracy(rollups[0].longestDistance, 10.0, 0.001);
+	XCTAssertEqualWithAccuracy(rollups[0].elapsedTime, 5400.0, 0.001);
+	XCTAssertEqual(rollups[1].bucketStart, TEST_START_TIME + 7 * TEST_DAY);
+	XCTAssertEqual(rollups[1].activityCount, 1);
+	XCTAssertEqualWithAccuracy(rollups[1].distance, 8.0, 0.001);
+
+	rollups.clear();
+	XCTAssert(db.RetrieveActivityRollups(ROLLUP_MONTH, ACTIVITY_TYPE_RUNNING, TEST_START_TIME, rangeEnd, rollups));
+	XCTAssertEqual(rollups.size(), 1);
+	XCTAssertEqual(rollups[0].activityCount, 3);
+	XCTAssertEqualWithAccuracy(rollups[0].distance, 23.0, 0.001);
+
+	// The longest distance is searched for again when the activity that held it gets shorter.
+	XCTAssert(db.CreateSummaryData("3002", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(4.0, MEASURE_DISTANCE)));
+	rollups.clear();
+	XCTAssert(db.RetrieveActivityRollups(ROLLUP_WEEK, ACTIVITY_TYPE_RUNNING, TEST_START_TIME, rangeEnd, rollups));
+	XCTAssertEqual(rollups.size(), 2);
+	XCTAssertEqualWithAccuracy(rollups[0].distance, 9.0, 0.001);
+	XCTAssertEqualWithAccuracy(rollups[0].longestDistance, 5.0, 0.001);
+
+	// And when it is deleted.
+	XCTAssert(db.DeleteActivity("3001"));
+	rollups.clear();
+	XCTAssert(db.RetrieveActivityRollups(ROLLUP_WEEK, ACTIVITY_TYPE_RUNNING, TEST_START_TIME, rangeEnd, rollups));
+	XCTAssertEqual(rollups.size(), 2);
+	XCTAssertEqual(rollups[0].activityCount, 1);
+	XCTAssertEqualWithAccuracy(rollups[0].distance, 4.0, 0.001);
+	XCTAssertEqualWithAccuracy(rollups[0].longestDistance, 4.0, 0.001);
+	XCTAssertEqualWithAccuracy(rollups[0].elapsedTime, 3600.0, 0.001);
+
+	// Merging away the only activity of the second week leaves that bucket empty, so it is dropped.
+	XCTAssert(db.MergeActivities("3002", "3003"));
+	rollups.clear();
+	XCTAssert(db.RetrieveActivityRollups(ROLLUP_WEEK, ACTIVITY_TYPE_RUNNING, TEST_START_TIME, rangeEnd, rollups));
+	XCTAssertEqual(rollups.size(), 1);
+	XCTAssertEqual(rollups[0].bucketStart, TEST_START_TIME);
+
+	rollups.clear();
+	XCTAssert(db.RetrieveActivityRollups(ROLLUP_YEAR, "", TEST_START_TIME, rangeEnd, rollups));
+	XCTAssertEqual(rollups.size(), 2);
+	for (auto iter = rollups.begin(); iter != rollups.end(); ++iter)
+	{
+		if ((*iter).activityType.compare(ACTIVITY_TYPE_CYCLING) == 0)
+		{
+			XCTAssertEqual((*iter).activityCount, 1);
+			XCTAssertEqualWithAccuracy((*iter).distance, 30.0, 0.001);
+		}
+		else
+		{
+			XCTAssertEqual((*iter).activityCount, 1);
+			XCTAssertEqualWithAccuracy((*iter).distance, 4.0, 0.001);
+		}
+	}
+}
+
+- (void)testSummaryValuesInRange
+{
+	// A rolling window can start part way through a week, and only the activities that start inside it count.
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, TemporaryFileName(@"SummaryIndexTest.db")));
+
+	XCTAssert(db.StartActivity("3101", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 2 * TEST_DAY));
+	XCTAssert(db.StartActivity("3102", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 5 * TEST_DAY));
+	XCTAssert(db.StartActivity("3103", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 9 * TEST_DAY));
+	XCTAssert(db.StartActivity("3104", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 10 * TEST_DAY));
+	XCTAssert(db.StartActivity("3105", "", ACTIVITY_TYPE_CYCLING, TEST_START_TIME + 6 * TEST_DAY));
+	XCTAssert(db.CreateSummaryData("3101", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(12.0, MEASURE_DISTANCE)));
+	XCTAssert(db.CreateSummaryData("3102", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(6.0, MEASURE_DISTANCE)));
+	XCTAssert(db.CreateSummaryData("3103", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(9.0, MEASURE_DISTANCE)));
+	XCTAssert(db.CreateSummaryData("3105", ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, DoubleValue(40.0, MEASURE_DISTANCE)));
+
+	// Thursday to the next Thursday, leaving out the Wednesday run. The one with no distance isn't counted.
+	const time_t windowStart = TEST_START_TIME + 3 * TEST_DAY;
+	const time_t windowEnd = windowStart + 7 * TEST_DAY;
+	double total = (double)0.0;
+	uint64_t count = 0;
+	double largest = (double)0.0;
+
+	XCTAssert(db.RetrieveSummaryValueTotal(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, windowStart, windowEnd, total, count));
+	XCTAssertEqualWithAccuracy(total, 15.0, 0.001);
+	XCTAssertEqual(count, 2);
+	XCTAssert(db.RetrieveLargestSummaryValue(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, windowStart, windowEnd, largest));
+	XCTAssertEqualWithAccuracy(largest, 9.0, 0.001);
+
+	XCTAssert(db.RetrieveSummaryValueTotal(ACTIVITY_TYPE_CYCLING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, windowStart, windowEnd, total, count));
+	XCTAssertEqualWithAccuracy(total, 40.0, 0.001);
+	XCTAssertEqual(count, 1);
+
+	// A window with nothing in it says so.
+	XCTAssertFalse(db.RetrieveSummaryValueTotal(ACTIVITY_TYPE_RUNNING, ACTIVITY_ATTRIBUTE_DISTANCE_TRAVELED, windowEnd, windowEnd + 7 * TEST_DAY, total, count));
+}
+
+- (void)testTrainingLoads
+{
+	// Each day's stress, and the loads of every day after it, follow the activities' training stress.
+	Database db;
+	XCTAssert(OpenEmptyDatabase(db, TemporaryFileName(@"SummaryIndexTest.db")));
+
+	XCTAssert(db.StartActivity("7001", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 8 * TEST_HOUR));
+	XCTAssert(db.StartActivity("7002", "", ACTIVITY_TYPE_CYCLING, TEST_START_TIME + 18 * TEST_HOUR));
+	XCTAssert(db.StartActivity("7003", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 2 * TEST_DAY));
+	XCTAssert(db.StartActivity("7004", "", ACTIVITY_TYPE_CYCLING, TEST_START_TIME + 5 * TEST_DAY));
+	XCTAssert(db.CreateSummaryData("7001", ACTIVITY_ATTRIBUTE_TRAINING_STRESS, DoubleValue(100.0, MEASURE_NOT_SET)));
+	XCTAssert(db.CreateSummaryData("7002", ACTIVITY_ATTRIBUTE_TRAINING_STRESS, DoubleValue(50.0, MEASURE_NOT_SET)));
+	XCTAssert(db.CreateSummaryData("7003", ACTIVITY_ATTRIBUTE_TRAINING_STRESS, DoubleValue(80.0, MEASURE_NOT_SET)));
+	XCTAssert(db.CreateSummaryData("7004", ACTIVITY_ATTRIBUTE_TRAINING_STRESS, DoubleValue(60.0, MEASURE_NOT_SET)));
+	XCTAssert(TrainingLoadsMatch(db, { 150.0, 0.0, 80.0, 0.0, 0.0, 60.0, 0.0, 0.0 }));
+
+	// Changing an activity's stress changes its day and carries through to the days after it.
+	XCTAssert(db.CreateSummaryData("7003", ACTIVITY_ATTRIBUTE_TRAINING_STRESS, DoubleValue(40.0, MEASURE_NOT_SET)));
+	XCTAssert(TrainingLoadsMatch(db, { 150.0, 0.0, 40.0, 0.0, 0.0, 60.0, 0.0, 0.0 }));
+
+	// Inside a transaction the loads are recomputed once, when it is committed.
+	XCTAssert(db.BeginTransaction());
+	XCTAssert(db.StartActivity("7005", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + TEST_DAY));
+	XCTAssert(db.CreateSummaryData("7005", ACTIVITY_ATTRIBUTE_TRAINING_STRESS, DoubleValue(30.0, MEASURE_NOT_SET)));
+	XCTAssert(db.StartActivity("7006", "", ACTIVITY_TYPE_RUNNING, TEST_START_TIME + 6 * TEST_DAY));
+	XCTAssert(db.CreateSummaryData("7006", ACTIVITY_ATTRIBUTE_TRAINING_STRESS, DoubleValue(20.0, MEASURE_NOT_SET)));
+	XCTAssert(db.CommitTransaction());
+	XCTAssert(TrainingLoadsMatch(db, { 150.0, 30.0, 40.0, 0.0, 0.0, 60.0, 20.0, 0.0 }));
+
+	// Deleted activities, and activities that are merged away, no longer count.
+	XCTAssert(db.DeleteActivity("7001"));
+	XCTAssert(TrainingLoadsMatch(db, { 50.0, 30.0, 40.0, 0.0, 0.0, 60.0, 20.0, 0.0 }));
+	XCTAssert(db.MergeActivities("7004", "7002"));
+	XCTAssert(TrainingLoadsMatch(db, { 0.0, 30.0, 40.0, 0.0, 0.0, 60.0, 20.0, 0.0 }));
+}
+
+@end
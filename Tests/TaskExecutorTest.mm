@@ -0,0 +1,158 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#import <XCTest/XCTest.h>
+#import "TaskExecutor.h"
+
+#include <atomic>
+#include <thread>
+
+@interface TaskExecutorTest : XCTestCase
+
+@end
+
+@implementation TaskExecutorTest
+
+typedef struct ProgressCounts
+{
+	std::atomic<size_t> numCalls;
+	std::atomic<size_t> lastCompleted;
+	std::atomic<size_t> lastTotal;
+} ProgressCounts;
+
+static void ProgressCallback(size_t numCompleted, size_t numTotal, void* context)
+{
+	ProgressCounts* counts = (ProgressCounts*)context;
+	++counts->numCalls;
+	counts->lastCompleted = numCompleted;
+	counts->lastTotal = numTotal;
+}
+
+- (void)setUp
+{
+	// Put setup code here. This method is called before the invocation of each test method in the class.
+}
+
+- (void)tearDown
+{
+	// Put teardown code here. This method is called after the invocation of each test method in the class.
+}
+
+- (void)testWait
+{
+	// Wait returns once every task has run, and the progress callback sees each one finish.
+	TaskExecutor executor(4);
+	ProgressCounts counts;
+	counts.numCalls = 0;
+	counts.lastCompleted = 0;
+	counts.lastTotal = 0;
+
+	const size_t numTasks = 1000;
+	std::atomic<size_t> numRun(0);
+
+	TaskGroup group(executor, ProgressCallback, &counts);
+	for (size_t i = 0; i < numTasks; ++i)
+	{
+		group.Run([&numRun] { ++numRun; });
+	}
+	group.Wait();
+
+	XCTAssertEqual(numRun.load(), numTasks);
+	XCTAssertEqual(counts.numCalls.load(), numTasks);
+	XCTAssertEqual(counts.lastCompleted.load(), numTasks);
+	XCTAssertEqual(counts.lastTotal.load(), numTasks);
+
+	// Waiting again, or on a group with nothing in it, returns straight away.
+	group.Wait();
+	TaskGroup emptyGroup(executor);
+	emptyGroup.Wait();
+}
+
+- (void)testCancel
+{
+	// The tasks that haven't started when the group is cancelled are skipped, but still count as finished.
+	TaskExecutor executor(1);
+	ProgressCounts counts;
+	counts.numCalls = 0;
+	counts.lastCompleted = 0;
+	counts.lastTotal = 0;
+
+	std::atomic<bool> started(false);
+	std::atomic<bool> release(false);
+	std::atomic<size_t> numRun(0);
+	const size_t numQueued = 100;
+
+	TaskGroup group(executor, ProgressCallback, &counts);
+
+	// Keeps the only worker busy, so everything after it stays queued.
+	group.Run([&started, &release] {
+		started = true;
+		while (!release)
+		{
+			std::this_thread::yield();
+		}
+	});
+	for (size_t i = 0; i < numQueued; ++i)
+	{
+		group.Run([&numRun] { ++numRun; });
+	}
+
+	while (!started)
+	{
+		std::this_thread::yield();
+	}
+	group.Cancel();
+	XCTAssert(group.IsCancelled());
+	XCTAssert(group.GetCancellationToken().IsCancelled());
+	release = true;
+	group.Wait();
+
+	XCTAssertEqual(numRun.load(), 0);
+	XCTAssertEqual(counts.numCalls.load(), numQueued + 1);
+	XCTAssertEqual(counts.lastCompleted.load(), numQueued + 1);
+}
+
+- (void)testNesting
+{
+	// Tasks that wait on groups of their own don't deadlock, even with more of them than there are workers,
+	// since a waiting worker runs queued tasks instead of blocking.
+	TaskExecutor executor(2);
+	const size_t numOuterTasks = 8;
+	const size_t numInnerTasks = 50;
+	std::atomic<size_t> numRun(0);
+	std::atomic<size_t> numInnerGroupsFinished(0);
+
+	TaskGroup outerGroup(executor);
+	for (size_t i = 0; i < numOuterTasks; ++i)
+	{
+		outerGroup.Run([&executor, &numRun, &numInnerGroupsFinished, numInnerTasks] {
+			std::atomic<size_t> numInnerRun(0);
+
+			TaskGroup innerGroup(executor);
+			for (size_t j = 0; j < numInnerTasks; ++j)
+			{
+				innerGroup.Run([&numRun, &numInnerRun] {
+					++numRun;
+					++numInnerRun;
+				});
+			}
+			innerGroup.Wait();
+
+			// Everything in the inner group has finished by the time its Wait returns.
+			if (numInnerRun == numInnerTasks)
+			{
+				++numInnerGroupsFinished;
+			}
+		});
+	}
+	outerGroup.Wait();
+
+	XCTAssertEqual(numRun.load(), numOuterTasks * numInnerTasks);
+	XCTAssertEqual(numInnerGroupsFinished.load(), numOuterTasks);
+}
+
+@end
@@ -0,0 +1,26 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef __TESTDATABASE__
+#define __TESTDATABASE__
+
+#import <Foundation/Foundation.h>
+#import "Database.h"
+
+#include <string>
+
+#define TEST_START_TIME 1590969600 // Monday, June 1, 2020, 00:00 UTC
+#define TEST_HOUR       3600
+#define TEST_DAY        86400
+
+/// Returns the path of a file with the given name in the test's temporary directory.
+std::string TemporaryFileName(NSString* fileName);
+
+/// Opens a new database at the given path, deleting whatever was left there by an earlier run.
+bool OpenEmptyDatabase(Database& db, const std::string& dbFileName);
+
+#endif
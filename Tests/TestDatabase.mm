@@ -0,0 +1,24 @@
+// Created by Michael Simms on 10/19/20.
+// Copyright (c) 2020 Michael J. Simms. All rights reserved.
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#import "TestDatabase.h"
+
+#include <stdio.h>
+
+std::string TemporaryFileName(NSString* fileName)
+{
+	NSURL* tempUrl = [[NSFileManager defaultManager] temporaryDirectory];
+	return std::string([[[tempUrl URLByAppendingPathComponent:fileName] path] UTF8String]);
+}
+
+bool OpenEmptyDatabase(Database& db, const std::string& dbFileName)
+{
+	remove(dbFileName.c_str());
+	remove((dbFileName + "-wal").c_str());
+	remove((dbFileName + "-shm").c_str());
+	return db.Open(dbFileName) && db.CreateTables();
+}
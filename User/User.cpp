@@ -22,8 +22,7 @@ void User::SetToDefaults()
 	m_birthDate.tm_year = 80;
 
 	time_t now = time(NULL);
-	struct tm* pToday = localtime(&now);
-	memcpy(&m_baseDate, pToday, sizeof(m_baseDate));
+	localtime_r(&now, &m_baseDate); // users are created on worker threads too, so not localtime's shared buffer
 
 	m_id                = 0;
 	m_activityLevel     = ACTIVITY_LEVEL_MODERATE;